@@ -0,0 +1,190 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <bitset>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#include "twin/bringup.h"
+#include "twin/module.h"
+#include "twin/queue.h"
+#include "twin/status.h"
+
+namespace twin {
+
+enum class AlarmType : std::uint8_t {
+  kLossOfLight,      ///< In-service output port carries no channel.
+  kAttenuationHigh,  ///< Channel attenuation at or above the threshold.
+  kTemperature,      ///< Module temperature above the high threshold.
+  kCommandFailure,   ///< Commands to a half are being rejected.
+};
+
+const char* to_string(AlarmType t);
+
+/// One reported raise or clear. `transitions` counts the underlying
+/// condition changes folded into this report, so a flapping condition shows
+/// up as one event with transitions > 1.
+struct AlarmEvent {
+  std::uint64_t seq = 0;
+  VirtualTime time = 0;
+  AlarmType type = AlarmType::kLossOfLight;
+  bool raised = false;
+  Half half = Half::kA;
+  std::uint32_t module = 0;
+  std::uint32_t object = 0;  ///< Port, channel id, or 0 for module-wide alarms.
+  std::uint32_t transitions = 0;
+  double value = 0.0;  ///< Attenuation dB, temperature C or failure count.
+};
+
+struct AlarmOptions {
+  /// A condition must hold this long before it is raised, and be absent
+  /// this long before it is cleared. Changes inside the window coalesce.
+  VirtualTime raise_hold_us = 2'000'000;
+  VirtualTime clear_hold_us = 5'000'000;
+  Attenuation attenuation_high = Attenuation::from_tenths(180);
+  double temperature_high_c = 70.0;
+  double temperature_clear_c = 65.0;
+  /// A command-failure alarm raises on the first failure and clears once
+  /// no failure has been seen for this long.
+  VirtualTime command_failure_window_us = 10'000'000;
+  /// Token bucket over published events. Events beyond it stay pending and
+  /// go out, with their latest state, as tokens return.
+  double events_per_second = 1000.0;
+  double burst = 200.0;
+  /// Ports enter service the first time they carry a channel.
+  bool auto_in_service = true;
+};
+
+struct AlarmStats {
+  std::uint64_t evaluations = 0;
+  std::uint64_t events = 0;
+  std::uint64_t deferred = 0;  ///< Emissions postponed by the rate limit.
+  std::size_t active = 0;
+  std::size_t pending = 0;
+  std::size_t tracked = 0;  ///< Conditions with state held, active or not.
+};
+
+/// A subscriber's event feed: a single-producer single-consumer ring that
+/// the engine fills without blocking. If the subscriber falls behind,
+/// events are dropped and counted rather than stalling the control path.
+class AlarmSubscription {
+ public:
+  explicit AlarmSubscription(std::size_t capacity) : queue_(capacity) {}
+
+  bool poll(AlarmEvent& out) { return queue_.try_pop(out); }
+  std::uint64_t dropped() const { return dropped_.load(std::memory_order_relaxed); }
+  /// Stops delivery; the engine skips closed subscriptions.
+  void close() { closed_.store(true, std::memory_order_release); }
+
+ private:
+  friend class AlarmEngine;
+
+  SpscQueue<AlarmEvent> queue_;
+  std::atomic<std::uint64_t> dropped_{0};
+  std::atomic<bool> closed_{false};
+};
+
+/// Evaluates alarm conditions when module state changes and publishes
+/// coalesced, rate-limited raise/clear events to subscribers.
+///
+/// The engine runs on the control path and is not itself thread-safe:
+/// attach, report_*, advance and observer callbacks must be serialised.
+/// subscribe() and each subscription's poll() may run on other threads.
+/// Attached halves must outlive the engine.
+class AlarmEngine {
+ public:
+  static constexpr std::size_t kMaxSubscribers = 16;
+
+  explicit AlarmEngine(const AlarmOptions& opts = {});
+  ~AlarmEngine();
+  AlarmEngine(const AlarmEngine&) = delete;
+  AlarmEngine& operator=(const AlarmEngine&) = delete;
+
+  /// Watches one half; its conditions are evaluated now and then on every
+  /// change it reports.
+  void attach(std::uint32_t module, Half half, WssHalf& wss);
+  /// Watches both halves of a module.
+  void attach(std::uint32_t module, TwinModule& m);
+
+  void set_in_service(std::uint32_t module, Half half, int port, bool in_service);
+
+  void report_temperature(std::uint32_t module, double celsius);
+  void report_command(std::uint32_t module, Half half, Status status);
+
+  /// Moves the virtual clock forward and emits whatever has become due.
+  void advance(VirtualTime now);
+  VirtualTime now() const { return now_; }
+
+  /// Returns a feed of every event published from now on, or nullptr if
+  /// kMaxSubscribers are already registered. Owned by the engine.
+  AlarmSubscription* subscribe(std::size_t capacity = 4096);
+
+  bool active(AlarmType type, std::uint32_t module, Half half, std::uint32_t object) const;
+  AlarmStats stats() const;
+
+ private:
+  struct Key {
+    std::uint32_t module;
+    std::uint32_t object;
+    Half half;
+    AlarmType type;
+    bool operator==(const Key&) const = default;
+  };
+  struct KeyHash {
+    std::size_t operator()(const Key& k) const {
+      std::uint64_t h = (std::uint64_t{k.module} << 32) ^ k.object;
+      h ^= (static_cast<std::uint64_t>(index_of(k.half)) << 8 | static_cast<std::uint64_t>(k.type)) << 56;
+      h *= 0x9E3779B97F4A7C15ull;
+      return static_cast<std::size_t>(h ^ (h >> 29));
+    }
+  };
+  struct State {
+    bool raw = false;
+    bool active = false;
+    bool pending = false;  ///< raw differs from what was last reported.
+    bool queued = false;   ///< Listed in pending_.
+    VirtualTime changed = 0;
+    VirtualTime expires = 0;  ///< Command failures only.
+    std::uint32_t transitions = 0;
+    double value = 0.0;
+  };
+
+  class Watch;
+  struct HalfInfo {
+    std::bitset<kNumPorts> in_service;
+    const WssHalf* wss = nullptr;
+    /// Channels whose attenuation-high condition is currently present, so a
+    /// plan replacement only looks at this half's own channels.
+    std::vector<std::uint32_t> attenuation_high;
+  };
+
+  void set_condition(const Key& key, bool raw, double value);
+  void evaluate_port(std::uint32_t module, Half half, const WssHalf& wss, int port);
+  void evaluate_channel(std::uint32_t module, Half half, const Channel& ch);
+  void evaluate_half(std::uint32_t module, Half half, const WssHalf& wss);
+  bool try_emit(const Key& key, State& st);
+  void publish(const AlarmEvent& ev);
+  HalfInfo& info(std::uint32_t module, Half half);
+
+  AlarmOptions opts_;
+  VirtualTime now_ = 0;
+  double tokens_;
+  std::uint64_t seq_ = 0;
+  AlarmStats stats_;
+
+  std::unordered_map<Key, State, KeyHash> states_;
+  std::vector<Key> pending_;
+  std::unordered_map<std::uint64_t, HalfInfo> halves_;
+  std::vector<std::unique_ptr<Watch>> watches_;
+
+  std::mutex subscribe_mu_;
+  std::array<std::unique_ptr<AlarmSubscription>, kMaxSubscribers> subs_;
+  std::atomic<std::size_t> num_subs_{0};
+};
+
+}  // namespace twin
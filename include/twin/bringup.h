@@ -0,0 +1,81 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+#include "twin/calibration.h"
+#include "twin/module.h"
+#include "twin/thread_pool.h"
+
+namespace twin {
+
+/// Virtual time in microseconds from the start of a bring-up.
+using VirtualTime = std::uint64_t;
+
+enum class ModuleState : std::uint8_t {
+  kOff,
+  kBooting,
+  kLoadingCalibration,
+  kInitialising,  ///< Ports coming up; not yet answering commands.
+  kReady,
+};
+
+const char* to_string(ModuleState s);
+
+enum class StartKind : std::uint8_t {
+  kCold,  ///< Power-on: full boot, calibration read from flash, plan lost.
+  kWarm,  ///< Controller restart: dataplane and retained calibration kept.
+};
+
+/// Phase durations of one module, in virtual microseconds.
+struct StartupTiming {
+  VirtualTime cold_boot_us = 42'000'000;
+  VirtualTime warm_boot_us = 2'500'000;
+  VirtualTime calibration_load_us = 18'000'000;
+  /// Checksum of a calibration retained across a warm start.
+  VirtualTime calibration_verify_us = 400'000;
+  VirtualTime ready_us = 300'000;
+};
+
+struct BringUpOptions {
+  StartupTiming timing;
+  StartKind kind = StartKind::kCold;
+  /// Modules the host drives through bring-up at once, taken in index
+  /// order; 0 starts every module at t = 0.
+  std::size_t max_concurrent = 0;
+};
+
+/// When each phase of one module ended.
+struct ModuleTimeline {
+  VirtualTime start = 0;
+  VirtualTime booted = 0;
+  VirtualTime calibrated = 0;
+  VirtualTime ready = 0;
+
+  ModuleState state_at(VirtualTime t) const;
+};
+
+struct BringUpReport {
+  std::vector<ModuleTimeline> timelines;
+  /// Virtual time at which the last module became ready.
+  VirtualTime makespan_us = 0;
+  std::size_t calibration_loads = 0;
+  std::size_t calibration_hits = 0;
+  double wall_seconds = 0.0;
+};
+
+/// Brings `modules` up on the virtual clock. Fetching calibrations runs in
+/// parallel on `pool`, and `cache` ensures each type is built once however
+/// many units share it. A module whose calibration matches its type, such
+/// as a unit calibrated from a CSV file, keeps it on either start; the rest
+/// get their type's. A warm start only pays the verify time for a kept
+/// calibration, and a cold start always pays the load.
+///
+/// A cold start clears both halves' plans on the calling thread, so their
+/// observers are notified there.
+BringUpReport bring_up(std::span<TwinModule> modules, CalibrationCache& cache, ThreadPool& pool,
+                       const BringUpOptions& opts = {});
+
+}  // namespace twin
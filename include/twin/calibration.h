@@ -0,0 +1,132 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+#include "twin/module.h"
+#include "twin/spectrum.h"
+#include "twin/status.h"
+#include "twin/thread_pool.h"
+
+namespace twin {
+
+/// Factory calibration of one module type, or of one unit when `serial` is
+/// set. Tables are quantised: loss in 0.001 dB steps and pixel positions in
+/// 1/16 pixel, both as uint16, about 65 KB per calibration.
+struct Calibration {
+  static constexpr double kLossStepDb = 0.001;
+  static constexpr double kPixelStep = 1.0 / 16.0;
+  /// Largest loss and pixel column the tables hold, 65.535 dB and 4095.9375.
+  static constexpr double kMaxLossDb = 65535 * kLossStepDb;
+  static constexpr double kMaxPixel = 65535 * kPixelStep;
+  using LossTable = std::array<std::uint16_t, kNumSlices>;
+  using PixelMap = std::array<std::uint16_t, kNumSlices + 1>;
+
+  std::string module_type;
+  std::string serial;
+  /// Common-to-port insertion loss per half, port and slice.
+  std::array<std::array<LossTable, kNumPorts>, kNumHalves> insertion_loss{};
+  /// Attenuation actually achieved per dB commanded, per half and port.
+  std::array<std::array<float, kNumPorts>, kNumHalves> attenuation_slope{};
+  /// LCoS pixel column at each slice edge (slice s spans edges s and s + 1).
+  std::array<PixelMap, kNumHalves> pixel_edge{};
+
+  /// Loss through `port` (1-based) of half `h` at `slice`, in dB.
+  float loss_db(Half h, int port, int slice) const {
+    return static_cast<float>(insertion_loss[index_of(h)][port - 1][slice] * kLossStepDb);
+  }
+  void set_loss_db(Half h, int port, int slice, double db) {
+    insertion_loss[index_of(h)][port - 1][slice] = quantise(db, kLossStepDb);
+  }
+  /// Pixel column of slice edge `edge` in [0, kNumSlices].
+  double pixel_at(Half h, int edge) const { return pixel_edge[index_of(h)][edge] * kPixelStep; }
+  void set_pixel(Half h, int edge, double column) {
+    pixel_edge[index_of(h)][edge] = quantise(column, kPixelStep);
+  }
+
+  /// True if `v` rounds to a step inside the uint16 range; false for
+  /// negatives and NaN.
+  static bool representable(double v, double step) { return v >= 0.0 && v / step < 65535.5; }
+
+  /// Rounds to the nearest step, clamped to the uint16 range.
+  static std::uint16_t quantise(double v, double step) {
+    const double q = v / step + 0.5;
+    if (!(q > 0.0)) return 0;
+    return q >= 65535.0 ? 65535 : static_cast<std::uint16_t>(q);
+  }
+};
+
+/// Builds the calibration tables for `module_type`. The twin has no factory
+/// data, so the tables are synthesised deterministically from the type name;
+/// this stands in for reading and expanding a calibration image.
+Calibration make_calibration(std::string_view module_type);
+
+/// Calibration text in the CSV stand-in for the vendor format, one record
+/// per line:
+///
+///   type,<module-type>
+///   serial,<unit-serial>
+///   loss,<A|B>,<port>,<slice>,<dB>
+///   slope,<A|B>,<port>,<ratio>
+///   pixel,<A|B>,<edge>,<column>
+///
+/// Blank lines and lines starting with '#' are ignored. A loss or pixel
+/// value the tables cannot hold (negative, NaN, above kMaxLossDb or
+/// kMaxPixel) or a non-finite slope is a malformed line, not clamped.
+/// Records overwrite
+/// whatever `out` already holds, so a unit file may carry only the cells
+/// that differ from its type's calibration. When a cell appears twice the
+/// later line wins.
+struct CalibrationParse {
+  Status status = Status::kOk;
+  std::size_t lines = 0;
+  std::size_t records = 0;
+  /// 1-based line of the first malformed record, 0 if none.
+  std::size_t error_line = 0;
+};
+
+/// Parses `text` in line-aligned chunks on `pool`. Chunk results are
+/// merged in file order, so the outcome does not depend on the pool.
+CalibrationParse parse_calibration_csv(std::string_view text, Calibration& out, ThreadPool& pool);
+
+/// Reads and parses a calibration file; kIoError if it cannot be read.
+CalibrationParse load_calibration_file(const std::string& path, Calibration& out,
+                                       ThreadPool& pool);
+
+/// Appends `cal` in the CSV form read by parse_calibration_csv().
+void format_calibration_csv(const Calibration& cal, std::string& out);
+
+/// Calibrations by module type. Concurrent callers asking for the same type
+/// share one load: the first builds it and the rest wait for that result.
+class CalibrationCache {
+ public:
+  std::shared_ptr<const Calibration> get(std::string_view module_type);
+
+  /// Uses `cal` for its module type instead of synthesising one. Returns
+  /// false if that type has already been loaded.
+  bool insert(std::shared_ptr<const Calibration> cal);
+
+  /// Types synthesised so far, not counting insert()ed ones, and lookups
+  /// satisfied without building.
+  std::size_t loads() const;
+  std::size_t hits() const;
+
+ private:
+  struct Entry {
+    std::once_flag once;
+    std::shared_ptr<const Calibration> cal;
+  };
+
+  mutable std::mutex mu_;
+  std::unordered_map<std::string, std::shared_ptr<Entry>> entries_;
+  std::size_t loads_ = 0;
+  std::size_t hits_ = 0;
+};
+
+}  // namespace twin
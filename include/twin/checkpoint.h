@@ -0,0 +1,137 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <string_view>
+#include <vector>
+
+#include "twin/module.h"
+#include "twin/status.h"
+
+namespace twin {
+
+struct Calibration;
+class CalibrationCache;
+
+/// Flat checkpoint of a module pool. All offsets are from the start of the
+/// blob and every section is 8-byte aligned, so a blob can be written as-is,
+/// mapped back at any address and read in place:
+///
+///   CheckpointHeader
+///   CheckpointModule[num_modules]
+///   CheckpointCalibration[num_calibrations]
+///   ChannelSpec[...]     per module, half A then half B, each padded
+///   char[...]            serial and module type per module, then per
+///                        calibration, not terminated
+///
+/// Channel records are stored in ChannelSpec's own little-endian layout, so
+/// restoring a half hands the mapped records straight to commit_plan().
+/// Modules sharing a calibration instance share one calibration record.
+struct CheckpointHeader {
+  static constexpr std::uint64_t kMagic = 0x31504B434E495754;  // "TWINCKP1"
+  /// Blobs of any other version are rejected.
+  static constexpr std::uint32_t kVersion = 2;
+
+  std::uint64_t magic = kMagic;
+  std::uint32_t version = kVersion;
+  std::uint32_t num_modules = 0;
+  std::uint64_t total_size = 0;
+  /// Over every byte after the header.
+  std::uint64_t checksum = 0;
+  std::uint32_t num_calibrations = 0;
+  std::uint32_t reserved = 0;
+};
+
+struct CheckpointModule {
+  static constexpr std::uint32_t kNoCalibration = 0xFFFFFFFF;
+
+  std::uint64_t serial_offset = 0;
+  std::uint64_t serial_size = 0;
+  std::uint64_t module_type_offset = 0;
+  std::uint64_t module_type_size = 0;
+  std::uint64_t channel_offset[kNumHalves] = {};
+  std::uint32_t channel_count[kNumHalves] = {};
+  /// Index into the calibration records, or kNoCalibration.
+  std::uint32_t calibration = kNoCalibration;
+  std::uint32_t reserved = 0;
+};
+
+/// Calibration tables in the quantised form Calibration holds them.
+struct CheckpointCalibration {
+  std::uint64_t module_type_offset = 0;
+  std::uint64_t module_type_size = 0;
+  std::uint64_t serial_offset = 0;
+  std::uint64_t serial_size = 0;
+  std::uint16_t insertion_loss[kNumHalves][kNumPorts][kNumSlices];
+  float attenuation_slope[kNumHalves][kNumPorts];
+  std::uint16_t pixel_edge[kNumHalves][kNumSlices + 1];
+};
+
+/// Read-only view over a checkpoint blob; nothing is copied or decoded.
+class CheckpointView {
+ public:
+  /// Checks magic, version, bounds, alignment and checksum.
+  static Status open(std::span<const std::byte> blob, CheckpointView& out);
+
+  std::size_t num_modules() const { return modules_.size(); }
+  std::string_view serial(std::size_t module) const;
+  std::string_view module_type(std::size_t module) const;
+  std::span<const ChannelSpec> channels(std::size_t module, Half h) const;
+  /// Calibration record of `module`, or kNoCalibration if none was saved.
+  std::uint32_t calibration_index(std::size_t module) const;
+
+  std::size_t num_calibrations() const { return calibrations_.size(); }
+  /// Decodes calibration record `index` into a Calibration.
+  std::shared_ptr<const Calibration> calibration(std::size_t index) const;
+
+ private:
+  const std::byte* base_ = nullptr;
+  std::span<const CheckpointModule> modules_;
+  std::span<const CheckpointCalibration> calibrations_;
+};
+
+/// Bytes save_checkpoint() will produce for `modules`.
+std::size_t checkpoint_size(std::span<const TwinModule> modules);
+
+/// Writes `modules` into `out`, resizing it. Reusing `out` across calls
+/// avoids reallocating.
+void save_checkpoint(std::span<const TwinModule> modules, std::vector<std::byte>& out);
+
+/// Restores one module from a view. The module's serial, type, calibration
+/// and both halves are replaced; a module saved without a calibration takes
+/// the one `cache` holds for its type. On error the module is left as it was.
+Status restore_module(const CheckpointView& view, std::size_t module, TwinModule& out,
+                      CalibrationCache& cache);
+
+/// Replaces `out` with every module in `blob`. Modules that shared a
+/// calibration when saved share one again.
+Status load_checkpoint(std::span<const std::byte> blob, std::vector<TwinModule>& out,
+                       CalibrationCache& cache);
+
+Status write_checkpoint_file(const char* path, std::span<const std::byte> blob);
+
+/// Read-only memory mapping of a checkpoint file.
+class MappedCheckpoint {
+ public:
+  MappedCheckpoint() = default;
+  ~MappedCheckpoint();
+  MappedCheckpoint(const MappedCheckpoint&) = delete;
+  MappedCheckpoint& operator=(const MappedCheckpoint&) = delete;
+
+  /// Maps `path` and validates it.
+  Status open(const char* path);
+
+  const CheckpointView& view() const { return view_; }
+  std::span<const std::byte> bytes() const { return {data_, size_}; }
+
+ private:
+  void close();
+
+  const std::byte* data_ = nullptr;
+  std::size_t size_ = 0;
+  CheckpointView view_;
+};
+
+}  // namespace twin
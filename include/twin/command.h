@@ -0,0 +1,58 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+#include "twin/module.h"
+#include "twin/status.h"
+#include "twin/wss.h"
+
+namespace twin {
+
+enum class CommandKind : std::uint8_t {
+  kAdd,
+  kDelete,
+  kRetune,
+  kAttenuate,
+  kSnapshot,
+};
+
+const char* to_string(CommandKind k);
+
+/// One operation against a half of one module in a pool. Fields a kind does
+/// not use are left at their defaults.
+struct Command {
+  CommandKind kind = CommandKind::kSnapshot;
+  Half half = Half::kA;
+  std::uint32_t module = 0;
+  ChannelId channel = 0;
+  std::uint8_t port = 0;
+  std::uint16_t first_slice = 0;
+  std::uint16_t num_slices = 0;
+  Attenuation attenuation;
+};
+
+/// Parses one line of the twin command language:
+///
+///   add      <module> <A|B> <channel> <port> <first-slice> <num-slices> [<atten-db>]
+///   del      <module> <A|B> <channel>
+///   retune   <module> <A|B> <channel> <first-slice> <num-slices>
+///   atten    <module> <A|B> <channel> <atten-db>
+///   snapshot <module> <A|B>
+///
+/// Tokens are separated by spaces or tabs. Attenuations round to the 0.1 dB
+/// step. Returns kParseError for anything else; range checks are left to
+/// validate_command().
+Status parse_command(std::string_view line, Command& out);
+
+/// Appends the text form of `c` to `out`; parse_command() reads it back.
+void format_command(const Command& c, std::string& out);
+
+/// Checks everything about `c` that does not depend on module state.
+Status validate_command(const Command& c, std::size_t num_modules);
+
+/// Applies `c` to `m`. Snapshots fill `telemetry` when it is non-null.
+Status apply_command(TwinModule& m, const Command& c, HalfTelemetry* telemetry = nullptr);
+
+}  // namespace twin
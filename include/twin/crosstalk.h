@@ -0,0 +1,128 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+#include "twin/spectrum.h"
+#include "twin/wss.h"
+
+namespace twin {
+
+/// Square matrix that is zero outside |row - col| <= bandwidth, stored as
+/// (2 * bandwidth + 1) diagonals per row.
+class BandedMatrix {
+ public:
+  BandedMatrix() = default;
+  BandedMatrix(int n, int bandwidth);
+
+  /// Symmetric Toeplitz matrix: entry (i, j) is `by_distance[|i - j|]`
+  /// and the bandwidth is by_distance.size() - 1.
+  static BandedMatrix toeplitz(int n, std::span<const double> by_distance);
+
+  int size() const { return n_; }
+  int bandwidth() const { return band_; }
+
+  /// Entry (row, col); zero outside the band.
+  double at(int row, int col) const {
+    const int d = col - row;
+    if (d < -band_ || d > band_) return 0.0;
+    return coef_[static_cast<std::size_t>(row * width() + d + band_)];
+  }
+  /// Sets an in-band entry; out-of-band writes are ignored.
+  void set(int row, int col, double v);
+
+ private:
+  int width() const { return 2 * band_ + 1; }
+
+  int n_ = 0;
+  int band_ = 0;
+  std::vector<double> coef_;
+};
+
+/// Leakage characteristics of one WSS half. Isolations are positive dB
+/// below the leaking signal.
+struct CrosstalkConfig {
+  /// Port-to-port isolation by port distance 1, 2, ...; ports further apart
+  /// are treated as fully isolated.
+  std::vector<double> port_isolation_db{38.0, 48.0};
+  /// Filter-skirt suppression by slice distance 1, 2, ... from a passband.
+  std::vector<double> skirt_isolation_db{22.0, 35.0};
+  /// Power per slice entering the common port.
+  double input_dbm_per_slice = -12.0;
+};
+
+/// In-band crosstalk per output port of one WSS half. Power routed to port q
+/// at slice s leaks into port p at slice s + d with weight
+/// port(p, q) * skirt(d); on the same port only the skirts of other channels
+/// count. Both couplings are banded, so a channel change touches
+/// (2 * port band + 1) x (num_slices + 2 * skirt band) cells instead of the
+/// whole ports x slices x ports x slices tensor.
+///
+/// The model attaches to the half as an observer and keeps itself current;
+/// it must not outlive the half. Power is accumulated in fixed point
+/// (2^-50 mW) so removing a channel cancels its contribution exactly and
+/// incremental updates never drift from a recompute.
+class CrosstalkModel : public WssObserver {
+ public:
+  explicit CrosstalkModel(WssHalf& wss, const CrosstalkConfig& config = {});
+  ~CrosstalkModel() override;
+  CrosstalkModel(const CrosstalkModel&) = delete;
+  CrosstalkModel& operator=(const CrosstalkModel&) = delete;
+
+  /// Leaked power landing inside the passbands of `port` (1-based), in mW.
+  double port_crosstalk_mw(int port) const;
+  /// Signal power leaving `port`, in mW.
+  double port_signal_mw(int port) const { return to_mw(signal_[port - 1]); }
+  /// Crosstalk relative to signal on `port` in dB, or -inf if it carries
+  /// nothing or sees no leakage.
+  double port_crosstalk_db(int port) const;
+  /// Crosstalk relative to signal for one channel, in dB. Costs
+  /// O(num_slices); -inf for an unknown channel.
+  double channel_crosstalk_db(ChannelId id) const;
+  /// Total leakage arriving at (port, slice) from all other channels, in mW.
+  double leakage_mw(int port, int slice) const {
+    return to_mw(leak_[port - 1][slice]);
+  }
+
+  /// Rebuilds everything from the half.
+  void recompute();
+
+  const BandedMatrix& port_coupling() const { return ports_; }
+
+  void on_channel_change(const WssHalf& wss, const Channel* before,
+                         const Channel* after) override;
+  void on_reset(const WssHalf& wss) override;
+
+ private:
+  using Power = std::int64_t;
+  static constexpr double kUnitsPerMw = 1125899906842624.0;  // 2^50
+
+  static Power to_units(double mw) { return static_cast<Power>(mw * kUnitsPerMw + 0.5); }
+  static double to_mw(Power p) { return static_cast<double>(p) / kUnitsPerMw; }
+
+  double slice_power(const Channel& ch) const;
+  /// Skirt weight reaching slice t from the passband [first, end); `same`
+  /// drops the passband's own centre tap.
+  double skirt_weight(int t, int first, int end, bool same) const;
+  /// Leakage a channel deposits on its own passband.
+  Power self_leak(const Channel& ch) const;
+  void add(const Channel& ch, bool remove);
+  void clear();
+
+  WssHalf* wss_;
+  BandedMatrix ports_;
+  std::vector<double> skirt_;  ///< Index 0 is the passband itself (1.0).
+  double input_mw_ = 0.0;
+
+  std::array<std::array<Power, kNumSlices>, kNumPorts> leak_{};
+  std::array<SliceBitmap, kNumPorts> occupied_{};
+  /// Sum of leak_ over occupied slices, including each channel's own skirts.
+  std::array<Power, kNumPorts> in_band_{};
+  /// Share of in_band_ that is a channel's skirts falling into itself.
+  std::array<Power, kNumPorts> self_{};
+  std::array<Power, kNumPorts> signal_{};
+};
+
+}  // namespace twin
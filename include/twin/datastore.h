@@ -0,0 +1,121 @@
+#pragma once
+
+#include <cstdint>
+#include <span>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "twin/module.h"
+#include "twin/status.h"
+#include "twin/wss.h"
+
+namespace twin {
+
+/// One `media-channel` list entry of the configuration tree.
+struct MediaChannelRow {
+  std::uint32_t module = 0;
+  Half half = Half::kA;
+  std::uint8_t port = 0;
+  ChannelId id = 0;
+  Frequency lower;
+  Frequency upper;
+  Attenuation attenuation;
+
+  Frequency center() const { return Frequency::from_mhz((lower.mhz() + upper.mhz()) / 2); }
+};
+
+/// Which access path a query used.
+enum class QueryIndex : std::uint8_t {
+  kChannelId,  ///< Hash lookup on (module, half, channel id).
+  kPortRange,  ///< Per-port list ordered by frequency.
+  kFrequency,  ///< Global list ordered by centre frequency.
+  kScan,       ///< Every row.
+};
+
+const char* to_string(QueryIndex q);
+
+struct QueryStats {
+  QueryIndex index = QueryIndex::kScan;
+  std::size_t examined = 0;
+};
+
+/// Configuration datastore mirroring module state as a YANG-shaped tree:
+///
+///   /module[id]/half[id]/port[id]/media-channel[id]
+///       lower-frequency, upper-frequency, frequency, width  (THz / GHz)
+///       attenuation                                        (dB)
+///
+/// Queries use an XPath subset. Each step may be any of the four node names,
+/// optionally preceded by `//` to skip levels, and may carry predicates
+/// `[key op value]` joined by `and`, with op one of = != < <= > >=:
+///
+///   /module[id=0]/half[id=A]/port[id=5]/media-channel[frequency>=193.1 and frequency<=193.5]
+///   //media-channel[attenuation>3]
+///   /module/half[id=B]/port/media-channel[id=17]
+///
+/// Keys are `id` on every node plus the media-channel leaves above.
+/// Frequencies (THz), widths (GHz) and attenuations (dB) are compared with
+/// the operand as given, so range bounds between stored MHz or 0.1 dB
+/// steps select correctly. Equality on
+/// module, half, port and channel id is answered from hash indexes and
+/// frequency bounds from ordered indexes, so selective queries do not walk
+/// the tree.
+class Datastore {
+ public:
+  /// Replaces the contents with the channels of `modules`.
+  void load(std::span<const TwinModule> modules);
+
+  /// Replaces the rows of one half with its current channel table.
+  void sync_half(std::uint32_t module, Half half, const WssHalf& wss);
+
+  void upsert(std::uint32_t module, Half half, const Channel& ch);
+  void erase(std::uint32_t module, Half half, ChannelId id);
+
+  std::size_t size() const { return rows_.size() - free_.size(); }
+
+  /// Runs an XPath-lite query. Matching rows are appended to `out` in
+  /// ascending frequency when an ordered index is used. kParseError for a
+  /// malformed path or an `id=` operand outside its key's range (negative,
+  /// or above the module, port or channel id type).
+  Status query(std::string_view xpath, std::vector<const MediaChannelRow*>& out,
+               QueryStats* stats = nullptr) const;
+
+  /// Canonical path of a row, e.g. /module[id=0]/half[id=A]/port[id=5]/media-channel[id=12].
+  static std::string path_of(const MediaChannelRow& r);
+
+  /// Renders rows as a JSON `media-channel` list.
+  static std::string to_json(std::span<const MediaChannelRow* const> rows);
+
+ private:
+  using RowId = std::uint32_t;
+
+  static std::uint64_t port_key(std::uint32_t module, Half half, int port) {
+    return (static_cast<std::uint64_t>(module) << 16) | (index_of(half) << 8) |
+           static_cast<std::uint64_t>(port);
+  }
+  static std::uint64_t id_key(std::uint32_t module, Half half, ChannelId id) {
+    return (static_cast<std::uint64_t>(module) << 33) |
+           (static_cast<std::uint64_t>(index_of(half)) << 32) | id;
+  }
+
+  /// Adds a row to the storage, id and port indexes; not to by_freq_.
+  RowId add_row(const MediaChannelRow& r);
+  void insert_row(const MediaChannelRow& r);
+  void remove_row(RowId id);
+  /// by_freq_ order: centre, then row id, so every row has one position.
+  bool freq_before(RowId a, RowId b) const;
+
+  std::vector<MediaChannelRow> rows_;
+  std::vector<char> live_;
+  std::vector<RowId> free_;
+  std::unordered_map<std::uint64_t, RowId> by_id_;
+  /// Rows of each port sorted by lower edge. Channels on one half never
+  /// overlap, so this is also upper-edge and centre order.
+  std::unordered_map<std::uint64_t, std::vector<RowId>> by_port_;
+  /// Live rows sorted by centre, kept in order as rows come and go.
+  std::vector<RowId> by_freq_;
+};
+
+}  // namespace twin
@@ -0,0 +1,81 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <span>
+
+#include "twin/spectrum.h"
+#include "twin/wss.h"
+
+namespace twin {
+
+/// Free-block statistics of one occupancy bitmap, updated per block split
+/// or merge and read in O(1).
+class FreeBlockStats {
+ public:
+  FreeBlockStats() = default;
+
+  int free_slices() const { return free_slices_; }
+  int free_blocks() const { return free_blocks_; }
+  int largest_free_block() const { return largest_; }
+  /// Number of free blocks exactly `len` slices wide.
+  int blocks_of_size(int len) const { return count_[static_cast<std::size_t>(len)]; }
+  /// Index i holds the number of free blocks of i slices (index 0 unused).
+  std::span<const std::uint16_t> histogram() const { return count_; }
+
+  /// Shannon entropy of the free-block size distribution weighted by
+  /// slices, -sum (b/F) ln(b/F), in nats.
+  double entropy() const;
+  /// entropy() / ln(free_slices): 0 for a single free block, 1 when every
+  /// free slice is isolated.
+  double fragmentation_index() const;
+
+  void add_block(int len);
+  void remove_block(int len);
+  /// Rebuilds from a bitmap (set = used).
+  void assign(const SliceBitmap& used);
+
+ private:
+  // b ln b per block, summed in fixed point (2^-40) so repeated splits and
+  // merges cancel exactly.
+  static constexpr double kScale = 1099511627776.0;
+
+  std::array<std::uint16_t, kNumSlices + 1> count_{};
+  /// Bit i set when count_[i] > 0, to find the next largest size quickly.
+  std::array<std::uint64_t, (kNumSlices + 64) / 64> nonzero_{};
+  int free_slices_ = 0;
+  int free_blocks_ = 0;
+  int largest_ = 0;
+  std::int64_t xlogx_ = 0;
+};
+
+/// Fragmentation of one WSS half, kept current through WssObserver. The
+/// common scope covers what any port can still be given. Each port scope
+/// covers that port's own assignments, i.e. the view of the fibre behind it.
+class FragmentationTracker : public WssObserver {
+ public:
+  /// Must not outlive `wss`.
+  explicit FragmentationTracker(WssHalf& wss);
+  ~FragmentationTracker() override;
+  FragmentationTracker(const FragmentationTracker&) = delete;
+  FragmentationTracker& operator=(const FragmentationTracker&) = delete;
+
+  const FreeBlockStats& common() const { return stats_[0]; }
+  /// Stats for output `port` (1-based).
+  const FreeBlockStats& port(int port) const { return stats_[static_cast<std::size_t>(port)]; }
+
+  void on_channel_change(const WssHalf& wss, const Channel* before,
+                         const Channel* after) override;
+  void on_reset(const WssHalf& wss) override;
+
+ private:
+  void allocate(std::size_t scope, int first, int count);
+  void release(std::size_t scope, int first, int count);
+  void rebuild();
+
+  WssHalf* wss_;
+  std::array<SliceBitmap, kNumPorts + 1> used_{};
+  std::array<FreeBlockStats, kNumPorts + 1> stats_{};
+};
+
+}  // namespace twin
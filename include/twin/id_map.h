@@ -0,0 +1,55 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+#include "twin/spectrum.h"
+
+namespace twin {
+
+/// Map from channel id to position in a WSS half's channel table. A half
+/// holds at most kNumSlices channels, so the slots live inline and the map
+/// never allocates. Linear probing with backward-shift deletion keeps
+/// lookups short without tombstones.
+class ChannelIdMap {
+ public:
+  static constexpr int kBits = 10;
+  static constexpr std::size_t kCapacity = std::size_t{1} << kBits;
+  static_assert(kCapacity * 3 / 4 >= static_cast<std::size_t>(kNumSlices),
+                "load factor must stay at or below 3/4");
+
+  /// Position of `id`, or -1.
+  int find(std::uint32_t id) const {
+    for (std::size_t i = home(id);; i = (i + 1) & kMask) {
+      const Slot& s = slots_[i];
+      if (!s.used) return -1;
+      if (s.id == id) return s.pos;
+    }
+  }
+  bool contains(std::uint32_t id) const { return find(id) >= 0; }
+
+  /// Inserts or updates `id`. Returns false if it was already present.
+  bool insert(std::uint32_t id, std::size_t pos);
+  /// Removes `id`. Returns false if it was absent.
+  bool erase(std::uint32_t id);
+  void clear();
+
+  std::size_t size() const { return size_; }
+
+ private:
+  static constexpr std::size_t kMask = kCapacity - 1;
+
+  struct Slot {
+    std::uint32_t id = 0;
+    std::uint16_t pos = 0;
+    std::uint16_t used = 0;
+  };
+
+  static std::size_t home(std::uint32_t id) { return (id * 0x9E3779B1u) >> (32 - kBits); }
+
+  std::array<Slot, kCapacity> slots_{};
+  std::size_t size_ = 0;
+};
+
+}  // namespace twin
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <cstdint>
+#include <span>
+#include <vector>
+
+namespace twin {
+
+/// Disjoint slice intervals [first, end) kept in a flat vector sorted by
+/// `first`. Because intervals never overlap, the entries overlapping any
+/// range are contiguous, so both stabbing and overlap queries are a binary
+/// search.
+class IntervalIndex {
+ public:
+  struct Entry {
+    std::uint16_t first = 0;
+    std::uint16_t end = 0;  ///< One past the last slice.
+    std::uint32_t id = 0;
+  };
+
+  /// Inserts `e`; the caller guarantees it overlaps no existing entry.
+  void insert(const Entry& e);
+  /// Removes the entry starting at `first`. Returns false if there is none.
+  bool erase(std::uint16_t first);
+  void clear() { entries_.clear(); }
+  void reserve(std::size_t n) { entries_.reserve(n); }
+
+  /// Entry containing `slice`, or nullptr.
+  const Entry* stab(int slice) const;
+
+  /// Entries overlapping [first, first + count), in ascending order.
+  std::span<const Entry> overlapping(int first, int count) const;
+
+  std::span<const Entry> entries() const { return entries_; }
+  std::size_t size() const { return entries_.size(); }
+
+ private:
+  std::vector<Entry> entries_;
+};
+
+}  // namespace twin
@@ -0,0 +1,123 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <bit>
+#include <cstdint>
+#include <string>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#else
+#include <chrono>
+#endif
+
+namespace twin {
+
+/// Public twin operations with latency tracking.
+enum class Op : std::uint8_t {
+  kAdd,
+  kDelete,
+  kRetune,
+  kAttenuate,
+  kPlanCommit,
+  kTelemetrySnapshot,
+  kCount,
+};
+
+inline constexpr int kNumOps = static_cast<int>(Op::kCount);
+
+const char* to_string(Op op);
+
+/// Log-linear histogram in the style of HdrHistogram: each power of two is
+/// split into 32 linear sub-buckets, so any recorded value is reported within
+/// about 3% of its true value.
+class LatencyHistogram {
+ public:
+  static constexpr int kSubBits = 5;
+  static constexpr int kSub = 1 << kSubBits;
+  static constexpr int kMaxExponent = 47;
+  static constexpr int kBuckets = (kMaxExponent - kSubBits + 2) * kSub;
+
+  static int bucket_of(std::uint64_t v) {
+    if (v < static_cast<std::uint64_t>(kSub)) return static_cast<int>(v);
+    int e = std::bit_width(v) - 1;
+    if (e > kMaxExponent) return kBuckets - 1;
+    const int group = e - kSubBits + 1;
+    return group * kSub + static_cast<int>((v >> (e - kSubBits)) - kSub);
+  }
+
+  /// Smallest value that lands in bucket `b`.
+  static std::uint64_t bucket_lower(int b) {
+    if (b < 2 * kSub) return static_cast<std::uint64_t>(b);
+    const int group = b / kSub;
+    return static_cast<std::uint64_t>(kSub + b % kSub) << (group - 1);
+  }
+
+  void record(std::uint64_t v) { ++counts_[bucket_of(v)]; }
+  void add_bucket(int b, std::uint64_t n) { counts_[b] += n; }
+  void merge(const LatencyHistogram& o);
+  void reset() { counts_.fill(0); }
+
+  std::uint64_t count() const;
+  /// Value at percentile `p` in [0, 100], as the midpoint of its bucket.
+  std::uint64_t percentile(double p) const;
+  std::uint64_t min() const;
+  std::uint64_t max() const;
+  double mean() const;
+
+  const std::array<std::uint64_t, kBuckets>& counts() const { return counts_; }
+
+ private:
+  std::array<std::uint64_t, kBuckets> counts_{};
+};
+
+namespace metrics {
+
+/// Raw timestamp. On x86 this is the TSC and is converted to nanoseconds only
+/// when histograms are read.
+inline std::uint64_t now_ticks() {
+#if defined(__x86_64__) || defined(__i386__)
+  return __rdtsc();
+#else
+  return static_cast<std::uint64_t>(
+      std::chrono::steady_clock::now().time_since_epoch().count());
+#endif
+}
+
+extern std::atomic<bool> g_enabled;
+
+inline bool enabled() { return g_enabled.load(std::memory_order_relaxed); }
+void set_enabled(bool on);
+
+/// Adds one sample of `ticks` to the calling thread's histogram for `op`.
+void record(Op op, std::uint64_t ticks);
+
+/// Merges every thread's samples for `op`, in nanoseconds.
+LatencyHistogram collect(Op op);
+
+/// Clears all recorded samples.
+void reset();
+
+std::string report_text();
+std::string report_json();
+
+}  // namespace metrics
+
+/// Times the enclosing scope as one call of `op`.
+class ScopedLatency {
+ public:
+  explicit ScopedLatency(Op op) : op_(op), start_(metrics::enabled() ? metrics::now_ticks() : 0) {}
+  ~ScopedLatency() {
+    if (start_ != 0) metrics::record(op_, metrics::now_ticks() - start_);
+  }
+
+  ScopedLatency(const ScopedLatency&) = delete;
+  ScopedLatency& operator=(const ScopedLatency&) = delete;
+
+ private:
+  Op op_;
+  std::uint64_t start_;
+};
+
+}  // namespace twin
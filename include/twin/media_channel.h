@@ -0,0 +1,134 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <unordered_map>
+#include <vector>
+
+#include "twin/id_map.h"
+#include "twin/spectrum.h"
+#include "twin/status.h"
+#include "twin/units.h"
+#include "twin/wss.h"
+
+namespace twin {
+
+using NmcId = std::uint32_t;
+
+/// A network media channel: one signal, such as a super-channel sub-carrier,
+/// carried inside a media channel. The media channel is the WSS passband,
+/// i.e. one of the half's channels.
+struct NetworkMediaChannel {
+  NmcId id = 0;
+  ChannelId media_channel = 0;
+  Frequency lower;
+  Frequency upper;
+};
+
+/// Two-level hierarchy of one WSS half: each output port holds media
+/// channels, and each media channel holds network media channels. Media
+/// channels are the half's own channels, followed as an observer; network
+/// media channels are added here.
+///
+/// Nodes live in flat slot arrays and link to their parent and siblings by
+/// slot index. Finding a parent or a child count is O(1) after the id
+/// lookup, and walking a media channel's children touches only those
+/// children. Children are kept in frequency order, so adding sub-carriers
+/// in ascending order costs O(1) each.
+///
+/// Retuning a media channel moves its network media channels by the change
+/// in centre frequency. Any that no longer fit inside the new passband are
+/// evicted, and all of them are evicted when the media channel is deleted.
+/// The hierarchy must not outlive the half.
+class MediaChannelHierarchy : public WssObserver {
+ public:
+  explicit MediaChannelHierarchy(WssHalf& wss);
+  ~MediaChannelHierarchy() override;
+  MediaChannelHierarchy(const MediaChannelHierarchy&) = delete;
+  MediaChannelHierarchy& operator=(const MediaChannelHierarchy&) = delete;
+
+  /// Adds signal `id` over [lower, upper) inside media channel `mc`.
+  /// kInvalidRange if it is empty or leaves the passband, kSliceConflict
+  /// if it overlaps another signal of the same media channel.
+  Status add(ChannelId mc, NmcId id, Frequency lower, Frequency upper);
+  Status remove(NmcId id);
+  /// Removes every network media channel of `mc`; returns how many.
+  std::size_t remove_children(ChannelId mc);
+
+  const NetworkMediaChannel* find(NmcId id) const;
+  /// Media channel carrying `id`, or nullptr.
+  const Channel* parent(NmcId id) const;
+  std::size_t num_children(ChannelId mc) const;
+  std::size_t num_media_channels(int port) const { return port_count_[port - 1]; }
+  std::size_t size() const { return nmc_index_.size(); }
+  /// Network media channels dropped by media channel changes so far.
+  std::uint64_t evicted() const { return evicted_; }
+
+  /// Calls `fn(const NetworkMediaChannel&)` for each child of `mc`, in
+  /// ascending frequency.
+  template <typename Fn>
+  void for_each_child(ChannelId mc, Fn&& fn) const {
+    const int slot = mc_index_.find(mc);
+    if (slot < 0) return;
+    for (std::uint32_t n = mcs_[slot].first_child; n != kNone; n = nmcs_[n].next) {
+      fn(nmcs_[n].nmc);
+    }
+  }
+
+  /// Calls `fn(const Channel&)` for each media channel on `port` (1-based).
+  template <typename Fn>
+  void for_each_media_channel(int port, Fn&& fn) const {
+    for (std::uint32_t m = port_head_[port - 1]; m != kNone; m = mcs_[m].next) {
+      fn(*wss_->find(mcs_[m].id));
+    }
+  }
+
+  void on_channel_change(const WssHalf& wss, const Channel* before,
+                         const Channel* after) override;
+  void on_reset(const WssHalf& wss) override;
+
+ private:
+  static constexpr std::uint32_t kNone = std::numeric_limits<std::uint32_t>::max();
+
+  struct McNode {
+    ChannelId id = 0;
+    std::uint8_t port = 0;
+    bool live = false;
+    std::uint16_t first_slice = 0;
+    std::uint16_t num_slices = 0;
+    std::uint32_t prev = kNone;  ///< Siblings on the same port.
+    std::uint32_t next = kNone;
+    std::uint32_t first_child = kNone;
+    std::uint32_t last_child = kNone;
+    std::uint32_t children = 0;
+  };
+
+  struct NmcNode {
+    NetworkMediaChannel nmc;
+    std::uint32_t parent = kNone;
+    std::uint32_t prev = kNone;  ///< Siblings in frequency order.
+    std::uint32_t next = kNone;
+  };
+
+  void add_media_channel(const Channel& ch);
+  void drop_media_channel(std::uint32_t m);
+  void update_media_channel(std::uint32_t m, const Channel& ch);
+  void link_port(std::uint32_t m);
+  void unlink_port(std::uint32_t m);
+  void unlink_child(std::uint32_t n);
+
+  WssHalf* wss_;
+  std::vector<McNode> mcs_;
+  std::vector<std::uint32_t> free_mcs_;
+  ChannelIdMap mc_index_;
+  std::array<std::uint32_t, kNumPorts> port_head_;
+  std::array<std::uint32_t, kNumPorts> port_count_{};
+  std::vector<NmcNode> nmcs_;
+  std::vector<std::uint32_t> free_nmcs_;
+  std::unordered_map<NmcId, std::uint32_t> nmc_index_;
+  std::uint64_t evicted_ = 0;
+};
+
+}  // namespace twin
@@ -0,0 +1,76 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <utility>
+
+#include "twin/wss.h"
+
+namespace twin {
+
+/// The NSP00700 packages two independent 1x20 WSS in one module.
+enum class Half : std::uint8_t { kA = 0, kB = 1 };
+
+inline constexpr int kNumHalves = 2;
+
+/// Part number assumed when none is given.
+inline constexpr const char* kDefaultModuleType = "NSP00700-02";
+
+struct Calibration;
+
+inline int index_of(Half h) { return static_cast<int>(h); }
+const char* to_string(Half h);
+
+struct PortTelemetry {
+  std::uint16_t channels = 0;
+  std::uint16_t used_slices = 0;
+  Attenuation max_attenuation;
+};
+
+struct HalfTelemetry {
+  std::array<PortTelemetry, kNumPorts> ports{};
+  std::uint16_t channels = 0;
+  std::uint16_t used_slices = 0;
+};
+
+struct TelemetrySnapshot {
+  std::array<HalfTelemetry, kNumHalves> halves{};
+};
+
+/// Digital twin of one twin 1x20 WSS module.
+class TwinModule {
+ public:
+  TwinModule() = default;
+  explicit TwinModule(std::string serial) : serial_(std::move(serial)) {}
+
+  WssHalf& half(Half h) { return halves_[index_of(h)]; }
+  const WssHalf& half(Half h) const { return halves_[index_of(h)]; }
+
+  const std::string& serial() const { return serial_; }
+  void set_serial(std::string serial) { serial_ = std::move(serial); }
+
+  const std::string& module_type() const { return module_type_; }
+  void set_module_type(std::string type) { module_type_ = std::move(type); }
+
+  /// Factory calibration for this module's type, or null before bring-up.
+  /// Units of the same type share one instance.
+  const Calibration* calibration() const { return calibration_.get(); }
+  void set_calibration(std::shared_ptr<const Calibration> cal) { calibration_ = std::move(cal); }
+
+  /// Fills `out` with the current per-port state of both halves.
+  void snapshot(TelemetrySnapshot& out) const;
+  /// Fills `out` with the current per-port state of one half.
+  void snapshot(Half h, HalfTelemetry& out) const;
+
+ private:
+  static void fill(const WssHalf& wss, HalfTelemetry& t);
+
+  std::string serial_;
+  std::string module_type_ = kDefaultModuleType;
+  std::shared_ptr<const Calibration> calibration_;
+  std::array<WssHalf, kNumHalves> halves_{};
+};
+
+}  // namespace twin
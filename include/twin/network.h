@@ -0,0 +1,74 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <deque>
+#include <span>
+#include <string>
+#include <vector>
+
+#include "twin/module.h"
+#include "twin/spectrum.h"
+
+namespace twin {
+
+using NodeId = std::uint32_t;
+using LinkId = std::uint32_t;
+
+inline constexpr LinkId kInvalidLink = ~LinkId{0};
+
+/// Directed fibre from an output port of one module's WSS half to another
+/// module.
+struct Link {
+  NodeId from = 0;
+  NodeId to = 0;
+  Half half = Half::kA;
+  std::uint8_t port = 0;
+  double length_km = 1.0;
+};
+
+using Path = std::vector<LinkId>;
+
+/// A network whose nodes are twin modules. Modules have stable addresses for
+/// the lifetime of the network.
+class Network {
+ public:
+  NodeId add_node(std::string serial);
+
+  /// Wires output `port` of `half` on node `from` to node `to`. Returns
+  /// kInvalidLink if a node or port is out of range or the port is taken.
+  LinkId add_link(NodeId from, NodeId to, Half half, int port, double length_km = 1.0);
+
+  std::size_t num_nodes() const { return modules_.size(); }
+  std::size_t num_links() const { return links_.size(); }
+
+  TwinModule& module(NodeId n) { return modules_[n]; }
+  const TwinModule& module(NodeId n) const { return modules_[n]; }
+  const Link& link(LinkId l) const { return links_[l]; }
+  std::span<const LinkId> out_links(NodeId n) const { return out_[n]; }
+
+  /// Slices that cannot carry a new channel on `l`. A 1xN WSS steers each
+  /// slice to a single port, so this is the common-port occupancy of the
+  /// egress half, which includes the egress port's own occupancy.
+  const SliceBitmap& blocked(LinkId l) const {
+    const Link& k = links_[l];
+    return modules_[k.from].half(k.half).common_occupancy();
+  }
+
+  double path_length_km(const Path& p) const;
+
+  /// Up to `k` loop-free paths from `src` to `dst` in ascending length
+  /// (Yen's algorithm; ties broken by hop count).
+  std::vector<Path> k_shortest_paths(NodeId src, NodeId dst, std::size_t k) const;
+
+ private:
+  Path shortest_path(NodeId src, NodeId dst, const std::vector<char>& banned_links,
+                     const std::vector<char>& banned_nodes) const;
+
+  std::deque<TwinModule> modules_;
+  std::vector<Link> links_;
+  std::vector<std::vector<LinkId>> out_;
+  std::vector<std::array<std::array<LinkId, kNumPorts>, kNumHalves>> port_links_;
+};
+
+}  // namespace twin
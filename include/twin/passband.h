@@ -0,0 +1,120 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <unordered_map>
+#include <vector>
+
+#include "twin/network.h"
+#include "twin/wss.h"
+
+namespace twin {
+
+using LightpathId = std::uint32_t;
+
+struct PassbandConfig {
+  /// Width of the WSS optical transfer function; each filter edge is an erf
+  /// with sigma = otf / (2 sqrt(2 ln 2)).
+  double otf_bandwidth_ghz = 10.4;
+  /// Frequency samples per 6.25 GHz slice.
+  int samples_per_slice = 8;
+};
+
+struct PassbandResult {
+  bool connected = false;
+  /// First hop whose WSS does not pass the channel; -1 when connected.
+  int blocked_hop = -1;
+  /// Slice block at the first hop, which sets the evaluation window.
+  double nominal_bandwidth_ghz = 0.0;
+  /// Cascade width 3 dB below its own peak.
+  double bandwidth_3db_ghz = 0.0;
+  /// Loss of the cascade at its peak, from filtering alone.
+  double peak_loss_db = 0.0;
+};
+
+struct CascadeStats {
+  std::uint64_t lightpaths_evaluated = 0;
+  std::uint64_t hops_evaluated = 0;
+};
+
+/// Filter narrowing of lightpaths that cross chains of WSS twins. A
+/// lightpath is a network path and the channel id it uses on every hop, as
+/// RsaSolver::provision sets it up. Each hop filters the channel with the
+/// slice block that hop's WSS passes, and the cascade is the product of the
+/// hop transfer functions.
+///
+/// Per-hop partial products are kept for every lightpath. A channel change
+/// on a hop marks the lightpaths through it dirty from that hop onward, and
+/// update() recomputes only those suffixes. Attenuation-only changes do not
+/// touch the shape and are ignored. Not thread-safe; the network must
+/// outlive the evaluator.
+class CascadeEvaluator {
+ public:
+  explicit CascadeEvaluator(Network& net, const PassbandConfig& config = {});
+  ~CascadeEvaluator();
+  CascadeEvaluator(const CascadeEvaluator&) = delete;
+  CascadeEvaluator& operator=(const CascadeEvaluator&) = delete;
+
+  const PassbandConfig& config() const { return config_; }
+
+  /// Tracks channel `id` along `path`; results are ready after update().
+  /// Ids of removed lightpaths are handed out again.
+  LightpathId add_lightpath(const Path& path, ChannelId id);
+  /// Does nothing for an unknown or already removed id.
+  void remove_lightpath(LightpathId lp);
+
+  /// Re-evaluates every lightpath with a dirty hop.
+  void update();
+
+  const PassbandResult& result(LightpathId lp) const { return paths_[lp].result; }
+  /// Linear cascade transmission over the evaluation window, one value per
+  /// sample. Empty unless the lightpath is connected.
+  std::span<const float> transmission(LightpathId lp) const;
+
+  std::size_t num_lightpaths() const { return live_; }
+  std::size_t num_dirty() const { return dirty_.size(); }
+  const CascadeStats& stats() const { return stats_; }
+
+ private:
+  class Watch;
+  struct Hop {
+    NodeId node = 0;
+    Half half = Half::kA;
+    std::uint8_t port = 0;
+  };
+  struct Lightpath {
+    std::vector<Hop> hops;
+    ChannelId id = 0;
+    bool live = false;
+    bool queued = false;
+    int first_slice = 0;
+    int num_samples = 0;
+    /// Rows [0, valid) of `prefix` hold the products through each hop.
+    std::size_t valid = 0;
+    std::vector<float> prefix;
+    PassbandResult result;
+  };
+
+  void mark_dirty(LightpathId lp, std::size_t hop);
+  void evaluate(Lightpath& p);
+  Watch& watch(NodeId node, Half half);
+
+  Network& net_;
+  PassbandConfig config_;
+  double sample_ghz_;
+  /// Edge response E(d) = 0.5 (1 + erf(...)) at sample offset d from an
+  /// edge, padded with 0 and 1 far enough that any hop row is a contiguous
+  /// slice of it.
+  std::vector<float> edge_;
+  std::ptrdiff_t edge_zero_ = 0;
+
+  std::vector<Lightpath> paths_;
+  std::vector<LightpathId> free_paths_;
+  std::vector<LightpathId> dirty_;
+  std::size_t live_ = 0;
+  std::unordered_map<std::uint64_t, std::unique_ptr<Watch>> watches_;
+  CascadeStats stats_;
+};
+
+}  // namespace twin
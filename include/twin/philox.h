@@ -0,0 +1,91 @@
+#pragma once
+
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <numbers>
+
+namespace twin {
+
+/// Philox4x32-10 counter-based generator (Salmon et al., SC'11). The output
+/// is a pure function of (key, counter), so any draw of any stream can be
+/// produced independently of every other, on any thread.
+class Philox4x32 {
+ public:
+  using Block = std::array<std::uint32_t, 4>;
+
+  explicit Philox4x32(std::uint64_t key)
+      : key_{static_cast<std::uint32_t>(key), static_cast<std::uint32_t>(key >> 32)} {}
+
+  Block operator()(Block ctr) const {
+    std::array<std::uint32_t, 2> k = key_;
+    for (int r = 0; r < 10; ++r) {
+      const std::uint64_t p0 = std::uint64_t{kM0} * ctr[0];
+      const std::uint64_t p1 = std::uint64_t{kM1} * ctr[2];
+      ctr = {static_cast<std::uint32_t>(p1 >> 32) ^ ctr[1] ^ k[0], static_cast<std::uint32_t>(p1),
+             static_cast<std::uint32_t>(p0 >> 32) ^ ctr[3] ^ k[1], static_cast<std::uint32_t>(p0)};
+      k[0] += kW0;
+      k[1] += kW1;
+    }
+    return ctr;
+  }
+
+ private:
+  static constexpr std::uint32_t kM0 = 0xD2511F53;
+  static constexpr std::uint32_t kM1 = 0xCD9E8D57;
+  static constexpr std::uint32_t kW0 = 0x9E3779B9;
+  static constexpr std::uint32_t kW1 = 0xBB67AE85;
+
+  std::array<std::uint32_t, 2> key_;
+};
+
+/// Sequential draws from one Philox stream. Stream `s` of seed `k` yields
+/// the same sequence wherever and whenever it is constructed.
+class PhiloxStream {
+ public:
+  PhiloxStream(std::uint64_t seed, std::uint64_t stream) : gen_(seed), stream_(stream) {}
+
+  std::uint32_t next_u32() {
+    if (used_ == 4) refill();
+    return buf_[used_++];
+  }
+
+  /// Uniform in [0, 1) with 53 random bits.
+  double uniform() {
+    const std::uint64_t hi = next_u32() >> 5;
+    const std::uint64_t lo = next_u32() >> 6;
+    return static_cast<double>((hi << 26) | lo) * 0x1.0p-53;
+  }
+
+  /// Standard normal by Box-Muller; both variates of a pair are used.
+  double normal() {
+    if (has_spare_) {
+      has_spare_ = false;
+      return spare_;
+    }
+    const double u1 = 1.0 - uniform();  // (0, 1]
+    const double u2 = uniform();
+    const double r = std::sqrt(-2.0 * std::log(u1));
+    spare_ = r * std::sin(2.0 * std::numbers::pi * u2);
+    has_spare_ = true;
+    return r * std::cos(2.0 * std::numbers::pi * u2);
+  }
+
+ private:
+  void refill() {
+    buf_ = gen_({static_cast<std::uint32_t>(counter_), static_cast<std::uint32_t>(counter_ >> 32),
+                 static_cast<std::uint32_t>(stream_), static_cast<std::uint32_t>(stream_ >> 32)});
+    ++counter_;
+    used_ = 0;
+  }
+
+  Philox4x32 gen_;
+  std::uint64_t stream_;
+  std::uint64_t counter_ = 0;
+  Philox4x32::Block buf_{};
+  int used_ = 4;
+  bool has_spare_ = false;
+  double spare_ = 0.0;
+};
+
+}  // namespace twin
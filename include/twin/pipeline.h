@@ -0,0 +1,119 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <span>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include "twin/command.h"
+#include "twin/module.h"
+#include "twin/queue.h"
+#include "twin/status.h"
+
+namespace twin {
+
+struct Ack {
+  std::uint64_t seq = 0;
+  CommandKind kind = CommandKind::kSnapshot;
+  Status status = Status::kOk;
+  std::uint32_t module = 0;
+  Half half = Half::kA;
+};
+
+struct PipelineOptions {
+  /// Number of validate/apply shard pairs; 0 picks one per two cores.
+  std::size_t shards = 0;
+  /// Capacity of every inter-stage queue.
+  std::size_t queue_capacity = 4096;
+};
+
+struct PipelineStats {
+  std::uint64_t submitted = 0;
+  std::uint64_t acked = 0;
+  std::uint64_t failed = 0;
+};
+
+/// Staged command processing for a pool of modules:
+///
+///   submit -> parse -> [validate -> apply] x shards -> acknowledge
+///
+/// Stages run on their own threads and are joined by bounded lock-free
+/// queues. Each WSS half maps to exactly one shard, so commands for the same
+/// half are applied and acknowledged in submission order while different
+/// halves proceed in parallel. Commands are submitted from one thread.
+class CommandPipeline {
+ public:
+  static constexpr std::size_t kMaxLine = 120;
+  using AckFn = std::function<void(const Ack&)>;
+
+  CommandPipeline(std::span<TwinModule> modules, AckFn on_ack, PipelineOptions opts = {});
+  ~CommandPipeline();
+
+  CommandPipeline(const CommandPipeline&) = delete;
+  CommandPipeline& operator=(const CommandPipeline&) = delete;
+
+  /// Queues a command in text form; returns its sequence number.
+  std::uint64_t submit(std::string_view line);
+  /// Queues an already parsed command; returns its sequence number.
+  std::uint64_t submit(const Command& c);
+
+  /// Blocks until every submitted command has been acknowledged.
+  void flush();
+
+  std::size_t num_shards() const { return shards_.size(); }
+  PipelineStats stats() const;
+
+ private:
+  static constexpr std::uint16_t kOverlong = 0xffff;
+
+  struct Inbound {
+    std::uint64_t seq = 0;
+    bool parsed = false;
+    std::uint16_t len = 0;
+    Command cmd;
+    char text[kMaxLine];
+  };
+
+  struct Item {
+    std::uint64_t seq = 0;
+    Command cmd;
+    Status status = Status::kOk;
+  };
+
+  struct Shard {
+    explicit Shard(std::size_t capacity) : to_validate(capacity), to_apply(capacity) {}
+    SpscQueue<Item> to_validate;
+    SpscQueue<Item> to_apply;
+    std::thread validator;
+    std::thread applier;
+  };
+
+  std::size_t shard_of(const Command& c) const {
+    return (static_cast<std::size_t>(c.module) * kNumHalves + index_of(c.half)) % shards_.size();
+  }
+
+  void parse_loop();
+  void validate_loop(Shard& s);
+  void apply_loop(Shard& s);
+  void ack_loop();
+  void post_ack(const Item& it);
+
+  std::span<TwinModule> modules_;
+  AckFn on_ack_;
+  SpscQueue<Inbound> inbound_;
+  MpmcQueue<Ack> acks_;
+  std::vector<std::unique_ptr<Shard>> shards_;
+  std::thread parser_;
+  std::thread acker_;
+  std::atomic<bool> stop_{false};
+  std::uint64_t next_seq_ = 0;
+  std::atomic<std::uint64_t> submitted_{0};
+  std::atomic<std::uint64_t> acked_{0};
+  std::atomic<std::uint64_t> failed_{0};
+};
+
+}  // namespace twin
@@ -0,0 +1,124 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "twin/module.h"
+#include "twin/spectrum.h"
+#include "twin/status.h"
+#include "twin/wss.h"
+
+namespace twin {
+
+/// Persistent snapshot of the channel plans of both halves of a module.
+///
+/// Copying or fork()ing a version is O(1): versions share one immutable tree.
+/// A modification copies only the path from the root to the touched port and
+/// id bucket; every other port keeps pointing at the same nodes as the
+/// version it was forked from.
+///
+/// Each node records the owner token of the version that created it, and a
+/// copy gives both the copy and the source fresh tokens. A node is updated in
+/// place only if it carries the writer's current token, i.e. it was created
+/// by that version since its last copy and no other version can reach it.
+/// Reference counts are never consulted, so a version being destroyed on
+/// another thread cannot make a shared node look private.
+///
+/// Threads: different version objects, forks of each other included, may be
+/// edited, copied and destroyed concurrently. One version object may be read
+/// and copied from by several threads at once, but not while it is being
+/// edited: a copy renews the source's token, and an edit that has already
+/// read the old token would change a node the copy now shares. Fork on the
+/// editing thread and hand the fork over instead.
+///
+/// A moved-from version holds no tree; it may only be assigned to or
+/// destroyed.
+class PlanVersion {
+ public:
+  PlanVersion();
+  PlanVersion(const PlanVersion& other);
+  PlanVersion(PlanVersion&& other) noexcept;
+  PlanVersion& operator=(const PlanVersion& other);
+  PlanVersion& operator=(PlanVersion&& other) noexcept;
+
+  /// Captures the current channel tables of `m`.
+  static PlanVersion from_module(const TwinModule& m);
+
+  PlanVersion fork() const { return *this; }
+
+  Status add_channel(Half h, const ChannelSpec& spec);
+  Status delete_channel(Half h, ChannelId id);
+  Status retune_channel(Half h, ChannelId id, int first_slice, int num_slices);
+  Status set_attenuation(Half h, ChannelId id, Attenuation attenuation);
+
+  const Channel* find(Half h, ChannelId id) const;
+  std::size_t num_channels(Half h) const { return half(h).num_channels; }
+  const SliceBitmap& port_occupancy(Half h, int port) const {
+    return half(h).ports[port - 1]->occupancy;
+  }
+  const SliceBitmap& common_occupancy(Half h) const { return half(h).common; }
+  /// Channels on `port`, in no particular order.
+  const std::vector<Channel>& port_channels(Half h, int port) const {
+    return half(h).ports[port - 1]->channels;
+  }
+
+  /// All channels of `h`, gathered from the port nodes.
+  std::vector<Channel> channels(Half h) const;
+
+  /// Commits this version to `m` as a plan on both halves. Nothing changes
+  /// unless both plans validate.
+  Status apply_to(TwinModule& m) const;
+
+  /// True if the two versions still share the node for `port`.
+  bool shares_port(const PlanVersion& other, Half h, int port) const {
+    return half(h).ports[port - 1] == other.half(h).ports[port - 1];
+  }
+
+ private:
+  static constexpr int kIdBuckets = 64;
+
+  struct PortNode {
+    std::uint64_t owner = 0;
+    SliceBitmap occupancy;
+    std::vector<Channel> channels;
+  };
+
+  /// Channel id -> port, split by the low bits of the id.
+  struct IdBucket {
+    std::uint64_t owner = 0;
+    std::vector<std::pair<ChannelId, std::uint8_t>> entries;
+  };
+
+  struct HalfNode {
+    std::uint64_t owner = 0;
+    std::array<std::shared_ptr<PortNode>, kNumPorts> ports;
+    std::array<std::shared_ptr<IdBucket>, kIdBuckets> ids;
+    SliceBitmap common;
+    std::size_t num_channels = 0;
+  };
+
+  struct Root {
+    std::uint64_t owner = 0;
+    std::array<std::shared_ptr<HalfNode>, kNumHalves> halves;
+  };
+
+  const HalfNode& half(Half h) const { return *root_->halves[index_of(h)]; }
+  HalfNode& writable_half(Half h);
+  static int bucket_of(ChannelId id) { return static_cast<int>(id % kIdBuckets); }
+  int port_of(Half h, ChannelId id) const;
+  Channel* writable_channel(Half h, ChannelId id);
+  /// Returns `p` for mutation, copying the node first unless this version
+  /// owns it.
+  template <typename T>
+  T& writable(std::shared_ptr<T>& p);
+
+  std::shared_ptr<Root> root_;
+  /// Renewed by every copy, including on the source, hence mutable.
+  mutable std::atomic<std::uint64_t> owner_;
+};
+
+}  // namespace twin
@@ -0,0 +1,148 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <unordered_map>
+#include <vector>
+
+#include "twin/crosstalk.h"
+#include "twin/network.h"
+#include "twin/wss.h"
+
+namespace twin {
+
+using QotPathId = std::uint32_t;
+
+/// Line system assumed behind every link: equal spans of standard fibre,
+/// each followed by an amplifier that exactly recovers the span loss.
+struct QotConfig {
+  double span_length_km = 80.0;
+  double fibre_loss_db_per_km = 0.2;
+  double noise_figure_db = 5.5;
+  /// Per-channel launch power at 0 dB WSS attenuation; the WSS attenuation
+  /// of a channel on the hop's egress port comes straight off it.
+  double launch_dbm = 0.0;
+  double gamma_per_w_km = 1.3;
+  double beta2_ps2_per_km = -21.7;
+  /// Symbol rate = channel bandwidth / (1 + roll_off).
+  double roll_off = 0.15;
+  /// Adds the in-band crosstalk of each traversed WSS half.
+  bool crosstalk = true;
+  CrosstalkConfig crosstalk_config{};
+};
+
+struct QotResult {
+  bool valid = false;
+  /// ASE-only OSNR in 12.5 GHz.
+  double osnr_db = 0.0;
+  /// ASE + NLI + crosstalk, in the signal bandwidth.
+  double gsnr_db = 0.0;
+};
+
+/// A channel that is not provisioned yet, for planners comparing options.
+struct QotCandidate {
+  std::span<const LinkId> path;
+  int first_slice = 0;
+  int num_slices = 1;
+  Attenuation attenuation;
+};
+
+/// Generalised SNR of lightpaths from a GN-model-style closed form. Each
+/// link adds ASE from its amplifiers and nonlinear interference
+/// eta * P^3 / Rs^2 per span, where eta grows with the spectrum occupied on
+/// the link (locally white, incoherent accumulation). Each hop also adds the
+/// in-band crosstalk of the WSS half that launches it.
+///
+/// Per-hop inputs are kept in flat arrays and evaluated together. A change
+/// on a half dirties its links' terms and the hops launched from it;
+/// update() re-evaluates just those hops and re-sums the lightpaths they
+/// belong to. Removed lightpaths free their slot for the next add, and their
+/// hops are compacted away once they outnumber the live ones, so a long run
+/// of adds and removes stays bounded by the live set. Not thread-safe; the
+/// network must outlive the estimator.
+class QotEstimator {
+ public:
+  explicit QotEstimator(Network& net, const QotConfig& config = {});
+  ~QotEstimator();
+  QotEstimator(const QotEstimator&) = delete;
+  QotEstimator& operator=(const QotEstimator&) = delete;
+
+  const QotConfig& config() const { return config_; }
+
+  /// Tracks channel `id` provisioned along `path`.
+  QotPathId add_lightpath(std::span<const LinkId> path, ChannelId id);
+  /// Stops tracking `lp`; its id may be handed out again by add_lightpath().
+  /// Removing an id that is not live does nothing.
+  void remove_lightpath(QotPathId lp);
+
+  void update();
+  const QotResult& result(QotPathId lp) const { return results_[lp]; }
+  std::size_t num_dirty_hops() const { return dirty_hops_.size(); }
+
+  /// Estimates channels as if each were added alone to the current state,
+  /// in one batch. Nothing is provisioned. A candidate with an empty path,
+  /// an unknown link, a slice block off the grid or an out-of-range
+  /// attenuation gets valid = false.
+  void estimate(std::span<const QotCandidate> candidates, std::span<QotResult> out);
+  QotResult estimate(const QotCandidate& candidate);
+
+ private:
+  class Watch;
+
+  /// Inputs and outputs of one hop evaluation, structure of arrays.
+  struct HopBatch {
+    std::vector<double> ase_psd, eta, power_w, rs_hz, xt;
+    std::vector<double> ase_nsr, nsr;
+    void resize(std::size_t n);
+    void run(std::size_t n);
+  };
+
+  struct LinkTerms {
+    double ase_psd = 0.0;  ///< W/Hz at the end of the link.
+    double eta = 0.0;      ///< 1/W^2 summed over spans.
+    bool dirty = true;
+    bool watched = false;
+  };
+
+  Watch& watch(const Link& link);
+  const LinkTerms& link_terms(LinkId l);
+  double eta_for(const Link& link, int occupied_slices) const;
+  double symbol_rate_hz(int num_slices) const;
+  void mark_half(Watch& w);
+  void unwatch_hop(std::uint32_t h);
+  void compact_hops();
+  void finish(QotResult& r, double ase_nsr, double nsr) const;
+  bool valid_candidate(const QotCandidate& c) const;
+
+  Network& net_;
+  QotConfig config_;
+  double launch_w_;
+  double span_ase_psd_ = 0.0;  ///< Per span, without the span count.
+  std::vector<LinkTerms> links_;
+  std::unordered_map<std::uint64_t, std::unique_ptr<Watch>> watches_;
+
+  static constexpr QotPathId kNoPath = ~QotPathId{0};
+
+  // Lightpaths; hops of lightpath i are [hop_begin_[i], hop_end_[i]).
+  std::vector<ChannelId> ids_;
+  std::vector<std::uint32_t> hop_begin_, hop_end_;
+  std::vector<std::uint8_t> lp_live_, lp_dirty_;
+  std::vector<QotResult> results_;
+  std::vector<QotPathId> dirty_paths_;
+  std::vector<QotPathId> free_paths_;
+
+  // Hops, flat. A removed lightpath's hops get hop_path_ kNoPath and leave
+  // their Watch at once; compact_hops() reclaims the slots.
+  std::vector<LinkId> hop_link_;
+  std::vector<QotPathId> hop_path_;
+  std::vector<std::uint32_t> hop_watch_pos_;  ///< Index in its Watch::hops.
+  std::vector<std::uint8_t> hop_ok_, hop_dirty_;
+  std::vector<double> hop_ase_nsr_, hop_nsr_;
+  std::vector<std::uint32_t> dirty_hops_;
+  std::size_t dead_hops_ = 0;
+
+  HopBatch batch_;
+};
+
+}  // namespace twin
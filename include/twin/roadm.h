@@ -0,0 +1,125 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <vector>
+
+#include "twin/module.h"
+#include "twin/spectrum.h"
+#include "twin/status.h"
+#include "twin/wss.h"
+
+namespace twin {
+
+enum class NodeArchitecture : std::uint8_t {
+  /// Line inputs are split to every other degree; only the egress WSS
+  /// selects. Drops still go through the ingress WSS.
+  kBroadcastSelect,
+  /// Line inputs are routed by an ingress WSS and selected by an egress WSS.
+  kRouteSelect,
+};
+
+const char* to_string(NodeArchitecture a);
+
+struct NodeConfig {
+  NodeArchitecture architecture = NodeArchitecture::kRouteSelect;
+  int degrees = 4;
+  /// Add ports on each egress WSS and drop ports on each ingress WSS.
+  int add_drop_ports = 8;
+};
+
+/// Parameters of a connection through the node; the same id is used on
+/// every WSS half it occupies.
+struct NodeChannel {
+  ChannelId id = 0;
+  int first_slice = 0;
+  int num_slices = 0;
+  Attenuation attenuation;
+};
+
+struct NodeStats {
+  std::uint64_t recomputes = 0;
+  std::uint64_t invalidations = 0;
+};
+
+/// A multi-degree ROADM composed from twin modules, one per degree. Half A
+/// of a degree's module is its ingress (route/drop) WSS: common = line in.
+/// Half B is its egress (select/add) WSS: common = line out. Port k of either
+/// half faces another degree for k < degrees, skipping the module's own
+/// degree, and the ports after that are add/drop ports.
+///
+/// End-to-end passbands (slices carried continuously from one endpoint to
+/// another) are kept in a path table. Entries are recomputed lazily and
+/// invalidated only when a channel changes on one of the WSS ports they
+/// depend on.
+class RoadmNode {
+ public:
+  /// `modules` must hold config.degrees modules and outlive the node.
+  /// Use valid_config() first; an invalid config yields an empty node.
+  RoadmNode(const NodeConfig& config, std::span<TwinModule> modules);
+  ~RoadmNode();
+  RoadmNode(const RoadmNode&) = delete;
+  RoadmNode& operator=(const RoadmNode&) = delete;
+
+  static bool valid_config(const NodeConfig& config, std::size_t modules);
+
+  const NodeConfig& config() const { return config_; }
+  int degrees() const { return config_.degrees; }
+
+  /// WSS port on degree `from` facing degree `to`.
+  int degree_port(int from, int to) const { return to < from ? to + 1 : to; }
+  /// Degree behind WSS port `port` of degree `d`, or -1 for add/drop ports.
+  int port_degree(int d, int port) const;
+  /// WSS port of add/drop port `a` (0-based).
+  int add_drop_port(int a) const { return config_.degrees + a; }
+
+  /// Provisions the WSS channels for a connection, rolling back on failure.
+  /// A slice block off the grid gives kInvalidRange and changes nothing.
+  Status connect_express(int from, int to, const NodeChannel& ch);
+  Status connect_add(int degree, int add_port, const NodeChannel& ch);
+  Status connect_drop(int degree, int drop_port, const NodeChannel& ch);
+  /// Removes `id` from every WSS half of the node that carries it.
+  void disconnect(ChannelId id);
+
+  /// Slices passing from line in of `from` to line out of `to`. Degrees
+  /// and add/drop ports out of range give kInvalidPort and leave `out` as is.
+  Status express(int from, int to, SliceBitmap& out) const;
+  /// Slices passing from add port `add_port` to line out of `degree`.
+  Status add_path(int degree, int add_port, SliceBitmap& out) const;
+  /// Slices passing from line in of `degree` to drop port `drop_port`.
+  Status drop_path(int degree, int drop_port, SliceBitmap& out) const;
+
+  const NodeStats& stats() const { return stats_; }
+
+ private:
+  class Watch;
+  struct Entry {
+    SliceBitmap passband;
+    bool dirty = true;
+  };
+
+  WssHalf& ingress(int d) const { return modules_[static_cast<std::size_t>(d)].half(Half::kA); }
+  WssHalf& egress(int d) const { return modules_[static_cast<std::size_t>(d)].half(Half::kB); }
+  std::size_t express_slot(int from, int to) const {
+    return static_cast<std::size_t>(from * config_.degrees + to);
+  }
+  std::size_t add_drop_slot(int d, int a) const {
+    return static_cast<std::size_t>(d * config_.add_drop_ports + a);
+  }
+  bool valid_degree(int d) const { return d >= 0 && d < config_.degrees; }
+  bool valid_add_drop(int a) const { return a >= 0 && a < config_.add_drop_ports; }
+  void invalidate(int degree, Half half, int port);
+  void invalidate_half(int degree, Half half);
+  void mark(Entry& e);
+
+  NodeConfig config_;
+  std::span<TwinModule> modules_;
+  mutable std::vector<Entry> express_;
+  mutable std::vector<Entry> add_;
+  mutable std::vector<Entry> drop_;
+  mutable NodeStats stats_;
+  std::vector<std::unique_ptr<Watch>> watches_;
+};
+
+}  // namespace twin
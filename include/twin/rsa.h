@@ -0,0 +1,97 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <span>
+#include <unordered_map>
+#include <vector>
+
+#include "twin/network.h"
+#include "twin/status.h"
+#include "twin/thread_pool.h"
+#include "twin/wss.h"
+
+namespace twin {
+
+/// How a contiguous slice block is chosen among the free runs of a path.
+enum class FitPolicy : std::uint8_t {
+  kFirstFit,  ///< Lowest free block on the shortest feasible path.
+  kLastFit,   ///< Highest free block on the shortest feasible path.
+  kBestFit,   ///< Tightest free run over all candidate paths.
+  kMinFragmentation,  ///< Like best fit, but never leaves a remnant narrower
+                      ///< than the demand unless nothing else fits.
+};
+
+const char* to_string(FitPolicy p);
+
+struct Demand {
+  NodeId src = 0;
+  NodeId dst = 0;
+  std::uint16_t num_slices = 1;
+};
+
+struct RsaOptions {
+  FitPolicy policy = FitPolicy::kFirstFit;
+  std::size_t k_paths = 4;
+  /// Wall-clock budget per demand. Paths not started before it runs out are
+  /// skipped and the best block found so far is returned.
+  std::chrono::microseconds budget{1000};
+  /// Ignores `budget` and evaluates every candidate path, so the chosen path,
+  /// block and paths_evaluated depend only on the network state and never on
+  /// timing or pool size.
+  bool deterministic = false;
+};
+
+struct RsaResult {
+  bool found = false;
+  Path path;
+  std::uint16_t first_slice = 0;
+  std::uint16_t num_slices = 0;
+  std::uint32_t paths_evaluated = 0;
+};
+
+/// Routing and spectrum assignment over a network of twin modules. A block is
+/// feasible on a path if the same contiguous slices are free on every hop
+/// (spectrum continuity and contiguity). Candidate paths are evaluated in
+/// parallel.
+class RsaSolver {
+ public:
+  RsaSolver(Network& net, ThreadPool& pool, RsaOptions opts = {});
+
+  const RsaOptions& options() const { return opts_; }
+  void set_options(const RsaOptions& opts);
+
+  /// Finds a path and slice block for `d` without changing any module.
+  RsaResult solve(const Demand& d);
+
+  /// Adds channel `id` on every hop of `r`. All-or-nothing.
+  Status provision(const RsaResult& r, ChannelId id, Attenuation attenuation = {});
+
+  /// Solves and provisions each demand in order, so later demands see the
+  /// spectrum taken by earlier ones. Demand i gets channel id `first_id + i`.
+  std::vector<RsaResult> solve_batch(std::span<const Demand> demands, ChannelId first_id);
+
+  /// Drops cached candidate paths; call after changing the topology.
+  void invalidate_paths() { path_cache_.clear(); }
+
+ private:
+  struct Candidate {
+    bool feasible = false;
+    bool evaluated = false;
+    int first = 0;
+    int cost = 0;
+  };
+
+  const std::vector<Path>& paths(NodeId src, NodeId dst);
+  Candidate evaluate(const Path& p, int num_slices) const;
+  bool better(const Candidate& a, std::size_t ia, const Candidate& b, std::size_t ib,
+              const std::vector<Path>& paths) const;
+
+  Network& net_;
+  ThreadPool& pool_;
+  RsaOptions opts_;
+  std::unordered_map<std::uint64_t, std::vector<Path>> path_cache_;
+  std::vector<Candidate> scratch_;
+};
+
+}  // namespace twin
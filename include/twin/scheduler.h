@@ -0,0 +1,177 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <limits>
+#include <span>
+#include <unordered_map>
+#include <vector>
+
+#include "twin/bringup.h"
+#include "twin/command.h"
+#include "twin/latency.h"
+#include "twin/module.h"
+#include "twin/status.h"
+
+namespace twin {
+
+/// Priority classes, highest first.
+enum class CommandClass : std::uint8_t {
+  kRestoration,   ///< Reroutes after a fault; always served first.
+  kProvisioning,  ///< Routine adds, deletes and retunes.
+  kEqualisation,  ///< Attenuation tweaks from power control loops.
+};
+
+inline constexpr int kNumCommandClasses = 3;
+
+inline int index_of(CommandClass c) { return static_cast<int>(c); }
+const char* to_string(CommandClass c);
+
+/// Settle time of the WSS per operation, in virtual microseconds.
+struct SettleTiming {
+  VirtualTime add_us = 120'000;
+  VirtualTime delete_us = 80'000;
+  VirtualTime retune_us = 150'000;
+  /// Per ramp step; see SchedulerOptions::ramp_step.
+  VirtualTime attenuate_step_us = 20'000;
+  VirtualTime snapshot_us = 1'000;
+};
+
+struct SchedulerOptions {
+  SettleTiming timing;
+  /// Attenuation moves in steps of at most this much. Every step boundary
+  /// is a safe point where a higher class may take the WSS.
+  Attenuation ramp_step = Attenuation::from_tenths(10);
+  /// A routine command that has waited this long is served ahead of every
+  /// other routine command, oldest first, though still after restoration.
+  /// The restoration entry is unused.
+  std::array<VirtualTime, kNumCommandClasses> max_wait_us{0, 2'000'000, 5'000'000};
+  /// Merges an attenuate or retune into the channel's previous command when
+  /// that is the same kind and has not started. See CommandScheduler.
+  bool coalesce = true;
+};
+
+/// Outcome of one scheduled command.
+struct Completion {
+  std::uint64_t seq = 0;
+  CommandClass cls = CommandClass::kProvisioning;
+  Command cmd;
+  Status status = Status::kOk;
+  VirtualTime queued = 0;
+  VirtualTime started = 0;  ///< Start of its first settle step.
+  VirtualTime finished = 0;
+  /// Set when a later command for the same channel replaced this one
+  /// before it started; it then completes at once with kOk.
+  std::uint64_t superseded_by = 0;
+};
+
+struct ClassStats {
+  std::uint64_t submitted = 0;
+  std::uint64_t completed = 0;
+  std::uint64_t failed = 0;
+  /// Times a command of this class was suspended at a safe point.
+  std::uint64_t preemptions = 0;
+  /// Commands served early because they had waited past max_wait_us.
+  std::uint64_t promotions = 0;
+  /// Commands replaced by a later one before they started.
+  std::uint64_t coalesced = 0;
+  /// Submission to first step, and submission to completion, in us.
+  /// Superseded commands never start, so they appear only in
+  /// completion_us, which therefore has `completed` samples.
+  LatencyHistogram queueing_us;
+  LatencyHistogram completion_us;
+};
+
+/// Orders commands for each WSS half by priority class on a virtual clock.
+/// Every half is an independent lane that settles one step at a time;
+/// commands take effect on the module when their step has settled. A
+/// multi-step command (an attenuation ramp) yields at each step boundary
+/// to anything of a higher class, then resumes ahead of its own class.
+///
+/// With coalescing on, a lane remembers the last queued, not yet started
+/// command for each channel. An attenuate or retune that finds one of the
+/// same kind there replaces it: in place (keeping its queue position) for
+/// the same class, or by retiring it and queueing normally when the new
+/// command is more urgent. Only the most recent command for a channel is
+/// ever merged, so an attenuate is never folded across an add, delete or
+/// retune of the same channel, and dependent operations keep their order.
+///
+/// Not thread-safe. `modules` must outlive the scheduler.
+class CommandScheduler {
+ public:
+  using DoneFn = std::function<void(const Completion&)>;
+  static constexpr VirtualTime kIdle = std::numeric_limits<VirtualTime>::max();
+
+  CommandScheduler(std::span<TwinModule> modules, DoneFn on_done,
+                   const SchedulerOptions& opts = {});
+
+  /// Queues `c` at the current time; returns its sequence number. Commands
+  /// that fail validation complete at once.
+  std::uint64_t submit(const Command& c, CommandClass cls);
+
+  /// Runs every lane up to `now`.
+  void advance(VirtualTime now);
+  VirtualTime now() const { return now_; }
+  /// Time the next in-flight step settles, or kIdle.
+  VirtualTime next_event() const;
+  /// Advances event by event until nothing is queued or in flight.
+  void run_until_idle();
+
+  std::size_t queued() const { return queued_; }
+  const ClassStats& stats(CommandClass c) const { return stats_[index_of(c)]; }
+
+ private:
+  struct Entry {
+    std::uint64_t seq = 0;
+    CommandClass cls = CommandClass::kProvisioning;
+    Command cmd;
+    VirtualTime queued = 0;
+    /// Queue position for eligibility and ageing; older than `queued` when
+    /// the entry absorbed a later command.
+    VirtualTime waiting_since = 0;
+    VirtualTime started = 0;
+    bool begun = false;
+    bool dead = false;  ///< Superseded; dropped when it reaches the front.
+    std::uint16_t steps_left = 0;
+    Attenuation ramp_from;
+    std::uint16_t ramp_steps = 0;
+  };
+
+  struct Lane {
+    std::array<std::deque<Entry>, kNumCommandClasses> queues;
+    Entry current;
+    bool in_flight = false;
+    VirtualTime free_at = 0;
+    bool listed = false;
+    /// Last queued, not yet started command per channel. Deque elements
+    /// stay put when the ends change, so the pointers remain valid until
+    /// the entry is popped.
+    std::unordered_map<ChannelId, Entry*> last;
+  };
+
+  Lane& lane_of(const Command& c) {
+    return lanes_[static_cast<std::size_t>(c.module) * kNumHalves + index_of(c.half)];
+  }
+  bool coalesce(Lane& lane, const Entry& e);
+  void purge(Lane& lane);
+  bool pick(Lane& lane, VirtualTime at, Entry& out);
+  void start_step(Lane& lane, Entry&& e, VirtualTime at);
+  void finish_step(Lane& lane);
+  void run_lane(Lane& lane, VirtualTime now);
+  VirtualTime step_duration(const Entry& e) const;
+  void complete(const Entry& e, Status status, VirtualTime at);
+
+  std::span<TwinModule> modules_;
+  DoneFn on_done_;
+  SchedulerOptions opts_;
+  VirtualTime now_ = 0;
+  std::uint64_t next_seq_ = 0;
+  std::size_t queued_ = 0;
+  std::vector<Lane> lanes_;
+  std::vector<std::uint32_t> active_;
+  std::array<ClassStats, kNumCommandClasses> stats_{};
+};
+
+}  // namespace twin
@@ -0,0 +1,108 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "twin/command.h"
+#include "twin/module.h"
+#include "twin/status.h"
+#include "twin/wss.h"
+
+namespace twin {
+
+/// A batch of twin operations, parsed once and run many times. One statement
+/// per line; `#` starts a comment.
+///
+///   modules <n>                          size of the module pool (default 1)
+///   <command>                            any line accepted by parse_command()
+///   expect <status> <command>            run a command, require its status
+///   commit <m> <A|B> [<id>:<port>:<first>:<n>[:<atten>] ...]
+///                                        replace a half's plan
+///   assert channels <m> <A|B> <count>
+///   assert exists|absent <m> <A|B> <id>
+///   assert free <m> <A|B> <first> <n>    slices unused on the common port
+///   assert used <m> <A|B> <port> <n>     slices in use on a port
+///   assert atten <m> <A|B> <id> <db>
+///   query channel <m> <A|B> <id>
+///   query port <m> <A|B> <port>
+///   query telemetry <m>
+///   repeat <n> ... end                   run the enclosed block n times
+///
+/// Status names are those of status_token(), e.g. `ok`, `slice-conflict`,
+/// `unknown-channel`.
+struct Script {
+  enum class Kind : std::uint8_t {
+    kCommand,
+    kExpect,
+    kCommit,
+    kAssertChannels,
+    kAssertExists,
+    kAssertAbsent,
+    kAssertFree,
+    kAssertUsed,
+    kAssertAtten,
+    kQueryChannel,
+    kQueryPort,
+    kQueryTelemetry,
+    kRepeat,
+    kEnd,
+  };
+
+  struct Step {
+    Kind kind = Kind::kCommand;
+    std::uint32_t line = 0;
+    Command cmd;  ///< Command, or module/half/channel/port operands.
+    Status expect = Status::kOk;
+    std::uint32_t count = 0;  ///< Repeat count, or expected count/slices.
+    std::uint32_t target = 0;  ///< Matching end/repeat step, or plan index.
+  };
+
+  std::uint32_t modules = 1;
+  std::vector<Step> steps;
+  std::vector<std::vector<ChannelSpec>> plans;
+};
+
+struct ScriptError {
+  std::uint32_t line = 0;
+  std::string message;
+};
+
+/// Parses `text` into `out`. On failure returns kParseError and fills `err`.
+Status parse_script(std::string_view text, Script& out, ScriptError& err);
+
+struct ScriptStats {
+  std::uint64_t commands = 0;
+  std::uint64_t failed_commands = 0;
+  std::uint64_t assertions = 0;
+  std::uint64_t failed_assertions = 0;
+};
+
+/// Executes a parsed script against a module pool.
+class ScriptRunner {
+ public:
+  /// Query results (if `echo_queries`) and assertion failures go to `out`
+  /// unless it is null. At most `max_failure_reports` failures are printed.
+  explicit ScriptRunner(const Script& script, std::FILE* out = stdout, bool echo_queries = true,
+                        std::uint32_t max_failure_reports = 20)
+      : script_(script), out_(out), echo_queries_(echo_queries), max_reports_(max_failure_reports) {}
+
+  void run(std::vector<TwinModule>& modules, ScriptStats& stats);
+
+ private:
+  bool check(const Script::Step& st, std::vector<TwinModule>& modules) const;
+  void query(const Script::Step& st, std::vector<TwinModule>& modules) const;
+  void report(const Script::Step& st, const char* what) const;
+
+  const Script& script_;
+  std::FILE* out_;
+  bool echo_queries_;
+  std::uint32_t max_reports_;
+  mutable std::uint32_t reported_ = 0;
+  /// Open repeat counters; kept across runs so a warm runner does not allocate.
+  std::vector<std::uint32_t> loops_;
+};
+
+}  // namespace twin
@@ -0,0 +1,107 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include "twin/command.h"
+#include "twin/module.h"
+#include "twin/status.h"
+
+namespace twin {
+
+struct ServerOptions {
+  /// Listen on this Unix socket path if set, otherwise on TCP 127.0.0.1.
+  std::string unix_path;
+  /// TCP port; 0 picks an ephemeral port (see ManagementServer::port()).
+  std::uint16_t tcp_port = 0;
+  /// Number of epoll reactor threads sharing the listening socket.
+  std::size_t reactors = 1;
+  /// Connections sending more than this without a newline are dropped.
+  std::size_t max_line = 4096;
+  /// Bytes read from one connection per wakeup. A connection with more
+  /// waiting is re-armed behind the others, so a pipelining client cannot
+  /// hold a reactor.
+  std::size_t max_read_burst = 256 * 1024;
+  /// High-water mark for replies the peer has not read. Above it the server
+  /// stops reading that connection until half of it has drained.
+  std::size_t max_pending = 1024 * 1024;
+};
+
+struct ServerStats {
+  std::uint64_t accepted = 0;
+  std::uint64_t open = 0;
+  std::uint64_t requests = 0;
+  std::uint64_t writev_calls = 0;
+  /// Reads cut short by max_read_burst with input still waiting.
+  std::uint64_t burst_yields = 0;
+  /// Times a connection stopped being read because of max_pending.
+  std::uint64_t read_pauses = 0;
+};
+
+/// Control-plane emulation for a pool of modules, speaking the command
+/// language of parse_command() one request per line. Each request gets one
+/// response line, in order: `ok`, `ok <channels> <used-slices>` for
+/// snapshots, or `err <status-token>`.
+///
+/// Every reactor owns an edge-triggered epoll set. All complete lines that
+/// arrive in one read burst are executed as a batch and their responses go
+/// out in a single writev. Modules are locked per request, so sessions on
+/// different reactors may address any module. TCP listens on loopback only.
+///
+/// Per connection, buffered input is bounded by max_read_burst + max_line
+/// and unsent replies by max_pending plus the replies to one burst.
+class ManagementServer {
+ public:
+  explicit ManagementServer(std::vector<TwinModule>& modules, ServerOptions opts = {});
+  ~ManagementServer();
+
+  ManagementServer(const ManagementServer&) = delete;
+  ManagementServer& operator=(const ManagementServer&) = delete;
+
+  /// Binds, listens and starts the reactors. On failure returns false and
+  /// describes the failing system call in `error`.
+  bool start(std::string& error);
+  /// Stops the reactors and closes every session.
+  void stop();
+
+  /// Bound TCP port, valid after start() when not using a Unix socket.
+  std::uint16_t port() const { return port_; }
+  ServerStats stats() const;
+
+ private:
+  struct Reactor;
+  struct Conn;
+
+  void reactor_loop(Reactor& r);
+  void accept_all(Reactor& r);
+  void on_readable(Reactor& r, Conn& c);
+  /// Writes what it can of `c.pending`; false on a socket error.
+  bool flush_pending(Conn& c);
+  void close_conn(Reactor& r, Conn* c);
+  /// Re-registers `c`, reading or not; pending input raises a fresh edge.
+  void rearm(Reactor& r, Conn& c, bool read);
+  Status execute(std::string_view line, Command& cmd, HalfTelemetry& t);
+
+  std::vector<TwinModule>& modules_;
+  std::unique_ptr<std::mutex[]> module_locks_;
+  ServerOptions opts_;
+  int listen_fd_ = -1;
+  int stop_fd_ = -1;
+  bool bound_unix_ = false;  ///< unix_path is our socket and is removed on stop().
+  std::uint16_t port_ = 0;
+  std::vector<std::unique_ptr<Reactor>> reactors_;
+  std::atomic<std::uint64_t> accepted_{0};
+  std::atomic<std::uint64_t> closed_{0};
+  std::atomic<std::uint64_t> requests_{0};
+  std::atomic<std::uint64_t> writev_calls_{0};
+  std::atomic<std::uint64_t> burst_yields_{0};
+  std::atomic<std::uint64_t> read_pauses_{0};
+};
+
+}  // namespace twin
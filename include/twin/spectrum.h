@@ -0,0 +1,107 @@
+#pragma once
+
+#include <array>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+
+namespace twin {
+
+/// Number of switched output ports on each 1x20 WSS half.
+inline constexpr int kNumPorts = 20;
+
+/// Flexgrid slices across the C band (191.325 THz .. 196.125 THz).
+inline constexpr int kNumSlices = 768;
+
+/// Width of one flexgrid slice.
+inline constexpr std::int64_t kSliceWidthMHz = 6'250;
+
+/// Lower edge of slice 0.
+inline constexpr std::int64_t kGridStartMHz = 191'325'000;
+
+/// Lower frequency edge of `slice` in MHz.
+constexpr std::int64_t slice_lower_mhz(int slice) {
+  return kGridStartMHz + static_cast<std::int64_t>(slice) * kSliceWidthMHz;
+}
+
+/// Centre frequency of a block of `count` slices starting at `first`, in MHz.
+constexpr std::int64_t block_center_mhz(int first, int count) {
+  return slice_lower_mhz(first) + static_cast<std::int64_t>(count) * kSliceWidthMHz / 2;
+}
+
+/// Slice containing `freq_mhz`, or -1 if it is off the grid.
+constexpr int slice_at_mhz(std::int64_t freq_mhz) {
+  if (freq_mhz < kGridStartMHz) return -1;
+  const std::int64_t s = (freq_mhz - kGridStartMHz) / kSliceWidthMHz;
+  return s < kNumSlices ? static_cast<int>(s) : -1;
+}
+
+/// True if [first, first + count) lies on the grid and is non-empty.
+constexpr bool valid_slice_range(int first, int count) {
+  return first >= 0 && count > 0 && count <= kNumSlices && first <= kNumSlices - count;
+}
+
+/// Fixed-size occupancy bitmap over the flexgrid; bit i set means slice i is in use.
+class SliceBitmap {
+ public:
+  static constexpr int kWords = kNumSlices / 64;
+  static_assert(kNumSlices % 64 == 0, "slice count must fill whole words");
+
+  constexpr SliceBitmap() = default;
+
+  bool test(int slice) const { return (words_[slice >> 6] >> (slice & 63)) & 1u; }
+
+  void set_range(int first, int count) { apply_range(first, count, true); }
+  void clear_range(int first, int count) { apply_range(first, count, false); }
+
+  /// True if any slice in [first, first + count) is set.
+  bool any_in(int first, int count) const;
+
+  bool none() const;
+  int count() const;
+
+  /// First clear slice at or after `from`, or kNumSlices if there is none.
+  int next_clear(int from) const;
+  /// First set slice at or after `from`, or kNumSlices if there is none.
+  int next_set(int from) const;
+  /// Last set slice at or before `from`, or -1 if there is none.
+  int prev_set(int from) const;
+
+  /// Calls `fn(first, length)` for every maximal run of clear slices, in
+  /// ascending order.
+  template <typename Fn>
+  void for_each_free_run(Fn&& fn) const {
+    int pos = next_clear(0);
+    while (pos < kNumSlices) {
+      const int end = next_set(pos);
+      fn(pos, end - pos);
+      pos = end < kNumSlices ? next_clear(end) : kNumSlices;
+    }
+  }
+
+  SliceBitmap& operator|=(const SliceBitmap& o) {
+    for (int i = 0; i < kWords; ++i) words_[i] |= o.words_[i];
+    return *this;
+  }
+  SliceBitmap& operator&=(const SliceBitmap& o) {
+    for (int i = 0; i < kWords; ++i) words_[i] &= o.words_[i];
+    return *this;
+  }
+  friend SliceBitmap operator|(SliceBitmap a, const SliceBitmap& b) { return a |= b; }
+  friend SliceBitmap operator&(SliceBitmap a, const SliceBitmap& b) { return a &= b; }
+  SliceBitmap operator~() const {
+    SliceBitmap r;
+    for (int i = 0; i < kWords; ++i) r.words_[i] = ~words_[i];
+    return r;
+  }
+  friend bool operator==(const SliceBitmap&, const SliceBitmap&) = default;
+
+  const std::array<std::uint64_t, kWords>& words() const { return words_; }
+
+ private:
+  void apply_range(int first, int count, bool value);
+
+  std::array<std::uint64_t, kWords> words_{};
+};
+
+}  // namespace twin
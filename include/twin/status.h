@@ -0,0 +1,29 @@
+#pragma once
+
+#include <cstdint>
+
+namespace twin {
+
+/// Result of a twin operation. Operations never throw on bad input; they
+/// leave state untouched and report why.
+enum class Status : std::uint8_t {
+  kOk = 0,
+  kInvalidPort,
+  kInvalidRange,
+  kInvalidAttenuation,
+  kSliceConflict,
+  kUnknownChannel,
+  kDuplicateChannel,
+  kTableFull,
+  kParseError,
+  kInvalidModule,
+  kIoError,
+};
+
+const char* to_string(Status s);
+
+/// Single-word spelling of `s` used in scripts and on the wire, e.g.
+/// "slice-conflict".
+const char* status_token(Status s);
+
+}  // namespace twin
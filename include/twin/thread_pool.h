@@ -0,0 +1,82 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace twin {
+
+/// Fixed set of worker threads running one index-space job at a time. The
+/// calling thread always takes part, so a pool of size 1 runs inline.
+class ThreadPool {
+ public:
+  /// `threads` counts the caller; 0 picks the hardware concurrency.
+  explicit ThreadPool(std::size_t threads = 0);
+  ~ThreadPool();
+
+  ThreadPool(const ThreadPool&) = delete;
+  ThreadPool& operator=(const ThreadPool&) = delete;
+
+  std::size_t size() const { return workers_.size() + 1; }
+
+  /// Runs `fn(i)` for every i in [0, n) and returns when all calls have
+  /// finished. Calls may run in any order and on any pool thread.
+  template <typename Fn>
+  void parallel_for(std::size_t n, Fn&& fn) {
+    using F = std::remove_reference_t<Fn>;
+    run(n, [](void* ctx, std::size_t i) { (*static_cast<F*>(ctx))(i); },
+        const_cast<void*>(static_cast<const void*>(&fn)));
+  }
+
+  /// Folds `map(i)` for i in [0, n) with `combine`, starting from
+  /// `identity`. The range is cut into fixed chunks of `chunk` indices that
+  /// are each folded in index order, and the chunk partials are then
+  /// combined in chunk order. Chunking depends only on n and chunk, so
+  /// floating-point results are bit-identical for any pool size or schedule.
+  template <typename T, typename Map, typename Combine>
+  T parallel_reduce(std::size_t n, std::size_t chunk, T identity, Map&& map, Combine&& combine) {
+    if (chunk == 0) chunk = 1;
+    const std::size_t chunks = (n + chunk - 1) / chunk;
+    std::vector<T> partial(chunks, identity);
+    parallel_for(chunks, [&](std::size_t c) {
+      T acc = identity;
+      const std::size_t end = std::min(n, (c + 1) * chunk);
+      for (std::size_t i = c * chunk; i < end; ++i) acc = combine(std::move(acc), map(i));
+      partial[c] = std::move(acc);
+    });
+    T out = std::move(identity);
+    for (T& p : partial) out = combine(std::move(out), std::move(p));
+    return out;
+  }
+
+ private:
+  using Call = void (*)(void*, std::size_t);
+
+  void run(std::size_t n, Call call, void* ctx);
+  void worker_loop();
+  void drain(Call call, void* ctx, std::size_t n);
+
+  std::vector<std::thread> workers_;
+  std::mutex submit_mu_;
+
+  std::mutex mu_;
+  std::condition_variable wake_;
+  std::condition_variable idle_;
+  std::uint64_t generation_ = 0;
+  bool stop_ = false;
+  Call call_ = nullptr;
+  void* ctx_ = nullptr;
+  std::size_t n_ = 0;
+  std::size_t active_ = 0;
+  std::atomic<std::size_t> next_{0};
+  std::atomic<std::size_t> completed_{0};
+};
+
+}  // namespace twin
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <cmath>
+#include <compare>
+#include <cstdint>
+#include <limits>
+
+namespace twin {
+
+/// Attenuation in steps of 0.1 dB, the resolution of the WSS attenuators.
+/// Settings are whole steps, so equal settings compare equal exactly.
+class Attenuation {
+ public:
+  static constexpr double kStepDb = 0.1;
+
+  constexpr Attenuation() = default;
+
+  static constexpr Attenuation from_tenths(std::int16_t tenths) {
+    Attenuation a;
+    a.tenths_ = tenths;
+    return a;
+  }
+
+  /// Nearest step to `db`, halves away from zero. NaN and values beyond
+  /// the int16 range saturate, so they stay outside every valid range.
+  static Attenuation from_db(double db) {
+    constexpr double kLo = std::numeric_limits<std::int16_t>::min();
+    constexpr double kHi = std::numeric_limits<std::int16_t>::max();
+    const double t = std::round(db * 10.0);
+    if (!(t >= kLo)) return from_tenths(std::numeric_limits<std::int16_t>::min());
+    if (t > kHi) return from_tenths(std::numeric_limits<std::int16_t>::max());
+    return from_tenths(static_cast<std::int16_t>(t));
+  }
+
+  constexpr std::int16_t tenths() const { return tenths_; }
+  /// Value in dB. from_db(a.db()) == a for every a.
+  constexpr double db() const { return tenths_ / 10.0; }
+
+  friend constexpr bool operator==(Attenuation, Attenuation) = default;
+  friend constexpr auto operator<=>(Attenuation, Attenuation) = default;
+
+ private:
+  std::int16_t tenths_ = 0;
+};
+
+/// Optical frequency in whole MHz. Flexgrid slices are 6.25 GHz wide, so
+/// every slice edge and block centre is exact.
+class Frequency {
+ public:
+  constexpr Frequency() = default;
+
+  static constexpr Frequency from_mhz(std::int64_t mhz) {
+    Frequency f;
+    f.mhz_ = mhz;
+    return f;
+  }
+  /// Nearest MHz to `thz`, halves away from zero. NaN and values beyond
+  /// the int64 range saturate, so they stay outside every valid range.
+  static Frequency from_thz(double thz) {
+    // -2^63 is exact as a double; 2^63 is the first value past the top.
+    constexpr double kLo = static_cast<double>(std::numeric_limits<std::int64_t>::min());
+    constexpr double kHi = -kLo;
+    const double m = std::round(thz * 1e6);
+    if (!(m >= kLo)) return from_mhz(std::numeric_limits<std::int64_t>::min());
+    if (m >= kHi) return from_mhz(std::numeric_limits<std::int64_t>::max());
+    return from_mhz(static_cast<std::int64_t>(m));
+  }
+
+  constexpr std::int64_t mhz() const { return mhz_; }
+  constexpr double thz() const { return mhz_ / 1e6; }
+
+  friend constexpr bool operator==(Frequency, Frequency) = default;
+  friend constexpr auto operator<=>(Frequency, Frequency) = default;
+
+ private:
+  std::int64_t mhz_ = 0;
+};
+
+}  // namespace twin
@@ -0,0 +1,102 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#include "twin/module.h"
+#include "twin/spectrum.h"
+#include "twin/thread_pool.h"
+
+namespace twin {
+
+/// Normal spread of a per-unit parameter; draws are clamped at zero.
+struct Spread {
+  double mean = 0.0;
+  double sigma = 0.0;
+};
+
+/// Manufacturing variation and the acceptance limits a plan must meet.
+struct VariationConfig {
+  /// Common-to-output insertion loss, drawn per port.
+  Spread insertion_loss_db{6.0, 0.4};
+  /// Peak-to-peak passband ripple, drawn per port with a random phase.
+  Spread ripple_db{0.4, 0.15};
+  double ripple_period_slices = 12.0;
+  /// Probability that a given (port, slice) pixel column is stuck.
+  double pixel_defect_rate = 2e-4;
+  /// A channel fails if any slice is defective, if its worst-slice loss
+  /// (insertion loss + ripple + attenuation) exceeds max_loss_db, or if its
+  /// in-band ripple exceeds max_ripple_db.
+  double max_loss_db = 26.0;
+  double max_ripple_db = 1.0;
+  std::uint64_t seed = 1;
+};
+
+/// Sampled characteristics of one WSS half of one unit.
+struct HalfVariation {
+  std::array<double, kNumPorts> insertion_loss_db{};
+  std::array<double, kNumPorts> ripple_db{};
+  std::array<double, kNumPorts> ripple_phase{};
+  std::array<SliceBitmap, kNumPorts> defects{};
+
+  /// Loss through `port` (1-based) at `slice`, excluding attenuation.
+  double loss_db(int port, int slice, double period_slices) const;
+};
+
+struct UnitVariation {
+  std::array<HalfVariation, kNumHalves> halves{};
+};
+
+struct UnitResult {
+  bool passed = true;
+  std::uint16_t failed_channels = 0;
+  std::uint16_t defective_channels = 0;
+  double worst_loss_db = 0.0;
+  double worst_ripple_db = 0.0;
+};
+
+/// Outcome of evaluating one plan across a population of units.
+struct SweepResult {
+  std::size_t units = 0;
+  std::size_t passed = 0;
+  double mean_worst_loss_db = 0.0;
+  double max_worst_loss_db = 0.0;
+  double max_ripple_db = 0.0;
+  /// Channels in plan order (half A, then half B) and how many units each
+  /// failed on.
+  std::vector<std::pair<Half, ChannelId>> channels;
+  std::vector<std::uint32_t> channel_failures;
+  /// One entry per unit, indexed by unit number.
+  std::vector<UnitResult> per_unit;
+
+  double yield() const { return units ? static_cast<double>(passed) / units : 0.0; }
+};
+
+/// Qualifies a channel plan against manufacturing spread. Unit `u` is drawn
+/// from Philox stream `u` of the configured seed, so a unit's sample and
+/// result depend only on (seed, u) and never on how units are scheduled
+/// across threads. Units are sampled on the fly rather than kept, and any
+/// one can be re-created with sample().
+class VariationSweep {
+ public:
+  explicit VariationSweep(const VariationConfig& config = {}) : config_(config) {}
+
+  const VariationConfig& config() const { return config_; }
+
+  UnitVariation sample(std::uint64_t unit) const;
+
+  /// Evaluates the channel plan of `plan` (both halves) on one sampled unit.
+  UnitResult evaluate(const TwinModule& plan, const UnitVariation& unit,
+                      std::uint8_t* channel_failed = nullptr) const;
+
+  /// Evaluates the plan on units [0, units) in parallel on `pool`.
+  SweepResult run(const TwinModule& plan, std::size_t units, ThreadPool& pool) const;
+
+ private:
+  VariationConfig config_;
+};
+
+}  // namespace twin
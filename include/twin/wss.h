@@ -0,0 +1,136 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+#include "twin/id_map.h"
+#include "twin/interval_index.h"
+#include "twin/spectrum.h"
+#include "twin/status.h"
+#include "twin/units.h"
+
+namespace twin {
+
+using ChannelId = std::uint32_t;
+
+inline constexpr Attenuation kMinAttenuation = Attenuation::from_tenths(0);
+inline constexpr Attenuation kMaxAttenuation = Attenuation::from_tenths(200);
+
+/// A media channel switched from the common port to one output port.
+struct ChannelSpec {
+  ChannelId id = 0;
+  std::uint8_t port = 0;  ///< 1-based output port.
+  std::uint16_t first_slice = 0;
+  std::uint16_t num_slices = 0;
+  Attenuation attenuation;
+};
+
+using Channel = ChannelSpec;
+
+class WssHalf;
+
+/// Notified after every change to a WSS half's channel table.
+class WssObserver {
+ public:
+  virtual ~WssObserver() = default;
+
+  /// `before` is null for an add and `after` is null for a delete.
+  virtual void on_channel_change(const WssHalf& wss, const Channel* before,
+                                 const Channel* after) = 0;
+  /// The whole table was replaced by a plan commit or clear().
+  virtual void on_reset(const WssHalf& wss) = 0;
+};
+
+/// One 1x20 wavelength selective switch. Every slice of the common port is
+/// steered to at most one output port, so a slice in use on any port is
+/// unavailable to all others.
+///
+/// Tables only grow, so once a half has held its peak channel count (or
+/// after reserve()), add, delete, retune, attenuation and snapshots do not
+/// touch the heap.
+class WssHalf {
+ public:
+  WssHalf() = default;
+
+  Status add_channel(const ChannelSpec& spec);
+  Status delete_channel(ChannelId id);
+  Status retune_channel(ChannelId id, int first_slice, int num_slices);
+  Status set_attenuation(ChannelId id, Attenuation attenuation);
+
+  /// Replaces the whole channel table. The plan is validated as a unit and
+  /// nothing changes unless every entry is acceptable.
+  Status commit_plan(std::span<const ChannelSpec> plan);
+
+  /// Checks a plan without applying it.
+  static Status validate_plan(std::span<const ChannelSpec> plan);
+
+  const Channel* find(ChannelId id) const;
+  std::span<const Channel> channels() const { return channels_; }
+  std::size_t num_channels() const { return channels_.size(); }
+
+  /// Occupancy of output `port` (1-based).
+  const SliceBitmap& port_occupancy(int port) const { return ports_[port - 1]; }
+  /// Union of all port occupancies.
+  const SliceBitmap& common_occupancy() const { return common_; }
+
+  /// Channel on `port` whose passband contains `freq`, or nullptr.
+  const Channel* channel_at(int port, Frequency freq) const;
+  /// Channel on any port whose passband contains `freq`, or nullptr.
+  const Channel* channel_at(Frequency freq) const;
+  /// Passbands on `port` overlapping [lower, upper), ascending.
+  std::span<const IntervalIndex::Entry> overlapping(int port, Frequency lower,
+                                                    Frequency upper) const;
+  /// Passbands on any port overlapping [lower, upper), ascending.
+  std::span<const IntervalIndex::Entry> overlapping(Frequency lower, Frequency upper) const;
+
+  void clear();
+
+  /// Pre-sizes the channel table and the whole-half interval index for
+  /// `channels` entries, and each port's index for `per_port`.
+  void reserve(std::size_t channels, std::size_t per_port);
+
+  /// Observers are not owned and are not carried over when a half is copied.
+  void add_observer(WssObserver* o) { observers_.list.push_back(o); }
+  void remove_observer(WssObserver* o) { std::erase(observers_.list, o); }
+
+  static bool valid_port(int port) { return port >= 1 && port <= kNumPorts; }
+  static bool valid_attenuation(Attenuation a) {
+    return a >= kMinAttenuation && a <= kMaxAttenuation;
+  }
+
+ private:
+  struct ObserverList {
+    ObserverList() = default;
+    ObserverList(const ObserverList&) {}
+    ObserverList& operator=(const ObserverList&) { return *this; }
+    std::vector<WssObserver*> list;
+  };
+
+  void notify(const Channel* before, const Channel* after) const {
+    for (WssObserver* o : observers_.list) o->on_channel_change(*this, before, after);
+  }
+  void notify_reset() const {
+    for (WssObserver* o : observers_.list) o->on_reset(*this);
+  }
+
+  static Status check_spec(const ChannelSpec& spec);
+  void erase_at(std::size_t pos);
+  void reset_tables();
+  void index_insert(const Channel& ch);
+  void index_erase(const Channel& ch);
+  std::span<const IntervalIndex::Entry> overlapping(const IntervalIndex& idx, Frequency lower,
+                                                    Frequency upper) const;
+
+  std::array<SliceBitmap, kNumPorts> ports_{};
+  SliceBitmap common_;
+  /// Passband edges per port and for the whole half, for frequency lookups.
+  std::array<IntervalIndex, kNumPorts> port_index_{};
+  IntervalIndex common_index_;
+  std::vector<Channel> channels_;
+  ChannelIdMap index_;
+  ObserverList observers_;
+};
+
+}  // namespace twin
@@ -0,0 +1,267 @@
+#include "twin/alarm.h"
+
+#include <algorithm>
+
+namespace twin {
+
+const char* to_string(AlarmType t) {
+  switch (t) {
+    case AlarmType::kLossOfLight:
+      return "loss-of-light";
+    case AlarmType::kAttenuationHigh:
+      return "attenuation-high";
+    case AlarmType::kTemperature:
+      return "temperature";
+    case AlarmType::kCommandFailure:
+      return "command-failure";
+  }
+  return "unknown";
+}
+
+class AlarmEngine::Watch : public WssObserver {
+ public:
+  Watch(AlarmEngine& engine, std::uint32_t module, Half half, WssHalf& wss)
+      : engine_(engine), module_(module), half_(half), wss_(wss) {
+    wss_.add_observer(this);
+  }
+  ~Watch() override { wss_.remove_observer(this); }
+
+  void on_channel_change(const WssHalf& wss, const Channel* before,
+                         const Channel* after) override {
+    if (before) engine_.evaluate_port(module_, half_, wss, before->port);
+    if (after && (!before || after->port != before->port)) {
+      engine_.evaluate_port(module_, half_, wss, after->port);
+    }
+    if (after) {
+      engine_.evaluate_channel(module_, half_, *after);
+    } else {
+      engine_.set_condition({module_, before->id, half_, AlarmType::kAttenuationHigh}, false,
+                            before->attenuation.db());
+    }
+  }
+
+  void on_reset(const WssHalf& wss) override { engine_.evaluate_half(module_, half_, wss); }
+
+ private:
+  AlarmEngine& engine_;
+  std::uint32_t module_;
+  Half half_;
+  WssHalf& wss_;
+};
+
+AlarmEngine::AlarmEngine(const AlarmOptions& opts) : opts_(opts), tokens_(opts.burst) {}
+
+AlarmEngine::~AlarmEngine() = default;
+
+AlarmEngine::HalfInfo& AlarmEngine::info(std::uint32_t module, Half half) {
+  return halves_[std::uint64_t{module} * kNumHalves + index_of(half)];
+}
+
+void AlarmEngine::attach(std::uint32_t module, Half half, WssHalf& wss) {
+  info(module, half).wss = &wss;
+  watches_.push_back(std::make_unique<Watch>(*this, module, half, wss));
+  evaluate_half(module, half, wss);
+}
+
+void AlarmEngine::attach(std::uint32_t module, TwinModule& m) {
+  for (Half h : {Half::kA, Half::kB}) attach(module, h, m.half(h));
+}
+
+void AlarmEngine::set_in_service(std::uint32_t module, Half half, int port, bool in_service) {
+  if (!WssHalf::valid_port(port)) return;
+  HalfInfo& hi = info(module, half);
+  hi.in_service.set(static_cast<std::size_t>(port - 1), in_service);
+  if (hi.wss) evaluate_port(module, half, *hi.wss, port);
+}
+
+void AlarmEngine::evaluate_port(std::uint32_t module, Half half, const WssHalf& wss, int port) {
+  HalfInfo& hi = info(module, half);
+  const bool light = !wss.port_occupancy(port).none();
+  if (light && opts_.auto_in_service) hi.in_service.set(static_cast<std::size_t>(port - 1));
+  const bool los = hi.in_service.test(static_cast<std::size_t>(port - 1)) && !light;
+  set_condition({module, static_cast<std::uint32_t>(port), half, AlarmType::kLossOfLight}, los,
+                0.0);
+}
+
+void AlarmEngine::evaluate_channel(std::uint32_t module, Half half, const Channel& ch) {
+  set_condition({module, ch.id, half, AlarmType::kAttenuationHigh},
+                ch.attenuation >= opts_.attenuation_high, ch.attenuation.db());
+}
+
+void AlarmEngine::evaluate_half(std::uint32_t module, Half half, const WssHalf& wss) {
+  for (int port = 1; port <= kNumPorts; ++port) evaluate_port(module, half, wss, port);
+  // Channels that vanished with a plan replacement clear their alarms.
+  std::vector<std::uint32_t> gone;
+  for (std::uint32_t id : info(module, half).attenuation_high) {
+    if (!wss.find(id)) gone.push_back(id);
+  }
+  for (std::uint32_t id : gone) {
+    const Key key{module, id, half, AlarmType::kAttenuationHigh};
+    set_condition(key, false, states_.at(key).value);
+  }
+  for (const Channel& ch : wss.channels()) evaluate_channel(module, half, ch);
+}
+
+void AlarmEngine::set_condition(const Key& key, bool raw, double value) {
+  ++stats_.evaluations;
+  auto it = states_.find(key);
+  if (it == states_.end()) {
+    // Absent conditions with no history need no state.
+    if (!raw) return;
+    it = states_.emplace(key, State{}).first;
+  }
+  State& st = it->second;
+  st.value = value;
+  if (st.raw == raw) return;
+  st.raw = raw;
+  st.changed = now_;
+  ++st.transitions;
+  if (key.type == AlarmType::kAttenuationHigh) {
+    std::vector<std::uint32_t>& ids = info(key.module, key.half).attenuation_high;
+    if (raw) {
+      ids.push_back(key.object);
+    } else {
+      ids.erase(std::find(ids.begin(), ids.end(), key.object));
+    }
+  }
+  st.pending = st.raw != st.active;
+  if (st.pending && !st.queued) {
+    st.queued = true;
+    pending_.push_back(key);
+  }
+  if (st.pending) try_emit(key, st);
+}
+
+void AlarmEngine::report_temperature(std::uint32_t module, double celsius) {
+  const Key key{module, 0, Half::kA, AlarmType::kTemperature};
+  auto it = states_.find(key);
+  const bool raised = it != states_.end() && it->second.raw;
+  set_condition(key, celsius > (raised ? opts_.temperature_clear_c : opts_.temperature_high_c),
+                celsius);
+}
+
+void AlarmEngine::report_command(std::uint32_t module, Half half, Status status) {
+  if (status == Status::kOk) return;
+  const Key key{module, 0, half, AlarmType::kCommandFailure};
+  State& st = states_[key];
+  ++stats_.evaluations;
+  st.value = (st.raw ? st.value : 0.0) + 1.0;
+  st.expires = now_ + opts_.command_failure_window_us;
+  if (!st.raw) {
+    st.raw = true;
+    st.changed = now_;
+    ++st.transitions;
+    st.pending = !st.active;
+  }
+  // Queued while raised so advance() sees the window expire.
+  if (!st.queued) {
+    st.queued = true;
+    pending_.push_back(key);
+  }
+  if (st.pending) try_emit(key, st);
+}
+
+bool AlarmEngine::try_emit(const Key& key, State& st) {
+  VirtualTime hold = st.raw ? opts_.raise_hold_us : opts_.clear_hold_us;
+  if (key.type == AlarmType::kCommandFailure) hold = 0;
+  if (now_ - st.changed < hold) return false;
+  if (tokens_ < 1.0) {
+    ++stats_.deferred;
+    return false;
+  }
+  tokens_ -= 1.0;
+  st.active = st.raw;
+  st.pending = false;
+  if (st.active) {
+    ++stats_.active;
+  } else {
+    --stats_.active;
+  }
+
+  AlarmEvent ev;
+  ev.seq = ++seq_;
+  ev.time = now_;
+  ev.type = key.type;
+  ev.raised = st.active;
+  ev.half = key.half;
+  ev.module = key.module;
+  ev.object = key.object;
+  ev.transitions = st.transitions;
+  ev.value = st.value;
+  st.transitions = 0;
+  ++stats_.events;
+  publish(ev);
+  return true;
+}
+
+void AlarmEngine::advance(VirtualTime now) {
+  if (now > now_) {
+    const double refill = static_cast<double>(now - now_) * opts_.events_per_second / 1e6;
+    tokens_ = std::min(opts_.burst, tokens_ + refill);
+    now_ = now;
+  }
+  std::size_t i = 0;
+  while (i < pending_.size()) {
+    const Key key = pending_[i];
+    auto it = states_.find(key);
+    State& st = it->second;
+    if (key.type == AlarmType::kCommandFailure && st.raw && now_ >= st.expires) {
+      st.raw = false;
+      st.changed = st.expires;
+      ++st.transitions;
+      st.pending = st.active;
+    }
+    if (st.pending) try_emit(key, st);
+    // A condition that flapped back unreported stays for one raise hold, so
+    // further flaps inside it are still counted.
+    const bool flapped = !st.raw && !st.active && st.transitions > 0 &&
+                         now_ - st.changed < opts_.raise_hold_us;
+    const bool keep =
+        st.pending || flapped || (key.type == AlarmType::kCommandFailure && st.raw);
+    if (keep) {
+      ++i;
+      continue;
+    }
+    st.queued = false;
+    pending_[i] = pending_.back();
+    pending_.pop_back();
+    // Quiet conditions are then forgotten, along with their flap count. An
+    // active one keeps its state, so a blip's transitions ride along on its
+    // clear.
+    if (!st.raw && !st.active) states_.erase(it);
+  }
+}
+
+AlarmSubscription* AlarmEngine::subscribe(std::size_t capacity) {
+  std::lock_guard lock(subscribe_mu_);
+  const std::size_t n = num_subs_.load(std::memory_order_relaxed);
+  if (n == kMaxSubscribers) return nullptr;
+  subs_[n] = std::make_unique<AlarmSubscription>(capacity);
+  num_subs_.store(n + 1, std::memory_order_release);
+  return subs_[n].get();
+}
+
+void AlarmEngine::publish(const AlarmEvent& ev) {
+  const std::size_t n = num_subs_.load(std::memory_order_acquire);
+  for (std::size_t i = 0; i < n; ++i) {
+    AlarmSubscription& sub = *subs_[i];
+    if (sub.closed_.load(std::memory_order_acquire)) continue;
+    if (!sub.queue_.try_push(ev)) sub.dropped_.fetch_add(1, std::memory_order_relaxed);
+  }
+}
+
+bool AlarmEngine::active(AlarmType type, std::uint32_t module, Half half,
+                         std::uint32_t object) const {
+  auto it = states_.find(Key{module, object, half, type});
+  return it != states_.end() && it->second.active;
+}
+
+AlarmStats AlarmEngine::stats() const {
+  AlarmStats s = stats_;
+  s.tracked = states_.size();
+  s.pending = 0;
+  for (const Key& key : pending_) s.pending += states_.at(key).pending;
+  return s;
+}
+
+}  // namespace twin
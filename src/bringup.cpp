@@ -0,0 +1,90 @@
+#include "twin/bringup.h"
+
+#include <algorithm>
+#include <chrono>
+#include <functional>
+#include <queue>
+
+namespace twin {
+
+const char* to_string(ModuleState s) {
+  switch (s) {
+    case ModuleState::kOff:
+      return "off";
+    case ModuleState::kBooting:
+      return "booting";
+    case ModuleState::kLoadingCalibration:
+      return "loading-calibration";
+    case ModuleState::kInitialising:
+      return "initialising";
+    case ModuleState::kReady:
+      return "ready";
+  }
+  return "unknown";
+}
+
+ModuleState ModuleTimeline::state_at(VirtualTime t) const {
+  if (t < start) return ModuleState::kOff;
+  if (t < booted) return ModuleState::kBooting;
+  if (t < calibrated) return ModuleState::kLoadingCalibration;
+  if (t < ready) return ModuleState::kInitialising;
+  return ModuleState::kReady;
+}
+
+BringUpReport bring_up(std::span<TwinModule> modules, CalibrationCache& cache, ThreadPool& pool,
+                       const BringUpOptions& opts) {
+  const auto t0 = std::chrono::steady_clock::now();
+  const std::size_t loads_before = cache.loads();
+  const std::size_t hits_before = cache.hits();
+  const bool warm = opts.kind == StartKind::kWarm;
+
+  // A cold start loses the plan. Halves are cleared here, serially, because
+  // clear() notifies their observers and those are not thread-safe.
+  if (!warm) {
+    for (TwinModule& m : modules) {
+      m.half(Half::kA).clear();
+      m.half(Half::kB).clear();
+    }
+  }
+
+  // A calibration that matches the module's type is kept across either
+  // start, so per-unit tables survive; only a warm start counts it as
+  // retained and skips the flash read.
+  std::vector<std::uint8_t> retained(modules.size());
+  pool.parallel_for(modules.size(), [&](std::size_t i) {
+    TwinModule& m = modules[i];
+    const Calibration* cal = m.calibration();
+    if (cal && cal->module_type == m.module_type()) {
+      retained[i] = warm;
+      return;
+    }
+    m.set_calibration(cache.get(m.module_type()));
+  });
+
+  // Durations only depend on the module, so the schedule is computed
+  // serially in index order and is the same for any pool size.
+  const StartupTiming& t = opts.timing;
+  BringUpReport report;
+  report.timelines.resize(modules.size());
+  const std::size_t slots = opts.max_concurrent ? opts.max_concurrent : modules.size();
+  std::priority_queue<VirtualTime, std::vector<VirtualTime>, std::greater<>> free_at;
+  for (std::size_t i = 0; i < slots && i < modules.size(); ++i) free_at.push(0);
+  for (std::size_t i = 0; i < modules.size(); ++i) {
+    ModuleTimeline& tl = report.timelines[i];
+    tl.start = free_at.top();
+    free_at.pop();
+    tl.booted = tl.start + (warm ? t.warm_boot_us : t.cold_boot_us);
+    tl.calibrated = tl.booted + (retained[i] ? t.calibration_verify_us : t.calibration_load_us);
+    tl.ready = tl.calibrated + t.ready_us;
+    free_at.push(tl.ready);
+    report.makespan_us = std::max(report.makespan_us, tl.ready);
+  }
+
+  report.calibration_loads = cache.loads() - loads_before;
+  report.calibration_hits = cache.hits() - hits_before;
+  report.wall_seconds =
+      std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+  return report;
+}
+
+}  // namespace twin
@@ -0,0 +1,325 @@
+#include "twin/calibration.h"
+
+#include <algorithm>
+#include <charconv>
+#include <cmath>
+#include <fstream>
+#include <iterator>
+#include <numbers>
+#include <vector>
+
+#include "twin/philox.h"
+
+namespace twin {
+
+namespace {
+
+std::uint64_t type_seed(std::string_view type) {
+  std::uint64_t h = 0xCBF29CE484222325ull;
+  for (char c : type) h = (h ^ static_cast<unsigned char>(c)) * 0x100000001B3ull;
+  return h;
+}
+
+enum class Field : std::uint8_t { kLoss, kSlope, kPixel };
+
+struct Record {
+  Field field;
+  std::uint8_t half;
+  std::uint8_t port;
+  std::uint16_t index;
+  double value;
+};
+
+struct Chunk {
+  std::vector<Record> records;
+  std::size_t lines = 0;
+  std::size_t error_line = 0;  ///< 1-based within the chunk.
+  std::string_view type;
+  std::string_view serial;
+};
+
+// Splits "a,b,c" into at most `max` fields; returns the count, or max + 1
+// if there are more.
+std::size_t split(std::string_view line, std::string_view* out, std::size_t max) {
+  std::size_t n = 0;
+  for (;;) {
+    const std::size_t comma = line.find(',');
+    if (n == max) return max + 1;
+    out[n++] = line.substr(0, comma);
+    if (comma == std::string_view::npos) return n;
+    line.remove_prefix(comma + 1);
+  }
+}
+
+template <typename T>
+bool parse_number(std::string_view s, T& out) {
+  const char* end = s.data() + s.size();
+  auto [ptr, ec] = std::from_chars(s.data(), end, out);
+  return ec == std::errc() && ptr == end;
+}
+
+bool parse_half(std::string_view s, std::uint8_t& out) {
+  if (s == "A" || s == "a") {
+    out = 0;
+  } else if (s == "B" || s == "b") {
+    out = 1;
+  } else {
+    return false;
+  }
+  return true;
+}
+
+bool parse_line(std::string_view line, Chunk& c) {
+  std::string_view f[6];
+  const std::size_t n = split(line, f, 5);
+  if (f[0] == "type" && n == 2 && !f[1].empty()) {
+    c.type = f[1];
+    return true;
+  }
+  if (f[0] == "serial" && n == 2) {
+    c.serial = f[1];
+    return true;
+  }
+  Record r{};
+  int port = 0;
+  int index = 0;
+  if (f[0] == "loss" && n == 5) {
+    r.field = Field::kLoss;
+    if (!parse_half(f[1], r.half) || !parse_number(f[2], port) || !parse_number(f[3], index) ||
+        !parse_number(f[4], r.value)) {
+      return false;
+    }
+    if (!WssHalf::valid_port(port) || index < 0 || index >= kNumSlices ||
+        !Calibration::representable(r.value, Calibration::kLossStepDb)) {
+      return false;
+    }
+  } else if (f[0] == "slope" && n == 4) {
+    r.field = Field::kSlope;
+    if (!parse_half(f[1], r.half) || !parse_number(f[2], port) || !parse_number(f[3], r.value)) {
+      return false;
+    }
+    if (!WssHalf::valid_port(port) || !std::isfinite(r.value)) return false;
+  } else if (f[0] == "pixel" && n == 4) {
+    r.field = Field::kPixel;
+    if (!parse_half(f[1], r.half) || !parse_number(f[2], index) || !parse_number(f[3], r.value)) {
+      return false;
+    }
+    if (index < 0 || index > kNumSlices ||
+        !Calibration::representable(r.value, Calibration::kPixelStep)) {
+      return false;
+    }
+  } else {
+    return false;
+  }
+  r.port = static_cast<std::uint8_t>(port);
+  r.index = static_cast<std::uint16_t>(index);
+  c.records.push_back(r);
+  return true;
+}
+
+void parse_chunk(std::string_view text, Chunk& c) {
+  c.records.reserve(text.size() / 20);
+  while (!text.empty()) {
+    const std::size_t nl = text.find('\n');
+    std::string_view line = text.substr(0, nl);
+    text.remove_prefix(nl == std::string_view::npos ? text.size() : nl + 1);
+    ++c.lines;
+    if (!line.empty() && line.back() == '\r') line.remove_suffix(1);
+    if (line.empty() || line.front() == '#') continue;
+    if (!parse_line(line, c)) {
+      c.error_line = c.lines;
+      return;
+    }
+  }
+}
+
+void append_number(std::string& out, double v, int precision) {
+  char buf[32];
+  auto [ptr, ec] = std::to_chars(buf, buf + sizeof buf, v, std::chars_format::fixed, precision);
+  out.append(buf, ptr);
+}
+
+}  // namespace
+
+Calibration make_calibration(std::string_view module_type) {
+  Calibration cal;
+  cal.module_type = module_type;
+  const std::uint64_t seed = type_seed(module_type);
+  for (int h = 0; h < kNumHalves; ++h) {
+    for (int p = 0; p < kNumPorts; ++p) {
+      PhiloxStream rng(seed, static_cast<std::uint64_t>(h * kNumPorts + p));
+      const double base = 5.0 + 0.02 * p + 0.3 * rng.normal();
+      const double ripple = 0.1 + 0.05 * rng.uniform();
+      const double phase = 2.0 * std::numbers::pi * rng.uniform();
+      cal.attenuation_slope[h][p] = static_cast<float>(1.0 + 0.01 * rng.normal());
+      for (int s = 0; s < kNumSlices; ++s) {
+        // Flat passband with ripple, rolling off over the outer ~5% of the band.
+        const double x = (s + 0.5) / kNumSlices;
+        const double edge = std::exp(-x / 0.02) + std::exp(-(1.0 - x) / 0.02);
+        cal.set_loss_db(static_cast<Half>(h), p + 1, s,
+                        base + ripple * std::sin(phase + 0.3 * s) + 3.0 * edge);
+      }
+    }
+    // About five pixel columns per slice, with a slight quadratic dispersion
+    // across the panel and a per-half alignment offset.
+    PhiloxStream rng(seed, static_cast<std::uint64_t>(kNumHalves * kNumPorts + h));
+    const double offset = 40.0 + 4.0 * rng.uniform();
+    for (int e = 0; e <= kNumSlices; ++e) {
+      const double d = e - kNumSlices / 2.0;
+      cal.set_pixel(static_cast<Half>(h), e, offset + 4.9 * e + 1.5e-4 * d * d);
+    }
+  }
+  return cal;
+}
+
+CalibrationParse parse_calibration_csv(std::string_view text, Calibration& out, ThreadPool& pool) {
+  // Line-aligned chunks, a few per thread, but never so small that the
+  // per-chunk overhead shows.
+  constexpr std::size_t kMinChunk = 64 * 1024;
+  const std::size_t target = std::max(kMinChunk, text.size() / (pool.size() * 4) + 1);
+  std::vector<std::string_view> pieces;
+  while (!text.empty()) {
+    std::size_t end = std::min(text.size(), target);
+    if (end < text.size()) {
+      const std::size_t nl = text.find('\n', end - 1);
+      end = nl == std::string_view::npos ? text.size() : nl + 1;
+    }
+    pieces.push_back(text.substr(0, end));
+    text.remove_prefix(end);
+  }
+
+  std::vector<Chunk> chunks(pieces.size());
+  pool.parallel_for(pieces.size(), [&](std::size_t i) { parse_chunk(pieces[i], chunks[i]); });
+
+  CalibrationParse result;
+  for (const Chunk& c : chunks) {
+    if (c.error_line != 0) {
+      result.status = Status::kParseError;
+      result.error_line = result.lines + c.error_line;
+      return result;
+    }
+    result.lines += c.lines;
+    result.records += c.records.size();
+  }
+  // Nothing is applied unless the whole text parsed. File order decides
+  // duplicates.
+  for (const Chunk& c : chunks) {
+    if (!c.type.empty()) out.module_type = c.type;
+    if (!c.serial.empty()) out.serial = c.serial;
+    for (const Record& r : c.records) {
+      const Half h = static_cast<Half>(r.half);
+      switch (r.field) {
+        case Field::kLoss:
+          out.set_loss_db(h, r.port, r.index, r.value);
+          break;
+        case Field::kSlope:
+          out.attenuation_slope[r.half][r.port - 1] = static_cast<float>(r.value);
+          break;
+        case Field::kPixel:
+          out.set_pixel(h, r.index, r.value);
+          break;
+      }
+    }
+  }
+  return result;
+}
+
+CalibrationParse load_calibration_file(const std::string& path, Calibration& out,
+                                       ThreadPool& pool) {
+  std::ifstream in(path, std::ios::binary);
+  if (!in) return {Status::kIoError, 0, 0, 0};
+  const std::string text(std::istreambuf_iterator<char>(in), {});
+  return parse_calibration_csv(text, out, pool);
+}
+
+void format_calibration_csv(const Calibration& cal, std::string& out) {
+  out += "# twin calibration\n";
+  out += "type,";
+  out += cal.module_type;
+  out += '\n';
+  if (!cal.serial.empty()) {
+    out += "serial,";
+    out += cal.serial;
+    out += '\n';
+  }
+  for (int h = 0; h < kNumHalves; ++h) {
+    const char* half = to_string(static_cast<Half>(h));
+    for (int p = 1; p <= kNumPorts; ++p) {
+      out += "slope,";
+      out += half;
+      out += ',';
+      out += std::to_string(p);
+      out += ',';
+      char buf[32];
+      auto [ptr, ec] = std::to_chars(buf, buf + sizeof buf, cal.attenuation_slope[h][p - 1]);
+      out.append(buf, ptr);
+      out += '\n';
+    }
+    for (int e = 0; e <= kNumSlices; ++e) {
+      out += "pixel,";
+      out += half;
+      out += ',';
+      out += std::to_string(e);
+      out += ',';
+      append_number(out, cal.pixel_at(static_cast<Half>(h), e), 4);
+      out += '\n';
+    }
+    for (int p = 1; p <= kNumPorts; ++p) {
+      for (int s = 0; s < kNumSlices; ++s) {
+        out += "loss,";
+        out += half;
+        out += ',';
+        out += std::to_string(p);
+        out += ',';
+        out += std::to_string(s);
+        out += ',';
+        append_number(out, cal.insertion_loss[h][p - 1][s] * Calibration::kLossStepDb, 3);
+        out += '\n';
+      }
+    }
+  }
+}
+
+bool CalibrationCache::insert(std::shared_ptr<const Calibration> cal) {
+  std::lock_guard lock(mu_);
+  auto [it, fresh] = entries_.emplace(cal->module_type, nullptr);
+  if (!fresh) return false;
+  it->second = std::make_shared<Entry>();
+  // Completed under the lock so no get() can start synthesising first.
+  Entry& e = *it->second;
+  std::call_once(e.once, [&] { e.cal = std::move(cal); });
+  return true;
+}
+
+std::shared_ptr<const Calibration> CalibrationCache::get(std::string_view module_type) {
+  std::shared_ptr<Entry> e;
+  {
+    std::lock_guard lock(mu_);
+    auto it = entries_.find(std::string(module_type));
+    if (it == entries_.end()) {
+      it = entries_.emplace(std::string(module_type), std::make_shared<Entry>()).first;
+    } else {
+      ++hits_;
+    }
+    e = it->second;
+  }
+  // Built outside the map lock so different types load in parallel.
+  std::call_once(e->once, [&] {
+    e->cal = std::make_shared<const Calibration>(make_calibration(module_type));
+    std::lock_guard lock(mu_);
+    ++loads_;
+  });
+  return e->cal;
+}
+
+std::size_t CalibrationCache::loads() const {
+  std::lock_guard lock(mu_);
+  return loads_;
+}
+
+std::size_t CalibrationCache::hits() const {
+  std::lock_guard lock(mu_);
+  return hits_;
+}
+
+}  // namespace twin
@@ -0,0 +1,361 @@
+#include "twin/checkpoint.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <bit>
+#include <cerrno>
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "twin/calibration.h"
+
+namespace twin {
+
+// Channel records are read in place, so the on-disk layout is ChannelSpec's.
+static_assert(std::endian::native == std::endian::little, "checkpoints are little-endian");
+static_assert(std::is_trivially_copyable_v<ChannelSpec>);
+static_assert(sizeof(ChannelSpec) == 12 && alignof(ChannelSpec) == 4);
+static_assert(offsetof(ChannelSpec, id) == 0 && offsetof(ChannelSpec, port) == 4 &&
+              offsetof(ChannelSpec, first_slice) == 6 && offsetof(ChannelSpec, num_slices) == 8 &&
+              offsetof(ChannelSpec, attenuation) == 10);
+static_assert(sizeof(CheckpointHeader) == 40 && sizeof(CheckpointModule) == 64);
+// Calibration records are the tables byte for byte.
+static_assert(sizeof(CheckpointCalibration::insertion_loss) == sizeof(Calibration::insertion_loss));
+static_assert(sizeof(CheckpointCalibration::attenuation_slope) ==
+              sizeof(Calibration::attenuation_slope));
+static_assert(sizeof(CheckpointCalibration::pixel_edge) == sizeof(Calibration::pixel_edge));
+static_assert(sizeof(CheckpointCalibration) % 8 == 0 && alignof(CheckpointCalibration) == 8);
+
+namespace {
+
+constexpr std::size_t kAlign = 8;
+
+std::size_t align_up(std::size_t n) { return (n + kAlign - 1) & ~(kAlign - 1); }
+
+// Each half's records start on an aligned offset.
+std::size_t channel_bytes(const TwinModule& m) {
+  return align_up(m.half(Half::kA).num_channels() * sizeof(ChannelSpec)) +
+         align_up(m.half(Half::kB).num_channels() * sizeof(ChannelSpec));
+}
+
+template <typename T>
+void put(std::byte* p, const T& v) {
+  std::memcpy(p, &v, sizeof v);
+}
+
+// Word-at-a-time multiply-xorshift; the length is a multiple of 8.
+std::uint64_t checksum(const std::byte* p, std::size_t n) {
+  std::uint64_t h = 0x9E3779B97F4A7C15ull ^ n;
+  for (std::size_t i = 0; i < n; i += 8) {
+    std::uint64_t w;
+    std::memcpy(&w, p + i, 8);
+    h = (h ^ w) * 0xBF58476D1CE4E5B9ull;
+    h ^= h >> 31;
+  }
+  return h;
+}
+
+bool in_bounds(std::uint64_t offset, std::uint64_t size, std::uint64_t total) {
+  return offset <= total && size <= total - offset;
+}
+
+// Distinct calibrations in first-use order, and each module's index into
+// them. Units of one type share an instance, so this is usually one per type.
+struct CalibrationIndex {
+  std::vector<const Calibration*> distinct;
+  std::vector<std::uint32_t> of_module;
+
+  explicit CalibrationIndex(std::span<const TwinModule> modules) {
+    std::unordered_map<const Calibration*, std::uint32_t> seen;
+    of_module.reserve(modules.size());
+    for (const TwinModule& m : modules) {
+      const Calibration* cal = m.calibration();
+      if (!cal) {
+        of_module.push_back(CheckpointModule::kNoCalibration);
+        continue;
+      }
+      const auto [it, added] = seen.try_emplace(cal, static_cast<std::uint32_t>(distinct.size()));
+      if (added) distinct.push_back(cal);
+      of_module.push_back(it->second);
+    }
+  }
+};
+
+std::size_t checkpoint_size(std::span<const TwinModule> modules, const CalibrationIndex& cals) {
+  std::size_t n = sizeof(CheckpointHeader) + modules.size() * sizeof(CheckpointModule) +
+                  cals.distinct.size() * sizeof(CheckpointCalibration);
+  for (const TwinModule& m : modules) {
+    n += channel_bytes(m) + m.serial().size() + m.module_type().size();
+  }
+  for (const Calibration* cal : cals.distinct) n += cal->module_type.size() + cal->serial.size();
+  return align_up(n);
+}
+
+std::size_t put_string(std::byte* base, std::size_t& at, const std::string& s) {
+  const std::size_t offset = at;
+  std::memcpy(base + at, s.data(), s.size());
+  at += s.size();
+  return offset;
+}
+
+Status restore(const CheckpointView& view, std::size_t module, TwinModule& out,
+               std::shared_ptr<const Calibration> cal) {
+  for (Half h : {Half::kA, Half::kB}) {
+    if (Status s = WssHalf::validate_plan(view.channels(module, h)); s != Status::kOk) return s;
+  }
+  out.set_serial(std::string(view.serial(module)));
+  out.set_module_type(std::string(view.module_type(module)));
+  out.set_calibration(std::move(cal));
+  for (Half h : {Half::kA, Half::kB}) out.half(h).commit_plan(view.channels(module, h));
+  return Status::kOk;
+}
+
+}  // namespace
+
+std::size_t checkpoint_size(std::span<const TwinModule> modules) {
+  return checkpoint_size(modules, CalibrationIndex(modules));
+}
+
+void save_checkpoint(std::span<const TwinModule> modules, std::vector<std::byte>& out) {
+  const CalibrationIndex cals(modules);
+  const std::size_t total = checkpoint_size(modules, cals);
+  // Zero-filled so padding inside records is deterministic.
+  out.assign(total, std::byte{0});
+  std::byte* base = out.data();
+
+  std::size_t dir = sizeof(CheckpointHeader);
+  std::size_t cal_dir = dir + modules.size() * sizeof(CheckpointModule);
+  std::size_t chan = cal_dir + cals.distinct.size() * sizeof(CheckpointCalibration);
+  std::size_t str = chan;
+  for (const TwinModule& m : modules) str += channel_bytes(m);
+
+  for (std::size_t i = 0; i < modules.size(); ++i) {
+    const TwinModule& m = modules[i];
+    CheckpointModule e;
+    e.serial_offset = put_string(base, str, m.serial());
+    e.serial_size = m.serial().size();
+    e.module_type_offset = put_string(base, str, m.module_type());
+    e.module_type_size = m.module_type().size();
+    e.calibration = cals.of_module[i];
+    for (Half h : {Half::kA, Half::kB}) {
+      const auto channels = m.half(h).channels();
+      e.channel_offset[index_of(h)] = chan;
+      e.channel_count[index_of(h)] = static_cast<std::uint32_t>(channels.size());
+      for (const ChannelSpec& c : channels) {
+        std::byte* r = base + chan;
+        put(r + offsetof(ChannelSpec, id), c.id);
+        put(r + offsetof(ChannelSpec, port), c.port);
+        put(r + offsetof(ChannelSpec, first_slice), c.first_slice);
+        put(r + offsetof(ChannelSpec, num_slices), c.num_slices);
+        put(r + offsetof(ChannelSpec, attenuation), c.attenuation.tenths());
+        chan += sizeof(ChannelSpec);
+      }
+      chan = align_up(chan);
+    }
+    put(base + dir, e);
+    dir += sizeof(CheckpointModule);
+  }
+
+  // Tables are copied field by field; the record is too large to stage.
+  for (const Calibration* cal : cals.distinct) {
+    std::byte* r = base + cal_dir;
+    put(r + offsetof(CheckpointCalibration, module_type_offset),
+        std::uint64_t{put_string(base, str, cal->module_type)});
+    put(r + offsetof(CheckpointCalibration, module_type_size),
+        std::uint64_t{cal->module_type.size()});
+    put(r + offsetof(CheckpointCalibration, serial_offset),
+        std::uint64_t{put_string(base, str, cal->serial)});
+    put(r + offsetof(CheckpointCalibration, serial_size), std::uint64_t{cal->serial.size()});
+    put(r + offsetof(CheckpointCalibration, insertion_loss), cal->insertion_loss);
+    put(r + offsetof(CheckpointCalibration, attenuation_slope), cal->attenuation_slope);
+    put(r + offsetof(CheckpointCalibration, pixel_edge), cal->pixel_edge);
+    cal_dir += sizeof(CheckpointCalibration);
+  }
+
+  CheckpointHeader hdr;
+  hdr.num_modules = static_cast<std::uint32_t>(modules.size());
+  hdr.num_calibrations = static_cast<std::uint32_t>(cals.distinct.size());
+  hdr.total_size = total;
+  hdr.checksum = checksum(base + sizeof hdr, total - sizeof hdr);
+  put(base, hdr);
+}
+
+Status CheckpointView::open(std::span<const std::byte> blob, CheckpointView& out) {
+  const std::byte* base = blob.data();
+  const std::uint64_t total = blob.size();
+  if (total < sizeof(CheckpointHeader) || total % kAlign != 0 ||
+      reinterpret_cast<std::uintptr_t>(base) % kAlign != 0) {
+    return Status::kParseError;
+  }
+  const auto* hdr = reinterpret_cast<const CheckpointHeader*>(base);
+  if (hdr->magic != CheckpointHeader::kMagic || hdr->version != CheckpointHeader::kVersion ||
+      hdr->total_size != total) {
+    return Status::kParseError;
+  }
+  const std::uint64_t dir_bytes = std::uint64_t{hdr->num_modules} * sizeof(CheckpointModule);
+  const std::uint64_t cal_bytes =
+      std::uint64_t{hdr->num_calibrations} * sizeof(CheckpointCalibration);
+  if (!in_bounds(sizeof *hdr, dir_bytes, total) ||
+      !in_bounds(sizeof *hdr + dir_bytes, cal_bytes, total)) {
+    return Status::kParseError;
+  }
+  if (checksum(base + sizeof *hdr, total - sizeof *hdr) != hdr->checksum) return Status::kParseError;
+
+  const std::span<const CheckpointModule> modules(
+      reinterpret_cast<const CheckpointModule*>(base + sizeof *hdr), hdr->num_modules);
+  const std::span<const CheckpointCalibration> calibrations(
+      reinterpret_cast<const CheckpointCalibration*>(base + sizeof *hdr + dir_bytes),
+      hdr->num_calibrations);
+  for (const CheckpointCalibration& c : calibrations) {
+    if (!in_bounds(c.module_type_offset, c.module_type_size, total) ||
+        !in_bounds(c.serial_offset, c.serial_size, total)) {
+      return Status::kParseError;
+    }
+  }
+  for (const CheckpointModule& m : modules) {
+    if (!in_bounds(m.serial_offset, m.serial_size, total) ||
+        !in_bounds(m.module_type_offset, m.module_type_size, total)) {
+      return Status::kParseError;
+    }
+    if (m.calibration != CheckpointModule::kNoCalibration &&
+        m.calibration >= calibrations.size()) {
+      return Status::kParseError;
+    }
+    for (int h = 0; h < kNumHalves; ++h) {
+      if (m.channel_offset[h] % kAlign != 0 ||
+          !in_bounds(m.channel_offset[h], std::uint64_t{m.channel_count[h]} * sizeof(ChannelSpec),
+                     total)) {
+        return Status::kParseError;
+      }
+    }
+  }
+  out.base_ = base;
+  out.modules_ = modules;
+  out.calibrations_ = calibrations;
+  return Status::kOk;
+}
+
+std::string_view CheckpointView::serial(std::size_t module) const {
+  const CheckpointModule& m = modules_[module];
+  return {reinterpret_cast<const char*>(base_ + m.serial_offset), m.serial_size};
+}
+
+std::string_view CheckpointView::module_type(std::size_t module) const {
+  const CheckpointModule& m = modules_[module];
+  return {reinterpret_cast<const char*>(base_ + m.module_type_offset), m.module_type_size};
+}
+
+std::span<const ChannelSpec> CheckpointView::channels(std::size_t module, Half h) const {
+  const CheckpointModule& m = modules_[module];
+  return {reinterpret_cast<const ChannelSpec*>(base_ + m.channel_offset[index_of(h)]),
+          m.channel_count[index_of(h)]};
+}
+
+std::uint32_t CheckpointView::calibration_index(std::size_t module) const {
+  return modules_[module].calibration;
+}
+
+std::shared_ptr<const Calibration> CheckpointView::calibration(std::size_t index) const {
+  const CheckpointCalibration& c = calibrations_[index];
+  auto cal = std::make_shared<Calibration>();
+  cal->module_type.assign(reinterpret_cast<const char*>(base_ + c.module_type_offset),
+                          c.module_type_size);
+  cal->serial.assign(reinterpret_cast<const char*>(base_ + c.serial_offset), c.serial_size);
+  std::memcpy(&cal->insertion_loss, c.insertion_loss, sizeof c.insertion_loss);
+  std::memcpy(&cal->attenuation_slope, c.attenuation_slope, sizeof c.attenuation_slope);
+  std::memcpy(&cal->pixel_edge, c.pixel_edge, sizeof c.pixel_edge);
+  return cal;
+}
+
+Status restore_module(const CheckpointView& view, std::size_t module, TwinModule& out,
+                      CalibrationCache& cache) {
+  if (module >= view.num_modules()) return Status::kInvalidModule;
+  const std::uint32_t c = view.calibration_index(module);
+  return restore(view, module, out,
+                 c == CheckpointModule::kNoCalibration
+                     ? cache.get(view.module_type(module))
+                     : view.calibration(c));
+}
+
+Status load_checkpoint(std::span<const std::byte> blob, std::vector<TwinModule>& out,
+                       CalibrationCache& cache) {
+  CheckpointView view;
+  if (Status s = CheckpointView::open(blob, view); s != Status::kOk) return s;
+  for (std::size_t i = 0; i < view.num_modules(); ++i) {
+    for (Half h : {Half::kA, Half::kB}) {
+      if (Status s = WssHalf::validate_plan(view.channels(i, h)); s != Status::kOk) return s;
+    }
+  }
+  std::vector<std::shared_ptr<const Calibration>> cals(view.num_calibrations());
+  for (std::size_t c = 0; c < cals.size(); ++c) cals[c] = view.calibration(c);
+  out.resize(view.num_modules());
+  for (std::size_t i = 0; i < view.num_modules(); ++i) {
+    const std::uint32_t c = view.calibration_index(i);
+    restore(view, i, out[i],
+            c == CheckpointModule::kNoCalibration ? cache.get(view.module_type(i)) : cals[c]);
+  }
+  return Status::kOk;
+}
+
+Status write_checkpoint_file(const char* path, std::span<const std::byte> blob) {
+  // Written beside the target and renamed over it, so readers never map a
+  // partial checkpoint.
+  const std::string tmp = std::string(path) + ".tmp";
+  const int fd = ::open(tmp.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+  if (fd < 0) return Status::kIoError;
+  std::size_t done = 0;
+  while (done < blob.size()) {
+    const ssize_t n = ::write(fd, blob.data() + done, blob.size() - done);
+    if (n < 0 && errno == EINTR) continue;
+    if (n <= 0) break;
+    done += static_cast<std::size_t>(n);
+  }
+  const bool ok = ::close(fd) == 0 && done == blob.size();
+  if (!ok || std::rename(tmp.c_str(), path) != 0) {
+    ::unlink(tmp.c_str());
+    return Status::kIoError;
+  }
+  return Status::kOk;
+}
+
+MappedCheckpoint::~MappedCheckpoint() { close(); }
+
+void MappedCheckpoint::close() {
+  if (data_) ::munmap(const_cast<std::byte*>(data_), size_);
+  data_ = nullptr;
+  size_ = 0;
+  view_ = CheckpointView{};
+}
+
+Status MappedCheckpoint::open(const char* path) {
+  close();
+  const int fd = ::open(path, O_RDONLY | O_CLOEXEC);
+  if (fd < 0) return Status::kIoError;
+  struct stat st {};
+  if (::fstat(fd, &st) != 0 || st.st_size <= 0) {
+    ::close(fd);
+    return Status::kIoError;
+  }
+  void* p = ::mmap(nullptr, static_cast<std::size_t>(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+  ::close(fd);
+  if (p == MAP_FAILED) return Status::kIoError;
+  data_ = static_cast<const std::byte*>(p);
+  size_ = static_cast<std::size_t>(st.st_size);
+  if (Status s = CheckpointView::open(bytes(), view_); s != Status::kOk) {
+    close();
+    return s;
+  }
+  return Status::kOk;
+}
+
+}  // namespace twin
@@ -0,0 +1,210 @@
+#include "twin/command.h"
+
+#include <charconv>
+#include <cstdio>
+
+namespace twin {
+
+const char* to_string(CommandKind k) {
+  switch (k) {
+    case CommandKind::kAdd:
+      return "add";
+    case CommandKind::kDelete:
+      return "del";
+    case CommandKind::kRetune:
+      return "retune";
+    case CommandKind::kAttenuate:
+      return "atten";
+    case CommandKind::kSnapshot:
+      return "snapshot";
+  }
+  return "unknown";
+}
+
+namespace {
+
+class Tokens {
+ public:
+  explicit Tokens(std::string_view s) : s_(s) {}
+
+  bool next(std::string_view& tok) {
+    while (pos_ < s_.size() && is_space(s_[pos_])) ++pos_;
+    if (pos_ == s_.size()) return false;
+    const std::size_t start = pos_;
+    while (pos_ < s_.size() && !is_space(s_[pos_])) ++pos_;
+    tok = s_.substr(start, pos_ - start);
+    return true;
+  }
+
+  bool done() {
+    std::string_view tok;
+    return !next(tok);
+  }
+
+ private:
+  static bool is_space(char c) { return c == ' ' || c == '\t' || c == '\r' || c == '\n'; }
+
+  std::string_view s_;
+  std::size_t pos_ = 0;
+};
+
+template <typename T>
+bool parse_uint(Tokens& t, T& out) {
+  std::string_view tok;
+  if (!t.next(tok)) return false;
+  auto [p, ec] = std::from_chars(tok.data(), tok.data() + tok.size(), out);
+  return ec == std::errc{} && p == tok.data() + tok.size();
+}
+
+bool parse_double(Tokens& t, double& out) {
+  std::string_view tok;
+  if (!t.next(tok)) return false;
+  auto [p, ec] = std::from_chars(tok.data(), tok.data() + tok.size(), out);
+  return ec == std::errc{} && p == tok.data() + tok.size();
+}
+
+// dB text, rounded to the attenuator step.
+bool parse_attenuation(Tokens& t, Attenuation& out) {
+  double db;
+  if (!parse_double(t, db)) return false;
+  out = Attenuation::from_db(db);
+  return true;
+}
+
+bool parse_half(Tokens& t, Half& out) {
+  std::string_view tok;
+  if (!t.next(tok) || tok.size() != 1) return false;
+  switch (tok[0]) {
+    case 'A':
+    case 'a':
+      out = Half::kA;
+      return true;
+    case 'B':
+    case 'b':
+      out = Half::kB;
+      return true;
+  }
+  return false;
+}
+
+}  // namespace
+
+Status parse_command(std::string_view line, Command& out) {
+  Tokens t(line);
+  std::string_view verb;
+  if (!t.next(verb)) return Status::kParseError;
+
+  Command c;
+  if (verb == "add") {
+    c.kind = CommandKind::kAdd;
+  } else if (verb == "del") {
+    c.kind = CommandKind::kDelete;
+  } else if (verb == "retune") {
+    c.kind = CommandKind::kRetune;
+  } else if (verb == "atten") {
+    c.kind = CommandKind::kAttenuate;
+  } else if (verb == "snapshot") {
+    c.kind = CommandKind::kSnapshot;
+  } else {
+    return Status::kParseError;
+  }
+
+  if (!parse_uint(t, c.module) || !parse_half(t, c.half)) return Status::kParseError;
+  bool ok = true;
+  switch (c.kind) {
+    case CommandKind::kAdd:
+      ok = parse_uint(t, c.channel) && parse_uint(t, c.port) && parse_uint(t, c.first_slice) &&
+           parse_uint(t, c.num_slices);
+      if (ok) {
+        std::string_view rest;
+        Tokens probe = t;
+        if (probe.next(rest)) ok = parse_attenuation(t, c.attenuation);
+      }
+      break;
+    case CommandKind::kDelete:
+      ok = parse_uint(t, c.channel);
+      break;
+    case CommandKind::kRetune:
+      ok = parse_uint(t, c.channel) && parse_uint(t, c.first_slice) && parse_uint(t, c.num_slices);
+      break;
+    case CommandKind::kAttenuate:
+      ok = parse_uint(t, c.channel) && parse_attenuation(t, c.attenuation);
+      break;
+    case CommandKind::kSnapshot:
+      break;
+  }
+  if (!ok || !t.done()) return Status::kParseError;
+  out = c;
+  return Status::kOk;
+}
+
+void format_command(const Command& c, std::string& out) {
+  char buf[128];
+  int n = 0;
+  const char* verb = to_string(c.kind);
+  const char* half = to_string(c.half);
+  switch (c.kind) {
+    case CommandKind::kAdd:
+      n = std::snprintf(buf, sizeof buf, "%s %u %s %u %u %u %u %g", verb, c.module, half, c.channel,
+                        c.port, c.first_slice, c.num_slices, c.attenuation.db());
+      break;
+    case CommandKind::kDelete:
+      n = std::snprintf(buf, sizeof buf, "%s %u %s %u", verb, c.module, half, c.channel);
+      break;
+    case CommandKind::kRetune:
+      n = std::snprintf(buf, sizeof buf, "%s %u %s %u %u %u", verb, c.module, half, c.channel,
+                        c.first_slice, c.num_slices);
+      break;
+    case CommandKind::kAttenuate:
+      n = std::snprintf(buf, sizeof buf, "%s %u %s %u %g", verb, c.module, half, c.channel,
+                        c.attenuation.db());
+      break;
+    case CommandKind::kSnapshot:
+      n = std::snprintf(buf, sizeof buf, "%s %u %s", verb, c.module, half);
+      break;
+  }
+  out.append(buf, static_cast<std::size_t>(n));
+}
+
+Status validate_command(const Command& c, std::size_t num_modules) {
+  if (c.module >= num_modules) return Status::kInvalidModule;
+  switch (c.kind) {
+    case CommandKind::kAdd:
+      if (!WssHalf::valid_port(c.port)) return Status::kInvalidPort;
+      if (!valid_slice_range(c.first_slice, c.num_slices)) return Status::kInvalidRange;
+      if (!WssHalf::valid_attenuation(c.attenuation)) return Status::kInvalidAttenuation;
+      break;
+    case CommandKind::kRetune:
+      if (!valid_slice_range(c.first_slice, c.num_slices)) return Status::kInvalidRange;
+      break;
+    case CommandKind::kAttenuate:
+      if (!WssHalf::valid_attenuation(c.attenuation)) return Status::kInvalidAttenuation;
+      break;
+    case CommandKind::kDelete:
+    case CommandKind::kSnapshot:
+      break;
+  }
+  return Status::kOk;
+}
+
+Status apply_command(TwinModule& m, const Command& c, HalfTelemetry* telemetry) {
+  WssHalf& wss = m.half(c.half);
+  switch (c.kind) {
+    case CommandKind::kAdd:
+      return wss.add_channel({c.channel, c.port, c.first_slice, c.num_slices, c.attenuation});
+    case CommandKind::kDelete:
+      return wss.delete_channel(c.channel);
+    case CommandKind::kRetune:
+      return wss.retune_channel(c.channel, c.first_slice, c.num_slices);
+    case CommandKind::kAttenuate:
+      return wss.set_attenuation(c.channel, c.attenuation);
+    case CommandKind::kSnapshot: {
+      HalfTelemetry scratch;
+      m.snapshot(c.half, telemetry ? *telemetry : scratch);
+      return Status::kOk;
+    }
+  }
+  return Status::kParseError;
+}
+
+}  // namespace twin
@@ -0,0 +1,159 @@
+#include "twin/crosstalk.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace twin {
+
+namespace {
+
+double db_to_linear(double db) { return std::pow(10.0, db / 10.0); }
+
+double ratio_db(double num, double den) {
+  if (num <= 0.0 || den <= 0.0) return -std::numeric_limits<double>::infinity();
+  return 10.0 * std::log10(num / den);
+}
+
+}  // namespace
+
+BandedMatrix::BandedMatrix(int n, int bandwidth)
+    : n_(n),
+      band_(bandwidth),
+      coef_(static_cast<std::size_t>(n) * static_cast<std::size_t>(2 * bandwidth + 1), 0.0) {}
+
+BandedMatrix BandedMatrix::toeplitz(int n, std::span<const double> by_distance) {
+  const int band = by_distance.empty() ? 0 : static_cast<int>(by_distance.size()) - 1;
+  BandedMatrix m(n, band);
+  for (int i = 0; i < n; ++i) {
+    for (int j = std::max(0, i - band); j <= std::min(n - 1, i + band); ++j) {
+      m.set(i, j, by_distance[static_cast<std::size_t>(std::abs(i - j))]);
+    }
+  }
+  return m;
+}
+
+void BandedMatrix::set(int row, int col, double v) {
+  const int d = col - row;
+  if (row < 0 || row >= n_ || d < -band_ || d > band_) return;
+  coef_[static_cast<std::size_t>(row * width() + d + band_)] = v;
+}
+
+CrosstalkModel::CrosstalkModel(WssHalf& wss, const CrosstalkConfig& config)
+    : wss_(&wss), input_mw_(db_to_linear(config.input_dbm_per_slice)) {
+  std::vector<double> by_distance{1.0};
+  for (double iso : config.port_isolation_db) by_distance.push_back(db_to_linear(-iso));
+  ports_ = BandedMatrix::toeplitz(kNumPorts, by_distance);
+  skirt_.push_back(1.0);
+  for (double iso : config.skirt_isolation_db) skirt_.push_back(db_to_linear(-iso));
+  recompute();
+  wss_->add_observer(this);
+}
+
+CrosstalkModel::~CrosstalkModel() { wss_->remove_observer(this); }
+
+double CrosstalkModel::slice_power(const Channel& ch) const {
+  return input_mw_ * db_to_linear(-ch.attenuation.db());
+}
+
+double CrosstalkModel::skirt_weight(int t, int first, int end, bool same) const {
+  const int k = static_cast<int>(skirt_.size()) - 1;
+  double w = 0.0;
+  for (int s = std::max(first, t - k); s < std::min(end, t + k + 1); ++s) {
+    const int d = std::abs(t - s);
+    if (same && d == 0) continue;
+    w += skirt_[static_cast<std::size_t>(d)];
+  }
+  return w;
+}
+
+CrosstalkModel::Power CrosstalkModel::self_leak(const Channel& ch) const {
+  const int first = ch.first_slice;
+  const int end = first + ch.num_slices;
+  const double power = slice_power(ch);
+  Power sum = 0;
+  for (int t = first; t < end; ++t) sum += to_units(power * skirt_weight(t, first, end, true));
+  return sum;
+}
+
+void CrosstalkModel::add(const Channel& ch, bool remove) {
+  const int q = ch.port - 1;
+  const int first = ch.first_slice;
+  const int end = first + ch.num_slices;
+  const int k = static_cast<int>(skirt_.size()) - 1;
+  const double power = slice_power(ch);
+  const Power sign = remove ? -1 : 1;
+
+  // Occupancy is updated separately from the leakage so in_band_ always
+  // equals leak_ summed over occupied slices.
+  Power existing = 0;
+  for (int s = first; s < end; ++s) existing += leak_[q][s];
+  if (remove) {
+    occupied_[q].clear_range(first, ch.num_slices);
+  } else {
+    occupied_[q].set_range(first, ch.num_slices);
+  }
+  in_band_[q] += sign * existing;
+  signal_[q] += sign * to_units(power) * ch.num_slices;
+
+  // Each delta is rounded from the same inputs on add and remove, so the two
+  // cancel exactly.
+  const int band = ports_.bandwidth();
+  const int lo = std::max(0, first - k);
+  const int hi = std::min(kNumSlices, end + k);
+  for (int p = std::max(0, q - band); p <= std::min(kNumPorts - 1, q + band); ++p) {
+    const double c = ports_.at(p, q) * power;
+    const bool same = p == q;
+    Power in_band = 0;
+    Power self = 0;
+    for (int t = lo; t < hi; ++t) {
+      const Power delta = sign * to_units(c * skirt_weight(t, first, end, same));
+      leak_[p][t] += delta;
+      if (occupied_[p].test(t)) in_band += delta;
+      if (same && t >= first && t < end) self += delta;
+    }
+    in_band_[p] += in_band;
+    self_[p] += self;
+  }
+}
+
+void CrosstalkModel::clear() {
+  for (auto& row : leak_) row.fill(0);
+  occupied_.fill(SliceBitmap{});
+  in_band_.fill(0);
+  self_.fill(0);
+  signal_.fill(0);
+}
+
+void CrosstalkModel::recompute() {
+  clear();
+  for (const Channel& ch : wss_->channels()) add(ch, false);
+}
+
+void CrosstalkModel::on_channel_change(const WssHalf&, const Channel* before,
+                                       const Channel* after) {
+  if (before) add(*before, true);
+  if (after) add(*after, false);
+}
+
+void CrosstalkModel::on_reset(const WssHalf&) { recompute(); }
+
+double CrosstalkModel::port_crosstalk_mw(int port) const {
+  return to_mw(in_band_[port - 1] - self_[port - 1]);
+}
+
+double CrosstalkModel::port_crosstalk_db(int port) const {
+  return ratio_db(port_crosstalk_mw(port), port_signal_mw(port));
+}
+
+double CrosstalkModel::channel_crosstalk_db(ChannelId id) const {
+  const Channel* ch = wss_->find(id);
+  if (!ch) return -std::numeric_limits<double>::infinity();
+  Power leaked = -self_leak(*ch);
+  for (int s = ch->first_slice; s < ch->first_slice + ch->num_slices; ++s) {
+    leaked += leak_[ch->port - 1][s];
+  }
+  return ratio_db(to_mw(leaked), slice_power(*ch) * ch->num_slices);
+}
+
+}  // namespace twin
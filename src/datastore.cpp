@@ -0,0 +1,438 @@
+#include "twin/datastore.h"
+
+#include <algorithm>
+#include <cctype>
+#include <charconv>
+#include <cmath>
+#include <cstdio>
+#include <limits>
+
+namespace twin {
+
+const char* to_string(QueryIndex q) {
+  switch (q) {
+    case QueryIndex::kChannelId:
+      return "channel-id";
+    case QueryIndex::kPortRange:
+      return "port-range";
+    case QueryIndex::kFrequency:
+      return "frequency";
+    case QueryIndex::kScan:
+      return "scan";
+  }
+  return "unknown";
+}
+
+namespace {
+
+MediaChannelRow row_of(std::uint32_t module, Half half, const Channel& ch) {
+  MediaChannelRow r;
+  r.module = module;
+  r.half = half;
+  r.port = ch.port;
+  r.id = ch.id;
+  r.lower = Frequency::from_mhz(slice_lower_mhz(ch.first_slice));
+  r.upper = Frequency::from_mhz(slice_lower_mhz(ch.first_slice + ch.num_slices));
+  r.attenuation = ch.attenuation;
+  return r;
+}
+
+// ---- XPath-lite ----------------------------------------------------------
+
+enum class Level : std::uint8_t { kModule, kHalf, kPort, kChannel };
+
+enum class Field : std::uint8_t {
+  kModule,
+  kHalf,
+  kPort,
+  kChannel,
+  kFrequency,
+  kLower,
+  kUpper,
+  kWidth,
+  kAttenuation,
+};
+
+enum class Cmp : std::uint8_t { kEq, kNe, kLt, kLe, kGt, kGe };
+
+struct Pred {
+  Field field;
+  Cmp cmp;
+  double value;  // THz for frequencies, GHz for width, index for ids.
+};
+
+template <typename T>
+bool compare(T a, Cmp cmp, T b) {
+  switch (cmp) {
+    case Cmp::kEq:
+      return a == b;
+    case Cmp::kNe:
+      return a != b;
+    case Cmp::kLt:
+      return a < b;
+    case Cmp::kLe:
+      return a <= b;
+    case Cmp::kGt:
+      return a > b;
+    case Cmp::kGe:
+      return a >= b;
+  }
+  return false;
+}
+
+bool matches(const MediaChannelRow& r, const Pred& p) {
+  switch (p.field) {
+    case Field::kModule:
+      return compare<double>(r.module, p.cmp, p.value);
+    case Field::kHalf:
+      return compare<double>(index_of(r.half), p.cmp, p.value);
+    case Field::kPort:
+      return compare<double>(r.port, p.cmp, p.value);
+    case Field::kChannel:
+      return compare<double>(r.id, p.cmp, p.value);
+    // thz(), width and db() are the nearest doubles to the stored decimal,
+    // the same values the parser produces for it, so operands are compared
+    // as given and bounds between stored steps select correctly.
+    case Field::kFrequency:
+      return compare(r.center().thz(), p.cmp, p.value);
+    case Field::kLower:
+      return compare(r.lower.thz(), p.cmp, p.value);
+    case Field::kUpper:
+      return compare(r.upper.thz(), p.cmp, p.value);
+    case Field::kWidth:
+      return compare(static_cast<double>(r.upper.mhz() - r.lower.mhz()) / 1e3, p.cmp, p.value);
+    case Field::kAttenuation:
+      return compare(r.attenuation.db(), p.cmp, p.value);
+  }
+  return false;
+}
+
+class QueryParser {
+ public:
+  explicit QueryParser(std::string_view s) : s_(s) {}
+
+  bool parse(std::vector<Pred>& preds) {
+    int level = -1;
+    while (pos_ < s_.size()) {
+      bool descend = false;
+      if (!eat('/')) return false;
+      if (eat('/')) descend = true;
+      const std::string_view name = ident();
+      Level lv;
+      if (name == "module") {
+        lv = Level::kModule;
+      } else if (name == "half") {
+        lv = Level::kHalf;
+      } else if (name == "port") {
+        lv = Level::kPort;
+      } else if (name == "media-channel") {
+        lv = Level::kChannel;
+      } else {
+        return false;
+      }
+      const int l = static_cast<int>(lv);
+      if (descend ? l <= level : l != level + 1) return false;
+      level = l;
+      while (peek() == '[') {
+        ++pos_;
+        do {
+          if (!predicate(lv, preds)) return false;
+        } while (eat_word("and"));
+        skip_space();
+        if (!eat(']')) return false;
+      }
+    }
+    return level == static_cast<int>(Level::kChannel);
+  }
+
+ private:
+  char peek() const { return pos_ < s_.size() ? s_[pos_] : '\0'; }
+  bool eat(char c) {
+    if (peek() != c) return false;
+    ++pos_;
+    return true;
+  }
+  void skip_space() {
+    while (peek() == ' ') ++pos_;
+  }
+  bool eat_word(std::string_view w) {
+    skip_space();
+    if (s_.substr(pos_, w.size()) != w) return false;
+    pos_ += w.size();
+    return true;
+  }
+  std::string_view ident() {
+    skip_space();
+    const std::size_t start = pos_;
+    while (pos_ < s_.size() &&
+           (std::isalnum(static_cast<unsigned char>(s_[pos_])) || s_[pos_] == '-' ||
+            s_[pos_] == '_')) {
+      ++pos_;
+    }
+    return s_.substr(start, pos_ - start);
+  }
+
+  bool predicate(Level lv, std::vector<Pred>& preds) {
+    const std::string_view key = ident();
+    Pred p{};
+    if (key == "id") {
+      p.field = static_cast<Field>(lv);
+    } else if (lv != Level::kChannel) {
+      return false;
+    } else if (key == "frequency") {
+      p.field = Field::kFrequency;
+    } else if (key == "lower-frequency") {
+      p.field = Field::kLower;
+    } else if (key == "upper-frequency") {
+      p.field = Field::kUpper;
+    } else if (key == "width") {
+      p.field = Field::kWidth;
+    } else if (key == "attenuation") {
+      p.field = Field::kAttenuation;
+    } else {
+      return false;
+    }
+
+    skip_space();
+    if (eat('=')) {
+      p.cmp = Cmp::kEq;
+    } else if (eat('!')) {
+      if (!eat('=')) return false;
+      p.cmp = Cmp::kNe;
+    } else if (eat('<')) {
+      p.cmp = eat('=') ? Cmp::kLe : Cmp::kLt;
+    } else if (eat('>')) {
+      p.cmp = eat('=') ? Cmp::kGe : Cmp::kGt;
+    } else {
+      return false;
+    }
+
+    skip_space();
+    if (p.field == Field::kHalf) {
+      const std::string_view v = ident();
+      if (v == "A" || v == "a") {
+        p.value = 0;
+      } else if (v == "B" || v == "b") {
+        p.value = 1;
+      } else {
+        return false;
+      }
+    } else {
+      const char* first = s_.data() + pos_;
+      auto [end, ec] = std::from_chars(first, s_.data() + s_.size(), p.value);
+      if (ec != std::errc{}) return false;
+      pos_ += static_cast<std::size_t>(end - first);
+    }
+    preds.push_back(p);
+    return true;
+  }
+
+  std::string_view s_;
+  std::size_t pos_ = 0;
+};
+
+// MHz bound for a THz operand: rounded outward, so the index never drops a
+// row the exact comparison in matches() keeps. NaN leaves the bound open.
+std::int64_t mhz_bound(double thz, bool upper) {
+  constexpr std::int64_t kMin = std::numeric_limits<std::int64_t>::min();
+  constexpr std::int64_t kMax = std::numeric_limits<std::int64_t>::max();
+  const double m = upper ? std::ceil(thz * 1e6) : std::floor(thz * 1e6);
+  if (std::isnan(m)) return upper ? kMax : kMin;
+  if (m <= -9e18) return kMin;
+  if (m >= 9e18) return kMax;
+  return static_cast<std::int64_t>(m);
+}
+
+// Bounds implied for the centre frequency, in MHz, inclusive. The centre lies
+// strictly between the edges, so edge bounds carry over conservatively.
+// Strict bounds are kept inclusive; matches() applies them exactly.
+void centre_bounds(const std::vector<Pred>& preds, std::int64_t& lo, std::int64_t& hi) {
+  lo = std::numeric_limits<std::int64_t>::min();
+  hi = std::numeric_limits<std::int64_t>::max();
+  for (const Pred& p : preds) {
+    const bool centre = p.field == Field::kFrequency;
+    const bool lower_edge = p.field == Field::kLower;
+    const bool upper_edge = p.field == Field::kUpper;
+    if (!centre && !lower_edge && !upper_edge) continue;
+    const bool below = p.cmp == Cmp::kGe || p.cmp == Cmp::kGt || p.cmp == Cmp::kEq;
+    const bool above = p.cmp == Cmp::kLe || p.cmp == Cmp::kLt || p.cmp == Cmp::kEq;
+    if ((centre || lower_edge) && below) lo = std::max(lo, mhz_bound(p.value, false));
+    if ((centre || upper_edge) && above) hi = std::min(hi, mhz_bound(p.value, true));
+  }
+}
+
+}  // namespace
+
+bool Datastore::freq_before(RowId a, RowId b) const {
+  const std::int64_t ca = rows_[a].center().mhz();
+  const std::int64_t cb = rows_[b].center().mhz();
+  return ca != cb ? ca < cb : a < b;
+}
+
+Datastore::RowId Datastore::add_row(const MediaChannelRow& r) {
+  RowId id;
+  if (!free_.empty()) {
+    id = free_.back();
+    free_.pop_back();
+    rows_[id] = r;
+    live_[id] = 1;
+  } else {
+    id = static_cast<RowId>(rows_.size());
+    rows_.push_back(r);
+    live_.push_back(1);
+  }
+  by_id_[id_key(r.module, r.half, r.id)] = id;
+  auto& list = by_port_[port_key(r.module, r.half, r.port)];
+  auto pos = std::lower_bound(list.begin(), list.end(), r.lower,
+                              [&](RowId a, Frequency v) { return rows_[a].lower < v; });
+  list.insert(pos, id);
+  return id;
+}
+
+void Datastore::insert_row(const MediaChannelRow& r) {
+  const RowId id = add_row(r);
+  auto pos = std::lower_bound(by_freq_.begin(), by_freq_.end(), id,
+                              [this](RowId a, RowId b) { return freq_before(a, b); });
+  by_freq_.insert(pos, id);
+}
+
+void Datastore::remove_row(RowId id) {
+  const MediaChannelRow& r = rows_[id];
+  by_id_.erase(id_key(r.module, r.half, r.id));
+  auto it = by_port_.find(port_key(r.module, r.half, r.port));
+  if (it != by_port_.end()) {
+    std::erase(it->second, id);
+    if (it->second.empty()) by_port_.erase(it);
+  }
+  auto pos = std::lower_bound(by_freq_.begin(), by_freq_.end(), id,
+                              [this](RowId a, RowId b) { return freq_before(a, b); });
+  by_freq_.erase(pos);
+  live_[id] = 0;
+  free_.push_back(id);
+}
+
+void Datastore::load(std::span<const TwinModule> modules) {
+  rows_.clear();
+  live_.clear();
+  free_.clear();
+  by_id_.clear();
+  by_port_.clear();
+  by_freq_.clear();
+  // Bulk load: one sort instead of an ordered insert per row.
+  for (std::uint32_t m = 0; m < modules.size(); ++m) {
+    for (Half h : {Half::kA, Half::kB}) {
+      for (const Channel& ch : modules[m].half(h).channels()) {
+        by_freq_.push_back(add_row(row_of(m, h, ch)));
+      }
+    }
+  }
+  std::sort(by_freq_.begin(), by_freq_.end(),
+            [this](RowId a, RowId b) { return freq_before(a, b); });
+}
+
+void Datastore::sync_half(std::uint32_t module, Half half, const WssHalf& wss) {
+  for (int port = 1; port <= kNumPorts; ++port) {
+    auto it = by_port_.find(port_key(module, half, port));
+    if (it == by_port_.end()) continue;
+    const std::vector<RowId> ids = it->second;
+    for (RowId id : ids) remove_row(id);
+  }
+  for (const Channel& ch : wss.channels()) insert_row(row_of(module, half, ch));
+}
+
+void Datastore::upsert(std::uint32_t module, Half half, const Channel& ch) {
+  erase(module, half, ch.id);
+  insert_row(row_of(module, half, ch));
+}
+
+void Datastore::erase(std::uint32_t module, Half half, ChannelId id) {
+  auto it = by_id_.find(id_key(module, half, id));
+  if (it != by_id_.end()) remove_row(it->second);
+}
+
+Status Datastore::query(std::string_view xpath, std::vector<const MediaChannelRow*>& out,
+                        QueryStats* stats) const {
+  std::vector<Pred> preds;
+  if (!QueryParser(xpath).parse(preds)) return Status::kParseError;
+
+  // Equality on a key level selects an index. The operand is range-checked
+  // before the integer conversion, which is undefined for large doubles.
+  static constexpr double kKeyMax[4] = {std::numeric_limits<std::uint32_t>::max(), 1,
+                                        std::numeric_limits<std::uint8_t>::max(),
+                                        std::numeric_limits<ChannelId>::max()};
+  std::int64_t eq[4] = {-1, -1, -1, -1};
+  for (const Pred& p : preds) {
+    const int key = static_cast<int>(p.field);
+    if (p.cmp != Cmp::kEq || key >= 4) continue;
+    if (!(p.value >= 0 && p.value <= kKeyMax[key])) return Status::kParseError;
+    if (p.value == std::floor(p.value)) eq[key] = static_cast<std::int64_t>(p.value);
+  }
+  std::int64_t lo, hi;
+  centre_bounds(preds, lo, hi);
+
+  QueryStats local;
+  auto consider = [&](RowId id) {
+    ++local.examined;
+    const MediaChannelRow& r = rows_[id];
+    for (const Pred& p : preds) {
+      if (!matches(r, p)) return;
+    }
+    out.push_back(&r);
+  };
+  auto by_centre = [&](const std::vector<RowId>& list) {
+    auto it = std::lower_bound(list.begin(), list.end(), lo,
+                               [&](RowId a, std::int64_t v) { return rows_[a].center().mhz() < v; });
+    for (; it != list.end() && rows_[*it].center().mhz() <= hi; ++it) consider(*it);
+  };
+
+  const bool fixed_half = eq[0] >= 0 && eq[1] >= 0;
+  const auto module = static_cast<std::uint32_t>(eq[0]);
+  const Half half = eq[1] == 1 ? Half::kB : Half::kA;
+  if (fixed_half && eq[3] >= 0) {
+    local.index = QueryIndex::kChannelId;
+    auto it = by_id_.find(id_key(module, half, static_cast<ChannelId>(eq[3])));
+    if (it != by_id_.end()) consider(it->second);
+  } else if (fixed_half && eq[2] >= 0) {
+    local.index = QueryIndex::kPortRange;
+    auto it = by_port_.find(port_key(module, half, static_cast<int>(eq[2])));
+    if (it != by_port_.end()) by_centre(it->second);
+  } else if (lo != std::numeric_limits<std::int64_t>::min() ||
+             hi != std::numeric_limits<std::int64_t>::max()) {
+    local.index = QueryIndex::kFrequency;
+    by_centre(by_freq_);
+  } else {
+    local.index = QueryIndex::kScan;
+    for (RowId id = 0; id < rows_.size(); ++id) {
+      if (live_[id]) consider(id);
+    }
+  }
+  if (stats) *stats = local;
+  return Status::kOk;
+}
+
+std::string Datastore::path_of(const MediaChannelRow& r) {
+  char buf[128];
+  std::snprintf(buf, sizeof buf, "/module[id=%u]/half[id=%s]/port[id=%u]/media-channel[id=%u]",
+                r.module, to_string(r.half), r.port, r.id);
+  return buf;
+}
+
+std::string Datastore::to_json(std::span<const MediaChannelRow* const> rows) {
+  std::string out = "{\"media-channel\":[";
+  char buf[320];
+  for (std::size_t i = 0; i < rows.size(); ++i) {
+    const MediaChannelRow& r = *rows[i];
+    std::snprintf(buf, sizeof buf,
+                  "%s{\"module\":%u,\"half\":\"%s\",\"port\":%u,\"id\":%u,"
+                  "\"lower-frequency\":%.6f,\"upper-frequency\":%.6f,\"frequency\":%.6f,"
+                  "\"width\":%.3f,\"attenuation\":%.1f}",
+                  i ? "," : "", r.module, to_string(r.half), r.port, r.id, r.lower.thz(),
+                  r.upper.thz(), r.center().thz(), (r.upper.mhz() - r.lower.mhz()) / 1e3,
+                  r.attenuation.db());
+    out += buf;
+  }
+  out += "]}";
+  return out;
+}
+
+}  // namespace twin
@@ -0,0 +1,125 @@
+#include "twin/fragmentation.h"
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+
+namespace twin {
+
+namespace {
+
+// len * ln(len) in fixed point, tabulated once.
+const std::array<std::int64_t, kNumSlices + 1>& xlogx_table() {
+  static const auto table = [] {
+    std::array<std::int64_t, kNumSlices + 1> t{};
+    for (int i = 2; i <= kNumSlices; ++i) {
+      t[static_cast<std::size_t>(i)] = std::llround(i * std::log(i) * 1099511627776.0);
+    }
+    return t;
+  }();
+  return table;
+}
+
+}  // namespace
+
+double FreeBlockStats::entropy() const {
+  if (free_slices_ == 0) return 0.0;
+  const double f = free_slices_;
+  return std::max(0.0, std::log(f) - static_cast<double>(xlogx_) / kScale / f);
+}
+
+double FreeBlockStats::fragmentation_index() const {
+  if (free_slices_ < 2) return 0.0;
+  return entropy() / std::log(static_cast<double>(free_slices_));
+}
+
+void FreeBlockStats::add_block(int len) {
+  const auto i = static_cast<std::size_t>(len);
+  if (count_[i]++ == 0) nonzero_[i >> 6] |= 1ull << (i & 63);
+  free_slices_ += len;
+  ++free_blocks_;
+  xlogx_ += xlogx_table()[i];
+  if (len > largest_) largest_ = len;
+}
+
+void FreeBlockStats::remove_block(int len) {
+  const auto i = static_cast<std::size_t>(len);
+  if (--count_[i] == 0) nonzero_[i >> 6] &= ~(1ull << (i & 63));
+  free_slices_ -= len;
+  --free_blocks_;
+  xlogx_ -= xlogx_table()[i];
+  if (len == largest_ && count_[i] == 0) {
+    // Next largest size still present; at most a dozen words to look at.
+    largest_ = 0;
+    for (int w = static_cast<int>(i >> 6); w >= 0; --w) {
+      if (nonzero_[static_cast<std::size_t>(w)]) {
+        largest_ = w * 64 + 63 - std::countl_zero(nonzero_[static_cast<std::size_t>(w)]);
+        break;
+      }
+    }
+  }
+}
+
+void FreeBlockStats::assign(const SliceBitmap& used) {
+  *this = FreeBlockStats{};
+  used.for_each_free_run([this](int, int len) { add_block(len); });
+}
+
+FragmentationTracker::FragmentationTracker(WssHalf& wss) : wss_(&wss) {
+  rebuild();
+  wss_->add_observer(this);
+}
+
+FragmentationTracker::~FragmentationTracker() { wss_->remove_observer(this); }
+
+void FragmentationTracker::rebuild() {
+  used_[0] = wss_->common_occupancy();
+  for (int p = 1; p <= kNumPorts; ++p) used_[static_cast<std::size_t>(p)] = wss_->port_occupancy(p);
+  for (std::size_t s = 0; s < used_.size(); ++s) stats_[s].assign(used_[s]);
+}
+
+// The range is free in `scope`: split the free block around it.
+void FragmentationTracker::allocate(std::size_t scope, int first, int count) {
+  SliceBitmap& used = used_[scope];
+  FreeBlockStats& st = stats_[scope];
+  const int end = first + count;
+  const int lo = used.prev_set(first - 1) + 1;
+  const int hi = used.next_set(end);
+  st.remove_block(hi - lo);
+  if (first > lo) st.add_block(first - lo);
+  if (hi > end) st.add_block(hi - end);
+  used.set_range(first, count);
+}
+
+// The range is used in `scope`: merge it with its free neighbours.
+void FragmentationTracker::release(std::size_t scope, int first, int count) {
+  SliceBitmap& used = used_[scope];
+  FreeBlockStats& st = stats_[scope];
+  const int end = first + count;
+  used.clear_range(first, count);
+  const int lo = used.prev_set(first - 1) + 1;
+  const int hi = used.next_set(end);
+  if (first > lo) st.remove_block(first - lo);
+  if (hi > end) st.remove_block(hi - end);
+  st.add_block(hi - lo);
+}
+
+void FragmentationTracker::on_channel_change(const WssHalf&, const Channel* before,
+                                             const Channel* after) {
+  if (before && after && before->port == after->port && before->first_slice == after->first_slice &&
+      before->num_slices == after->num_slices) {
+    return;  // Attenuation only.
+  }
+  if (before) {
+    release(0, before->first_slice, before->num_slices);
+    release(before->port, before->first_slice, before->num_slices);
+  }
+  if (after) {
+    allocate(0, after->first_slice, after->num_slices);
+    allocate(after->port, after->first_slice, after->num_slices);
+  }
+}
+
+void FragmentationTracker::on_reset(const WssHalf&) { rebuild(); }
+
+}  // namespace twin
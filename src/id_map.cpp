@@ -0,0 +1,43 @@
+#include "twin/id_map.h"
+
+namespace twin {
+
+bool ChannelIdMap::insert(std::uint32_t id, std::size_t pos) {
+  for (std::size_t i = home(id);; i = (i + 1) & kMask) {
+    Slot& s = slots_[i];
+    if (s.used && s.id != id) continue;
+    const bool fresh = !s.used;
+    s = Slot{id, static_cast<std::uint16_t>(pos), 1};
+    size_ += fresh;
+    return fresh;
+  }
+}
+
+bool ChannelIdMap::erase(std::uint32_t id) {
+  std::size_t i = home(id);
+  for (;; i = (i + 1) & kMask) {
+    if (!slots_[i].used) return false;
+    if (slots_[i].id == id) break;
+  }
+  slots_[i].used = 0;
+  --size_;
+  // Shift later members of the probe run back into the hole unless their
+  // home lies cyclically in (hole, j], where they are already reachable.
+  for (std::size_t j = (i + 1) & kMask; slots_[j].used; j = (j + 1) & kMask) {
+    const std::size_t k = home(slots_[j].id);
+    const bool reachable = i <= j ? (i < k && k <= j) : (i < k || k <= j);
+    if (reachable) continue;
+    slots_[i] = slots_[j];
+    slots_[j].used = 0;
+    i = j;
+  }
+  return true;
+}
+
+void ChannelIdMap::clear() {
+  if (size_ == 0) return;
+  slots_.fill(Slot{});
+  size_ = 0;
+}
+
+}  // namespace twin
@@ -0,0 +1,48 @@
+#include "twin/interval_index.h"
+
+#include <algorithm>
+
+namespace twin {
+
+namespace {
+
+// First entry whose end lies beyond `slice`, i.e. the first that could
+// contain or follow it.
+auto first_ending_after(std::span<const IntervalIndex::Entry> v, int slice) {
+  return std::upper_bound(v.begin(), v.end(), slice,
+                          [](int s, const IntervalIndex::Entry& e) { return s < e.end; });
+}
+
+}  // namespace
+
+void IntervalIndex::insert(const Entry& e) {
+  auto pos = std::lower_bound(entries_.begin(), entries_.end(), e.first,
+                              [](const Entry& a, std::uint16_t f) { return a.first < f; });
+  entries_.insert(pos, e);
+}
+
+bool IntervalIndex::erase(std::uint16_t first) {
+  auto pos = std::lower_bound(entries_.begin(), entries_.end(), first,
+                              [](const Entry& a, std::uint16_t f) { return a.first < f; });
+  if (pos == entries_.end() || pos->first != first) return false;
+  entries_.erase(pos);
+  return true;
+}
+
+const IntervalIndex::Entry* IntervalIndex::stab(int slice) const {
+  const std::span<const Entry> all = entries_;
+  auto it = first_ending_after(all, slice);
+  if (it == all.end() || it->first > slice) return nullptr;
+  return &*it;
+}
+
+std::span<const IntervalIndex::Entry> IntervalIndex::overlapping(int first, int count) const {
+  const std::span<const Entry> all = entries_;
+  auto lo = first_ending_after(all, first);
+  auto hi = std::lower_bound(lo, all.end(), first + count,
+                             [](const Entry& e, int end) { return e.first < end; });
+  return all.subspan(static_cast<std::size_t>(lo - all.begin()),
+                     static_cast<std::size_t>(hi - lo));
+}
+
+}  // namespace twin
@@ -0,0 +1,262 @@
+#include "twin/latency.h"
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace twin {
+
+const char* to_string(Op op) {
+  switch (op) {
+    case Op::kAdd:
+      return "add";
+    case Op::kDelete:
+      return "delete";
+    case Op::kRetune:
+      return "retune";
+    case Op::kAttenuate:
+      return "attenuate";
+    case Op::kPlanCommit:
+      return "plan_commit";
+    case Op::kTelemetrySnapshot:
+      return "telemetry_snapshot";
+    case Op::kCount:
+      break;
+  }
+  return "unknown";
+}
+
+void LatencyHistogram::merge(const LatencyHistogram& o) {
+  for (int b = 0; b < kBuckets; ++b) counts_[b] += o.counts_[b];
+}
+
+std::uint64_t LatencyHistogram::count() const {
+  std::uint64_t n = 0;
+  for (auto c : counts_) n += c;
+  return n;
+}
+
+namespace {
+
+std::uint64_t bucket_mid(int b) {
+  const std::uint64_t lo = LatencyHistogram::bucket_lower(b);
+  if (b + 1 >= LatencyHistogram::kBuckets) return lo;
+  return lo + (LatencyHistogram::bucket_lower(b + 1) - lo) / 2;
+}
+
+}  // namespace
+
+std::uint64_t LatencyHistogram::percentile(double p) const {
+  const std::uint64_t total = count();
+  if (total == 0) return 0;
+  auto rank = static_cast<std::uint64_t>(std::ceil(p / 100.0 * static_cast<double>(total)));
+  if (rank == 0) rank = 1;
+  std::uint64_t seen = 0;
+  for (int b = 0; b < kBuckets; ++b) {
+    seen += counts_[b];
+    if (seen >= rank) return bucket_mid(b);
+  }
+  return max();
+}
+
+std::uint64_t LatencyHistogram::min() const {
+  for (int b = 0; b < kBuckets; ++b) {
+    if (counts_[b]) return bucket_lower(b);
+  }
+  return 0;
+}
+
+std::uint64_t LatencyHistogram::max() const {
+  for (int b = kBuckets - 1; b >= 0; --b) {
+    if (counts_[b]) return bucket_mid(b);
+  }
+  return 0;
+}
+
+double LatencyHistogram::mean() const {
+  double sum = 0.0;
+  std::uint64_t n = 0;
+  for (int b = 0; b < kBuckets; ++b) {
+    sum += static_cast<double>(counts_[b]) * static_cast<double>(bucket_mid(b));
+    n += counts_[b];
+  }
+  return n ? sum / static_cast<double>(n) : 0.0;
+}
+
+namespace metrics {
+
+std::atomic<bool> g_enabled{true};
+
+void set_enabled(bool on) { g_enabled.store(on, std::memory_order_relaxed); }
+
+namespace {
+
+// One thread's samples in raw ticks. Only the owning thread writes; readers
+// merge with relaxed loads, so recording needs no read-modify-write.
+struct Shard {
+  std::array<std::array<std::atomic<std::uint64_t>, LatencyHistogram::kBuckets>, kNumOps> counts{};
+};
+
+struct Registry {
+  std::mutex mu;
+  std::vector<Shard*> live;
+  std::array<LatencyHistogram, kNumOps> retired{};
+};
+
+Registry& registry() {
+  static Registry* r = new Registry;  // Outlives thread-exit retirement.
+  return *r;
+}
+
+struct ShardHandle {
+  Shard* shard = nullptr;
+
+  Shard* get() {
+    if (shard == nullptr) {
+      shard = new Shard;
+      Registry& r = registry();
+      std::lock_guard lock(r.mu);
+      r.live.push_back(shard);
+    }
+    return shard;
+  }
+
+  ~ShardHandle() {
+    if (shard == nullptr) return;
+    Registry& r = registry();
+    std::lock_guard lock(r.mu);
+    for (int op = 0; op < kNumOps; ++op) {
+      for (int b = 0; b < LatencyHistogram::kBuckets; ++b) {
+        r.retired[op].add_bucket(b, shard->counts[op][b].load(std::memory_order_relaxed));
+      }
+    }
+    std::erase(r.live, shard);
+    delete shard;
+  }
+};
+
+thread_local ShardHandle t_shard;
+
+double ns_per_tick() {
+  static const double value = [] {
+#if defined(__x86_64__) || defined(__i386__)
+    using clock = std::chrono::steady_clock;
+    const auto t0 = clock::now();
+    const std::uint64_t c0 = now_ticks();
+    while (clock::now() - t0 < std::chrono::milliseconds(10)) {
+    }
+    const std::uint64_t c1 = now_ticks();
+    const double ns = std::chrono::duration<double, std::nano>(clock::now() - t0).count();
+    return c1 > c0 ? ns / static_cast<double>(c1 - c0) : 1.0;
+#else
+    using period = std::chrono::steady_clock::period;
+    return 1e9 * static_cast<double>(period::num) / static_cast<double>(period::den);
+#endif
+  }();
+  return value;
+}
+
+}  // namespace
+
+void record(Op op, std::uint64_t ticks) {
+  auto& c = t_shard.get()->counts[static_cast<int>(op)][LatencyHistogram::bucket_of(ticks)];
+  c.store(c.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+}
+
+LatencyHistogram collect(Op op) {
+  const int o = static_cast<int>(op);
+  LatencyHistogram ticks;
+  {
+    Registry& r = registry();
+    std::lock_guard lock(r.mu);
+    ticks = r.retired[o];
+    for (Shard* s : r.live) {
+      for (int b = 0; b < LatencyHistogram::kBuckets; ++b) {
+        ticks.add_bucket(b, s->counts[o][b].load(std::memory_order_relaxed));
+      }
+    }
+  }
+
+  const double scale = ns_per_tick();
+  LatencyHistogram ns;
+  for (int b = 0; b < LatencyHistogram::kBuckets; ++b) {
+    if (std::uint64_t n = ticks.counts()[b]) {
+      const auto v = static_cast<std::uint64_t>(static_cast<double>(bucket_mid(b)) * scale);
+      ns.add_bucket(LatencyHistogram::bucket_of(v), n);
+    }
+  }
+  return ns;
+}
+
+void reset() {
+  Registry& r = registry();
+  std::lock_guard lock(r.mu);
+  for (auto& h : r.retired) h.reset();
+  for (Shard* s : r.live) {
+    for (auto& op : s->counts) {
+      for (auto& c : op) c.store(0, std::memory_order_relaxed);
+    }
+  }
+}
+
+namespace {
+
+constexpr double kPercentiles[] = {50.0, 90.0, 99.0, 99.9, 99.99};
+constexpr const char* kPercentileNames[] = {"p50", "p90", "p99", "p999", "p9999"};
+
+}  // namespace
+
+std::string report_text() {
+  std::string out;
+  char line[256];
+  std::snprintf(line, sizeof line, "%-20s %12s %10s %10s %10s %10s %10s %10s %10s %10s\n", "op (ns)",
+                "count", "min", "mean", "p50", "p90", "p99", "p99.9", "p99.99", "max");
+  out += line;
+  for (int o = 0; o < kNumOps; ++o) {
+    const LatencyHistogram h = collect(static_cast<Op>(o));
+    std::snprintf(line, sizeof line,
+                  "%-20s %12llu %10llu %10.0f %10llu %10llu %10llu %10llu %10llu %10llu\n",
+                  to_string(static_cast<Op>(o)), static_cast<unsigned long long>(h.count()),
+                  static_cast<unsigned long long>(h.min()), h.mean(),
+                  static_cast<unsigned long long>(h.percentile(kPercentiles[0])),
+                  static_cast<unsigned long long>(h.percentile(kPercentiles[1])),
+                  static_cast<unsigned long long>(h.percentile(kPercentiles[2])),
+                  static_cast<unsigned long long>(h.percentile(kPercentiles[3])),
+                  static_cast<unsigned long long>(h.percentile(kPercentiles[4])),
+                  static_cast<unsigned long long>(h.max()));
+    out += line;
+  }
+  return out;
+}
+
+std::string report_json() {
+  std::string out = "{\"unit\":\"ns\",\"ops\":{";
+  char buf[64];
+  for (int o = 0; o < kNumOps; ++o) {
+    const LatencyHistogram h = collect(static_cast<Op>(o));
+    if (o) out += ',';
+    out += '"';
+    out += to_string(static_cast<Op>(o));
+    out += "\":{";
+    std::snprintf(buf, sizeof buf, "\"count\":%llu,\"min\":%llu,\"mean\":%.1f",
+                  static_cast<unsigned long long>(h.count()),
+                  static_cast<unsigned long long>(h.min()), h.mean());
+    out += buf;
+    for (std::size_t i = 0; i < std::size(kPercentiles); ++i) {
+      std::snprintf(buf, sizeof buf, ",\"%s\":%llu", kPercentileNames[i],
+                    static_cast<unsigned long long>(h.percentile(kPercentiles[i])));
+      out += buf;
+    }
+    std::snprintf(buf, sizeof buf, ",\"max\":%llu}", static_cast<unsigned long long>(h.max()));
+    out += buf;
+  }
+  out += "}}";
+  return out;
+}
+
+}  // namespace metrics
+
+}  // namespace twin
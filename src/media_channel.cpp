@@ -0,0 +1,238 @@
+#include "twin/media_channel.h"
+
+namespace twin {
+
+namespace {
+
+Frequency passband_lower(int first_slice) {
+  return Frequency::from_mhz(slice_lower_mhz(first_slice));
+}
+
+Frequency passband_upper(int first_slice, int num_slices) {
+  return Frequency::from_mhz(slice_lower_mhz(first_slice + num_slices));
+}
+
+}  // namespace
+
+MediaChannelHierarchy::MediaChannelHierarchy(WssHalf& wss) : wss_(&wss) {
+  port_head_.fill(kNone);
+  for (const Channel& ch : wss.channels()) add_media_channel(ch);
+  wss_->add_observer(this);
+}
+
+MediaChannelHierarchy::~MediaChannelHierarchy() { wss_->remove_observer(this); }
+
+void MediaChannelHierarchy::link_port(std::uint32_t m) {
+  McNode& node = mcs_[m];
+  const int p = node.port - 1;
+  node.prev = kNone;
+  node.next = port_head_[p];
+  if (node.next != kNone) mcs_[node.next].prev = m;
+  port_head_[p] = m;
+  ++port_count_[p];
+}
+
+void MediaChannelHierarchy::unlink_port(std::uint32_t m) {
+  McNode& node = mcs_[m];
+  const int p = node.port - 1;
+  if (node.prev != kNone) {
+    mcs_[node.prev].next = node.next;
+  } else {
+    port_head_[p] = node.next;
+  }
+  if (node.next != kNone) mcs_[node.next].prev = node.prev;
+  --port_count_[p];
+}
+
+void MediaChannelHierarchy::unlink_child(std::uint32_t n) {
+  NmcNode& node = nmcs_[n];
+  McNode& mc = mcs_[node.parent];
+  if (node.prev != kNone) {
+    nmcs_[node.prev].next = node.next;
+  } else {
+    mc.first_child = node.next;
+  }
+  if (node.next != kNone) {
+    nmcs_[node.next].prev = node.prev;
+  } else {
+    mc.last_child = node.prev;
+  }
+  --mc.children;
+  nmc_index_.erase(node.nmc.id);
+  node.parent = kNone;
+  free_nmcs_.push_back(n);
+}
+
+void MediaChannelHierarchy::add_media_channel(const Channel& ch) {
+  std::uint32_t m;
+  if (!free_mcs_.empty()) {
+    m = free_mcs_.back();
+    free_mcs_.pop_back();
+  } else {
+    m = static_cast<std::uint32_t>(mcs_.size());
+    mcs_.emplace_back();
+  }
+  McNode& node = mcs_[m];
+  node = McNode{};
+  node.id = ch.id;
+  node.port = ch.port;
+  node.live = true;
+  node.first_slice = ch.first_slice;
+  node.num_slices = ch.num_slices;
+  mc_index_.insert(ch.id, m);
+  link_port(m);
+}
+
+void MediaChannelHierarchy::drop_media_channel(std::uint32_t m) {
+  while (mcs_[m].first_child != kNone) {
+    unlink_child(mcs_[m].first_child);
+    ++evicted_;
+  }
+  unlink_port(m);
+  mc_index_.erase(mcs_[m].id);
+  mcs_[m].live = false;
+  free_mcs_.push_back(m);
+}
+
+void MediaChannelHierarchy::update_media_channel(std::uint32_t m, const Channel& ch) {
+  McNode& node = mcs_[m];
+  if (node.port != ch.port) {
+    unlink_port(m);
+    node.port = ch.port;
+    link_port(m);
+  }
+  if (node.first_slice == ch.first_slice && node.num_slices == ch.num_slices) return;
+  // Centres are whole MHz multiples of half a slice, so the shift is exact.
+  const std::int64_t shift = block_center_mhz(ch.first_slice, ch.num_slices) -
+                             block_center_mhz(node.first_slice, node.num_slices);
+  node.first_slice = ch.first_slice;
+  node.num_slices = ch.num_slices;
+  const Frequency lower = passband_lower(ch.first_slice);
+  const Frequency upper = passband_upper(ch.first_slice, ch.num_slices);
+  // A uniform shift keeps the children in frequency order.
+  for (std::uint32_t n = node.first_child; n != kNone;) {
+    NetworkMediaChannel& nmc = nmcs_[n].nmc;
+    const std::uint32_t next = nmcs_[n].next;
+    nmc.lower = Frequency::from_mhz(nmc.lower.mhz() + shift);
+    nmc.upper = Frequency::from_mhz(nmc.upper.mhz() + shift);
+    if (nmc.lower < lower || nmc.upper > upper) {
+      unlink_child(n);
+      ++evicted_;
+    }
+    n = next;
+  }
+}
+
+Status MediaChannelHierarchy::add(ChannelId mc, NmcId id, Frequency lower, Frequency upper) {
+  const int slot = mc_index_.find(mc);
+  if (slot < 0) return Status::kUnknownChannel;
+  const auto m = static_cast<std::uint32_t>(slot);
+  const McNode& parent = mcs_[m];
+  if (!(lower < upper) || lower < passband_lower(parent.first_slice) ||
+      upper > passband_upper(parent.first_slice, parent.num_slices)) {
+    return Status::kInvalidRange;
+  }
+  if (nmc_index_.contains(id)) return Status::kDuplicateChannel;
+
+  // Walk back from the highest child; ascending adds stop at once.
+  std::uint32_t prev = parent.last_child;
+  while (prev != kNone && nmcs_[prev].nmc.lower > lower) prev = nmcs_[prev].prev;
+  const std::uint32_t next = prev == kNone ? parent.first_child : nmcs_[prev].next;
+  if ((prev != kNone && nmcs_[prev].nmc.upper > lower) ||
+      (next != kNone && nmcs_[next].nmc.lower < upper)) {
+    return Status::kSliceConflict;
+  }
+
+  std::uint32_t n;
+  if (!free_nmcs_.empty()) {
+    n = free_nmcs_.back();
+    free_nmcs_.pop_back();
+  } else {
+    n = static_cast<std::uint32_t>(nmcs_.size());
+    nmcs_.emplace_back();
+  }
+  NmcNode& node = nmcs_[n];
+  node.nmc = {id, mc, lower, upper};
+  node.parent = m;
+  node.prev = prev;
+  node.next = next;
+  McNode& owner = mcs_[m];
+  if (prev != kNone) {
+    nmcs_[prev].next = n;
+  } else {
+    owner.first_child = n;
+  }
+  if (next != kNone) {
+    nmcs_[next].prev = n;
+  } else {
+    owner.last_child = n;
+  }
+  ++owner.children;
+  nmc_index_.emplace(id, n);
+  return Status::kOk;
+}
+
+Status MediaChannelHierarchy::remove(NmcId id) {
+  auto it = nmc_index_.find(id);
+  if (it == nmc_index_.end()) return Status::kUnknownChannel;
+  unlink_child(it->second);
+  return Status::kOk;
+}
+
+std::size_t MediaChannelHierarchy::remove_children(ChannelId mc) {
+  const int slot = mc_index_.find(mc);
+  if (slot < 0) return 0;
+  std::size_t removed = 0;
+  while (mcs_[slot].first_child != kNone) {
+    unlink_child(mcs_[slot].first_child);
+    ++removed;
+  }
+  return removed;
+}
+
+const NetworkMediaChannel* MediaChannelHierarchy::find(NmcId id) const {
+  auto it = nmc_index_.find(id);
+  return it == nmc_index_.end() ? nullptr : &nmcs_[it->second].nmc;
+}
+
+const Channel* MediaChannelHierarchy::parent(NmcId id) const {
+  auto it = nmc_index_.find(id);
+  return it == nmc_index_.end() ? nullptr : wss_->find(mcs_[nmcs_[it->second].parent].id);
+}
+
+std::size_t MediaChannelHierarchy::num_children(ChannelId mc) const {
+  const int slot = mc_index_.find(mc);
+  return slot < 0 ? 0 : mcs_[slot].children;
+}
+
+void MediaChannelHierarchy::on_channel_change(const WssHalf&, const Channel* before,
+                                              const Channel* after) {
+  if (!before) {
+    add_media_channel(*after);
+    return;
+  }
+  const int slot = mc_index_.find(before->id);
+  if (slot < 0) return;
+  if (!after) {
+    drop_media_channel(static_cast<std::uint32_t>(slot));
+  } else {
+    update_media_channel(static_cast<std::uint32_t>(slot), *after);
+  }
+}
+
+void MediaChannelHierarchy::on_reset(const WssHalf& wss) {
+  // Media channels that survive the new plan keep their children.
+  for (std::uint32_t m = 0; m < mcs_.size(); ++m) {
+    if (!mcs_[m].live) continue;
+    if (const Channel* ch = wss.find(mcs_[m].id)) {
+      update_media_channel(m, *ch);
+    } else {
+      drop_media_channel(m);
+    }
+  }
+  for (const Channel& ch : wss.channels()) {
+    if (!mc_index_.contains(ch.id)) add_media_channel(ch);
+  }
+}
+
+}  // namespace twin
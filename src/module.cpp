@@ -0,0 +1,33 @@
+#include "twin/module.h"
+
+#include <algorithm>
+
+#include "twin/latency.h"
+
+namespace twin {
+
+const char* to_string(Half h) { return h == Half::kA ? "A" : "B"; }
+
+void TwinModule::fill(const WssHalf& wss, HalfTelemetry& t) {
+  t = HalfTelemetry{};
+  for (const Channel& ch : wss.channels()) {
+    PortTelemetry& p = t.ports[ch.port - 1];
+    ++p.channels;
+    p.used_slices = static_cast<std::uint16_t>(p.used_slices + ch.num_slices);
+    p.max_attenuation = std::max(p.max_attenuation, ch.attenuation);
+  }
+  t.channels = static_cast<std::uint16_t>(wss.num_channels());
+  t.used_slices = static_cast<std::uint16_t>(wss.common_occupancy().count());
+}
+
+void TwinModule::snapshot(TelemetrySnapshot& out) const {
+  ScopedLatency timer(Op::kTelemetrySnapshot);
+  for (int h = 0; h < kNumHalves; ++h) fill(halves_[h], out.halves[h]);
+}
+
+void TwinModule::snapshot(Half h, HalfTelemetry& out) const {
+  ScopedLatency timer(Op::kTelemetrySnapshot);
+  fill(halves_[index_of(h)], out);
+}
+
+}  // namespace twin
@@ -0,0 +1,127 @@
+#include "twin/network.h"
+
+#include <algorithm>
+#include <limits>
+#include <queue>
+#include <tuple>
+
+namespace twin {
+
+NodeId Network::add_node(std::string serial) {
+  modules_.emplace_back(std::move(serial));
+  out_.emplace_back();
+  auto& ports = port_links_.emplace_back();
+  for (auto& half : ports) half.fill(kInvalidLink);
+  return static_cast<NodeId>(modules_.size() - 1);
+}
+
+LinkId Network::add_link(NodeId from, NodeId to, Half half, int port, double length_km) {
+  if (from >= modules_.size() || to >= modules_.size() || from == to) return kInvalidLink;
+  if (!WssHalf::valid_port(port) || !(length_km > 0.0)) return kInvalidLink;
+  LinkId& slot = port_links_[from][index_of(half)][port - 1];
+  if (slot != kInvalidLink) return kInvalidLink;
+
+  const auto id = static_cast<LinkId>(links_.size());
+  links_.push_back(Link{from, to, half, static_cast<std::uint8_t>(port), length_km});
+  out_[from].push_back(id);
+  slot = id;
+  return id;
+}
+
+double Network::path_length_km(const Path& p) const {
+  double total = 0.0;
+  for (LinkId l : p) total += links_[l].length_km;
+  return total;
+}
+
+Path Network::shortest_path(NodeId src, NodeId dst, const std::vector<char>& banned_links,
+                            const std::vector<char>& banned_nodes) const {
+  constexpr double kInf = std::numeric_limits<double>::infinity();
+  const std::size_t n = modules_.size();
+  std::vector<double> dist(n, kInf);
+  std::vector<std::uint32_t> hops(n, ~0u);
+  std::vector<LinkId> via(n, kInvalidLink);
+
+  using Entry = std::tuple<double, std::uint32_t, NodeId>;
+  std::priority_queue<Entry, std::vector<Entry>, std::greater<>> frontier;
+  dist[src] = 0.0;
+  hops[src] = 0;
+  frontier.emplace(0.0, 0u, src);
+
+  while (!frontier.empty()) {
+    auto [d, h, u] = frontier.top();
+    frontier.pop();
+    if (d > dist[u] || (d == dist[u] && h > hops[u])) continue;
+    if (u == dst) break;
+    for (LinkId l : out_[u]) {
+      if (banned_links[l]) continue;
+      const Link& k = links_[l];
+      if (banned_nodes[k.to]) continue;
+      const double nd = d + k.length_km;
+      const std::uint32_t nh = h + 1;
+      if (nd < dist[k.to] || (nd == dist[k.to] && nh < hops[k.to])) {
+        dist[k.to] = nd;
+        hops[k.to] = nh;
+        via[k.to] = l;
+        frontier.emplace(nd, nh, k.to);
+      }
+    }
+  }
+
+  Path path;
+  if (via[dst] == kInvalidLink) return path;
+  for (NodeId v = dst; v != src; v = links_[via[v]].from) path.push_back(via[v]);
+  std::reverse(path.begin(), path.end());
+  return path;
+}
+
+std::vector<Path> Network::k_shortest_paths(NodeId src, NodeId dst, std::size_t k) const {
+  std::vector<Path> result;
+  if (k == 0 || src >= modules_.size() || dst >= modules_.size() || src == dst) return result;
+
+  std::vector<char> banned_links(links_.size(), 0);
+  std::vector<char> banned_nodes(modules_.size(), 0);
+  Path first = shortest_path(src, dst, banned_links, banned_nodes);
+  if (first.empty()) return result;
+  result.push_back(std::move(first));
+
+  auto longer = [this](const Path& a, const Path& b) {
+    const double la = path_length_km(a), lb = path_length_km(b);
+    return la != lb ? la > lb : a.size() > b.size();
+  };
+  std::vector<Path> candidates;
+
+  while (result.size() < k) {
+    const Path& prev = result.back();
+    for (std::size_t spur = 0; spur < prev.size(); ++spur) {
+      const NodeId spur_node = links_[prev[spur]].from;
+      std::fill(banned_links.begin(), banned_links.end(), 0);
+      std::fill(banned_nodes.begin(), banned_nodes.end(), 0);
+
+      // Ban the next hop of every accepted path sharing this root.
+      for (const Path& p : result) {
+        if (p.size() > spur && std::equal(p.begin(), p.begin() + spur, prev.begin())) {
+          banned_links[p[spur]] = 1;
+        }
+      }
+      for (std::size_t i = 0; i < spur; ++i) banned_nodes[links_[prev[i]].from] = 1;
+
+      Path tail = shortest_path(spur_node, dst, banned_links, banned_nodes);
+      if (tail.empty()) continue;
+      Path candidate(prev.begin(), prev.begin() + spur);
+      candidate.insert(candidate.end(), tail.begin(), tail.end());
+      if (std::find(candidates.begin(), candidates.end(), candidate) == candidates.end() &&
+          std::find(result.begin(), result.end(), candidate) == result.end()) {
+        candidates.push_back(std::move(candidate));
+        std::push_heap(candidates.begin(), candidates.end(), longer);
+      }
+    }
+    if (candidates.empty()) break;
+    std::pop_heap(candidates.begin(), candidates.end(), longer);
+    result.push_back(std::move(candidates.back()));
+    candidates.pop_back();
+  }
+  return result;
+}
+
+}  // namespace twin
@@ -0,0 +1,205 @@
+#include "twin/passband.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace twin {
+
+class CascadeEvaluator::Watch : public WssObserver {
+ public:
+  Watch(CascadeEvaluator& eval, WssHalf& wss) : eval_(eval), wss_(wss) {
+    wss_.add_observer(this);
+  }
+  ~Watch() override { wss_.remove_observer(this); }
+
+  struct Use {
+    LightpathId lp;
+    std::uint32_t hop;
+  };
+  std::unordered_map<ChannelId, std::vector<Use>> uses;
+
+  void on_channel_change(const WssHalf&, const Channel* before, const Channel* after) override {
+    if (before && after && before->port == after->port &&
+        before->first_slice == after->first_slice && before->num_slices == after->num_slices) {
+      return;
+    }
+    auto it = uses.find(before ? before->id : after->id);
+    if (it == uses.end()) return;
+    for (const Use& u : it->second) eval_.mark_dirty(u.lp, u.hop);
+  }
+
+  void on_reset(const WssHalf&) override {
+    for (const auto& [id, list] : uses) {
+      for (const Use& u : list) eval_.mark_dirty(u.lp, u.hop);
+    }
+  }
+
+ private:
+  CascadeEvaluator& eval_;
+  WssHalf& wss_;
+};
+
+CascadeEvaluator::CascadeEvaluator(Network& net, const PassbandConfig& config)
+    : net_(net), config_(config) {
+  config_.samples_per_slice = std::max(1, config_.samples_per_slice);
+  sample_ghz_ = static_cast<double>(kSliceWidthMHz) / 1000.0 / config_.samples_per_slice;
+  const double sigma = config_.otf_bandwidth_ghz / (2.0 * std::sqrt(2.0 * std::log(2.0)));
+  // Windows and hop blocks both lie on the grid, so no row reads offsets
+  // more than one grid width either side of an edge.
+  const std::ptrdiff_t span = std::ptrdiff_t{kNumSlices} * config_.samples_per_slice;
+  edge_zero_ = span;
+  edge_.resize(static_cast<std::size_t>(2 * span + 1));
+  for (std::ptrdiff_t d = -span; d <= span; ++d) {
+    // Sample centres sit half a sample past the integer offset.
+    const double x = (static_cast<double>(d) + 0.5) * sample_ghz_;
+    edge_[static_cast<std::size_t>(d + span)] =
+        static_cast<float>(0.5 * (1.0 + std::erf(x / (std::sqrt(2.0) * sigma))));
+  }
+}
+
+CascadeEvaluator::~CascadeEvaluator() = default;
+
+CascadeEvaluator::Watch& CascadeEvaluator::watch(NodeId node, Half half) {
+  const std::uint64_t key = std::uint64_t{node} * kNumHalves + index_of(half);
+  auto& w = watches_[key];
+  if (!w) w = std::make_unique<Watch>(*this, net_.module(node).half(half));
+  return *w;
+}
+
+LightpathId CascadeEvaluator::add_lightpath(const Path& path, ChannelId id) {
+  LightpathId lp;
+  if (!free_paths_.empty()) {
+    lp = free_paths_.back();
+    free_paths_.pop_back();
+  } else {
+    lp = static_cast<LightpathId>(paths_.size());
+    paths_.emplace_back();
+  }
+  Lightpath& p = paths_[lp];
+  p.id = id;
+  p.live = true;
+  p.hops.reserve(path.size());
+  for (LinkId l : path) {
+    const Link& link = net_.link(l);
+    p.hops.push_back({link.from, link.half, link.port});
+  }
+  for (std::uint32_t h = 0; h < p.hops.size(); ++h) {
+    watch(p.hops[h].node, p.hops[h].half).uses[id].push_back({lp, h});
+  }
+  ++live_;
+  mark_dirty(lp, 0);
+  return lp;
+}
+
+void CascadeEvaluator::remove_lightpath(LightpathId lp) {
+  // Unknown ids and repeated removes are ignored, so a slot is freed once.
+  if (lp >= paths_.size() || !paths_[lp].live) return;
+  Lightpath& p = paths_[lp];
+  for (const Hop& hop : p.hops) {
+    auto& uses = watch(hop.node, hop.half).uses;
+    auto it = uses.find(p.id);
+    if (it == uses.end()) continue;
+    std::erase_if(it->second, [lp](const Watch::Use& u) { return u.lp == lp; });
+    if (it->second.empty()) uses.erase(it);
+  }
+  p.live = false;
+  p.hops.clear();
+  p.prefix = {};
+  p.result = {};
+  free_paths_.push_back(lp);
+  --live_;
+}
+
+void CascadeEvaluator::mark_dirty(LightpathId lp, std::size_t hop) {
+  Lightpath& p = paths_[lp];
+  p.valid = std::min(p.valid, hop);
+  if (!p.queued) {
+    p.queued = true;
+    dirty_.push_back(lp);
+  }
+}
+
+void CascadeEvaluator::update() {
+  for (LightpathId lp : dirty_) {
+    Lightpath& p = paths_[lp];
+    p.queued = false;
+    if (p.live) evaluate(p);
+  }
+  dirty_.clear();
+}
+
+void CascadeEvaluator::evaluate(Lightpath& p) {
+  ++stats_.lightpaths_evaluated;
+  p.result = {};
+  const std::size_t k = static_cast<std::size_t>(config_.samples_per_slice);
+  auto find = [&](const Hop& hop) -> const Channel* {
+    const Channel* ch = net_.module(hop.node).half(hop.half).find(p.id);
+    return ch && ch->port == hop.port ? ch : nullptr;
+  };
+
+  if (p.hops.empty()) return;
+  if (p.valid == 0) {
+    // The first hop sets the window every later hop is sampled on.
+    const Channel* first = find(p.hops[0]);
+    if (!first) {
+      p.result.blocked_hop = 0;
+      return;
+    }
+    p.first_slice = first->first_slice;
+    p.num_samples = static_cast<int>(first->num_slices * k);
+    p.prefix.resize(p.hops.size() * static_cast<std::size_t>(p.num_samples));
+  }
+  const auto n = static_cast<std::size_t>(p.num_samples);
+  p.result.nominal_bandwidth_ghz = static_cast<double>(n) * sample_ghz_;
+
+  for (std::size_t h = p.valid; h < p.hops.size(); ++h) {
+    const Channel* ch = find(p.hops[h]);
+    if (!ch) {
+      p.valid = h;
+      p.result.blocked_hop = static_cast<int>(h);
+      return;
+    }
+    ++stats_.hops_evaluated;
+    // Row = E(i - lo) - E(i - hi): two contiguous runs of the edge table.
+    // With K = kNumSlices * k (edge_zero_), a WssHalf keeps every block
+    // inside [0, kNumSlices), so the window [f0, f0 + n) and this hop's
+    // block [lo, hi) (both in samples from the window start) give
+    // hi <= K - f0 and lo >= -f0. The reads for i in [0, n) then stay in
+    // [K - hi, K - lo + n - 1], inside [0, 2K - 1].
+    const std::ptrdiff_t lo = (std::ptrdiff_t{ch->first_slice} - p.first_slice) *
+                              static_cast<std::ptrdiff_t>(k);
+    const std::ptrdiff_t hi = lo + std::ptrdiff_t{ch->num_slices} * static_cast<std::ptrdiff_t>(k);
+    const float* rise = edge_.data() + (edge_zero_ - lo);
+    const float* fall = edge_.data() + (edge_zero_ - hi);
+    float* out = p.prefix.data() + h * n;
+    if (h == 0) {
+      for (std::size_t i = 0; i < n; ++i) out[i] = rise[i] - fall[i];
+    } else {
+      const float* prev = out - n;
+      for (std::size_t i = 0; i < n; ++i) out[i] = prev[i] * (rise[i] - fall[i]);
+    }
+  }
+  p.valid = p.hops.size();
+
+  const float* t = p.prefix.data() + (p.hops.size() - 1) * n;
+  const float peak = *std::max_element(t, t + n);
+  if (peak <= 0.0f) {
+    p.result.blocked_hop = static_cast<int>(p.hops.size() - 1);
+    return;
+  }
+  const float half_power = 0.5f * peak;
+  std::size_t above = 0;
+  for (std::size_t i = 0; i < n; ++i) above += t[i] >= half_power;
+  p.result.connected = true;
+  p.result.bandwidth_3db_ghz = static_cast<double>(above) * sample_ghz_;
+  p.result.peak_loss_db = -10.0 * std::log10(static_cast<double>(peak));
+}
+
+std::span<const float> CascadeEvaluator::transmission(LightpathId lp) const {
+  const Lightpath& p = paths_[lp];
+  if (!p.result.connected) return {};
+  const auto n = static_cast<std::size_t>(p.num_samples);
+  return {p.prefix.data() + (p.hops.size() - 1) * n, n};
+}
+
+}  // namespace twin
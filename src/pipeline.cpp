@@ -0,0 +1,152 @@
+#include "twin/pipeline.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace twin {
+
+CommandPipeline::CommandPipeline(std::span<TwinModule> modules, AckFn on_ack, PipelineOptions opts)
+    : modules_(modules),
+      on_ack_(std::move(on_ack)),
+      inbound_(opts.queue_capacity),
+      acks_(opts.queue_capacity) {
+  std::size_t shards = opts.shards;
+  if (shards == 0) shards = std::clamp<std::size_t>(std::thread::hardware_concurrency() / 2, 1, 8);
+  shards_.reserve(shards);
+  for (std::size_t i = 0; i < shards; ++i) {
+    shards_.push_back(std::make_unique<Shard>(opts.queue_capacity));
+  }
+  acker_ = std::thread([this] { ack_loop(); });
+  for (auto& s : shards_) {
+    s->applier = std::thread([this, sh = s.get()] { apply_loop(*sh); });
+    s->validator = std::thread([this, sh = s.get()] { validate_loop(*sh); });
+  }
+  parser_ = std::thread([this] { parse_loop(); });
+}
+
+CommandPipeline::~CommandPipeline() {
+  flush();
+  stop_.store(true, std::memory_order_release);
+  parser_.join();
+  for (auto& s : shards_) {
+    s->validator.join();
+    s->applier.join();
+  }
+  acker_.join();
+}
+
+std::uint64_t CommandPipeline::submit(std::string_view line) {
+  Inbound in;
+  in.seq = next_seq_++;
+  if (line.size() > kMaxLine) {
+    in.len = kOverlong;
+  } else {
+    in.len = static_cast<std::uint16_t>(line.size());
+    std::memcpy(in.text, line.data(), line.size());
+  }
+  submitted_.fetch_add(1, std::memory_order_relaxed);
+  push_blocking(inbound_, in);
+  return in.seq;
+}
+
+std::uint64_t CommandPipeline::submit(const Command& c) {
+  Inbound in;
+  in.seq = next_seq_++;
+  in.parsed = true;
+  in.cmd = c;
+  submitted_.fetch_add(1, std::memory_order_relaxed);
+  push_blocking(inbound_, in);
+  return in.seq;
+}
+
+void CommandPipeline::flush() {
+  Backoff b;
+  while (acked_.load(std::memory_order_acquire) != submitted_.load(std::memory_order_relaxed)) {
+    b.pause();
+  }
+}
+
+PipelineStats CommandPipeline::stats() const {
+  return {submitted_.load(std::memory_order_relaxed), acked_.load(std::memory_order_relaxed),
+          failed_.load(std::memory_order_relaxed)};
+}
+
+void CommandPipeline::post_ack(const Item& it) {
+  push_blocking(acks_, Ack{it.seq, it.cmd.kind, it.status, it.cmd.module, it.cmd.half});
+}
+
+void CommandPipeline::parse_loop() {
+  Inbound in;
+  Backoff b;
+  for (;;) {
+    if (!inbound_.try_pop(in)) {
+      if (stop_.load(std::memory_order_acquire)) return;
+      b.pause();
+      continue;
+    }
+    b.reset();
+    Item it;
+    it.seq = in.seq;
+    if (in.parsed) {
+      it.cmd = in.cmd;
+    } else if (in.len == kOverlong) {
+      it.status = Status::kParseError;
+    } else {
+      it.status = parse_command(std::string_view(in.text, in.len), it.cmd);
+    }
+    // Unparsable lines have no half to order against; acknowledge directly.
+    if (it.status != Status::kOk) {
+      post_ack(it);
+      continue;
+    }
+    push_blocking(shards_[shard_of(it.cmd)]->to_validate, it);
+  }
+}
+
+void CommandPipeline::validate_loop(Shard& s) {
+  Item it;
+  Backoff b;
+  for (;;) {
+    if (!s.to_validate.try_pop(it)) {
+      if (stop_.load(std::memory_order_acquire)) return;
+      b.pause();
+      continue;
+    }
+    b.reset();
+    it.status = validate_command(it.cmd, modules_.size());
+    push_blocking(s.to_apply, it);
+  }
+}
+
+void CommandPipeline::apply_loop(Shard& s) {
+  Item it;
+  Backoff b;
+  for (;;) {
+    if (!s.to_apply.try_pop(it)) {
+      if (stop_.load(std::memory_order_acquire)) return;
+      b.pause();
+      continue;
+    }
+    b.reset();
+    if (it.status == Status::kOk) it.status = apply_command(modules_[it.cmd.module], it.cmd);
+    post_ack(it);
+  }
+}
+
+void CommandPipeline::ack_loop() {
+  Ack a;
+  Backoff b;
+  for (;;) {
+    if (!acks_.try_pop(a)) {
+      if (stop_.load(std::memory_order_acquire)) return;
+      b.pause();
+      continue;
+    }
+    b.reset();
+    if (a.status != Status::kOk) failed_.fetch_add(1, std::memory_order_relaxed);
+    if (on_ack_) on_ack_(a);
+    acked_.fetch_add(1, std::memory_order_release);
+  }
+}
+
+}  // namespace twin
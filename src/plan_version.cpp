@@ -0,0 +1,182 @@
+#include "twin/plan_version.h"
+
+#include <algorithm>
+#include <atomic>
+
+namespace twin {
+
+namespace {
+
+// Token 0 is never handed out, so the shared empty nodes always get copied.
+std::uint64_t next_owner() {
+  static std::atomic<std::uint64_t> next{1};
+  return next.fetch_add(1, std::memory_order_relaxed);
+}
+
+}  // namespace
+
+template <typename T>
+T& PlanVersion::writable(std::shared_ptr<T>& p) {
+  const std::uint64_t owner = owner_.load(std::memory_order_relaxed);
+  if (p->owner != owner) {
+    p = std::make_shared<T>(*p);
+    p->owner = owner;
+  }
+  return *p;
+}
+
+PlanVersion::PlanVersion(const PlanVersion& other) : root_(other.root_), owner_(next_owner()) {
+  other.owner_.store(next_owner(), std::memory_order_relaxed);
+}
+
+PlanVersion::PlanVersion(PlanVersion&& other) noexcept
+    : root_(std::move(other.root_)), owner_(other.owner_.load(std::memory_order_relaxed)) {}
+
+PlanVersion& PlanVersion::operator=(const PlanVersion& other) {
+  if (this != &other) {
+    root_ = other.root_;
+    owner_.store(next_owner(), std::memory_order_relaxed);
+    other.owner_.store(next_owner(), std::memory_order_relaxed);
+  }
+  return *this;
+}
+
+PlanVersion& PlanVersion::operator=(PlanVersion&& other) noexcept {
+  root_ = std::move(other.root_);
+  owner_.store(other.owner_.load(std::memory_order_relaxed), std::memory_order_relaxed);
+  return *this;
+}
+
+PlanVersion::PlanVersion() : root_(std::make_shared<Root>()), owner_(next_owner()) {
+  root_->owner = owner_.load(std::memory_order_relaxed);
+  // All empty ports and buckets share one node each until first written.
+  auto empty_port = std::make_shared<PortNode>();
+  auto empty_bucket = std::make_shared<IdBucket>();
+  auto empty_half = std::make_shared<HalfNode>();
+  empty_half->ports.fill(empty_port);
+  empty_half->ids.fill(empty_bucket);
+  root_->halves.fill(empty_half);
+}
+
+PlanVersion PlanVersion::from_module(const TwinModule& m) {
+  PlanVersion v;
+  for (Half h : {Half::kA, Half::kB}) {
+    for (const Channel& ch : m.half(h).channels()) (void)v.add_channel(h, ch);
+  }
+  return v;
+}
+
+PlanVersion::HalfNode& PlanVersion::writable_half(Half h) {
+  return writable(writable(root_).halves[index_of(h)]);
+}
+
+int PlanVersion::port_of(Half h, ChannelId id) const {
+  for (const auto& [cid, port] : half(h).ids[bucket_of(id)]->entries) {
+    if (cid == id) return port;
+  }
+  return 0;
+}
+
+const Channel* PlanVersion::find(Half h, ChannelId id) const {
+  const int port = port_of(h, id);
+  if (port == 0) return nullptr;
+  for (const Channel& ch : half(h).ports[port - 1]->channels) {
+    if (ch.id == id) return &ch;
+  }
+  return nullptr;
+}
+
+Channel* PlanVersion::writable_channel(Half h, ChannelId id) {
+  const int port = port_of(h, id);
+  if (port == 0) return nullptr;
+  PortNode& node = writable(writable_half(h).ports[port - 1]);
+  for (Channel& ch : node.channels) {
+    if (ch.id == id) return &ch;
+  }
+  return nullptr;
+}
+
+Status PlanVersion::add_channel(Half h, const ChannelSpec& spec) {
+  if (!WssHalf::valid_port(spec.port)) return Status::kInvalidPort;
+  if (!valid_slice_range(spec.first_slice, spec.num_slices)) return Status::kInvalidRange;
+  if (!WssHalf::valid_attenuation(spec.attenuation)) return Status::kInvalidAttenuation;
+  if (port_of(h, spec.id) != 0) return Status::kDuplicateChannel;
+  if (half(h).common.any_in(spec.first_slice, spec.num_slices)) return Status::kSliceConflict;
+
+  HalfNode& hn = writable_half(h);
+  PortNode& port = writable(hn.ports[spec.port - 1]);
+  port.occupancy.set_range(spec.first_slice, spec.num_slices);
+  port.channels.push_back(spec);
+  writable(hn.ids[bucket_of(spec.id)]).entries.emplace_back(spec.id, spec.port);
+  hn.common.set_range(spec.first_slice, spec.num_slices);
+  ++hn.num_channels;
+  return Status::kOk;
+}
+
+Status PlanVersion::delete_channel(Half h, ChannelId id) {
+  const int p = port_of(h, id);
+  if (p == 0) return Status::kUnknownChannel;
+
+  HalfNode& hn = writable_half(h);
+  PortNode& port = writable(hn.ports[p - 1]);
+  auto it = std::find_if(port.channels.begin(), port.channels.end(),
+                         [id](const Channel& c) { return c.id == id; });
+  port.occupancy.clear_range(it->first_slice, it->num_slices);
+  hn.common.clear_range(it->first_slice, it->num_slices);
+  *it = port.channels.back();
+  port.channels.pop_back();
+
+  auto& entries = writable(hn.ids[bucket_of(id)]).entries;
+  std::erase_if(entries, [id](const auto& e) { return e.first == id; });
+  --hn.num_channels;
+  return Status::kOk;
+}
+
+Status PlanVersion::retune_channel(Half h, ChannelId id, int first_slice, int num_slices) {
+  const Channel* cur = find(h, id);
+  if (cur == nullptr) return Status::kUnknownChannel;
+  if (!valid_slice_range(first_slice, num_slices)) return Status::kInvalidRange;
+  SliceBitmap others = half(h).common;
+  others.clear_range(cur->first_slice, cur->num_slices);
+  if (others.any_in(first_slice, num_slices)) return Status::kSliceConflict;
+
+  const int p = cur->port;
+  HalfNode& hn = writable_half(h);
+  PortNode& port = writable(hn.ports[p - 1]);
+  Channel* ch = writable_channel(h, id);
+  port.occupancy.clear_range(ch->first_slice, ch->num_slices);
+  hn.common.clear_range(ch->first_slice, ch->num_slices);
+  ch->first_slice = static_cast<std::uint16_t>(first_slice);
+  ch->num_slices = static_cast<std::uint16_t>(num_slices);
+  port.occupancy.set_range(first_slice, num_slices);
+  hn.common.set_range(first_slice, num_slices);
+  return Status::kOk;
+}
+
+Status PlanVersion::set_attenuation(Half h, ChannelId id, Attenuation attenuation) {
+  if (port_of(h, id) == 0) return Status::kUnknownChannel;
+  if (!WssHalf::valid_attenuation(attenuation)) return Status::kInvalidAttenuation;
+  writable_channel(h, id)->attenuation = attenuation;
+  return Status::kOk;
+}
+
+std::vector<Channel> PlanVersion::channels(Half h) const {
+  std::vector<Channel> out;
+  out.reserve(num_channels(h));
+  for (const auto& port : half(h).ports) {
+    out.insert(out.end(), port->channels.begin(), port->channels.end());
+  }
+  return out;
+}
+
+Status PlanVersion::apply_to(TwinModule& m) const {
+  const std::vector<Channel> a = channels(Half::kA);
+  const std::vector<Channel> b = channels(Half::kB);
+  if (Status s = WssHalf::validate_plan(a); s != Status::kOk) return s;
+  if (Status s = WssHalf::validate_plan(b); s != Status::kOk) return s;
+  (void)m.half(Half::kA).commit_plan(a);
+  (void)m.half(Half::kB).commit_plan(b);
+  return Status::kOk;
+}
+
+}  // namespace twin
@@ -0,0 +1,355 @@
+#include "twin/qot.h"
+
+#include <algorithm>
+#include <cmath>
+#include <numbers>
+
+namespace twin {
+
+namespace {
+
+constexpr double kPlanck = 6.62607015e-34;
+constexpr double kCentreHz = 193.4e12;
+
+double db_to_lin(double db) { return std::pow(10.0, db / 10.0); }
+
+}  // namespace
+
+class QotEstimator::Watch : public WssObserver {
+ public:
+  Watch(QotEstimator& est, WssHalf& wss, bool crosstalk, const CrosstalkConfig& xc)
+      : est_(est), wss_(wss) {
+    if (crosstalk) xt = std::make_unique<CrosstalkModel>(wss, xc);
+    wss_.add_observer(this);
+  }
+  ~Watch() override { wss_.remove_observer(this); }
+
+  const WssHalf& wss() const { return wss_; }
+
+  std::unique_ptr<CrosstalkModel> xt;
+  std::vector<LinkId> links;
+  std::vector<std::uint32_t> hops;
+
+  void on_channel_change(const WssHalf&, const Channel*, const Channel*) override {
+    est_.mark_half(*this);
+  }
+  void on_reset(const WssHalf&) override { est_.mark_half(*this); }
+
+ private:
+  QotEstimator& est_;
+  WssHalf& wss_;
+};
+
+void QotEstimator::HopBatch::resize(std::size_t n) {
+  for (auto* v : {&ase_psd, &eta, &power_w, &rs_hz, &xt, &ase_nsr, &nsr}) {
+    if (v->size() < n) v->resize(n);
+  }
+}
+
+void QotEstimator::HopBatch::run(std::size_t n) {
+  // Straight-line arithmetic over parallel arrays; vectorises as written.
+  constexpr double kRef = 12.5e9;
+  for (std::size_t i = 0; i < n; ++i) {
+    const double p = power_w[i];
+    const double ase = ase_psd[i] / p;
+    const double nli = eta[i] * p * p / (rs_hz[i] * rs_hz[i]);
+    ase_nsr[i] = ase * kRef;
+    nsr[i] = ase * rs_hz[i] + nli + xt[i];
+  }
+}
+
+QotEstimator::QotEstimator(Network& net, const QotConfig& config)
+    : net_(net), config_(config), launch_w_(db_to_lin(config.launch_dbm) * 1e-3) {
+  const double span_loss_db = config_.span_length_km * config_.fibre_loss_db_per_km;
+  span_ase_psd_ = db_to_lin(config_.noise_figure_db) * kPlanck * kCentreHz *
+                  db_to_lin(span_loss_db);
+}
+
+QotEstimator::~QotEstimator() = default;
+
+double QotEstimator::symbol_rate_hz(int num_slices) const {
+  return static_cast<double>(num_slices) * static_cast<double>(kSliceWidthMHz) * 1e6 /
+         (1.0 + config_.roll_off);
+}
+
+double QotEstimator::eta_for(const Link& link, int occupied_slices) const {
+  const int spans =
+      std::max(1, static_cast<int>(std::ceil(link.length_km / config_.span_length_km)));
+  const double span_km = link.length_km / spans;
+  const double alpha = config_.fibre_loss_db_per_km / (10.0 * std::numbers::log10e);
+  const double l_eff = (1.0 - std::exp(-alpha * span_km)) / alpha;
+  const double l_eff_a = 1.0 / alpha;
+  const double beta2 = std::abs(config_.beta2_ps2_per_km) * 1e-24;
+  const double bw = static_cast<double>(std::max(occupied_slices, 1)) *
+                    static_cast<double>(kSliceWidthMHz) * 1e6;
+  const double pi = std::numbers::pi;
+  const double per_span = 8.0 / 27.0 * config_.gamma_per_w_km * config_.gamma_per_w_km *
+                          l_eff * l_eff *
+                          std::asinh(pi * pi / 2.0 * beta2 * l_eff_a * bw * bw) /
+                          (pi * beta2 * l_eff_a);
+  return per_span * spans;
+}
+
+const QotEstimator::LinkTerms& QotEstimator::link_terms(LinkId l) {
+  if (links_.size() <= l) links_.resize(std::size_t{l} + 1);
+  LinkTerms& t = links_[l];
+  if (!t.watched) {
+    watch(net_.link(l)).links.push_back(l);
+    t.watched = true;
+  }
+  if (t.dirty) {
+    const Link& link = net_.link(l);
+    const int spans =
+        std::max(1, static_cast<int>(std::ceil(link.length_km / config_.span_length_km)));
+    // Shorter spans than nominal still use the nominal amplifier gain; the
+    // excess becomes a fixed pad and adds no noise.
+    t.ase_psd = span_ase_psd_ * spans;
+    t.eta = eta_for(link, net_.module(link.from).half(link.half).port_occupancy(link.port).count());
+    t.dirty = false;
+  }
+  return t;
+}
+
+QotEstimator::Watch& QotEstimator::watch(const Link& link) {
+  const std::uint64_t key = std::uint64_t{link.from} * kNumHalves + index_of(link.half);
+  auto& w = watches_[key];
+  if (!w) {
+    w = std::make_unique<Watch>(*this, net_.module(link.from).half(link.half), config_.crosstalk,
+                                config_.crosstalk_config);
+  }
+  return *w;
+}
+
+void QotEstimator::mark_half(Watch& w) {
+  for (LinkId l : w.links) {
+    if (l < links_.size()) links_[l].dirty = true;
+  }
+  for (std::uint32_t h : w.hops) {
+    if (hop_dirty_[h]) continue;
+    hop_dirty_[h] = 1;
+    dirty_hops_.push_back(h);
+  }
+}
+
+QotPathId QotEstimator::add_lightpath(std::span<const LinkId> path, ChannelId id) {
+  QotPathId lp;
+  if (!free_paths_.empty()) {
+    lp = free_paths_.back();
+    free_paths_.pop_back();
+    ids_[lp] = id;
+    lp_live_[lp] = 1;
+    results_[lp] = {};
+  } else {
+    lp = static_cast<QotPathId>(ids_.size());
+    ids_.push_back(id);
+    hop_begin_.push_back(0);
+    hop_end_.push_back(0);
+    lp_live_.push_back(1);
+    lp_dirty_.push_back(0);
+    results_.emplace_back();
+  }
+  hop_begin_[lp] = static_cast<std::uint32_t>(hop_link_.size());
+  for (LinkId l : path) {
+    const auto h = static_cast<std::uint32_t>(hop_link_.size());
+    std::vector<std::uint32_t>& hops = watch(net_.link(l)).hops;
+    hop_link_.push_back(l);
+    hop_path_.push_back(lp);
+    hop_watch_pos_.push_back(static_cast<std::uint32_t>(hops.size()));
+    hop_ok_.push_back(0);
+    hop_dirty_.push_back(1);
+    hop_ase_nsr_.push_back(0.0);
+    hop_nsr_.push_back(0.0);
+    dirty_hops_.push_back(h);
+    hops.push_back(h);
+  }
+  hop_end_[lp] = static_cast<std::uint32_t>(hop_link_.size());
+  // A reused slot may still be queued from its previous lightpath.
+  if (path.empty() && !lp_dirty_[lp]) {
+    lp_dirty_[lp] = 1;
+    dirty_paths_.push_back(lp);
+  }
+  return lp;
+}
+
+void QotEstimator::unwatch_hop(std::uint32_t h) {
+  std::vector<std::uint32_t>& hops = watch(net_.link(hop_link_[h])).hops;
+  const std::uint32_t pos = hop_watch_pos_[h];
+  const std::uint32_t moved = hops.back();
+  hops[pos] = moved;
+  hop_watch_pos_[moved] = pos;
+  hops.pop_back();
+}
+
+void QotEstimator::remove_lightpath(QotPathId lp) {
+  // A second remove must not free the slot twice.
+  if (lp >= lp_live_.size() || !lp_live_[lp]) return;
+  for (std::uint32_t h = hop_begin_[lp]; h < hop_end_[lp]; ++h) {
+    unwatch_hop(h);
+    hop_path_[h] = kNoPath;
+  }
+  dead_hops_ += hop_end_[lp] - hop_begin_[lp];
+  hop_begin_[lp] = hop_end_[lp] = 0;
+  lp_live_[lp] = 0;
+  results_[lp] = {};
+  free_paths_.push_back(lp);
+  if (dead_hops_ > hop_link_.size() / 2) compact_hops();
+}
+
+void QotEstimator::compact_hops() {
+  // Live hops slide down in order, so each lightpath's hops stay contiguous
+  // and every index only decreases. Hops in flight in dirty_hops_ are mapped
+  // across and dead ones dropped.
+  std::vector<std::uint32_t> remap(hop_link_.size(), ~std::uint32_t{0});
+  std::uint32_t n = 0;
+  for (std::uint32_t h = 0; h < hop_link_.size(); ++h) {
+    if (hop_path_[h] == kNoPath) continue;
+    const QotPathId lp = hop_path_[h];
+    if (hop_begin_[lp] == h) hop_begin_[lp] = n;
+    if (hop_end_[lp] == h + 1) hop_end_[lp] = n + 1;
+    hop_link_[n] = hop_link_[h];
+    hop_path_[n] = lp;
+    hop_watch_pos_[n] = hop_watch_pos_[h];
+    hop_ok_[n] = hop_ok_[h];
+    hop_dirty_[n] = hop_dirty_[h];
+    hop_ase_nsr_[n] = hop_ase_nsr_[h];
+    hop_nsr_[n] = hop_nsr_[h];
+    watch(net_.link(hop_link_[n])).hops[hop_watch_pos_[n]] = n;
+    remap[h] = n++;
+  }
+  hop_link_.resize(n);
+  hop_path_.resize(n);
+  hop_watch_pos_.resize(n);
+  hop_ok_.resize(n);
+  hop_dirty_.resize(n);
+  hop_ase_nsr_.resize(n);
+  hop_nsr_.resize(n);
+  std::size_t kept = 0;
+  for (std::uint32_t h : dirty_hops_) {
+    if (remap[h] != ~std::uint32_t{0}) dirty_hops_[kept++] = remap[h];
+  }
+  dirty_hops_.resize(kept);
+  dead_hops_ = 0;
+}
+
+void QotEstimator::update() {
+  const std::size_t n = dirty_hops_.size();
+  batch_.resize(n);
+  for (std::size_t i = 0; i < n; ++i) {
+    const std::uint32_t h = dirty_hops_[i];
+    const QotPathId lp = hop_path_[h];
+    const Link& link = net_.link(hop_link_[h]);
+    const Watch& w = watch(link);
+    const Channel* ch = lp != kNoPath ? w.wss().find(ids_[lp]) : nullptr;
+    const bool ok = ch && ch->port == link.port;
+    hop_ok_[h] = ok;
+    const LinkTerms& t = link_terms(hop_link_[h]);
+    batch_.ase_psd[i] = t.ase_psd;
+    batch_.eta[i] = t.eta;
+    batch_.power_w[i] = ok ? launch_w_ / db_to_lin(ch->attenuation.db()) : launch_w_;
+    batch_.rs_hz[i] = symbol_rate_hz(ok ? ch->num_slices : 1);
+    double xt = 0.0;
+    if (ok && w.xt) {
+      const double db = w.xt->channel_crosstalk_db(ch->id);
+      if (std::isfinite(db)) xt = db_to_lin(db);
+    }
+    batch_.xt[i] = xt;
+  }
+  batch_.run(n);
+  for (std::size_t i = 0; i < n; ++i) {
+    const std::uint32_t h = dirty_hops_[i];
+    hop_ase_nsr_[h] = batch_.ase_nsr[i];
+    hop_nsr_[h] = batch_.nsr[i];
+    hop_dirty_[h] = 0;
+    const QotPathId lp = hop_path_[h];
+    if (lp != kNoPath && !lp_dirty_[lp]) {
+      lp_dirty_[lp] = 1;
+      dirty_paths_.push_back(lp);
+    }
+  }
+  dirty_hops_.clear();
+
+  for (QotPathId lp : dirty_paths_) {
+    lp_dirty_[lp] = 0;
+    if (!lp_live_[lp]) continue;
+    double ase = 0.0;
+    double nsr = 0.0;
+    bool ok = hop_begin_[lp] != hop_end_[lp];
+    for (std::uint32_t h = hop_begin_[lp]; h < hop_end_[lp]; ++h) {
+      ok = ok && hop_ok_[h];
+      ase += hop_ase_nsr_[h];
+      nsr += hop_nsr_[h];
+    }
+    results_[lp] = {};
+    if (ok) finish(results_[lp], ase, nsr);
+  }
+  dirty_paths_.clear();
+}
+
+void QotEstimator::finish(QotResult& r, double ase_nsr, double nsr) const {
+  r.valid = true;
+  r.osnr_db = -10.0 * std::log10(ase_nsr);
+  r.gsnr_db = -10.0 * std::log10(nsr);
+}
+
+bool QotEstimator::valid_candidate(const QotCandidate& c) const {
+  if (c.path.empty() || !valid_slice_range(c.first_slice, c.num_slices)) return false;
+  if (!WssHalf::valid_attenuation(c.attenuation)) return false;
+  for (LinkId l : c.path) {
+    if (l >= net_.num_links()) return false;
+  }
+  return true;
+}
+
+void QotEstimator::estimate(std::span<const QotCandidate> candidates, std::span<QotResult> out) {
+  std::size_t n = 0;
+  for (const QotCandidate& c : candidates) {
+    if (valid_candidate(c)) n += c.path.size();
+  }
+  batch_.resize(n);
+  std::size_t i = 0;
+  for (const QotCandidate& c : candidates) {
+    if (!valid_candidate(c)) continue;
+    const double power = launch_w_ / db_to_lin(c.attenuation.db());
+    const double rs = symbol_rate_hz(c.num_slices);
+    for (LinkId l : c.path) {
+      const Link& link = net_.link(l);
+      const WssHalf& wss = net_.module(link.from).half(link.half);
+      // The candidate's own slices count towards the occupied bandwidth.
+      SliceBitmap occ = wss.port_occupancy(link.port);
+      occ.set_range(c.first_slice, c.num_slices);
+      batch_.ase_psd[i] = link_terms(l).ase_psd;
+      batch_.eta[i] = eta_for(link, occ.count());
+      batch_.power_w[i] = power;
+      batch_.rs_hz[i] = rs;
+      // Not yet switched, so the port's present crosstalk ratio stands in.
+      double xt = 0.0;
+      if (const Watch* w = config_.crosstalk ? &watch(link) : nullptr; w && w->xt) {
+        const double db = w->xt->port_crosstalk_db(link.port);
+        if (std::isfinite(db)) xt = db_to_lin(db);
+      }
+      batch_.xt[i] = xt;
+      ++i;
+    }
+  }
+  batch_.run(n);
+  i = 0;
+  for (std::size_t c = 0; c < candidates.size(); ++c) {
+    out[c] = {};
+    if (!valid_candidate(candidates[c])) continue;
+    double ase = 0.0;
+    double nsr = 0.0;
+    for (std::size_t k = 0; k < candidates[c].path.size(); ++k, ++i) {
+      ase += batch_.ase_nsr[i];
+      nsr += batch_.nsr[i];
+    }
+    finish(out[c], ase, nsr);
+  }
+}
+
+QotResult QotEstimator::estimate(const QotCandidate& candidate) {
+  QotResult r;
+  estimate(std::span<const QotCandidate>(&candidate, 1), std::span<QotResult>(&r, 1));
+  return r;
+}
+
+}  // namespace twin
@@ -0,0 +1,198 @@
+#include "twin/roadm.h"
+
+namespace twin {
+
+const char* to_string(NodeArchitecture a) {
+  switch (a) {
+    case NodeArchitecture::kBroadcastSelect:
+      return "broadcast-select";
+    case NodeArchitecture::kRouteSelect:
+      return "route-select";
+  }
+  return "unknown";
+}
+
+class RoadmNode::Watch : public WssObserver {
+ public:
+  Watch(RoadmNode& node, int degree, Half half, WssHalf& wss)
+      : node_(node), degree_(degree), half_(half), wss_(wss) {
+    wss_.add_observer(this);
+  }
+  ~Watch() override { wss_.remove_observer(this); }
+
+  void on_channel_change(const WssHalf&, const Channel* before, const Channel* after) override {
+    if (before) node_.invalidate(degree_, half_, before->port);
+    if (after && (!before || after->port != before->port)) {
+      node_.invalidate(degree_, half_, after->port);
+    }
+  }
+
+  void on_reset(const WssHalf&) override { node_.invalidate_half(degree_, half_); }
+
+ private:
+  RoadmNode& node_;
+  int degree_;
+  Half half_;
+  WssHalf& wss_;
+};
+
+bool RoadmNode::valid_config(const NodeConfig& config, std::size_t modules) {
+  return config.degrees >= 2 && config.add_drop_ports >= 0 &&
+         static_cast<std::size_t>(config.degrees) == modules &&
+         config.degrees - 1 + config.add_drop_ports <= kNumPorts;
+}
+
+RoadmNode::RoadmNode(const NodeConfig& config, std::span<TwinModule> modules) : config_(config) {
+  if (!valid_config(config, modules.size())) {
+    config_.degrees = 0;
+    config_.add_drop_ports = 0;
+    return;
+  }
+  modules_ = modules;
+  const auto d = static_cast<std::size_t>(config_.degrees);
+  const auto a = static_cast<std::size_t>(config_.add_drop_ports);
+  express_.resize(d * d);
+  add_.resize(d * a);
+  drop_.resize(d * a);
+  watches_.reserve(2 * d);
+  for (int i = 0; i < config_.degrees; ++i) {
+    watches_.push_back(std::make_unique<Watch>(*this, i, Half::kA, ingress(i)));
+    watches_.push_back(std::make_unique<Watch>(*this, i, Half::kB, egress(i)));
+  }
+}
+
+RoadmNode::~RoadmNode() = default;
+
+int RoadmNode::port_degree(int d, int port) const {
+  if (port < 1 || port >= config_.degrees) return -1;
+  return port <= d ? port - 1 : port;
+}
+
+void RoadmNode::mark(Entry& e) {
+  if (e.dirty) return;
+  e.dirty = true;
+  ++stats_.invalidations;
+}
+
+void RoadmNode::invalidate(int degree, Half half, int port) {
+  const int peer = port_degree(degree, port);
+  const int a = port - config_.degrees;
+  if (half == Half::kB) {
+    // Egress: selects another degree's express traffic or an add port.
+    if (peer >= 0) {
+      mark(express_[express_slot(peer, degree)]);
+    } else if (valid_add_drop(a)) {
+      mark(add_[add_drop_slot(degree, a)]);
+    }
+    return;
+  }
+  // Ingress: a splitter leg under broadcast-and-select, so only its drop
+  // ports matter there.
+  if (peer >= 0) {
+    if (config_.architecture == NodeArchitecture::kRouteSelect) {
+      mark(express_[express_slot(degree, peer)]);
+    }
+  } else if (valid_add_drop(a)) {
+    mark(drop_[add_drop_slot(degree, a)]);
+  }
+}
+
+void RoadmNode::invalidate_half(int degree, Half half) {
+  for (int port = 1; port <= config_.degrees - 1 + config_.add_drop_ports; ++port) {
+    invalidate(degree, half, port);
+  }
+}
+
+Status RoadmNode::express(int from, int to, SliceBitmap& out) const {
+  if (!valid_degree(from) || !valid_degree(to)) return Status::kInvalidPort;
+  Entry& e = express_[express_slot(from, to)];
+  if (e.dirty) {
+    ++stats_.recomputes;
+    if (from == to) {
+      e.passband = SliceBitmap{};
+    } else {
+      e.passband = egress(to).port_occupancy(degree_port(to, from));
+      if (config_.architecture == NodeArchitecture::kRouteSelect) {
+        // The slices must be switched the same way at both WSSs; there is
+        // no wavelength conversion inside the node.
+        e.passband &= ingress(from).port_occupancy(degree_port(from, to));
+      }
+    }
+    e.dirty = false;
+  }
+  out = e.passband;
+  return Status::kOk;
+}
+
+Status RoadmNode::add_path(int degree, int add_port, SliceBitmap& out) const {
+  if (!valid_degree(degree) || !valid_add_drop(add_port)) return Status::kInvalidPort;
+  Entry& e = add_[add_drop_slot(degree, add_port)];
+  if (e.dirty) {
+    ++stats_.recomputes;
+    e.passband = egress(degree).port_occupancy(add_drop_port(add_port));
+    e.dirty = false;
+  }
+  out = e.passband;
+  return Status::kOk;
+}
+
+Status RoadmNode::drop_path(int degree, int drop_port, SliceBitmap& out) const {
+  if (!valid_degree(degree) || !valid_add_drop(drop_port)) return Status::kInvalidPort;
+  Entry& e = drop_[add_drop_slot(degree, drop_port)];
+  if (e.dirty) {
+    ++stats_.recomputes;
+    e.passband = ingress(degree).port_occupancy(add_drop_port(drop_port));
+    e.dirty = false;
+  }
+  out = e.passband;
+  return Status::kOk;
+}
+
+namespace {
+
+// Callers have checked the slice range, so the narrowing is exact.
+ChannelSpec spec_for(const NodeChannel& ch, int port) {
+  ChannelSpec s;
+  s.id = ch.id;
+  s.port = static_cast<std::uint8_t>(port);
+  s.first_slice = static_cast<std::uint16_t>(ch.first_slice);
+  s.num_slices = static_cast<std::uint16_t>(ch.num_slices);
+  s.attenuation = ch.attenuation;
+  return s;
+}
+
+}  // namespace
+
+Status RoadmNode::connect_express(int from, int to, const NodeChannel& ch) {
+  if (!valid_degree(from) || !valid_degree(to) || from == to) return Status::kInvalidPort;
+  if (!valid_slice_range(ch.first_slice, ch.num_slices)) return Status::kInvalidRange;
+  if (config_.architecture == NodeArchitecture::kBroadcastSelect) {
+    return egress(to).add_channel(spec_for(ch, degree_port(to, from)));
+  }
+  const Status s = ingress(from).add_channel(spec_for(ch, degree_port(from, to)));
+  if (s != Status::kOk) return s;
+  const Status t = egress(to).add_channel(spec_for(ch, degree_port(to, from)));
+  if (t != Status::kOk) ingress(from).delete_channel(ch.id);
+  return t;
+}
+
+Status RoadmNode::connect_add(int degree, int add_port, const NodeChannel& ch) {
+  if (!valid_degree(degree) || !valid_add_drop(add_port)) return Status::kInvalidPort;
+  if (!valid_slice_range(ch.first_slice, ch.num_slices)) return Status::kInvalidRange;
+  return egress(degree).add_channel(spec_for(ch, add_drop_port(add_port)));
+}
+
+Status RoadmNode::connect_drop(int degree, int drop_port, const NodeChannel& ch) {
+  if (!valid_degree(degree) || !valid_add_drop(drop_port)) return Status::kInvalidPort;
+  if (!valid_slice_range(ch.first_slice, ch.num_slices)) return Status::kInvalidRange;
+  return ingress(degree).add_channel(spec_for(ch, add_drop_port(drop_port)));
+}
+
+void RoadmNode::disconnect(ChannelId id) {
+  for (int d = 0; d < config_.degrees; ++d) {
+    if (ingress(d).find(id)) ingress(d).delete_channel(id);
+    if (egress(d).find(id)) egress(d).delete_channel(id);
+  }
+}
+
+}  // namespace twin
@@ -0,0 +1,158 @@
+#include "twin/rsa.h"
+
+#include <limits>
+
+namespace twin {
+
+const char* to_string(FitPolicy p) {
+  switch (p) {
+    case FitPolicy::kFirstFit:
+      return "first-fit";
+    case FitPolicy::kLastFit:
+      return "last-fit";
+    case FitPolicy::kBestFit:
+      return "best-fit";
+    case FitPolicy::kMinFragmentation:
+      return "min-fragmentation";
+  }
+  return "unknown";
+}
+
+RsaSolver::RsaSolver(Network& net, ThreadPool& pool, RsaOptions opts)
+    : net_(net), pool_(pool), opts_(opts) {}
+
+void RsaSolver::set_options(const RsaOptions& opts) {
+  if (opts.k_paths != opts_.k_paths) invalidate_paths();
+  opts_ = opts;
+}
+
+const std::vector<Path>& RsaSolver::paths(NodeId src, NodeId dst) {
+  const std::uint64_t key = (static_cast<std::uint64_t>(src) << 32) | dst;
+  auto it = path_cache_.find(key);
+  if (it == path_cache_.end()) {
+    it = path_cache_.emplace(key, net_.k_shortest_paths(src, dst, opts_.k_paths)).first;
+  }
+  return it->second;
+}
+
+RsaSolver::Candidate RsaSolver::evaluate(const Path& p, int num_slices) const {
+  SliceBitmap blocked;
+  for (LinkId l : p) blocked |= net_.blocked(l);
+
+  Candidate best;
+  best.evaluated = true;
+  best.cost = std::numeric_limits<int>::max();
+  const int n = num_slices;
+
+  blocked.for_each_free_run([&](int first, int len) {
+    if (len < n) return;
+    int cost = 0;
+    int place = first;
+    switch (opts_.policy) {
+      case FitPolicy::kFirstFit:
+        if (best.feasible) return;
+        cost = first;
+        break;
+      case FitPolicy::kLastFit:
+        place = first + len - n;
+        cost = kNumSlices - place;
+        break;
+      case FitPolicy::kBestFit:
+        cost = len - n;
+        break;
+      case FitPolicy::kMinFragmentation: {
+        const int remnant = len - n;
+        cost = remnant == 0 ? 0 : remnant < n ? 2 * kNumSlices - remnant : remnant;
+        break;
+      }
+    }
+    if (!best.feasible || cost < best.cost) {
+      best.feasible = true;
+      best.first = place;
+      best.cost = cost;
+    }
+  });
+  return best;
+}
+
+bool RsaSolver::better(const Candidate& a, std::size_t ia, const Candidate& b, std::size_t ib,
+                       const std::vector<Path>& paths) const {
+  if (!a.feasible) return false;
+  if (!b.feasible) return true;
+  switch (opts_.policy) {
+    case FitPolicy::kFirstFit:
+    case FitPolicy::kLastFit:
+      // Paths are already in ascending length; take the shortest feasible.
+      return ia < ib;
+    case FitPolicy::kBestFit:
+    case FitPolicy::kMinFragmentation:
+      if (a.cost != b.cost) return a.cost < b.cost;
+      if (paths[ia].size() != paths[ib].size()) return paths[ia].size() < paths[ib].size();
+      return ia < ib;
+  }
+  return false;
+}
+
+RsaResult RsaSolver::solve(const Demand& d) {
+  RsaResult result;
+  if (!valid_slice_range(0, d.num_slices)) return result;
+  const std::vector<Path>& cand = paths(d.src, d.dst);
+  if (cand.empty()) return result;
+
+  const auto deadline = std::chrono::steady_clock::now() + opts_.budget;
+  scratch_.assign(cand.size(), Candidate{});
+  pool_.parallel_for(cand.size(), [&](std::size_t i) {
+    // The shortest path is always evaluated so a tight budget still yields
+    // an answer when one exists.
+    if (i != 0 && !opts_.deterministic && std::chrono::steady_clock::now() > deadline) return;
+    scratch_[i] = evaluate(cand[i], d.num_slices);
+  });
+
+  std::size_t best = cand.size();
+  for (std::size_t i = 0; i < cand.size(); ++i) {
+    if (scratch_[i].evaluated) ++result.paths_evaluated;
+    if (best == cand.size() ? scratch_[i].feasible
+                            : better(scratch_[i], i, scratch_[best], best, cand)) {
+      best = i;
+    }
+  }
+  if (best == cand.size()) return result;
+
+  result.found = true;
+  result.path = cand[best];
+  result.first_slice = static_cast<std::uint16_t>(scratch_[best].first);
+  result.num_slices = d.num_slices;
+  return result;
+}
+
+Status RsaSolver::provision(const RsaResult& r, ChannelId id, Attenuation attenuation) {
+  if (!r.found) return Status::kInvalidRange;
+  for (std::size_t i = 0; i < r.path.size(); ++i) {
+    const Link& l = net_.link(r.path[i]);
+    ChannelSpec spec{id, l.port, r.first_slice, r.num_slices, attenuation};
+    Status s = net_.module(l.from).half(l.half).add_channel(spec);
+    if (s != Status::kOk) {
+      while (i-- > 0) {
+        const Link& undo = net_.link(r.path[i]);
+        (void)net_.module(undo.from).half(undo.half).delete_channel(id);
+      }
+      return s;
+    }
+  }
+  return Status::kOk;
+}
+
+std::vector<RsaResult> RsaSolver::solve_batch(std::span<const Demand> demands, ChannelId first_id) {
+  std::vector<RsaResult> results;
+  results.reserve(demands.size());
+  for (std::size_t i = 0; i < demands.size(); ++i) {
+    RsaResult r = solve(demands[i]);
+    if (r.found && provision(r, first_id + static_cast<ChannelId>(i)) != Status::kOk) {
+      r.found = false;
+    }
+    results.push_back(std::move(r));
+  }
+  return results;
+}
+
+}  // namespace twin
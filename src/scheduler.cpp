@@ -0,0 +1,269 @@
+#include "twin/scheduler.h"
+
+#include <algorithm>
+#include <cstdlib>
+
+namespace twin {
+
+const char* to_string(CommandClass c) {
+  switch (c) {
+    case CommandClass::kRestoration:
+      return "restoration";
+    case CommandClass::kProvisioning:
+      return "provisioning";
+    case CommandClass::kEqualisation:
+      return "equalisation";
+  }
+  return "unknown";
+}
+
+CommandScheduler::CommandScheduler(std::span<TwinModule> modules, DoneFn on_done,
+                                   const SchedulerOptions& opts)
+    : modules_(modules),
+      on_done_(std::move(on_done)),
+      opts_(opts),
+      lanes_(modules.size() * kNumHalves) {
+  if (opts_.ramp_step.tenths() <= 0) opts_.ramp_step = kMaxAttenuation;
+}
+
+std::uint64_t CommandScheduler::submit(const Command& c, CommandClass cls) {
+  Entry e;
+  e.seq = ++next_seq_;
+  e.cls = cls;
+  e.cmd = c;
+  e.queued = now_;
+  e.waiting_since = now_;
+  ++stats_[index_of(cls)].submitted;
+  const Status s = validate_command(c, modules_.size());
+  if (s != Status::kOk) {
+    e.started = now_;
+    complete(e, s, now_);
+    return e.seq;
+  }
+  Lane& lane = lane_of(c);
+  if (opts_.coalesce && coalesce(lane, e)) return e.seq;
+  auto& q = lane.queues[index_of(cls)];
+  q.push_back(e);
+  if (c.kind != CommandKind::kSnapshot) lane.last[c.channel] = &q.back();
+  ++queued_;
+  if (!lane.listed) {
+    lane.listed = true;
+    active_.push_back(static_cast<std::uint32_t>(&lane - lanes_.data()));
+  }
+  return e.seq;
+}
+
+bool CommandScheduler::coalesce(Lane& lane, const Entry& e) {
+  if (e.cmd.kind != CommandKind::kAttenuate && e.cmd.kind != CommandKind::kRetune) return false;
+  auto it = lane.last.find(e.cmd.channel);
+  if (it == lane.last.end()) return false;
+  Entry& prev = *it->second;
+  // A less urgent command queues behind the pending one as usual.
+  if (prev.cmd.kind != e.cmd.kind || index_of(e.cls) > index_of(prev.cls)) return false;
+
+  ClassStats& st = stats_[index_of(prev.cls)];
+  ++st.completed;
+  ++st.coalesced;
+  st.completion_us.record(now_ - prev.queued);
+  if (on_done_) {
+    Completion done;
+    done.seq = prev.seq;
+    done.cls = prev.cls;
+    done.cmd = prev.cmd;
+    done.queued = prev.queued;
+    done.started = now_;
+    done.finished = now_;
+    done.superseded_by = e.seq;
+    on_done_(done);
+  }
+  if (e.cls == prev.cls) {
+    prev.seq = e.seq;
+    prev.cmd = e.cmd;
+    prev.queued = e.queued;
+    return true;
+  }
+  prev.dead = true;
+  lane.last.erase(it);
+  --queued_;
+  return false;
+}
+
+void CommandScheduler::purge(Lane& lane) {
+  for (auto& q : lane.queues) {
+    while (!q.empty() && q.front().dead) q.pop_front();
+  }
+}
+
+bool CommandScheduler::pick(Lane& lane, VirtualTime at, Entry& out) {
+  constexpr int kRestoration = static_cast<int>(CommandClass::kRestoration);
+  int by_priority = -1;
+  int oldest_aged = -1;
+  for (int c = 0; c < kNumCommandClasses; ++c) {
+    const auto& q = lane.queues[static_cast<std::size_t>(c)];
+    if (q.empty() || q.front().waiting_since > at) continue;
+    if (by_priority < 0) by_priority = c;
+    if (c == kRestoration) break;
+    const VirtualTime since = q.front().waiting_since;
+    if (at - since >= opts_.max_wait_us[static_cast<std::size_t>(c)] &&
+        (oldest_aged < 0 ||
+         since < lane.queues[static_cast<std::size_t>(oldest_aged)].front().waiting_since)) {
+      oldest_aged = c;
+    }
+  }
+  if (by_priority < 0) return false;
+  const int chosen = by_priority != kRestoration && oldest_aged >= 0 ? oldest_aged : by_priority;
+  auto& q = lane.queues[static_cast<std::size_t>(chosen)];
+  if (!q.front().begun && q.front().cmd.kind != CommandKind::kSnapshot) {
+    auto it = lane.last.find(q.front().cmd.channel);
+    if (it != lane.last.end() && it->second == &q.front()) lane.last.erase(it);
+  }
+  out = std::move(q.front());
+  q.pop_front();
+  if (chosen != by_priority && !out.begun) ++stats_[static_cast<std::size_t>(chosen)].promotions;
+  return true;
+}
+
+VirtualTime CommandScheduler::step_duration(const Entry& e) const {
+  const SettleTiming& t = opts_.timing;
+  switch (e.cmd.kind) {
+    case CommandKind::kAdd:
+      return t.add_us;
+    case CommandKind::kDelete:
+      return t.delete_us;
+    case CommandKind::kRetune:
+      return t.retune_us;
+    case CommandKind::kAttenuate:
+      return t.attenuate_step_us;
+    case CommandKind::kSnapshot:
+      return t.snapshot_us;
+  }
+  return 0;
+}
+
+void CommandScheduler::start_step(Lane& lane, Entry&& e, VirtualTime at) {
+  if (!e.begun) {
+    e.begun = true;
+    e.started = at;
+    stats_[index_of(e.cls)].queueing_us.record(at - e.queued);
+    e.steps_left = 1;
+    if (e.cmd.kind == CommandKind::kAttenuate) {
+      const WssHalf& wss = modules_[e.cmd.module].half(e.cmd.half);
+      if (const Channel* ch = wss.find(e.cmd.channel)) {
+        e.ramp_from = ch->attenuation;
+        const int delta = std::abs(e.cmd.attenuation.tenths() - ch->attenuation.tenths());
+        const int step = opts_.ramp_step.tenths();
+        e.ramp_steps = static_cast<std::uint16_t>(std::max(1, (delta + step - 1) / step));
+        e.steps_left = e.ramp_steps;
+      }
+    }
+  }
+  lane.free_at = at + step_duration(e);
+  lane.current = std::move(e);
+  lane.in_flight = true;
+}
+
+void CommandScheduler::finish_step(Lane& lane) {
+  lane.in_flight = false;
+  Entry& e = lane.current;
+  Command step = e.cmd;
+  --e.steps_left;
+  if (e.cmd.kind == CommandKind::kAttenuate && e.steps_left > 0) {
+    const int done = e.ramp_steps - e.steps_left;
+    const int span = e.cmd.attenuation.tenths() - e.ramp_from.tenths();
+    step.attenuation = Attenuation::from_tenths(
+        static_cast<std::int16_t>(e.ramp_from.tenths() + span * done / e.ramp_steps));
+  }
+  const Status s = apply_command(modules_[step.module], step);
+  if (s != Status::kOk || e.steps_left == 0) {
+    complete(e, s, lane.free_at);
+    return;
+  }
+  // Safe point: the rest of the ramp goes back to the head of its class.
+  auto& q = lane.queues[index_of(e.cls)];
+  q.push_front(std::move(e));
+  purge(lane);
+  bool yielded = false;
+  for (int c = 0; c < index_of(q.front().cls) && !yielded; ++c) {
+    const auto& hq = lane.queues[static_cast<std::size_t>(c)];
+    yielded = !hq.empty() && hq.front().waiting_since <= lane.free_at;
+  }
+  if (yielded) ++stats_[index_of(q.front().cls)].preemptions;
+}
+
+void CommandScheduler::complete(const Entry& e, Status status, VirtualTime at) {
+  ClassStats& st = stats_[index_of(e.cls)];
+  ++st.completed;
+  if (status != Status::kOk) ++st.failed;
+  st.completion_us.record(at - e.queued);
+  if (e.begun) --queued_;
+  if (on_done_) {
+    Completion done;
+    done.seq = e.seq;
+    done.cls = e.cls;
+    done.cmd = e.cmd;
+    done.status = status;
+    done.queued = e.queued;
+    done.started = e.started;
+    done.finished = at;
+    on_done_(done);
+  }
+}
+
+void CommandScheduler::run_lane(Lane& lane, VirtualTime now) {
+  for (;;) {
+    if (lane.in_flight) {
+      if (lane.free_at > now) return;
+      finish_step(lane);
+    }
+    purge(lane);
+    VirtualTime earliest = kIdle;
+    for (const auto& q : lane.queues) {
+      if (!q.empty()) earliest = std::min(earliest, q.front().waiting_since);
+    }
+    if (earliest == kIdle) return;
+    const VirtualTime at = std::max(lane.free_at, earliest);
+    if (at > now) return;
+    Entry e;
+    pick(lane, at, e);
+    start_step(lane, std::move(e), at);
+  }
+}
+
+void CommandScheduler::advance(VirtualTime now) {
+  now_ = std::max(now_, now);
+  std::size_t i = 0;
+  while (i < active_.size()) {
+    Lane& lane = lanes_[active_[i]];
+    run_lane(lane, now_);
+    const bool idle = !lane.in_flight && std::all_of(lane.queues.begin(), lane.queues.end(),
+                                                     [](const auto& q) { return q.empty(); });
+    if (!idle) {
+      ++i;
+      continue;
+    }
+    lane.listed = false;
+    active_[i] = active_.back();
+    active_.pop_back();
+  }
+}
+
+VirtualTime CommandScheduler::next_event() const {
+  VirtualTime next = kIdle;
+  for (std::uint32_t l : active_) {
+    const Lane& lane = lanes_[l];
+    if (lane.in_flight) {
+      next = std::min(next, lane.free_at);
+      continue;
+    }
+    for (const auto& q : lane.queues) {
+      if (!q.empty()) next = std::min(next, std::max(lane.free_at, q.front().waiting_since));
+    }
+  }
+  return next;
+}
+
+void CommandScheduler::run_until_idle() {
+  for (VirtualTime t = next_event(); t != kIdle; t = next_event()) advance(t);
+}
+
+}  // namespace twin
@@ -0,0 +1,352 @@
+#include "twin/script.h"
+
+#include <charconv>
+
+namespace twin {
+
+namespace {
+
+using Kind = Script::Kind;
+
+constexpr Status kAllStatuses[] = {
+    Status::kOk,
+    Status::kInvalidPort,
+    Status::kInvalidRange,
+    Status::kInvalidAttenuation,
+    Status::kSliceConflict,
+    Status::kUnknownChannel,
+    Status::kDuplicateChannel,
+    Status::kTableFull,
+    Status::kParseError,
+    Status::kInvalidModule,
+    Status::kIoError,
+};
+
+bool is_space(char c) { return c == ' ' || c == '\t' || c == '\r'; }
+
+void split(std::string_view line, std::vector<std::string_view>& toks) {
+  toks.clear();
+  std::size_t i = 0;
+  while (i < line.size()) {
+    while (i < line.size() && is_space(line[i])) ++i;
+    const std::size_t start = i;
+    while (i < line.size() && !is_space(line[i])) ++i;
+    if (i > start) toks.push_back(line.substr(start, i - start));
+  }
+}
+
+template <typename T>
+bool to_number(std::string_view tok, T& out) {
+  auto [p, ec] = std::from_chars(tok.data(), tok.data() + tok.size(), out);
+  return ec == std::errc{} && p == tok.data() + tok.size();
+}
+
+bool to_attenuation(std::string_view tok, Attenuation& out) {
+  double db;
+  if (!to_number(tok, db)) return false;
+  out = Attenuation::from_db(db);
+  return true;
+}
+
+bool to_half(std::string_view tok, Half& out) {
+  if (tok == "A" || tok == "a") {
+    out = Half::kA;
+  } else if (tok == "B" || tok == "b") {
+    out = Half::kB;
+  } else {
+    return false;
+  }
+  return true;
+}
+
+bool to_status(std::string_view tok, Status& out) {
+  for (Status s : kAllStatuses) {
+    if (tok == status_token(s)) {
+      out = s;
+      return true;
+    }
+  }
+  return false;
+}
+
+// Parses "<id>:<port>:<first>:<n>[:<atten>]".
+bool to_plan_entry(std::string_view tok, ChannelSpec& out) {
+  std::string_view f[5];
+  int n = 0;
+  std::size_t start = 0;
+  for (std::size_t i = 0; i <= tok.size(); ++i) {
+    if (i == tok.size() || tok[i] == ':') {
+      if (n == 5) return false;
+      f[n++] = tok.substr(start, i - start);
+      start = i + 1;
+    }
+  }
+  if (n < 4) return false;
+  out = ChannelSpec{};
+  return to_number(f[0], out.id) && to_number(f[1], out.port) && to_number(f[2], out.first_slice) &&
+         to_number(f[3], out.num_slices) && (n == 4 || to_attenuation(f[4], out.attenuation));
+}
+
+}  // namespace
+
+Status parse_script(std::string_view text, Script& out, ScriptError& err) {
+  out = Script{};
+  std::vector<std::string_view> toks;
+  std::vector<std::uint32_t> open_repeats;
+  std::uint32_t line_no = 0;
+
+  auto fail = [&](const char* msg) {
+    err.line = line_no;
+    err.message = msg;
+    return Status::kParseError;
+  };
+
+  std::size_t pos = 0;
+  while (pos <= text.size()) {
+    std::size_t eol = text.find('\n', pos);
+    if (eol == std::string_view::npos) eol = text.size();
+    std::string_view line = text.substr(pos, eol - pos);
+    pos = eol + 1;
+    ++line_no;
+    if (auto hash = line.find('#'); hash != std::string_view::npos) line = line.substr(0, hash);
+    split(line, toks);
+    if (toks.empty()) continue;
+
+    Script::Step st;
+    st.line = line_no;
+    const std::string_view verb = toks[0];
+
+    // Operand layout shared by asserts and queries: <m> <A|B> <x> [<y>].
+    auto operands = [&](std::size_t first, std::size_t n) {
+      return toks.size() == first + n && to_number(toks[first], st.cmd.module) &&
+             to_half(toks[first + 1], st.cmd.half);
+    };
+
+    if (verb == "modules") {
+      if (toks.size() != 2 || !to_number(toks[1], out.modules) || out.modules == 0) {
+        return fail("expected: modules <n>");
+      }
+      continue;
+    } else if (verb == "repeat") {
+      st.kind = Kind::kRepeat;
+      if (toks.size() != 2 || !to_number(toks[1], st.count)) return fail("expected: repeat <n>");
+      open_repeats.push_back(static_cast<std::uint32_t>(out.steps.size()));
+    } else if (verb == "end") {
+      if (toks.size() != 1 || open_repeats.empty()) return fail("end without repeat");
+      st.kind = Kind::kEnd;
+      st.target = open_repeats.back();
+      out.steps[open_repeats.back()].target = static_cast<std::uint32_t>(out.steps.size());
+      open_repeats.pop_back();
+    } else if (verb == "expect") {
+      st.kind = Kind::kExpect;
+      if (toks.size() < 3 || !to_status(toks[1], st.expect)) {
+        return fail("expected: expect <status> <command>");
+      }
+      const std::size_t rest = static_cast<std::size_t>(toks[2].data() - line.data());
+      if (parse_command(line.substr(rest), st.cmd) != Status::kOk) return fail("bad command");
+    } else if (verb == "commit") {
+      st.kind = Kind::kCommit;
+      if (toks.size() < 3 || !to_number(toks[1], st.cmd.module) || !to_half(toks[2], st.cmd.half)) {
+        return fail("expected: commit <m> <A|B> [entries]");
+      }
+      std::vector<ChannelSpec>& plan = out.plans.emplace_back();
+      for (std::size_t i = 3; i < toks.size(); ++i) {
+        if (!to_plan_entry(toks[i], plan.emplace_back())) {
+          return fail("bad plan entry, expected <id>:<port>:<first>:<n>[:<atten>]");
+        }
+      }
+      st.target = static_cast<std::uint32_t>(out.plans.size() - 1);
+    } else if (verb == "assert") {
+      if (toks.size() < 2) return fail("assert needs a predicate");
+      const std::string_view what = toks[1];
+      bool ok = false;
+      if (what == "channels") {
+        st.kind = Kind::kAssertChannels;
+        ok = operands(2, 3) && to_number(toks[4], st.count);
+      } else if (what == "exists" || what == "absent") {
+        st.kind = what == "exists" ? Kind::kAssertExists : Kind::kAssertAbsent;
+        ok = operands(2, 3) && to_number(toks[4], st.cmd.channel);
+      } else if (what == "free") {
+        st.kind = Kind::kAssertFree;
+        ok = operands(2, 4) && to_number(toks[4], st.cmd.first_slice) &&
+             to_number(toks[5], st.cmd.num_slices);
+      } else if (what == "used") {
+        st.kind = Kind::kAssertUsed;
+        ok = operands(2, 4) && to_number(toks[4], st.cmd.port) && to_number(toks[5], st.count);
+      } else if (what == "atten") {
+        st.kind = Kind::kAssertAtten;
+        ok = operands(2, 4) && to_number(toks[4], st.cmd.channel) &&
+             to_attenuation(toks[5], st.cmd.attenuation);
+      }
+      if (!ok) return fail("malformed assert");
+    } else if (verb == "query") {
+      if (toks.size() < 2) return fail("query needs a subject");
+      const std::string_view what = toks[1];
+      bool ok = false;
+      if (what == "channel") {
+        st.kind = Kind::kQueryChannel;
+        ok = operands(2, 3) && to_number(toks[4], st.cmd.channel);
+      } else if (what == "port") {
+        st.kind = Kind::kQueryPort;
+        ok = operands(2, 3) && to_number(toks[4], st.cmd.port);
+      } else if (what == "telemetry") {
+        st.kind = Kind::kQueryTelemetry;
+        ok = toks.size() == 3 && to_number(toks[2], st.cmd.module);
+      }
+      if (!ok) return fail("malformed query");
+    } else {
+      st.kind = Kind::kCommand;
+      if (parse_command(line, st.cmd) != Status::kOk) return fail("unknown or malformed statement");
+    }
+    out.steps.push_back(st);
+  }
+  if (!open_repeats.empty()) {
+    line_no = out.steps[open_repeats.back()].line;
+    return fail("repeat without end");
+  }
+  return Status::kOk;
+}
+
+void ScriptRunner::report(const Script::Step& st, const char* what) const {
+  if (out_ == nullptr || reported_ >= max_reports_) return;
+  ++reported_;
+  std::fprintf(out_, "line %u: %s\n", st.line, what);
+}
+
+bool ScriptRunner::check(const Script::Step& st, std::vector<TwinModule>& modules) const {
+  if (st.cmd.module >= modules.size()) return false;
+  const WssHalf& wss = modules[st.cmd.module].half(st.cmd.half);
+  switch (st.kind) {
+    case Kind::kAssertChannels:
+      return wss.num_channels() == st.count;
+    case Kind::kAssertExists:
+      return wss.find(st.cmd.channel) != nullptr;
+    case Kind::kAssertAbsent:
+      return wss.find(st.cmd.channel) == nullptr;
+    case Kind::kAssertFree:
+      return valid_slice_range(st.cmd.first_slice, st.cmd.num_slices) &&
+             !wss.common_occupancy().any_in(st.cmd.first_slice, st.cmd.num_slices);
+    case Kind::kAssertUsed:
+      return WssHalf::valid_port(st.cmd.port) &&
+             static_cast<std::uint32_t>(wss.port_occupancy(st.cmd.port).count()) == st.count;
+    case Kind::kAssertAtten: {
+      const Channel* ch = wss.find(st.cmd.channel);
+      return ch != nullptr && ch->attenuation == st.cmd.attenuation;
+    }
+    default:
+      return false;
+  }
+}
+
+void ScriptRunner::query(const Script::Step& st, std::vector<TwinModule>& modules) const {
+  if (out_ == nullptr || !echo_queries_) return;
+  if (st.cmd.module >= modules.size()) {
+    std::fprintf(out_, "line %u: no module %u\n", st.line, st.cmd.module);
+    return;
+  }
+  const TwinModule& m = modules[st.cmd.module];
+  const WssHalf& wss = m.half(st.cmd.half);
+  switch (st.kind) {
+    case Kind::kQueryChannel:
+      if (const Channel* ch = wss.find(st.cmd.channel)) {
+        std::fprintf(out_, "channel %u %s %u: port %u slices %u+%u atten %.1f dB\n", st.cmd.module,
+                     to_string(st.cmd.half), ch->id, ch->port, ch->first_slice, ch->num_slices,
+                     ch->attenuation.db());
+      } else {
+        std::fprintf(out_, "channel %u %s %u: absent\n", st.cmd.module, to_string(st.cmd.half),
+                     st.cmd.channel);
+      }
+      break;
+    case Kind::kQueryPort:
+      if (!WssHalf::valid_port(st.cmd.port)) {
+        std::fprintf(out_, "line %u: no port %u\n", st.line, st.cmd.port);
+      } else {
+        std::fprintf(out_, "port %u %s %u: %d slices used\n", st.cmd.module, to_string(st.cmd.half),
+                     st.cmd.port, wss.port_occupancy(st.cmd.port).count());
+      }
+      break;
+    case Kind::kQueryTelemetry: {
+      TelemetrySnapshot snap;
+      m.snapshot(snap);
+      for (Half h : {Half::kA, Half::kB}) {
+        const HalfTelemetry& t = snap.halves[index_of(h)];
+        std::fprintf(out_, "telemetry %u %s: %u channels, %u slices used\n", st.cmd.module,
+                     to_string(h), t.channels, t.used_slices);
+      }
+      break;
+    }
+    default:
+      break;
+  }
+}
+
+void ScriptRunner::run(std::vector<TwinModule>& modules, ScriptStats& stats) {
+  const auto& steps = script_.steps;
+  std::vector<std::uint32_t>& loops = loops_;
+  loops.clear();
+  char msg[96];
+
+  for (std::size_t pc = 0; pc < steps.size(); ++pc) {
+    const Script::Step& st = steps[pc];
+    switch (st.kind) {
+      case Kind::kCommand:
+      case Kind::kExpect: {
+        ++stats.commands;
+        Status s = validate_command(st.cmd, modules.size());
+        if (s == Status::kOk) s = apply_command(modules[st.cmd.module], st.cmd);
+        if (s != Status::kOk) ++stats.failed_commands;
+        if (st.kind == Kind::kExpect) {
+          ++stats.assertions;
+          if (s != st.expect) {
+            ++stats.failed_assertions;
+            std::snprintf(msg, sizeof msg, "expected %s, got %s", status_token(st.expect),
+                          status_token(s));
+            report(st, msg);
+          }
+        }
+        break;
+      }
+      case Kind::kCommit: {
+        ++stats.commands;
+        Status s = st.cmd.module < modules.size()
+                       ? modules[st.cmd.module].half(st.cmd.half).commit_plan(script_.plans[st.target])
+                       : Status::kInvalidModule;
+        if (s != Status::kOk) ++stats.failed_commands;
+        break;
+      }
+      case Kind::kAssertChannels:
+      case Kind::kAssertExists:
+      case Kind::kAssertAbsent:
+      case Kind::kAssertFree:
+      case Kind::kAssertUsed:
+      case Kind::kAssertAtten:
+        ++stats.assertions;
+        if (!check(st, modules)) {
+          ++stats.failed_assertions;
+          report(st, "assertion failed");
+        }
+        break;
+      case Kind::kQueryChannel:
+      case Kind::kQueryPort:
+      case Kind::kQueryTelemetry:
+        query(st, modules);
+        break;
+      case Kind::kRepeat:
+        if (st.count == 0) {
+          pc = st.target;
+        } else {
+          loops.push_back(st.count);
+        }
+        break;
+      case Kind::kEnd:
+        if (--loops.back() > 0) {
+          pc = st.target;
+        } else {
+          loops.pop_back();
+        }
+        break;
+    }
+  }
+}
+
+}  // namespace twin
@@ -0,0 +1,430 @@
+#include "twin/server.h"
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <climits>
+#include <cstdio>
+#include <cstring>
+#include <unordered_set>
+
+namespace twin {
+
+namespace {
+
+char g_listen_tag;
+char g_stop_tag;
+
+constexpr char kOk[] = "ok\n";
+constexpr char kErr[] = "err ";
+constexpr char kNewline[] = "\n";
+constexpr std::size_t kReadChunk = 64 * 1024;
+constexpr int kMaxEvents = 256;
+
+// Responses for one read burst. Fixed replies point at static strings;
+// formatted ones live in `scratch` and are patched into `iov` just before the
+// writev, once `scratch` has stopped growing.
+struct Batch {
+  std::vector<iovec> iov;
+  std::vector<std::size_t> dynamic;  // Indices into iov whose base is a scratch offset.
+  std::string scratch;
+
+  void clear() {
+    iov.clear();
+    dynamic.clear();
+    scratch.clear();
+  }
+  void add_static(const char* s, std::size_t n) {
+    iov.push_back({const_cast<char*>(s), n});
+  }
+  void add_static(const char* s) { add_static(s, std::strlen(s)); }
+  void add_formatted(const char* s, std::size_t n) {
+    dynamic.push_back(iov.size());
+    iov.push_back({reinterpret_cast<void*>(scratch.size()), n});
+    scratch.append(s, n);
+  }
+  void finalize() {
+    for (std::size_t i : dynamic) {
+      iov[i].iov_base = scratch.data() + reinterpret_cast<std::size_t>(iov[i].iov_base);
+    }
+  }
+};
+
+std::string errno_message(const char* what) {
+  return std::string(what) + ": " + std::strerror(errno);
+}
+
+}  // namespace
+
+struct ManagementServer::Conn {
+  int fd = -1;
+  std::string in;
+  std::string pending;  // Bytes accepted for sending but not yet written.
+  /// The peer has shut down its side; close once `pending` has drained.
+  bool read_closed = false;
+  /// EPOLLIN is off because `pending` passed max_pending.
+  bool paused = false;
+};
+
+struct ManagementServer::Reactor {
+  int epfd = -1;
+  std::thread thread;
+  std::unordered_set<Conn*> conns;
+  Batch batch;
+};
+
+ManagementServer::ManagementServer(std::vector<TwinModule>& modules, ServerOptions opts)
+    : modules_(modules),
+      module_locks_(std::make_unique<std::mutex[]>(modules.size())),
+      opts_(std::move(opts)) {
+  if (opts_.reactors == 0) opts_.reactors = 1;
+  if (opts_.max_read_burst == 0) opts_.max_read_burst = 1;
+}
+
+ManagementServer::~ManagementServer() { stop(); }
+
+bool ManagementServer::start(std::string& error) {
+  if (listen_fd_ >= 0) return true;
+
+  if (!opts_.unix_path.empty()) {
+    sockaddr_un addr{};
+    if (opts_.unix_path.size() >= sizeof addr.sun_path) {
+      error = "unix socket path too long";
+      return false;
+    }
+    addr.sun_family = AF_UNIX;
+    std::memcpy(addr.sun_path, opts_.unix_path.c_str(), opts_.unix_path.size() + 1);
+    listen_fd_ = ::socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (listen_fd_ < 0) {
+      error = errno_message("socket");
+      return false;
+    }
+    // Replace a stale socket from an earlier run, but never another file.
+    struct stat st;
+    if (::lstat(opts_.unix_path.c_str(), &st) == 0) {
+      if (!S_ISSOCK(st.st_mode)) {
+        errno = EADDRINUSE;
+        error = errno_message("bind");
+        stop();
+        return false;
+      }
+      ::unlink(opts_.unix_path.c_str());
+    }
+    if (::bind(listen_fd_, reinterpret_cast<sockaddr*>(&addr), sizeof addr) != 0) {
+      error = errno_message("bind");
+      stop();
+      return false;
+    }
+    bound_unix_ = true;
+  } else {
+    listen_fd_ = ::socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (listen_fd_ < 0) {
+      error = errno_message("socket");
+      return false;
+    }
+    int one = 1;
+    ::setsockopt(listen_fd_, SOL_SOCKET, SO_REUSEADDR, &one, sizeof one);
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = htons(opts_.tcp_port);
+    if (::bind(listen_fd_, reinterpret_cast<sockaddr*>(&addr), sizeof addr) != 0) {
+      error = errno_message("bind");
+      stop();
+      return false;
+    }
+    socklen_t len = sizeof addr;
+    ::getsockname(listen_fd_, reinterpret_cast<sockaddr*>(&addr), &len);
+    port_ = ntohs(addr.sin_port);
+  }
+  if (::listen(listen_fd_, SOMAXCONN) != 0) {
+    error = errno_message("listen");
+    stop();
+    return false;
+  }
+
+  stop_fd_ = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+  if (stop_fd_ < 0) {
+    error = errno_message("eventfd");
+    stop();
+    return false;
+  }
+
+  for (std::size_t i = 0; i < opts_.reactors; ++i) {
+    auto r = std::make_unique<Reactor>();
+    r->epfd = ::epoll_create1(EPOLL_CLOEXEC);
+    if (r->epfd < 0) {
+      error = errno_message("epoll_create1");
+      reactors_.push_back(std::move(r));
+      stop();
+      return false;
+    }
+    // The listening socket is level-triggered and exclusive so a new
+    // connection wakes one reactor rather than all of them.
+    epoll_event ev{};
+    ev.events = EPOLLIN | EPOLLEXCLUSIVE;
+    ev.data.ptr = &g_listen_tag;
+    ::epoll_ctl(r->epfd, EPOLL_CTL_ADD, listen_fd_, &ev);
+    ev.events = EPOLLIN;
+    ev.data.ptr = &g_stop_tag;
+    ::epoll_ctl(r->epfd, EPOLL_CTL_ADD, stop_fd_, &ev);
+    reactors_.push_back(std::move(r));
+  }
+  for (auto& r : reactors_) r->thread = std::thread([this, rp = r.get()] { reactor_loop(*rp); });
+  return true;
+}
+
+void ManagementServer::stop() {
+  if (stop_fd_ >= 0) {
+    const std::uint64_t one = 1;
+    (void)::write(stop_fd_, &one, sizeof one);
+  }
+  for (auto& r : reactors_) {
+    if (r->thread.joinable()) r->thread.join();
+    for (Conn* c : r->conns) {
+      ::close(c->fd);
+      delete c;
+    }
+    r->conns.clear();
+    if (r->epfd >= 0) ::close(r->epfd);
+  }
+  reactors_.clear();
+  if (stop_fd_ >= 0) ::close(stop_fd_);
+  stop_fd_ = -1;
+  if (listen_fd_ >= 0) ::close(listen_fd_);
+  if (bound_unix_) ::unlink(opts_.unix_path.c_str());
+  listen_fd_ = -1;
+  bound_unix_ = false;
+}
+
+ServerStats ManagementServer::stats() const {
+  ServerStats s;
+  s.accepted = accepted_.load(std::memory_order_relaxed);
+  s.open = s.accepted - closed_.load(std::memory_order_relaxed);
+  s.requests = requests_.load(std::memory_order_relaxed);
+  s.writev_calls = writev_calls_.load(std::memory_order_relaxed);
+  s.burst_yields = burst_yields_.load(std::memory_order_relaxed);
+  s.read_pauses = read_pauses_.load(std::memory_order_relaxed);
+  return s;
+}
+
+void ManagementServer::reactor_loop(Reactor& r) {
+  epoll_event events[kMaxEvents];
+  for (;;) {
+    const int n = ::epoll_wait(r.epfd, events, kMaxEvents, -1);
+    if (n < 0) {
+      if (errno == EINTR) continue;
+      return;
+    }
+    for (int i = 0; i < n; ++i) {
+      void* tag = events[i].data.ptr;
+      if (tag == &g_stop_tag) return;
+      if (tag == &g_listen_tag) {
+        accept_all(r);
+        continue;
+      }
+      auto* c = static_cast<Conn*>(tag);
+      const std::uint32_t ev = events[i].events;
+      if ((ev & EPOLLOUT) || c->read_closed) {
+        // Replies that cannot be delivered end the session.
+        if (!flush_pending(*c) || (c->read_closed && c->pending.empty())) {
+          close_conn(r, c);
+          continue;
+        }
+        if (c->read_closed) continue;
+        if (c->paused && c->pending.size() <= opts_.max_pending / 2) {
+          c->paused = false;
+          rearm(r, *c, true);
+          continue;  // The re-arm reports any input that waited.
+        }
+      }
+      if (c->paused) {
+        if (ev & (EPOLLHUP | EPOLLERR)) close_conn(r, c);
+        continue;
+      }
+      if (ev & (EPOLLIN | EPOLLRDHUP | EPOLLHUP | EPOLLERR)) on_readable(r, *c);
+    }
+  }
+}
+
+void ManagementServer::accept_all(Reactor& r) {
+  for (;;) {
+    const int fd = ::accept4(listen_fd_, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+    if (fd < 0) return;  // EAGAIN, or another reactor took it.
+    if (opts_.unix_path.empty()) {
+      int one = 1;
+      ::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof one);
+    }
+    auto* c = new Conn;
+    c->fd = fd;
+    epoll_event ev{};
+    ev.events = EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET;
+    ev.data.ptr = c;
+    if (::epoll_ctl(r.epfd, EPOLL_CTL_ADD, fd, &ev) != 0) {
+      ::close(fd);
+      delete c;
+      continue;
+    }
+    r.conns.insert(c);
+    accepted_.fetch_add(1, std::memory_order_relaxed);
+  }
+}
+
+void ManagementServer::close_conn(Reactor& r, Conn* c) {
+  ::epoll_ctl(r.epfd, EPOLL_CTL_DEL, c->fd, nullptr);
+  ::close(c->fd);
+  r.conns.erase(c);
+  delete c;
+  closed_.fetch_add(1, std::memory_order_relaxed);
+}
+
+void ManagementServer::rearm(Reactor& r, Conn& c, bool read) {
+  // EPOLL_CTL_MOD re-polls the socket, so input that is already waiting is
+  // queued as a new edge behind the events other connections have pending.
+  epoll_event ev{};
+  ev.events = (read ? EPOLLIN : 0u) | EPOLLOUT | EPOLLRDHUP | EPOLLET;
+  ev.data.ptr = &c;
+  ::epoll_ctl(r.epfd, EPOLL_CTL_MOD, c.fd, &ev);
+}
+
+Status ManagementServer::execute(std::string_view line, Command& cmd, HalfTelemetry& t) {
+  Status s = parse_command(line, cmd);
+  if (s == Status::kOk) s = validate_command(cmd, modules_.size());
+  if (s != Status::kOk) return s;
+  std::lock_guard lock(module_locks_[cmd.module]);
+  return apply_command(modules_[cmd.module], cmd, &t);
+}
+
+bool ManagementServer::flush_pending(Conn& c) {
+  while (!c.pending.empty()) {
+    const ssize_t n = ::send(c.fd, c.pending.data(), c.pending.size(), MSG_NOSIGNAL);
+    if (n < 0 && errno == EINTR) continue;
+    // EAGAIN: wait for the next EPOLLOUT edge.
+    if (n < 0) return errno == EAGAIN || errno == EWOULDBLOCK;
+    if (n == 0) return true;
+    c.pending.erase(0, static_cast<std::size_t>(n));
+  }
+  return true;
+}
+
+void ManagementServer::on_readable(Reactor& r, Conn& c) {
+  bool eof = false;
+  bool overlong = false;
+  bool more = false;  // Stopped at max_read_burst rather than EAGAIN.
+  // c.in holds no newline on entry; `partial` is where its last line starts.
+  std::size_t partial = 0;
+  for (std::size_t budget = opts_.max_read_burst;;) {
+    if (budget == 0) {
+      more = true;
+      break;
+    }
+    const std::size_t old = c.in.size();
+    const std::size_t want = std::min(kReadChunk, budget);
+    c.in.resize(old + want);
+    const ssize_t n = ::read(c.fd, c.in.data() + old, want);
+    c.in.resize(old + (n > 0 ? static_cast<std::size_t>(n) : 0));
+    if (n > 0) {
+      budget -= static_cast<std::size_t>(n);
+      const std::size_t nl =
+          std::string_view(c.in.data() + old, static_cast<std::size_t>(n)).rfind('\n');
+      if (nl != std::string_view::npos) partial = old + nl + 1;
+      // Stop reading before an unterminated line can grow without bound.
+      if (c.in.size() - partial > opts_.max_line) {
+        overlong = true;
+        break;
+      }
+      continue;
+    }
+    if (n == 0) eof = true;
+    else if (errno == EINTR) continue;
+    else if (errno != EAGAIN && errno != EWOULDBLOCK) eof = true;
+    break;
+  }
+
+  Batch& b = r.batch;
+  b.clear();
+  std::size_t start = 0;
+  for (std::size_t nl; (nl = c.in.find('\n', start)) != std::string::npos; start = nl + 1) {
+    std::string_view line(c.in.data() + start, nl - start);
+    if (!line.empty() && line.back() == '\r') line.remove_suffix(1);
+    if (line.empty()) continue;
+    requests_.fetch_add(1, std::memory_order_relaxed);
+
+    Command cmd;
+    HalfTelemetry t;
+    const Status s = execute(line, cmd, t);
+    if (s != Status::kOk) {
+      b.add_static(kErr, sizeof kErr - 1);
+      b.add_static(status_token(s));
+      b.add_static(kNewline, 1);
+    } else if (cmd.kind == CommandKind::kSnapshot) {
+      char buf[32];
+      const int len = std::snprintf(buf, sizeof buf, "ok %u %u\n", t.channels, t.used_slices);
+      b.add_formatted(buf, static_cast<std::size_t>(len));
+    } else {
+      b.add_static(kOk, sizeof kOk - 1);
+    }
+  }
+  c.in.erase(0, start);
+  overlong = overlong || c.in.size() > opts_.max_line;
+
+  if (!b.iov.empty()) {
+    b.finalize();
+    std::size_t i = 0;
+    // Anything still queued from an earlier burst must go out first.
+    while (c.pending.empty() && i < b.iov.size()) {
+      const std::size_t cnt = std::min<std::size_t>(b.iov.size() - i, IOV_MAX);
+      std::size_t want = 0;
+      for (std::size_t k = i; k < i + cnt; ++k) want += b.iov[k].iov_len;
+      // sendmsg is writev with MSG_NOSIGNAL, so a vanished peer is an error
+      // return rather than SIGPIPE.
+      msghdr msg{};
+      msg.msg_iov = &b.iov[i];
+      msg.msg_iovlen = cnt;
+      writev_calls_.fetch_add(1, std::memory_order_relaxed);
+      const ssize_t n = ::sendmsg(c.fd, &msg, MSG_NOSIGNAL);
+      if (n < 0 && errno == EINTR) continue;
+      // Anything else is left queued for the writable path.
+      if (n < 0) break;
+      auto left = static_cast<std::size_t>(n);
+      while (left > 0 && left >= b.iov[i].iov_len) left -= b.iov[i++].iov_len;
+      if (left > 0) {
+        b.iov[i].iov_base = static_cast<char*>(b.iov[i].iov_base) + left;
+        b.iov[i].iov_len -= left;
+      }
+      if (static_cast<std::size_t>(n) < want) break;  // Socket buffer full.
+    }
+    for (; i < b.iov.size(); ++i) {
+      c.pending.append(static_cast<const char*>(b.iov[i].iov_base), b.iov[i].iov_len);
+    }
+  }
+
+  if (overlong || (eof && c.pending.empty())) {
+    close_conn(r, &c);
+  } else if (eof) {
+    // Replies queued behind a full socket buffer still go out; the writable
+    // path closes the connection once they have.
+    c.read_closed = true;
+  } else if (c.pending.size() > opts_.max_pending) {
+    // The peer is not reading its replies; stop reading its requests until
+    // the writable path has drained them.
+    c.paused = true;
+    read_pauses_.fetch_add(1, std::memory_order_relaxed);
+    rearm(r, c, false);
+  } else if (more) {
+    burst_yields_.fetch_add(1, std::memory_order_relaxed);
+    rearm(r, c, true);
+  }
+}
+
+}  // namespace twin
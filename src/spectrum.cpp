@@ -0,0 +1,92 @@
+#include "twin/spectrum.h"
+
+namespace twin {
+
+namespace {
+
+// Mask with bits [lo, hi) of a single word set; 0 <= lo < hi <= 64.
+std::uint64_t word_mask(int lo, int hi) {
+  const std::uint64_t upper = hi == 64 ? ~0ull : (1ull << hi) - 1;
+  return upper & ~((1ull << lo) - 1);
+}
+
+}  // namespace
+
+void SliceBitmap::apply_range(int first, int count, bool value) {
+  int pos = first;
+  const int end = first + count;
+  while (pos < end) {
+    const int w = pos >> 6;
+    const int lo = pos & 63;
+    const int hi = (end - (w << 6)) < 64 ? end - (w << 6) : 64;
+    const std::uint64_t m = word_mask(lo, hi);
+    if (value) {
+      words_[w] |= m;
+    } else {
+      words_[w] &= ~m;
+    }
+    pos = (w + 1) << 6;
+  }
+}
+
+bool SliceBitmap::any_in(int first, int count) const {
+  int pos = first;
+  const int end = first + count;
+  while (pos < end) {
+    const int w = pos >> 6;
+    const int lo = pos & 63;
+    const int hi = (end - (w << 6)) < 64 ? end - (w << 6) : 64;
+    if (words_[w] & word_mask(lo, hi)) return true;
+    pos = (w + 1) << 6;
+  }
+  return false;
+}
+
+bool SliceBitmap::none() const {
+  std::uint64_t acc = 0;
+  for (auto w : words_) acc |= w;
+  return acc == 0;
+}
+
+int SliceBitmap::count() const {
+  int n = 0;
+  for (auto w : words_) n += std::popcount(w);
+  return n;
+}
+
+int SliceBitmap::next_clear(int from) const {
+  if (from >= kNumSlices) return kNumSlices;
+  int w = from >> 6;
+  std::uint64_t bits = ~words_[w] & ~((1ull << (from & 63)) - 1);
+  while (bits == 0) {
+    if (++w == kWords) return kNumSlices;
+    bits = ~words_[w];
+  }
+  return (w << 6) + std::countr_zero(bits);
+}
+
+int SliceBitmap::next_set(int from) const {
+  if (from >= kNumSlices) return kNumSlices;
+  int w = from >> 6;
+  std::uint64_t bits = words_[w] & ~((1ull << (from & 63)) - 1);
+  while (bits == 0) {
+    if (++w == kWords) return kNumSlices;
+    bits = words_[w];
+  }
+  return (w << 6) + std::countr_zero(bits);
+}
+
+int SliceBitmap::prev_set(int from) const {
+  if (from < 0) return -1;
+  if (from >= kNumSlices) from = kNumSlices - 1;
+  int w = from >> 6;
+  const int bit = from & 63;
+  std::uint64_t bits = words_[w] & (bit == 63 ? ~0ull : (1ull << (bit + 1)) - 1);
+  while (bits == 0) {
+    if (--w < 0) return -1;
+    bits = words_[w];
+  }
+  return (w << 6) + 63 - std::countl_zero(bits);
+}
+
+}  // namespace twin
@@ -0,0 +1,61 @@
+#include "twin/status.h"
+
+namespace twin {
+
+const char* to_string(Status s) {
+  switch (s) {
+    case Status::kOk:
+      return "ok";
+    case Status::kInvalidPort:
+      return "invalid port";
+    case Status::kInvalidRange:
+      return "invalid slice range";
+    case Status::kInvalidAttenuation:
+      return "attenuation out of range";
+    case Status::kSliceConflict:
+      return "slice conflict";
+    case Status::kUnknownChannel:
+      return "unknown channel";
+    case Status::kDuplicateChannel:
+      return "duplicate channel";
+    case Status::kTableFull:
+      return "channel table full";
+    case Status::kParseError:
+      return "parse error";
+    case Status::kInvalidModule:
+      return "invalid module";
+    case Status::kIoError:
+      return "I/O error";
+  }
+  return "unknown status";
+}
+
+const char* status_token(Status s) {
+  switch (s) {
+    case Status::kOk:
+      return "ok";
+    case Status::kInvalidPort:
+      return "invalid-port";
+    case Status::kInvalidRange:
+      return "invalid-slice-range";
+    case Status::kInvalidAttenuation:
+      return "attenuation-out-of-range";
+    case Status::kSliceConflict:
+      return "slice-conflict";
+    case Status::kUnknownChannel:
+      return "unknown-channel";
+    case Status::kDuplicateChannel:
+      return "duplicate-channel";
+    case Status::kTableFull:
+      return "channel-table-full";
+    case Status::kParseError:
+      return "parse-error";
+    case Status::kInvalidModule:
+      return "invalid-module";
+    case Status::kIoError:
+      return "io-error";
+  }
+  return "unknown-status";
+}
+
+}  // namespace twin
@@ -0,0 +1,83 @@
+#include "twin/thread_pool.h"
+
+#include <algorithm>
+
+namespace twin {
+
+ThreadPool::ThreadPool(std::size_t threads) {
+  if (threads == 0) threads = std::max(1u, std::thread::hardware_concurrency());
+  workers_.reserve(threads - 1);
+  for (std::size_t i = 1; i < threads; ++i) workers_.emplace_back([this] { worker_loop(); });
+}
+
+ThreadPool::~ThreadPool() {
+  {
+    std::lock_guard lock(mu_);
+    stop_ = true;
+  }
+  wake_.notify_all();
+  for (auto& t : workers_) t.join();
+}
+
+void ThreadPool::drain(Call call, void* ctx, std::size_t n) {
+  std::size_t done = 0;
+  for (std::size_t i = next_.fetch_add(1, std::memory_order_relaxed); i < n;
+       i = next_.fetch_add(1, std::memory_order_relaxed)) {
+    call(ctx, i);
+    ++done;
+  }
+  if (done != 0 && completed_.fetch_add(done, std::memory_order_acq_rel) + done == n) {
+    std::lock_guard lock(mu_);
+    idle_.notify_all();
+  }
+}
+
+void ThreadPool::run(std::size_t n, Call call, void* ctx) {
+  if (n == 0) return;
+  if (workers_.empty() || n == 1) {
+    for (std::size_t i = 0; i < n; ++i) call(ctx, i);
+    return;
+  }
+
+  std::lock_guard submit(submit_mu_);
+  {
+    std::lock_guard lock(mu_);
+    call_ = call;
+    ctx_ = ctx;
+    n_ = n;
+    next_.store(0, std::memory_order_relaxed);
+    completed_.store(0, std::memory_order_relaxed);
+    ++generation_;
+  }
+  wake_.notify_all();
+
+  drain(call, ctx, n);
+
+  // Workers that joined late must leave before the job's context dies.
+  std::unique_lock lock(mu_);
+  idle_.wait(lock, [&] { return completed_.load(std::memory_order_acquire) == n && active_ == 0; });
+  call_ = nullptr;
+  ctx_ = nullptr;
+}
+
+void ThreadPool::worker_loop() {
+  std::uint64_t seen = 0;
+  std::unique_lock lock(mu_);
+  for (;;) {
+    wake_.wait(lock, [&] { return stop_ || (generation_ != seen && call_ != nullptr); });
+    if (stop_) return;
+    seen = generation_;
+    Call call = call_;
+    void* ctx = ctx_;
+    std::size_t n = n_;
+    ++active_;
+    lock.unlock();
+
+    drain(call, ctx, n);
+
+    lock.lock();
+    if (--active_ == 0) idle_.notify_all();
+  }
+}
+
+}  // namespace twin
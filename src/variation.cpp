@@ -0,0 +1,140 @@
+#include "twin/variation.h"
+
+#include <algorithm>
+#include <cmath>
+#include <numbers>
+
+#include "twin/philox.h"
+
+namespace twin {
+
+namespace {
+
+double draw(PhiloxStream& rng, const Spread& s) {
+  return std::max(0.0, s.mean + s.sigma * rng.normal());
+}
+
+// Marks stuck pixels by jumping geometric gaps between defects, so the cost
+// follows the number of defects rather than the number of pixels.
+void draw_defects(PhiloxStream& rng, double rate, std::array<SliceBitmap, kNumPorts>& out) {
+  if (rate <= 0.0) return;
+  constexpr long kPixels = static_cast<long>(kNumPorts) * kNumSlices;
+  if (rate >= 1.0) {
+    for (SliceBitmap& b : out) b.set_range(0, kNumSlices);
+    return;
+  }
+  const double log_keep = std::log1p(-rate);
+  long pos = -1;
+  for (;;) {
+    // At tiny rates the gap can exceed any integer type; it only matters
+    // whether it runs past the last pixel, so clamp it before converting.
+    const double gap = std::min(std::log1p(-rng.uniform()) / log_keep,
+                                static_cast<double>(kPixels));
+    pos += 1 + static_cast<long>(gap);
+    if (pos >= kPixels) break;
+    out[pos / kNumSlices].set_range(static_cast<int>(pos % kNumSlices), 1);
+  }
+}
+
+}  // namespace
+
+double HalfVariation::loss_db(int port, int slice, double period_slices) const {
+  const int p = port - 1;
+  const double phase = 2.0 * std::numbers::pi * (slice + 0.5) / period_slices + ripple_phase[p];
+  return insertion_loss_db[p] + 0.5 * ripple_db[p] * std::sin(phase);
+}
+
+UnitVariation VariationSweep::sample(std::uint64_t unit) const {
+  PhiloxStream rng(config_.seed, unit);
+  UnitVariation u;
+  for (HalfVariation& h : u.halves) {
+    for (int p = 0; p < kNumPorts; ++p) {
+      h.insertion_loss_db[p] = draw(rng, config_.insertion_loss_db);
+      h.ripple_db[p] = draw(rng, config_.ripple_db);
+      h.ripple_phase[p] = 2.0 * std::numbers::pi * rng.uniform();
+    }
+    draw_defects(rng, config_.pixel_defect_rate, h.defects);
+  }
+  return u;
+}
+
+UnitResult VariationSweep::evaluate(const TwinModule& plan, const UnitVariation& unit,
+                                    std::uint8_t* channel_failed) const {
+  UnitResult r;
+  std::size_t n = 0;
+  for (Half half : {Half::kA, Half::kB}) {
+    const HalfVariation& hv = unit.halves[index_of(half)];
+    for (const Channel& ch : plan.half(half).channels()) {
+      const bool defective = hv.defects[ch.port - 1].any_in(ch.first_slice, ch.num_slices);
+      double lo = hv.loss_db(ch.port, ch.first_slice, config_.ripple_period_slices);
+      double hi = lo;
+      for (int s = ch.first_slice + 1; s < ch.first_slice + ch.num_slices; ++s) {
+        const double l = hv.loss_db(ch.port, s, config_.ripple_period_slices);
+        lo = std::min(lo, l);
+        hi = std::max(hi, l);
+      }
+      const double loss = hi + ch.attenuation.db();
+      const double ripple = hi - lo;
+      r.worst_loss_db = std::max(r.worst_loss_db, loss);
+      r.worst_ripple_db = std::max(r.worst_ripple_db, ripple);
+      const bool failed =
+          defective || loss > config_.max_loss_db || ripple > config_.max_ripple_db;
+      if (defective) ++r.defective_channels;
+      if (failed) ++r.failed_channels;
+      if (channel_failed) channel_failed[n] = failed;
+      ++n;
+    }
+  }
+  r.passed = r.failed_channels == 0;
+  return r;
+}
+
+SweepResult VariationSweep::run(const TwinModule& plan, std::size_t units,
+                                ThreadPool& pool) const {
+  SweepResult out;
+  out.units = units;
+  for (Half half : {Half::kA, Half::kB}) {
+    for (const Channel& ch : plan.half(half).channels()) out.channels.emplace_back(half, ch.id);
+  }
+  const std::size_t nch = out.channels.size();
+  out.per_unit.resize(units);
+  std::vector<std::uint8_t> failed(units * nch);
+
+  // Units are folded in fixed chunks and the partials combined in chunk
+  // order, so the floating-point sums do not depend on scheduling.
+  struct Totals {
+    std::size_t passed = 0;
+    double loss_sum = 0.0;
+    double max_loss = 0.0;
+    double max_ripple = 0.0;
+  };
+  constexpr std::size_t kChunk = 64;
+  const Totals t = pool.parallel_reduce(
+      units, kChunk, Totals{},
+      [&](std::size_t u) {
+        const UnitResult& r = out.per_unit[u] =
+            evaluate(plan, sample(u), failed.data() + u * nch);
+        return Totals{r.passed ? 1u : 0u, r.worst_loss_db, r.worst_loss_db, r.worst_ripple_db};
+      },
+      [](Totals a, const Totals& b) {
+        a.passed += b.passed;
+        a.loss_sum += b.loss_sum;
+        a.max_loss = std::max(a.max_loss, b.max_loss);
+        a.max_ripple = std::max(a.max_ripple, b.max_ripple);
+        return a;
+      });
+  out.passed = t.passed;
+  out.max_worst_loss_db = t.max_loss;
+  out.max_ripple_db = t.max_ripple;
+
+  out.channel_failures.assign(nch, 0);
+  pool.parallel_for(nch, [&](std::size_t c) {
+    std::uint32_t n = 0;
+    for (std::size_t u = 0; u < units; ++u) n += failed[u * nch + c];
+    out.channel_failures[c] = n;
+  });
+  out.mean_worst_loss_db = units ? t.loss_sum / static_cast<double>(units) : 0.0;
+  return out;
+}
+
+}  // namespace twin
@@ -0,0 +1,193 @@
+#include "twin/wss.h"
+
+#include <algorithm>
+
+#include "twin/latency.h"
+
+namespace twin {
+
+Status WssHalf::check_spec(const ChannelSpec& spec) {
+  if (!valid_port(spec.port)) return Status::kInvalidPort;
+  if (!valid_slice_range(spec.first_slice, spec.num_slices)) return Status::kInvalidRange;
+  if (!valid_attenuation(spec.attenuation)) return Status::kInvalidAttenuation;
+  return Status::kOk;
+}
+
+Status WssHalf::add_channel(const ChannelSpec& spec) {
+  ScopedLatency timer(Op::kAdd);
+  if (Status s = check_spec(spec); s != Status::kOk) return s;
+  if (index_.contains(spec.id)) return Status::kDuplicateChannel;
+  if (common_.any_in(spec.first_slice, spec.num_slices)) return Status::kSliceConflict;
+
+  ports_[spec.port - 1].set_range(spec.first_slice, spec.num_slices);
+  common_.set_range(spec.first_slice, spec.num_slices);
+  index_.insert(spec.id, channels_.size());
+  channels_.push_back(spec);
+  index_insert(spec);
+  notify(nullptr, &spec);
+  return Status::kOk;
+}
+
+void WssHalf::index_insert(const Channel& ch) {
+  const IntervalIndex::Entry e{ch.first_slice,
+                               static_cast<std::uint16_t>(ch.first_slice + ch.num_slices), ch.id};
+  port_index_[ch.port - 1].insert(e);
+  common_index_.insert(e);
+}
+
+void WssHalf::index_erase(const Channel& ch) {
+  port_index_[ch.port - 1].erase(ch.first_slice);
+  common_index_.erase(ch.first_slice);
+}
+
+void WssHalf::erase_at(std::size_t pos) {
+  const Channel& ch = channels_[pos];
+  index_erase(ch);
+  ports_[ch.port - 1].clear_range(ch.first_slice, ch.num_slices);
+  common_.clear_range(ch.first_slice, ch.num_slices);
+  index_.erase(ch.id);
+  if (pos + 1 != channels_.size()) {
+    channels_[pos] = channels_.back();
+    index_.insert(channels_[pos].id, pos);
+  }
+  channels_.pop_back();
+}
+
+Status WssHalf::delete_channel(ChannelId id) {
+  ScopedLatency timer(Op::kDelete);
+  const int pos = index_.find(id);
+  if (pos < 0) return Status::kUnknownChannel;
+  const Channel before = channels_[pos];
+  erase_at(static_cast<std::size_t>(pos));
+  notify(&before, nullptr);
+  return Status::kOk;
+}
+
+Status WssHalf::retune_channel(ChannelId id, int first_slice, int num_slices) {
+  ScopedLatency timer(Op::kRetune);
+  const int pos = index_.find(id);
+  if (pos < 0) return Status::kUnknownChannel;
+  if (!valid_slice_range(first_slice, num_slices)) return Status::kInvalidRange;
+
+  Channel& ch = channels_[pos];
+  // The channel's own slices do not conflict with its new position.
+  SliceBitmap others = common_;
+  others.clear_range(ch.first_slice, ch.num_slices);
+  if (others.any_in(first_slice, num_slices)) return Status::kSliceConflict;
+
+  const Channel before = ch;
+  SliceBitmap& port = ports_[ch.port - 1];
+  index_erase(ch);
+  port.clear_range(ch.first_slice, ch.num_slices);
+  common_.clear_range(ch.first_slice, ch.num_slices);
+  ch.first_slice = static_cast<std::uint16_t>(first_slice);
+  ch.num_slices = static_cast<std::uint16_t>(num_slices);
+  port.set_range(first_slice, num_slices);
+  common_.set_range(first_slice, num_slices);
+  index_insert(ch);
+  notify(&before, &ch);
+  return Status::kOk;
+}
+
+Status WssHalf::set_attenuation(ChannelId id, Attenuation attenuation) {
+  ScopedLatency timer(Op::kAttenuate);
+  const int pos = index_.find(id);
+  if (pos < 0) return Status::kUnknownChannel;
+  if (!valid_attenuation(attenuation)) return Status::kInvalidAttenuation;
+  Channel& ch = channels_[pos];
+  const Channel before = ch;
+  ch.attenuation = attenuation;
+  notify(&before, &ch);
+  return Status::kOk;
+}
+
+Status WssHalf::validate_plan(std::span<const ChannelSpec> plan) {
+  if (plan.size() > static_cast<std::size_t>(kNumSlices)) return Status::kTableFull;
+  SliceBitmap used;
+  ChannelIdMap ids;
+  for (const ChannelSpec& spec : plan) {
+    if (Status s = check_spec(spec); s != Status::kOk) return s;
+    if (!ids.insert(spec.id, 0)) return Status::kDuplicateChannel;
+    if (used.any_in(spec.first_slice, spec.num_slices)) return Status::kSliceConflict;
+    used.set_range(spec.first_slice, spec.num_slices);
+  }
+  return Status::kOk;
+}
+
+Status WssHalf::commit_plan(std::span<const ChannelSpec> plan) {
+  ScopedLatency timer(Op::kPlanCommit);
+  if (Status s = validate_plan(plan); s != Status::kOk) return s;
+  reset_tables();
+  for (const ChannelSpec& spec : plan) {
+    ports_[spec.port - 1].set_range(spec.first_slice, spec.num_slices);
+    common_.set_range(spec.first_slice, spec.num_slices);
+    index_.insert(spec.id, channels_.size());
+    channels_.push_back(spec);
+    index_insert(spec);
+  }
+  notify_reset();
+  return Status::kOk;
+}
+
+const Channel* WssHalf::find(ChannelId id) const {
+  const int pos = index_.find(id);
+  return pos < 0 ? nullptr : &channels_[pos];
+}
+
+const Channel* WssHalf::channel_at(int port, Frequency freq) const {
+  const int slice = slice_at_mhz(freq.mhz());
+  if (!valid_port(port) || slice < 0) return nullptr;
+  const IntervalIndex::Entry* e = port_index_[port - 1].stab(slice);
+  return e ? find(e->id) : nullptr;
+}
+
+const Channel* WssHalf::channel_at(Frequency freq) const {
+  const int slice = slice_at_mhz(freq.mhz());
+  if (slice < 0) return nullptr;
+  const IntervalIndex::Entry* e = common_index_.stab(slice);
+  return e ? find(e->id) : nullptr;
+}
+
+std::span<const IntervalIndex::Entry> WssHalf::overlapping(const IntervalIndex& idx,
+                                                           Frequency lower,
+                                                           Frequency upper) const {
+  const std::int64_t lower_mhz = std::max(lower.mhz(), kGridStartMHz);
+  const std::int64_t upper_mhz = std::min(upper.mhz(), slice_lower_mhz(kNumSlices));
+  if (lower_mhz >= upper_mhz) return {};
+  const int first = static_cast<int>((lower_mhz - kGridStartMHz) / kSliceWidthMHz);
+  const int end =
+      static_cast<int>((upper_mhz - kGridStartMHz + kSliceWidthMHz - 1) / kSliceWidthMHz);
+  return idx.overlapping(first, end - first);
+}
+
+std::span<const IntervalIndex::Entry> WssHalf::overlapping(int port, Frequency lower,
+                                                           Frequency upper) const {
+  if (!valid_port(port)) return {};
+  return overlapping(port_index_[port - 1], lower, upper);
+}
+
+std::span<const IntervalIndex::Entry> WssHalf::overlapping(Frequency lower, Frequency upper) const {
+  return overlapping(common_index_, lower, upper);
+}
+
+void WssHalf::reserve(std::size_t channels, std::size_t per_port) {
+  channels_.reserve(channels);
+  common_index_.reserve(channels);
+  for (IntervalIndex& idx : port_index_) idx.reserve(per_port);
+}
+
+void WssHalf::clear() {
+  reset_tables();
+  notify_reset();
+}
+
+void WssHalf::reset_tables() {
+  ports_ = {};
+  common_ = SliceBitmap{};
+  for (auto& idx : port_index_) idx.clear();
+  common_index_.clear();
+  channels_.clear();
+  index_.clear();
+}
+
+}  // namespace twin
@@ -0,0 +1,256 @@
+// Drives AlarmEngine on the virtual clock: conditions raise and clear only
+// after their hold times, flapping inside the window folds into one event
+// carrying the transition count, a condition that flaps back before it is
+// reported leaves no state behind, the token bucket defers events past its
+// burst and releases them with their latest state as tokens return, a full
+// subscriber ring counts drops, and a plan replacement clears only the
+// replaced half's vanished channels.
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+#include "check.h"
+#include "twin/alarm.h"
+
+namespace {
+
+using namespace twin;
+
+constexpr VirtualTime kSecond = 1'000'000;
+
+std::vector<AlarmEvent> drain(AlarmSubscription& sub) {
+  std::vector<AlarmEvent> out;
+  AlarmEvent ev;
+  while (sub.poll(ev)) out.push_back(ev);
+  return out;
+}
+
+void hold_times() {
+  TwinModule m;  // Attached halves must outlive the engine.
+  AlarmEngine engine;
+  AlarmSubscription* sub = engine.subscribe();
+  engine.attach(0, m);
+  WssHalf& wss = m.half(Half::kA);
+  TWIN_CHECK(wss.add_channel({1, 3, 100, 4, {}}) == Status::kOk);
+
+  // Port 3 went into service with its first channel; losing it is LOS.
+  TWIN_CHECK(wss.delete_channel(1) == Status::kOk);
+  engine.advance(2 * kSecond - 1);
+  TWIN_CHECK(!engine.active(AlarmType::kLossOfLight, 0, Half::kA, 3));
+  TWIN_CHECK(drain(*sub).empty());
+  engine.advance(2 * kSecond);
+  TWIN_CHECK(engine.active(AlarmType::kLossOfLight, 0, Half::kA, 3));
+  std::vector<AlarmEvent> ev = drain(*sub);
+  TWIN_CHECK(ev.size() == 1);
+  TWIN_CHECK(ev[0].raised && ev[0].object == 3 && ev[0].time == 2 * kSecond);
+  TWIN_CHECK(ev[0].transitions == 1);
+
+  // Light returns at 3 s; the clear waits out the 5 s clear hold.
+  engine.advance(3 * kSecond);
+  TWIN_CHECK(wss.add_channel({1, 3, 100, 4, {}}) == Status::kOk);
+  engine.advance(8 * kSecond - 1);
+  TWIN_CHECK(engine.active(AlarmType::kLossOfLight, 0, Half::kA, 3));
+  engine.advance(8 * kSecond);
+  TWIN_CHECK(!engine.active(AlarmType::kLossOfLight, 0, Half::kA, 3));
+  ev = drain(*sub);
+  TWIN_CHECK(ev.size() == 1);
+  TWIN_CHECK(!ev[0].raised && ev[0].seq == 2 && ev[0].time == 8 * kSecond);
+
+  // Temperature has hysteresis: 68 C keeps a raised alarm, 64 C clears it.
+  engine.report_temperature(0, 71.0);
+  engine.advance(10 * kSecond);
+  TWIN_CHECK(engine.active(AlarmType::kTemperature, 0, Half::kA, 0));
+  engine.report_temperature(0, 68.0);
+  engine.advance(20 * kSecond);
+  TWIN_CHECK(engine.active(AlarmType::kTemperature, 0, Half::kA, 0));
+  engine.report_temperature(0, 64.0);
+  engine.advance(25 * kSecond);
+  TWIN_CHECK(!engine.active(AlarmType::kTemperature, 0, Half::kA, 0));
+
+  // Command failures raise at once and clear a window after the last one.
+  engine.report_command(0, Half::kB, Status::kSliceConflict);
+  TWIN_CHECK(engine.active(AlarmType::kCommandFailure, 0, Half::kB, 0));
+  engine.advance(30 * kSecond);
+  engine.report_command(0, Half::kB, Status::kSliceConflict);
+  engine.advance(40 * kSecond - 1);
+  TWIN_CHECK(engine.active(AlarmType::kCommandFailure, 0, Half::kB, 0));
+  engine.advance(40 * kSecond);
+  TWIN_CHECK(!engine.active(AlarmType::kCommandFailure, 0, Half::kB, 0));
+  TWIN_CHECK(engine.stats().active == 0 && engine.stats().pending == 0);
+}
+
+void flapping_coalesces() {
+  TwinModule m;
+  AlarmEngine engine;
+  AlarmSubscription* sub = engine.subscribe();
+  engine.attach(0, m);
+  WssHalf& wss = m.half(Half::kA);
+  TWIN_CHECK(wss.add_channel({1, 5, 100, 4, {}}) == Status::kOk);
+
+  // Five changes in a second, ending dark: one raise, 2 s after the last.
+  for (int i = 0; i < 5; ++i) {
+    engine.advance(i * kSecond / 4);
+    if (i % 2 == 0) {
+      wss.delete_channel(1);
+    } else {
+      wss.add_channel({1, 5, 100, 4, {}});
+    }
+  }
+  engine.advance(3 * kSecond - 1);
+  TWIN_CHECK(drain(*sub).empty());
+  engine.advance(3 * kSecond);
+  std::vector<AlarmEvent> ev = drain(*sub);
+  TWIN_CHECK(ev.size() == 1);
+  TWIN_CHECK(ev[0].raised && ev[0].transitions == 5);
+
+  // A blip that ends where it started is not reported, but its two
+  // transitions ride along on the next event.
+  engine.advance(4 * kSecond);
+  wss.add_channel({1, 5, 100, 4, {}});
+  engine.advance(5 * kSecond);
+  wss.delete_channel(1);
+  engine.advance(20 * kSecond);
+  TWIN_CHECK(drain(*sub).empty());
+  TWIN_CHECK(engine.active(AlarmType::kLossOfLight, 0, Half::kA, 5));
+  wss.add_channel({1, 5, 100, 4, {}});
+  engine.advance(30 * kSecond);
+  ev = drain(*sub);
+  TWIN_CHECK(ev.size() == 1);
+  TWIN_CHECK(!ev[0].raised && ev[0].transitions == 3);
+}
+
+void blips_leave_no_state() {
+  TwinModule m;
+  AlarmOptions opts;
+  opts.auto_in_service = false;
+  AlarmEngine engine(opts);
+  AlarmSubscription* sub = engine.subscribe();
+  engine.attach(0, m);
+  WssHalf& wss = m.half(Half::kA);
+  const Attenuation high = Attenuation::from_db(19.0);
+
+  // Churned channel ids that go briefly over the threshold and come back,
+  // or are deleted while high, inside the raise hold.
+  for (ChannelId id = 1; id <= 1000; ++id) {
+    engine.advance(id * kSecond / 1000);
+    TWIN_CHECK(wss.add_channel({id, 1, 100, 4, {}}) == Status::kOk);
+    wss.set_attenuation(id, high);
+    if (id % 2) wss.set_attenuation(id, {});
+    TWIN_CHECK(wss.delete_channel(id) == Status::kOk);
+  }
+  engine.advance(10 * kSecond);
+  TWIN_CHECK(engine.stats().tracked == 0);
+
+  // Port 1 blips dark and back, then stays lit: nothing is reported and
+  // the count starts afresh for the next raise.
+  TWIN_CHECK(wss.add_channel({1, 1, 100, 4, {}}) == Status::kOk);
+  engine.set_in_service(0, Half::kA, 1, true);
+  engine.advance(11 * kSecond);
+  wss.delete_channel(1);
+  wss.add_channel({1, 1, 100, 4, {}});
+  engine.advance(20 * kSecond);
+  TWIN_CHECK(engine.stats().tracked == 0);
+  wss.delete_channel(1);
+  engine.advance(30 * kSecond);
+  const std::vector<AlarmEvent> ev = drain(*sub);
+  TWIN_CHECK(ev.size() == 1);
+  TWIN_CHECK(ev[0].raised && ev[0].object == 1 && ev[0].transitions == 1);
+  TWIN_CHECK(engine.stats().tracked == 1);
+}
+
+void rate_limited() {
+  AlarmOptions opts;
+  opts.events_per_second = 10.0;
+  opts.burst = 3.0;
+  TwinModule m;
+  AlarmEngine engine(opts);
+  AlarmSubscription* sub = engine.subscribe();
+  AlarmSubscription* small = engine.subscribe(2);
+  WssHalf& wss = m.half(Half::kA);
+  for (int p = 1; p <= 8; ++p) {
+    wss.add_channel({static_cast<ChannelId>(p), static_cast<std::uint8_t>(p),
+                     static_cast<std::uint16_t>(20 * p), 4, {}});
+  }
+  engine.attach(0, m);
+  for (int p = 1; p <= 8; ++p) wss.delete_channel(static_cast<ChannelId>(p));
+
+  // Eight raises fall due together; the bucket holds three.
+  engine.advance(2 * kSecond);
+  const std::vector<AlarmEvent> first = drain(*sub);
+  TWIN_CHECK(first.size() == 3);
+  TWIN_CHECK(engine.stats().deferred == 5);
+  TWIN_CHECK(engine.stats().pending == 5);
+
+  // A deferred port gets its light back; its raise is never sent.
+  std::uint32_t back = 1;
+  while (std::any_of(first.begin(), first.end(),
+                     [&](const AlarmEvent& ev) { return ev.object == back; })) {
+    ++back;
+  }
+  engine.advance(2 * kSecond + kSecond / 20);
+  TWIN_CHECK(drain(*sub).empty());
+  wss.add_channel({back, static_cast<std::uint8_t>(back), static_cast<std::uint16_t>(20 * back),
+                   4, {}});
+  TWIN_CHECK(engine.stats().pending == 4);
+  engine.advance(2 * kSecond + kSecond / 10);
+  TWIN_CHECK(drain(*sub).size() == 1);
+  engine.advance(2 * kSecond + kSecond / 2);
+  const std::vector<AlarmEvent> rest = drain(*sub);
+  TWIN_CHECK(rest.size() == 3);
+  bool raises = true;
+  for (const AlarmEvent& ev : rest) raises = raises && ev.raised && ev.object != back;
+  TWIN_CHECK(raises);
+  TWIN_CHECK(!engine.active(AlarmType::kLossOfLight, 0, Half::kA, back));
+  TWIN_CHECK(engine.stats().events == 7 && engine.stats().active == 7);
+  TWIN_CHECK(engine.stats().pending == 0);
+
+  // The two-slot subscriber kept the first two and counted the rest.
+  TWIN_CHECK(drain(*small).size() == 2);
+  TWIN_CHECK(small->dropped() == 5);
+}
+
+void plan_replacement_is_per_half() {
+  TwinModule m[2];
+  AlarmEngine engine;
+  const Attenuation high = Attenuation::from_db(19.0);
+  for (std::uint32_t i = 0; i < 2; ++i) {
+    for (Half h : {Half::kA, Half::kB}) {
+      m[i].half(h).add_channel({9, 1, 100, 4, high});
+      m[i].half(h).add_channel({10, 2, 200, 4, {}});
+    }
+    engine.attach(i, m[i]);
+  }
+  engine.advance(2 * kSecond);
+  for (std::uint32_t i = 0; i < 2; ++i) {
+    TWIN_CHECK(engine.active(AlarmType::kAttenuationHigh, i, Half::kA, 9));
+    TWIN_CHECK(engine.active(AlarmType::kAttenuationHigh, i, Half::kB, 9));
+  }
+
+  // Half A of module 0 is replaced without channel 9; only its alarm goes.
+  const std::vector<ChannelSpec> plan{{10, 2, 200, 4, {}}, {11, 1, 300, 4, high}};
+  TWIN_CHECK(m[0].half(Half::kA).commit_plan(plan) == Status::kOk);
+  engine.advance(7 * kSecond);
+  TWIN_CHECK(!engine.active(AlarmType::kAttenuationHigh, 0, Half::kA, 9));
+  TWIN_CHECK(engine.active(AlarmType::kAttenuationHigh, 0, Half::kA, 11));
+  TWIN_CHECK(engine.active(AlarmType::kAttenuationHigh, 0, Half::kB, 9));
+  TWIN_CHECK(engine.active(AlarmType::kAttenuationHigh, 1, Half::kA, 9));
+  TWIN_CHECK(!engine.active(AlarmType::kLossOfLight, 0, Half::kA, 1));
+
+  // Lowering the attenuation clears it the ordinary way.
+  m[1].half(Half::kB).set_attenuation(9, Attenuation::from_db(3.0));
+  engine.advance(12 * kSecond);
+  TWIN_CHECK(!engine.active(AlarmType::kAttenuationHigh, 1, Half::kB, 9));
+  TWIN_CHECK(engine.stats().active == 3);
+}
+
+}  // namespace
+
+int main() {
+  hold_times();
+  flapping_coalesces();
+  blips_leave_no_state();
+  rate_limited();
+  plan_replacement_is_per_half();
+  return twin::test::test_result();
+}
@@ -0,0 +1,111 @@
+// Brings a small pool up cold and then warm. Units carrying their own
+// calibration must keep it on both starts while the rest share their type's,
+// a cold start must clear plans (on the calling thread, where observers are
+// notified) and a warm start must keep them, and the virtual timelines must
+// charge the flash read or the verify accordingly.
+
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "check.h"
+#include "twin/bringup.h"
+
+namespace {
+
+using namespace twin;
+
+struct ResetLog : WssObserver {
+  void on_channel_change(const WssHalf&, const Channel*, const Channel*) override {}
+  void on_reset(const WssHalf&) override {
+    ++resets;
+    other_thread = other_thread || std::this_thread::get_id() != caller;
+  }
+  std::thread::id caller = std::this_thread::get_id();
+  int resets = 0;
+  bool other_thread = false;
+};
+
+void provision(std::vector<TwinModule>& modules) {
+  for (TwinModule& m : modules) {
+    m.half(Half::kA).add_channel({1, 3, 100, 8, {}});
+    m.half(Half::kB).add_channel({2, 4, 200, 8, {}});
+  }
+}
+
+}  // namespace
+
+int main() {
+  std::vector<TwinModule> modules(6);
+  // Units 0 and 1 were calibrated individually; unit 5 is of another type
+  // but still holds a calibration for the default one.
+  std::shared_ptr<const Calibration> unit_cal[2];
+  for (int i = 0; i < 2; ++i) {
+    Calibration cal = make_calibration(kDefaultModuleType);
+    cal.serial = "unit-" + std::to_string(i);
+    cal.set_loss_db(Half::kA, 1, 10, 9.0 + i);
+    unit_cal[i] = std::make_shared<const Calibration>(std::move(cal));
+    modules[i].set_calibration(unit_cal[i]);
+  }
+  modules[5].set_module_type("NSP00700-03");
+  modules[5].set_calibration(
+      std::make_shared<const Calibration>(make_calibration(kDefaultModuleType)));
+  provision(modules);
+  ResetLog log;
+  for (TwinModule& m : modules) {
+    m.half(Half::kA).add_observer(&log);
+    m.half(Half::kB).add_observer(&log);
+  }
+
+  ThreadPool pool(4);
+  CalibrationCache cache;
+  BringUpOptions opts;
+  const StartupTiming& t = opts.timing;
+
+  const BringUpReport cold = bring_up(modules, cache, pool, opts);
+  TWIN_CHECK(log.resets == 12);
+  TWIN_CHECK(!log.other_thread);
+  for (const TwinModule& m : modules) {
+    TWIN_CHECK(m.half(Half::kA).channels().empty() && m.half(Half::kB).channels().empty());
+  }
+  TWIN_CHECK(modules[0].calibration() == unit_cal[0].get());
+  TWIN_CHECK(modules[1].calibration() == unit_cal[1].get());
+  TWIN_CHECK(modules[0].calibration()->serial == "unit-0");
+  TWIN_CHECK(modules[2].calibration() == modules[3].calibration());
+  TWIN_CHECK(modules[2].calibration() == modules[4].calibration());
+  TWIN_CHECK(modules[5].calibration()->module_type == "NSP00700-03");
+  TWIN_CHECK(cold.calibration_loads == 2);
+  TWIN_CHECK(cold.calibration_hits == 2);
+  // A cold start reads calibration from flash even for a kept unit table.
+  for (const ModuleTimeline& tl : cold.timelines) {
+    TWIN_CHECK(tl.start == 0);
+    TWIN_CHECK(tl.booted == t.cold_boot_us);
+    TWIN_CHECK(tl.calibrated == tl.booted + t.calibration_load_us);
+    TWIN_CHECK(tl.ready == tl.calibrated + t.ready_us);
+  }
+  TWIN_CHECK(cold.makespan_us == t.cold_boot_us + t.calibration_load_us + t.ready_us);
+
+  provision(modules);
+  const Calibration* before[6];
+  for (int i = 0; i < 6; ++i) before[i] = modules[i].calibration();
+  opts.kind = StartKind::kWarm;
+  opts.max_concurrent = 2;
+  const BringUpReport warm = bring_up(modules, cache, pool, opts);
+  TWIN_CHECK(log.resets == 12);
+  for (int i = 0; i < 6; ++i) {
+    TWIN_CHECK(modules[i].calibration() == before[i]);
+    TWIN_CHECK(modules[i].half(Half::kA).channels().size() == 1);
+    TWIN_CHECK(modules[i].half(Half::kB).channels().size() == 1);
+  }
+  TWIN_CHECK(warm.calibration_loads == 0 && warm.calibration_hits == 0);
+  const VirtualTime per_module = t.warm_boot_us + t.calibration_verify_us + t.ready_us;
+  for (std::size_t i = 0; i < warm.timelines.size(); ++i) {
+    const ModuleTimeline& tl = warm.timelines[i];
+    TWIN_CHECK(tl.start == (i / 2) * per_module);
+    TWIN_CHECK(tl.calibrated == tl.booted + t.calibration_verify_us);
+    TWIN_CHECK(tl.state_at(tl.booted) == ModuleState::kLoadingCalibration);
+  }
+  TWIN_CHECK(warm.makespan_us == 3 * per_module);
+  return twin::test::test_result();
+}
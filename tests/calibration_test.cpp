@@ -0,0 +1,197 @@
+// Checks the chunked calibration parser: a formatted calibration, large
+// enough to split into many chunks, parses back to identical tables on any
+// pool size; an error in a later chunk is reported at its line in the whole
+// file; values the tables cannot hold are rejected rather than clamped; and
+// a file that fails anywhere leaves the target exactly as it was.
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "check.h"
+#include "twin/calibration.h"
+
+namespace {
+
+using namespace twin;
+
+bool same_tables(const Calibration& a, const Calibration& b) {
+  return a.module_type == b.module_type && a.serial == b.serial &&
+         a.insertion_loss == b.insertion_loss && a.attenuation_slope == b.attenuation_slope &&
+         a.pixel_edge == b.pixel_edge;
+}
+
+std::size_t count_lines(const std::string& text) {
+  std::size_t n = 0;
+  for (char ch : text) n += ch == '\n';
+  return n;
+}
+
+// Offset of the start of 1-based line `line`.
+std::size_t line_start(const std::string& text, std::size_t line) {
+  std::size_t pos = 0;
+  for (std::size_t i = 1; i < line; ++i) pos = text.find('\n', pos) + 1;
+  return pos;
+}
+
+void round_trip() {
+  Calibration cal = make_calibration("NSP00700-02");
+  cal.serial = "SN0042";
+  std::string text;
+  format_calibration_csv(cal, text);
+  // Per half, 20 slopes, 769 pixel edges and a loss per port and slice.
+  // Type and serial lines are not counted as records.
+  const std::size_t records = kNumHalves * (kNumPorts + kNumSlices + 1 + kNumPorts * kNumSlices);
+  TWIN_CHECK(text.size() > 4 * 64 * 1024);
+
+  for (std::size_t threads : {1, 2, 4, 8}) {
+    ThreadPool pool(threads);
+    Calibration back;
+    const CalibrationParse r = parse_calibration_csv(text, back, pool);
+    TWIN_CHECK(r.status == Status::kOk && r.error_line == 0);
+    TWIN_CHECK(r.lines == count_lines(text));
+    TWIN_CHECK(r.records == records);
+    TWIN_CHECK(same_tables(back, cal));
+
+    // Formatting what was parsed gives the same text.
+    std::string again;
+    format_calibration_csv(back, again);
+    TWIN_CHECK(again == text);
+  }
+
+  // CRLF endings, comments, blank lines and a missing final newline.
+  ThreadPool pool(2);
+  Calibration back;
+  const std::string crlf = "# unit\r\n\r\ntype,X\r\nserial,S1\r\nloss,b,20,767,65.535";
+  const CalibrationParse r = parse_calibration_csv(crlf, back, pool);
+  TWIN_CHECK(r.status == Status::kOk && r.lines == 5 && r.records == 1);
+  TWIN_CHECK(back.module_type == "X" && back.serial == "S1");
+  TWIN_CHECK(back.insertion_loss[1][19][767] == 65535);
+}
+
+void overrides() {
+  // A unit file changes only the cells it names; the later line wins.
+  const Calibration type = make_calibration("NSP00700-02");
+  Calibration unit = type;
+  ThreadPool pool(4);
+  const std::string text =
+      "serial,U7\n"
+      "loss,A,3,100,7.25\n"
+      "slope,B,20,0.98\n"
+      "pixel,A,768,4095.9375\n"
+      "loss,A,3,100,7.5\n";
+  const CalibrationParse r = parse_calibration_csv(text, unit, pool);
+  TWIN_CHECK(r.status == Status::kOk && r.records == 4);
+  TWIN_CHECK(unit.module_type == type.module_type && unit.serial == "U7");
+  TWIN_CHECK(unit.insertion_loss[0][2][100] == 7500);
+  TWIN_CHECK(unit.attenuation_slope[1][19] == 0.98f);
+  TWIN_CHECK(unit.pixel_edge[0][768] == 65535);
+  unit.serial.clear();
+  unit.insertion_loss[0][2][100] = type.insertion_loss[0][2][100];
+  unit.attenuation_slope[1][19] = type.attenuation_slope[1][19];
+  unit.pixel_edge[0][768] = type.pixel_edge[0][768];
+  TWIN_CHECK(same_tables(unit, type));
+}
+
+void errors_in_later_chunks() {
+  const Calibration cal = make_calibration("NSP00700-02");
+  std::string good;
+  format_calibration_csv(cal, good);
+  const std::size_t lines = count_lines(good);
+
+  // A target that differs from the file everywhere, to show nothing lands.
+  Calibration before = make_calibration("other");
+  before.serial = "keep";
+
+  // Lines in the first chunk, around chunk boundaries and at the very end.
+  bool reported = true;
+  bool untouched = true;
+  for (std::size_t line : {std::size_t{1}, std::size_t{3}, lines / 3, lines / 2 + 1, lines - 1,
+                           lines}) {
+    std::string text = good;
+    text.insert(line_start(text, line), "loss,A,1,0,oops\n");
+    // A second, later error must not hide the first.
+    text += "pixel,A,0,-1\n";
+    for (std::size_t threads : {1, 3, 8}) {
+      ThreadPool pool(threads);
+      Calibration target = before;
+      const CalibrationParse r = parse_calibration_csv(text, target, pool);
+      reported = reported && r.status == Status::kParseError && r.error_line == line;
+      untouched = untouched && same_tables(target, before);
+    }
+  }
+  TWIN_CHECK(reported);
+  TWIN_CHECK(untouched);
+
+  // The last line, without a trailing newline.
+  ThreadPool pool(4);
+  Calibration target = before;
+  const CalibrationParse r = parse_calibration_csv(good + "slope,A,1,x", target, pool);
+  TWIN_CHECK(r.status == Status::kParseError && r.error_line == lines + 1);
+  TWIN_CHECK(same_tables(target, before));
+}
+
+void rejects_unrepresentable() {
+  const std::vector<std::string> bad = {
+      // Values the uint16 tables cannot hold, and non-finite slopes.
+      "loss,A,1,0,-0.001",
+      "loss,A,1,0,65.536",
+      "loss,A,1,0,1e300",
+      "loss,A,1,0,nan",
+      "loss,A,1,0,inf",
+      "pixel,A,0,-0.0625",
+      "pixel,A,0,4096",
+      "pixel,B,0,nan",
+      "slope,A,1,nan",
+      "slope,A,1,-inf",
+      // Addresses off the tables.
+      "loss,A,0,0,1.0",
+      "loss,A,21,0,1.0",
+      "loss,A,1,768,1.0",
+      "loss,A,1,-1,1.0",
+      "pixel,A,769,1.0",
+      "slope,C,1,1.0",
+      // Shape.
+      "loss,A,1,0",
+      "loss,A,1,0,1.0,2",
+      "type,",
+      "loss,A,1,0, 1.0",
+      "frobnicate",
+  };
+  ThreadPool pool(2);
+  const Calibration before = make_calibration("NSP00700-02");
+  bool rejected = true;
+  bool untouched = true;
+  for (const std::string& line : bad) {
+    Calibration target = before;
+    const std::string text = "loss,A,1,0,2.0\n" + line + "\n";
+    const CalibrationParse r = parse_calibration_csv(text, target, pool);
+    rejected = rejected && r.status == Status::kParseError && r.error_line == 2;
+    untouched = untouched && same_tables(target, before);
+  }
+  TWIN_CHECK(rejected);
+  TWIN_CHECK(untouched);
+
+  // The largest values that fit are accepted.
+  Calibration target = before;
+  const CalibrationParse r = parse_calibration_csv(
+      "loss,A,1,0,65.5354\npixel,A,0,4095.96\nloss,B,20,767,0\n", target, pool);
+  TWIN_CHECK(r.status == Status::kOk);
+  TWIN_CHECK(target.insertion_loss[0][0][0] == 65535 && target.pixel_edge[0][0] == 65535);
+  TWIN_CHECK(target.insertion_loss[1][19][767] == 0);
+
+  Calibration missing = before;
+  TWIN_CHECK(load_calibration_file("/nonexistent/twin.csv", missing, pool).status ==
+             Status::kIoError);
+  TWIN_CHECK(same_tables(missing, before));
+}
+
+}  // namespace
+
+int main() {
+  round_trip();
+  overrides();
+  errors_in_later_chunks();
+  rejects_unrepresentable();
+  return twin::test::test_result();
+}
@@ -0,0 +1,26 @@
+#pragma once
+
+// Minimal checks for the test programs. A failed check prints its location
+// and keeps going, so one run reports every mismatch; main() returns
+// test_result() and ctest sees a non-zero exit.
+
+#include <cstdio>
+
+namespace twin::test {
+
+inline int failures = 0;
+
+inline int test_result() {
+  if (failures) std::fprintf(stderr, "%d check(s) failed\n", failures);
+  return failures ? 1 : 0;
+}
+
+}  // namespace twin::test
+
+#define TWIN_CHECK(cond)                                                         \
+  do {                                                                           \
+    if (!(cond)) {                                                               \
+      std::fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); \
+      ++::twin::test::failures;                                                  \
+    }                                                                            \
+  } while (0)
@@ -0,0 +1,154 @@
+// Round-trips a module pool through a checkpoint file: channel plans, a
+// per-unit calibration loaded from CSV, a type calibration shared by two
+// units, and a module saved without one. Also checks that a corrupted blob,
+// or one of another format version, is rejected.
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "check.h"
+#include "twin/calibration.h"
+#include "twin/checkpoint.h"
+
+namespace {
+
+using namespace twin;
+
+bool same_tables(const Calibration& a, const Calibration& b) {
+  return a.module_type == b.module_type && a.serial == b.serial &&
+         a.insertion_loss == b.insertion_loss && a.attenuation_slope == b.attenuation_slope &&
+         a.pixel_edge == b.pixel_edge;
+}
+
+bool same_plan(const TwinModule& a, const TwinModule& b) {
+  for (Half h : {Half::kA, Half::kB}) {
+    const auto x = a.half(h).channels();
+    const auto y = b.half(h).channels();
+    if (x.size() != y.size()) return false;
+    for (std::size_t i = 0; i < x.size(); ++i) {
+      if (x[i].id != y[i].id || x[i].port != y[i].port || x[i].first_slice != y[i].first_slice ||
+          x[i].num_slices != y[i].num_slices || x[i].attenuation != y[i].attenuation) {
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+std::vector<TwinModule> make_pool(CalibrationCache& cache, ThreadPool& pool) {
+  std::vector<TwinModule> modules(4);
+  for (std::size_t i = 0; i < modules.size(); ++i) {
+    TwinModule& m = modules[i];
+    m.set_serial("SN-" + std::to_string(100 + i));
+    m.set_module_type("WSS-2x20");
+    for (int c = 0; c < 30; ++c) {
+      const ChannelSpec spec{static_cast<ChannelId>(c + 1), static_cast<std::uint8_t>(1 + c % 20),
+                             static_cast<std::uint16_t>(c * 20 + i), 12,
+                             Attenuation::from_tenths(static_cast<std::int16_t>(c * 3 + i))};
+      m.half(c % 2 ? Half::kB : Half::kA).add_channel(spec);
+    }
+  }
+
+  // Unit 0 carries its own tables: its type's, with a few cells overridden.
+  auto unit = std::make_shared<Calibration>(*cache.get("WSS-2x20"));
+  const std::string csv =
+      "# unit file\n"
+      "serial,SN-100\n"
+      "loss,A,3,17,4.321\n"
+      "loss,B,20,767,12.5\n"
+      "slope,A,1,0.975\n"
+      "pixel,B,768,4000.0625\n";
+  TWIN_CHECK(parse_calibration_csv(csv, *unit, pool).status == Status::kOk);
+  modules[0].set_calibration(unit);
+  // Units 1 and 2 share the type calibration; unit 3 has none.
+  modules[1].set_calibration(cache.get("WSS-2x20"));
+  modules[2].set_calibration(cache.get("WSS-2x20"));
+  return modules;
+}
+
+void round_trip() {
+  ThreadPool pool(2);
+  CalibrationCache cache;
+  const std::vector<TwinModule> modules = make_pool(cache, pool);
+
+  std::vector<std::byte> blob;
+  save_checkpoint(modules, blob);
+  TWIN_CHECK(blob.size() == checkpoint_size(modules));
+  const std::string path = "twin-checkpoint-test.ckpt";
+  TWIN_CHECK(write_checkpoint_file(path.c_str(), blob) == Status::kOk);
+
+  MappedCheckpoint file;
+  TWIN_CHECK(file.open(path.c_str()) == Status::kOk);
+  std::remove(path.c_str());
+  // One record for the unit's tables and one for the shared type tables.
+  TWIN_CHECK(file.view().num_calibrations() == 2);
+  TWIN_CHECK(file.view().calibration_index(1) == file.view().calibration_index(2));
+  TWIN_CHECK(file.view().calibration_index(3) == CheckpointModule::kNoCalibration);
+
+  // A fresh cache, as after a restart: nothing in it knows unit 0's overrides.
+  CalibrationCache fresh;
+  std::vector<TwinModule> loaded;
+  TWIN_CHECK(load_checkpoint(file.bytes(), loaded, fresh) == Status::kOk);
+  TWIN_CHECK(loaded.size() == modules.size());
+  for (std::size_t i = 0; i < loaded.size(); ++i) {
+    TWIN_CHECK(loaded[i].serial() == modules[i].serial());
+    TWIN_CHECK(loaded[i].module_type() == modules[i].module_type());
+    TWIN_CHECK(same_plan(loaded[i], modules[i]));
+  }
+  for (std::size_t i = 0; i < 3; ++i) {
+    TWIN_CHECK(loaded[i].calibration() &&
+               same_tables(*loaded[i].calibration(), *modules[i].calibration()));
+  }
+  const Calibration& unit = *loaded[0].calibration();
+  TWIN_CHECK(unit.serial == "SN-100");
+  TWIN_CHECK(unit.insertion_loss[0][2][17] == 4321);
+  TWIN_CHECK(unit.pixel_edge[1][768] == 64001);
+  TWIN_CHECK(!same_tables(unit, *loaded[1].calibration()));
+  TWIN_CHECK(loaded[1].calibration() == loaded[2].calibration());
+  // Only the module saved without tables went to the cache.
+  TWIN_CHECK(loaded[3].calibration() == fresh.get("WSS-2x20").get());
+  TWIN_CHECK(fresh.loads() == 1);
+
+  // restore_module() gives the same tables one module at a time.
+  TwinModule one;
+  TWIN_CHECK(restore_module(file.view(), 0, one, fresh) == Status::kOk);
+  TWIN_CHECK(one.calibration() && same_tables(*one.calibration(), *modules[0].calibration()));
+  TWIN_CHECK(restore_module(file.view(), 4, one, fresh) == Status::kInvalidModule);
+}
+
+void corruption_is_rejected() {
+  ThreadPool pool(1);
+  CalibrationCache cache;
+  const std::vector<TwinModule> modules = make_pool(cache, pool);
+  std::vector<std::byte> blob;
+  save_checkpoint(modules, blob);
+
+  CheckpointView view;
+  TWIN_CHECK(CheckpointView::open(blob, view) == Status::kOk);
+  // A flipped bit inside the calibration tables fails the checksum.
+  std::vector<std::byte> bad = blob;
+  bad[sizeof(CheckpointHeader) + 4 * sizeof(CheckpointModule) + 1000] ^= std::byte{1};
+  TWIN_CHECK(CheckpointView::open(bad, view) == Status::kParseError);
+  // So does a truncated file.
+  bad.assign(blob.begin(), blob.end() - 8);
+  TWIN_CHECK(CheckpointView::open(bad, view) == Status::kParseError);
+  // A blob from the 24-byte channel layout of version 1 is not read.
+  bad = blob;
+  const std::uint32_t old_version = 1;
+  std::memcpy(bad.data() + offsetof(CheckpointHeader, version), &old_version,
+              sizeof old_version);
+  TWIN_CHECK(CheckpointView::open(bad, view) == Status::kParseError);
+}
+
+}  // namespace
+
+int main() {
+  round_trip();
+  corruption_is_rejected();
+  return twin::test::test_result();
+}
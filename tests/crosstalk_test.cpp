@@ -0,0 +1,219 @@
+// Checks CrosstalkModel three ways: a hand-computed pair of adjacent
+// channels; a randomised run compared with a brute-force reference that
+// spreads every channel of the half over ports and slices in plain doubles;
+// and, in the same run, bit-identity with a model rebuilt from scratch on a
+// copy of the half, which shows removals cancel exactly.
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+#include "check.h"
+#include "twin/crosstalk.h"
+
+namespace {
+
+using namespace twin;
+
+double from_db(double db) { return std::pow(10.0, db / 10.0); }
+
+// Each cell is rounded to 2^-50 mW, so sums of a few cells agree to ~1e-14.
+bool near(double got, double want) { return std::abs(got - want) <= 1e-13; }
+
+void adjacent_pair() {
+  WssHalf wss;
+  const CrosstalkConfig cfg;
+  CrosstalkModel xt(wss, cfg);
+  wss.add_channel({1, 1, 100, 4, {}});
+  wss.add_channel({2, 2, 104, 4, {}});
+
+  // Port 1 picks up channel 2's skirts in its top two slices: slice 103 from
+  // slices 104 and 105, slice 102 from slice 104. Ports 1 and 2 are one apart.
+  // Slice 103 also carries channel 1's own skirts from slices 102 and 101,
+  // which leakage_mw() reports but the port total leaves out.
+  const double p = from_db(cfg.input_dbm_per_slice);
+  const double iso = from_db(-cfg.port_isolation_db[0]);
+  const double sk1 = from_db(-cfg.skirt_isolation_db[0]);
+  const double sk2 = from_db(-cfg.skirt_isolation_db[1]);
+  const double leak = p * iso * (sk1 + 2 * sk2);
+  TWIN_CHECK(near(xt.port_crosstalk_mw(1), leak));
+  TWIN_CHECK(near(xt.port_crosstalk_mw(2), leak));
+  TWIN_CHECK(near(xt.port_signal_mw(1), 4 * p));
+  const double own = p * (sk1 + sk2);
+  TWIN_CHECK(near(xt.leakage_mw(1, 103), own + p * iso * (sk1 + sk2)));
+  TWIN_CHECK(std::abs(xt.channel_crosstalk_db(1) - 10 * std::log10(leak / (4 * p))) < 1e-6);
+  TWIN_CHECK(xt.port_crosstalk_mw(3) == 0.0);
+
+  // Attenuating channel 2 by 10 dB scales what it leaks by the same factor.
+  wss.set_attenuation(2, Attenuation::from_tenths(100));
+  TWIN_CHECK(near(xt.port_crosstalk_mw(1), leak / 10));
+
+  // Removal cancels exactly, leaving only channel 1's own skirts.
+  const double before = xt.leakage_mw(1, 103);
+  wss.add_channel({3, 3, 90, 4, {}});
+  wss.delete_channel(3);
+  TWIN_CHECK(xt.leakage_mw(1, 103) == before);
+  wss.delete_channel(2);
+  TWIN_CHECK(xt.port_crosstalk_mw(1) == 0.0);
+  TWIN_CHECK(near(xt.leakage_mw(1, 103), own));
+  TWIN_CHECK(std::isinf(xt.channel_crosstalk_db(1)));
+}
+
+// Leakage from first principles: every slice of every channel leaks into
+// each port within the isolation band, at each slice within the skirt band,
+// except a slice into itself.
+struct Reference {
+  std::array<std::array<double, kNumSlices>, kNumPorts> leak{};
+  std::array<double, kNumPorts> crosstalk{};  // In-band, other channels only.
+  std::array<double, kNumPorts> signal{};
+  std::vector<Channel> channels;
+  std::vector<double> channel_crosstalk;  // mW landing in each channel.
+  std::vector<double> channel_signal;
+
+  Reference(const WssHalf& wss, const CrosstalkConfig& cfg) {
+    const int pband = static_cast<int>(cfg.port_isolation_db.size());
+    const int sband = static_cast<int>(cfg.skirt_isolation_db.size());
+    channels.assign(wss.channels().begin(), wss.channels().end());
+    channel_crosstalk.assign(channels.size(), 0.0);
+    channel_signal.assign(channels.size(), 0.0);
+    // Which channel owns each slice of each port, to tell own skirts apart.
+    std::array<std::array<int, kNumSlices>, kNumPorts> owner;
+    for (auto& row : owner) row.fill(-1);
+    for (std::size_t i = 0; i < channels.size(); ++i) {
+      const Channel& ch = channels[i];
+      for (int s = ch.first_slice; s < ch.first_slice + ch.num_slices; ++s) {
+        owner[ch.port - 1][s] = static_cast<int>(i);
+      }
+    }
+    for (std::size_t i = 0; i < channels.size(); ++i) {
+      const Channel& ch = channels[i];
+      const double power = from_db(cfg.input_dbm_per_slice - ch.attenuation.db());
+      signal[ch.port - 1] += power * ch.num_slices;
+      channel_signal[i] = power * ch.num_slices;
+      for (int s = ch.first_slice; s < ch.first_slice + ch.num_slices; ++s) {
+        for (int p = 0; p < kNumPorts; ++p) {
+          const int dp = std::abs(p - (ch.port - 1));
+          if (dp > pband) continue;
+          const double port_w = dp == 0 ? 1.0 : from_db(-cfg.port_isolation_db[dp - 1]);
+          for (int t = std::max(0, s - sband); t <= std::min(kNumSlices - 1, s + sband); ++t) {
+            const int ds = std::abs(t - s);
+            if (dp == 0 && ds == 0) continue;
+            const double skirt_w = ds == 0 ? 1.0 : from_db(-cfg.skirt_isolation_db[ds - 1]);
+            const double w = power * port_w * skirt_w;
+            leak[p][t] += w;
+            const int o = owner[p][t];
+            if (o >= 0 && o != static_cast<int>(i)) {
+              crosstalk[p] += w;
+              channel_crosstalk[static_cast<std::size_t>(o)] += w;
+            }
+          }
+        }
+      }
+    }
+  }
+};
+
+void matches_reference(const CrosstalkModel& got, const WssHalf& wss) {
+  const CrosstalkConfig cfg;
+  const Reference want(wss, cfg);
+  for (int port = 1; port <= kNumPorts; ++port) {
+    const int p = port - 1;
+    bool leak_close = true;
+    for (int s = 0; s < kNumSlices; ++s) {
+      leak_close = leak_close && near(got.leakage_mw(port, s), want.leak[p][s]);
+    }
+    TWIN_CHECK(leak_close);
+    TWIN_CHECK(std::abs(got.port_crosstalk_mw(port) - want.crosstalk[p]) <= 1e-11);
+    TWIN_CHECK(std::abs(got.port_signal_mw(port) - want.signal[p]) <= 1e-11);
+  }
+  // Compared in mW: the model's fixed point is absolute, and the weakest
+  // channels see only a few units of it.
+  bool channels_close = true;
+  for (std::size_t i = 0; i < want.channels.size(); ++i) {
+    const double db = got.channel_crosstalk_db(want.channels[i].id);
+    const double mw = std::isinf(db) ? 0.0 : from_db(db) * want.channel_signal[i];
+    channels_close = channels_close && near(mw, want.channel_crosstalk[i]);
+  }
+  TWIN_CHECK(channels_close);
+}
+
+void same_state(const CrosstalkModel& got, const CrosstalkModel& want, const WssHalf& wss) {
+  for (int port = 1; port <= kNumPorts; ++port) {
+    TWIN_CHECK(got.port_crosstalk_mw(port) == want.port_crosstalk_mw(port));
+    TWIN_CHECK(got.port_signal_mw(port) == want.port_signal_mw(port));
+    bool leak_equal = true;
+    for (int s = 0; s < kNumSlices; ++s) {
+      leak_equal = leak_equal && got.leakage_mw(port, s) == want.leakage_mw(port, s);
+    }
+    TWIN_CHECK(leak_equal);
+  }
+  for (const Channel& ch : wss.channels()) {
+    const double a = got.channel_crosstalk_db(ch.id);
+    const double b = want.channel_crosstalk_db(ch.id);
+    TWIN_CHECK(a == b || (std::isinf(a) && std::isinf(b)));
+  }
+}
+
+void incremental_matches_reference() {
+  WssHalf wss;
+  CrosstalkModel xt(wss);
+  std::mt19937 rng(1);
+  int adds = 0;
+  for (int i = 0; i < 100000; ++i) {
+    const ChannelId id = rng() % 200;
+    switch (rng() % 5) {
+      case 0: {
+        const ChannelSpec spec{id, static_cast<std::uint8_t>(1 + rng() % kNumPorts),
+                               static_cast<std::uint16_t>(rng() % 760),
+                               static_cast<std::uint16_t>(1 + rng() % 8),
+                               Attenuation::from_tenths(static_cast<std::int16_t>(rng() % 200))};
+        adds += wss.add_channel(spec) == Status::kOk;
+        break;
+      }
+      case 1:
+        wss.delete_channel(id);
+        break;
+      case 2:
+        wss.retune_channel(id, static_cast<int>(rng() % 760), static_cast<int>(1 + rng() % 8));
+        break;
+      case 3:
+        wss.set_attenuation(id, Attenuation::from_tenths(static_cast<std::int16_t>(rng() % 200)));
+        break;
+      default:
+        if (rng() % 1000 == 0) {
+          // Re-route everything one port up through a plan commit.
+          std::vector<ChannelSpec> plan(wss.channels().begin(), wss.channels().end());
+          for (ChannelSpec& spec : plan) {
+            spec.port = static_cast<std::uint8_t>(spec.port % kNumPorts + 1);
+          }
+          TWIN_CHECK(wss.commit_plan(plan) == Status::kOk);
+        }
+        break;
+    }
+    if (i % 4999 == 0) {
+      matches_reference(xt, wss);
+      WssHalf copy = wss;
+      const CrosstalkModel fresh(copy);
+      same_state(xt, fresh, wss);
+    }
+  }
+  TWIN_CHECK(adds > 1000);
+  matches_reference(xt, wss);
+  WssHalf copy = wss;
+  CrosstalkModel fresh(copy);
+  same_state(xt, fresh, wss);
+  xt.recompute();
+  same_state(xt, fresh, wss);
+}
+
+}  // namespace
+
+int main() {
+  adjacent_pair();
+  incremental_matches_reference();
+  return twin::test::test_result();
+}
@@ -0,0 +1,315 @@
+// Checks Datastore queries against hand-picked bounds that fall between the
+// stored 1 MHz and 0.1 dB steps. Each must select exactly as the unrounded
+// comparison does, through every access path. Then checks the XPath-lite
+// parser and index selection, and runs random queries against a datastore
+// kept in sync with changing modules, comparing each answer with a filter
+// over every channel.
+
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <algorithm>
+#include <limits>
+#include <random>
+#include <string>
+#include <tuple>
+#include <vector>
+
+#include "check.h"
+#include "twin/datastore.h"
+
+namespace {
+
+using namespace twin;
+
+std::size_t count(const Datastore& ds, const std::string& xpath, QueryIndex want) {
+  std::vector<const MediaChannelRow*> out;
+  QueryStats st;
+  const Status s = ds.query(xpath, out, &st);
+  TWIN_CHECK(s == Status::kOk);
+  if (st.index != want) {
+    std::fprintf(stderr, "%s: used %s index\n", xpath.c_str(), to_string(st.index));
+    ++twin::test::failures;
+  }
+  return out.size();
+}
+
+void bounds_between_steps() {
+  // Slice 284 starts at 193.1 THz, so slices 280-287 are centred on it:
+  // 193.075 to 193.125 THz, 50 GHz wide.
+  std::vector<TwinModule> modules(1);
+  modules[0].half(Half::kA).add_channel({9, 3, 280, 8, Attenuation::from_db(3.0)});
+  Datastore ds;
+  ds.load(modules);
+
+  const std::string all = "//media-channel";
+  const std::string port = "/module[id=0]/half[id=A]/port[id=3]/media-channel";
+  constexpr QueryIndex kFreq = QueryIndex::kFrequency;
+  constexpr QueryIndex kPort = QueryIndex::kPortRange;
+  constexpr QueryIndex kScan = QueryIndex::kScan;
+  TWIN_CHECK(count(ds, all + "[frequency<193.1000004]", kFreq) == 1);
+  TWIN_CHECK(count(ds, all + "[frequency>193.0999996]", kFreq) == 1);
+  TWIN_CHECK(count(ds, all + "[frequency<=193.0999996]", kFreq) == 0);
+  TWIN_CHECK(count(ds, all + "[frequency>193.1]", kFreq) == 0);
+  TWIN_CHECK(count(ds, all + "[frequency=193.1]", kFreq) == 1);
+  TWIN_CHECK(count(ds, all + "[frequency=193.1000004]", kFreq) == 0);
+  TWIN_CHECK(count(ds, port + "[frequency<193.1000004]", kPort) == 1);
+  TWIN_CHECK(count(ds, port + "[frequency>=193.1000004]", kPort) == 0);
+  TWIN_CHECK(count(ds, all + "[lower-frequency>=193.0749996]", kFreq) == 1);
+  TWIN_CHECK(count(ds, all + "[lower-frequency>193.075]", kFreq) == 0);
+  TWIN_CHECK(count(ds, all + "[upper-frequency<=193.1250004]", kFreq) == 1);
+  TWIN_CHECK(count(ds, all + "[upper-frequency<193.125]", kFreq) == 0);
+  TWIN_CHECK(count(ds, all + "[width>49.9996]", kScan) == 1);
+  TWIN_CHECK(count(ds, all + "[width<50.0004]", kScan) == 1);
+  TWIN_CHECK(count(ds, all + "[width=50]", kScan) == 1);
+  TWIN_CHECK(count(ds, all + "[width<50]", kScan) == 0);
+  TWIN_CHECK(count(ds, all + "[attenuation<3.04]", kScan) == 1);
+  TWIN_CHECK(count(ds, all + "[attenuation>2.96 and attenuation<3]", kScan) == 0);
+  // NaN and out-of-range bounds leave the index bounds open.
+  TWIN_CHECK(count(ds, all + "[frequency>=nan]", kScan) == 0);
+  TWIN_CHECK(count(ds, all + "[frequency<=1e300]", kScan) == 1);
+  TWIN_CHECK(count(ds, all + "[frequency>=-1e300]", kScan) == 1);
+
+  constexpr std::int64_t kMin = std::numeric_limits<std::int64_t>::min();
+  constexpr std::int64_t kMax = std::numeric_limits<std::int64_t>::max();
+  constexpr double kInf = std::numeric_limits<double>::infinity();
+  TWIN_CHECK(Frequency::from_thz(std::nan("")).mhz() == kMin);
+  TWIN_CHECK(Frequency::from_thz(kInf).mhz() == kMax);
+  TWIN_CHECK(Frequency::from_thz(-kInf).mhz() == kMin);
+  TWIN_CHECK(Frequency::from_thz(1e300).mhz() == kMax);
+  TWIN_CHECK(Frequency::from_thz(193.1).mhz() == 193'100'000);
+  TWIN_CHECK(Frequency::from_thz(193.1000004).mhz() == 193'100'000);
+}
+
+void parsing_and_index_choice() {
+  std::vector<TwinModule> modules(2);
+  modules[1].half(Half::kB).add_channel({17, 5, 100, 4, {}});
+  Datastore ds;
+  ds.load(modules);
+
+  std::vector<const MediaChannelRow*> out;
+  for (const char* bad : {
+           "", "/media-channel", "/module/half/port", "/module/port/media-channel",
+           "//port//half/media-channel", "//media-channel[foo=1]", "//media-channel[id=1 and]",
+           "//media-channel[id=1", "//media-channel[id==1]", "//media-channel[id=x]",
+           "/module[frequency>1]//media-channel", "/module/half[id=C]/port/media-channel",
+           "/module[id=-1]//media-channel", "/module[id=1e12]//media-channel",
+           "/module/half/port[id=256]/media-channel", "//media-channel[id=4294967296]",
+           "//media-channel extra"}) {
+    out.clear();
+    if (ds.query(bad, out) != Status::kParseError) {
+      std::fprintf(stderr, "accepted malformed query: %s\n", bad);
+      ++twin::test::failures;
+    }
+  }
+
+  const std::string m1b = "/module[id=1]/half[id=B]";
+  TWIN_CHECK(count(ds, m1b + "/port/media-channel[id=17]", QueryIndex::kChannelId) == 1);
+  TWIN_CHECK(count(ds, m1b + "//media-channel[id=17]", QueryIndex::kChannelId) == 1);
+  TWIN_CHECK(count(ds, m1b + "/port[id=5]/media-channel", QueryIndex::kPortRange) == 1);
+  TWIN_CHECK(count(ds, m1b + "/port[id=4]/media-channel", QueryIndex::kPortRange) == 0);
+  TWIN_CHECK(count(ds, "/module[id=1]//media-channel[id=17]", QueryIndex::kScan) == 1);
+  TWIN_CHECK(count(ds, "//port[id=5]/media-channel", QueryIndex::kScan) == 1);
+  TWIN_CHECK(count(ds, "//media-channel[id=17.5]", QueryIndex::kScan) == 0);
+  TWIN_CHECK(count(ds, "/module[ id = 1 ]/half[id=b]//media-channel[ id != 3 ]",
+                   QueryIndex::kScan) == 1);
+}
+
+using Key = std::tuple<std::uint32_t, int, ChannelId>;
+
+struct Query {
+  std::string xpath;
+  // Reference filter, written independently of the datastore.
+  int module = -1, half = -1, port = -1;
+  std::int64_t id = -1;
+  struct Leaf {
+    int field;  // 0 centre, 1 lower, 2 upper (THz); 3 width (GHz); 4 attenuation (dB)
+    int op;     // = != < <= > >=
+    double value;
+  };
+  std::vector<Leaf> leaves;
+};
+
+bool compare(double a, int op, double b) {
+  switch (op) {
+    case 0:
+      return a == b;
+    case 1:
+      return a != b;
+    case 2:
+      return a < b;
+    case 3:
+      return a <= b;
+    case 4:
+      return a > b;
+    default:
+      return a >= b;
+  }
+}
+
+bool selects(const Query& q, std::uint32_t module, int half, const Channel& ch) {
+  if (q.module >= 0 && module != static_cast<std::uint32_t>(q.module)) return false;
+  if (q.half >= 0 && half != q.half) return false;
+  if (q.port >= 0 && ch.port != q.port) return false;
+  if (q.id >= 0 && ch.id != q.id) return false;
+  const std::int64_t lower = slice_lower_mhz(ch.first_slice);
+  const std::int64_t upper = slice_lower_mhz(ch.first_slice + ch.num_slices);
+  for (const Query::Leaf& l : q.leaves) {
+    double v = ch.attenuation.tenths() / 10.0;
+    if (l.field == 0) v = static_cast<double>((lower + upper) / 2) / 1e6;
+    if (l.field == 1) v = static_cast<double>(lower) / 1e6;
+    if (l.field == 2) v = static_cast<double>(upper) / 1e6;
+    if (l.field == 3) v = static_cast<double>(upper - lower) / 1e3;
+    if (!compare(v, l.op, l.value)) return false;
+  }
+  return true;
+}
+
+Query random_query(std::mt19937& rng, std::size_t num_modules) {
+  static const char* kOps[] = {"=", "!=", "<", "<=", ">", ">="};
+  static const char* kLeaves[] = {"frequency", "lower-frequency", "upper-frequency", "width",
+                                  "attenuation"};
+  Query q;
+  const bool keyed = rng() % 3 != 0;
+  if (keyed) {
+    q.module = static_cast<int>(rng() % num_modules);
+    q.half = static_cast<int>(rng() % 2);
+    q.xpath = "/module[id=" + std::to_string(q.module) + "]/half[id=" + (q.half ? "B" : "A") +
+              "]";
+    if (rng() % 2) {
+      q.port = static_cast<int>(1 + rng() % kNumPorts);
+      q.xpath += "/port[id=" + std::to_string(q.port) + "]";
+    } else {
+      q.xpath += "/port";
+    }
+    q.xpath += "/media-channel";
+  } else {
+    q.xpath = "//media-channel";
+  }
+  std::vector<std::string> preds;
+  if (rng() % 4 == 0) {
+    q.id = rng() % 64;
+    preds.push_back("id=" + std::to_string(q.id));
+  }
+  const int leaves = static_cast<int>(rng() % 3);
+  for (int i = 0; i < leaves; ++i) {
+    Query::Leaf l{static_cast<int>(rng() % 5), static_cast<int>(rng() % 6), 0.0};
+    // Values on the grid and a little either side of it.
+    const double jitter = (static_cast<double>(rng() % 3) - 1.0) * 4e-7;
+    const int slice = static_cast<int>(rng() % (kNumSlices + 1));
+    switch (l.field) {
+      case 0:
+      case 1:
+      case 2:
+        l.value = static_cast<double>(slice_lower_mhz(slice)) / 1e6 + jitter;
+        break;
+      case 3:
+        l.value = 6.25 * static_cast<double>(1 + rng() % 8) + jitter * 1e3;
+        break;
+      default:
+        l.value = static_cast<double>(rng() % 150) / 10.0 + jitter * 1e5;
+        break;
+    }
+    char buf[64];
+    std::snprintf(buf, sizeof buf, "%s%s%.17g", kLeaves[l.field], kOps[l.op], l.value);
+    preds.push_back(buf);
+    q.leaves.push_back(l);
+  }
+  if (!preds.empty()) {
+    q.xpath += "[";
+    for (std::size_t i = 0; i < preds.size(); ++i) q.xpath += (i ? " and " : "") + preds[i];
+    q.xpath += "]";
+  }
+  return q;
+}
+
+void random_queries_match_scan() {
+  std::vector<TwinModule> modules(4);
+  Datastore ds;
+  std::mt19937 rng(21);
+  auto edit = [&] {
+    const auto m = static_cast<std::uint32_t>(rng() % modules.size());
+    const Half h = rng() % 2 ? Half::kB : Half::kA;
+    WssHalf& wss = modules[m].half(h);
+    const ChannelId id = rng() % 64;
+    switch (rng() % 4) {
+      case 0: {
+        const ChannelSpec spec{id, static_cast<std::uint8_t>(1 + rng() % kNumPorts),
+                               static_cast<std::uint16_t>(rng() % 760),
+                               static_cast<std::uint16_t>(1 + rng() % 8),
+                               Attenuation::from_tenths(static_cast<std::int16_t>(rng() % 150))};
+        if (wss.add_channel(spec) == Status::kOk) ds.upsert(m, h, *wss.find(id));
+        break;
+      }
+      case 1:
+        wss.delete_channel(id);
+        ds.erase(m, h, id);
+        break;
+      case 2:
+        if (wss.retune_channel(id, static_cast<int>(rng() % 760),
+                               static_cast<int>(1 + rng() % 8)) == Status::kOk) {
+          ds.upsert(m, h, *wss.find(id));
+        }
+        break;
+      default:
+        // Several changes at once, mirrored with one resync.
+        for (int i = 0; i < 4; ++i) {
+          wss.set_attenuation(rng() % 64,
+                              Attenuation::from_tenths(static_cast<std::int16_t>(rng() % 150)));
+        }
+        ds.sync_half(m, h, wss);
+        break;
+    }
+  };
+  for (int i = 0; i < 600; ++i) edit();
+  ds.load(modules);
+
+  int indexed = 0;
+  for (int round = 0; round < 4000; ++round) {
+    if (round % 8 == 0) edit();
+    const Query q = random_query(rng, modules.size());
+    std::vector<const MediaChannelRow*> out;
+    QueryStats st;
+    if (ds.query(q.xpath, out, &st) != Status::kOk) {
+      std::fprintf(stderr, "rejected: %s\n", q.xpath.c_str());
+      ++twin::test::failures;
+      continue;
+    }
+    indexed += st.index != QueryIndex::kScan;
+
+    std::vector<Key> want;
+    std::size_t total = 0;
+    for (std::uint32_t m = 0; m < modules.size(); ++m) {
+      for (int h = 0; h < kNumHalves; ++h) {
+        for (const Channel& ch : modules[m].half(static_cast<Half>(h)).channels()) {
+          ++total;
+          if (selects(q, m, h, ch)) want.emplace_back(m, h, ch.id);
+        }
+      }
+    }
+    std::vector<Key> got;
+    for (const MediaChannelRow* r : out) got.emplace_back(r->module, index_of(r->half), r->id);
+    if (st.index == QueryIndex::kFrequency || st.index == QueryIndex::kPortRange) {
+      TWIN_CHECK(std::is_sorted(out.begin(), out.end(), [](auto* a, auto* b) {
+        return a->center() < b->center();
+      }));
+    }
+    std::sort(got.begin(), got.end());
+    std::sort(want.begin(), want.end());
+    if (got != want) {
+      std::fprintf(stderr, "%s: %zu rows, want %zu\n", q.xpath.c_str(), got.size(), want.size());
+      ++twin::test::failures;
+    }
+    TWIN_CHECK(ds.size() == total);
+  }
+  TWIN_CHECK(indexed > 1000);
+}
+
+}  // namespace
+
+int main() {
+  bounds_between_steps();
+  parsing_and_index_choice();
+  random_queries_match_scan();
+  return twin::test::test_result();
+}
@@ -0,0 +1,84 @@
+// Randomised check of FragmentationTracker: 200k adds, deletes, retunes and
+// occasional plan commits, with every scope compared against a full rescan
+// of the occupancy bitmap along the way.
+
+#include <cstdint>
+#include <random>
+#include <vector>
+
+#include "check.h"
+#include "twin/fragmentation.h"
+
+namespace {
+
+using namespace twin;
+
+bool same(const FreeBlockStats& got, const FreeBlockStats& want) {
+  if (got.free_slices() != want.free_slices() || got.free_blocks() != want.free_blocks() ||
+      got.largest_free_block() != want.largest_free_block()) {
+    return false;
+  }
+  for (int len = 1; len <= kNumSlices; ++len) {
+    if (got.blocks_of_size(len) != want.blocks_of_size(len)) return false;
+  }
+  // The b ln b sum is kept in fixed point, so even entropy matches exactly.
+  return got.entropy() == want.entropy();
+}
+
+void check_against_rescan(const WssHalf& wss, const FragmentationTracker& tracker) {
+  FreeBlockStats want;
+  want.assign(wss.common_occupancy());
+  TWIN_CHECK(same(tracker.common(), want));
+  for (int port = 1; port <= kNumPorts; ++port) {
+    want.assign(wss.port_occupancy(port));
+    TWIN_CHECK(same(tracker.port(port), want));
+  }
+}
+
+}  // namespace
+
+int main() {
+  WssHalf wss;
+  FragmentationTracker tracker(wss);
+  std::mt19937 rng(5);
+  for (int i = 0; i < 200000; ++i) {
+    const ChannelId id = rng() % 150;
+    switch (rng() % 4) {
+      case 0:
+        wss.add_channel({id, static_cast<std::uint8_t>(1 + rng() % kNumPorts),
+                         static_cast<std::uint16_t>(rng() % 760),
+                         static_cast<std::uint16_t>(1 + rng() % 8), {}});
+        break;
+      case 1:
+        wss.delete_channel(id);
+        break;
+      case 2:
+        wss.retune_channel(id, static_cast<int>(rng() % 760), static_cast<int>(1 + rng() % 8));
+        break;
+      default:
+        if (rng() % 5000 == 0) {
+          const std::vector<ChannelSpec> plan{{1, 2, 3, 4, {}}};
+          wss.commit_plan(plan);
+        } else {
+          wss.set_attenuation(id, Attenuation::from_tenths(static_cast<std::int16_t>(rng() % 200)));
+        }
+        break;
+    }
+    if (i % 997 == 0) check_against_rescan(wss, tracker);
+  }
+  check_against_rescan(wss, tracker);
+
+  // Edge cases: an empty half is one block; a comb of single slices is fully
+  // fragmented.
+  WssHalf comb;
+  FragmentationTracker comb_tracker(comb);
+  TWIN_CHECK(comb_tracker.common().largest_free_block() == kNumSlices);
+  TWIN_CHECK(comb_tracker.common().fragmentation_index() == 0.0);
+  for (int s = 0; s < kNumSlices; s += 2) {
+    comb.add_channel({static_cast<ChannelId>(s), 1, static_cast<std::uint16_t>(s), 1, {}});
+  }
+  TWIN_CHECK(comb_tracker.common().largest_free_block() == 1);
+  TWIN_CHECK(comb_tracker.common().blocks_of_size(1) == kNumSlices / 2);
+  TWIN_CHECK(comb_tracker.common().fragmentation_index() > 0.999);
+  return twin::test::test_result();
+}
@@ -0,0 +1,210 @@
+// Checks IntervalIndex on a few hand-placed intervals, then WssHalf's
+// frequency lookups against a scan of the channel table while random adds,
+// deletes, retunes, plan commits and clears keep the indexes up to date.
+// Probes sit on slice edges, one MHz either side of them, and off the grid,
+// and range queries treat the upper bound as exclusive.
+
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <random>
+#include <span>
+#include <vector>
+
+#include "check.h"
+#include "twin/wss.h"
+
+namespace {
+
+using namespace twin;
+
+using Entry = IntervalIndex::Entry;
+
+std::vector<std::uint32_t> ids(std::span<const Entry> entries) {
+  std::vector<std::uint32_t> out;
+  for (const Entry& e : entries) out.push_back(e.id);
+  return out;
+}
+
+void hand_placed() {
+  IntervalIndex idx;
+  idx.insert({20, 30, 2});
+  idx.insert({0, 4, 1});
+  idx.insert({30, 31, 3});
+  idx.insert({764, 768, 4});
+  TWIN_CHECK(idx.size() == 4 && idx.entries()[1].id == 2);
+
+  TWIN_CHECK(idx.stab(0)->id == 1 && idx.stab(3)->id == 1);
+  TWIN_CHECK(!idx.stab(4) && !idx.stab(19) && !idx.stab(-1) && !idx.stab(768));
+  TWIN_CHECK(idx.stab(29)->id == 2 && idx.stab(30)->id == 3);
+  TWIN_CHECK(idx.stab(767)->id == 4);
+
+  // [first, first + count) touches an interval only if it shares a slice.
+  TWIN_CHECK(idx.overlapping(4, 16).empty());
+  TWIN_CHECK(ids(idx.overlapping(4, 17)) == (std::vector<std::uint32_t>{2}));
+  TWIN_CHECK(ids(idx.overlapping(3, 28)) == (std::vector<std::uint32_t>{1, 2, 3}));
+  TWIN_CHECK(ids(idx.overlapping(0, kNumSlices)) == (std::vector<std::uint32_t>{1, 2, 3, 4}));
+  TWIN_CHECK(idx.overlapping(31, 733).empty());
+
+  TWIN_CHECK(!idx.erase(21));
+  TWIN_CHECK(idx.erase(20));
+  TWIN_CHECK(!idx.stab(25) && idx.size() == 3);
+  idx.clear();
+  TWIN_CHECK(idx.size() == 0 && !idx.stab(0));
+}
+
+// What the indexes should say, from the channel table alone.
+const Channel* scan_at(const WssHalf& wss, int port, std::int64_t mhz) {
+  for (const Channel& ch : wss.channels()) {
+    if (port != 0 && ch.port != port) continue;
+    if (slice_lower_mhz(ch.first_slice) <= mhz &&
+        mhz < slice_lower_mhz(ch.first_slice + ch.num_slices)) {
+      return &ch;
+    }
+  }
+  return nullptr;
+}
+
+std::vector<std::uint32_t> scan_overlapping(const WssHalf& wss, int port, std::int64_t lower,
+                                            std::int64_t upper) {
+  if (lower >= upper) return {};  // An empty range overlaps nothing.
+  std::vector<const Channel*> hits;
+  for (const Channel& ch : wss.channels()) {
+    if (port != 0 && ch.port != port) continue;
+    if (slice_lower_mhz(ch.first_slice) < upper &&
+        lower < slice_lower_mhz(ch.first_slice + ch.num_slices)) {
+      hits.push_back(&ch);
+    }
+  }
+  std::sort(hits.begin(), hits.end(),
+            [](const Channel* a, const Channel* b) { return a->first_slice < b->first_slice; });
+  std::vector<std::uint32_t> out;
+  for (const Channel* ch : hits) out.push_back(ch->id);
+  return out;
+}
+
+// A slice edge, or one MHz either side of it, anywhere from below the grid
+// to above it.
+std::int64_t probe(std::mt19937& rng) {
+  const int slice = static_cast<int>(rng() % (kNumSlices + 3)) - 1;
+  return slice_lower_mhz(slice) + static_cast<int>(rng() % 3) - 1;
+}
+
+bool lookups_match(const WssHalf& wss, std::mt19937& rng) {
+  bool ok = true;
+  for (int i = 0; i < 200; ++i) {
+    const int port = static_cast<int>(rng() % (kNumPorts + 1));  // 0 is any port.
+    const std::int64_t a = probe(rng);
+    const Frequency f = Frequency::from_mhz(a);
+    const Channel* got = port ? wss.channel_at(port, f) : wss.channel_at(f);
+    ok = ok && got == scan_at(wss, port, a);
+
+    const std::int64_t b = probe(rng);
+    const Frequency lo = Frequency::from_mhz(std::min(a, b));
+    const Frequency hi = Frequency::from_mhz(std::max(a, b));
+    const std::span<const Entry> span = port ? wss.overlapping(port, lo, hi)
+                                             : wss.overlapping(lo, hi);
+    ok = ok && ids(span) == scan_overlapping(wss, port, lo.mhz(), hi.mhz());
+  }
+  return ok;
+}
+
+void off_grid(const WssHalf& wss) {
+  constexpr std::int64_t kMin = std::numeric_limits<std::int64_t>::min();
+  constexpr std::int64_t kMax = std::numeric_limits<std::int64_t>::max();
+  const std::int64_t top = slice_lower_mhz(kNumSlices);
+  for (std::int64_t mhz : {kMin, kGridStartMHz - 1, top, top + 1, kMax}) {
+    TWIN_CHECK(!wss.channel_at(Frequency::from_mhz(mhz)));
+    TWIN_CHECK(!wss.channel_at(1, Frequency::from_mhz(mhz)));
+  }
+  TWIN_CHECK(!wss.channel_at(0, Frequency::from_mhz(kGridStartMHz)));
+  TWIN_CHECK(!wss.channel_at(kNumPorts + 1, Frequency::from_mhz(kGridStartMHz)));
+  TWIN_CHECK(wss.overlapping(0, Frequency::from_mhz(kMin), Frequency::from_mhz(kMax)).empty());
+  // Ranges wholly off the grid, empty or reversed, find nothing.
+  TWIN_CHECK(wss.overlapping(Frequency::from_mhz(kMin), Frequency::from_mhz(kGridStartMHz))
+                 .empty());
+  TWIN_CHECK(wss.overlapping(Frequency::from_mhz(top), Frequency::from_mhz(kMax)).empty());
+  const Frequency mid = Frequency::from_mhz(slice_lower_mhz(384));
+  TWIN_CHECK(wss.overlapping(mid, mid).empty());
+  TWIN_CHECK(wss.overlapping(Frequency::from_mhz(top), mid).empty());
+  // The whole int64 range covers every channel.
+  TWIN_CHECK(wss.overlapping(Frequency::from_mhz(kMin), Frequency::from_mhz(kMax)).size() ==
+             wss.num_channels());
+}
+
+void wss_lookups() {
+  WssHalf wss;
+  // The grid edges themselves.
+  TWIN_CHECK(wss.add_channel({1, 1, 0, 2, {}}) == Status::kOk);
+  TWIN_CHECK(wss.add_channel({2, 2, kNumSlices - 3, 3, {}}) == Status::kOk);
+  TWIN_CHECK(wss.channel_at(Frequency::from_mhz(kGridStartMHz))->id == 1);
+  TWIN_CHECK(wss.channel_at(1, Frequency::from_mhz(slice_lower_mhz(2) - 1))->id == 1);
+  TWIN_CHECK(!wss.channel_at(Frequency::from_mhz(slice_lower_mhz(2))));
+  TWIN_CHECK(!wss.channel_at(2, Frequency::from_mhz(kGridStartMHz)));
+  TWIN_CHECK(wss.channel_at(Frequency::from_mhz(slice_lower_mhz(kNumSlices) - 1))->id == 2);
+  // Upper bounds are exclusive: a range ending on a passband's lower edge
+  // misses it, one MHz more reaches it.
+  const Frequency edge = Frequency::from_mhz(slice_lower_mhz(kNumSlices - 3));
+  TWIN_CHECK(wss.overlapping(Frequency::from_mhz(kGridStartMHz), edge).size() == 1);
+  TWIN_CHECK(
+      wss.overlapping(Frequency::from_mhz(kGridStartMHz), Frequency::from_mhz(edge.mhz() + 1))
+          .size() == 2);
+  off_grid(wss);
+
+  std::mt19937 rng(5);
+  bool ok = true;
+  int adds = 0;
+  for (int i = 0; i < 20000; ++i) {
+    const ChannelId id = rng() % 64;
+    switch (rng() % 8) {
+      case 0:
+      case 1:
+      case 2: {
+        const ChannelSpec spec{id, static_cast<std::uint8_t>(1 + rng() % kNumPorts),
+                               static_cast<std::uint16_t>(rng() % (kNumSlices - 16)),
+                               static_cast<std::uint16_t>(1 + rng() % 16),
+                               {}};
+        adds += wss.add_channel(spec) == Status::kOk;
+        break;
+      }
+      case 3:
+      case 4:
+        wss.delete_channel(id);
+        break;
+      case 5:
+      case 6:
+        wss.retune_channel(id, static_cast<int>(rng() % (kNumSlices - 16)),
+                           static_cast<int>(1 + rng() % 16));
+        break;
+      default:
+        if (rng() % 100 == 0) {
+          wss.clear();
+        } else if (rng() % 50 == 0) {
+          // Swap every channel one port up through a plan commit.
+          std::vector<ChannelSpec> plan(wss.channels().begin(), wss.channels().end());
+          for (ChannelSpec& spec : plan) {
+            spec.port = static_cast<std::uint8_t>(spec.port % kNumPorts + 1);
+          }
+          TWIN_CHECK(wss.commit_plan(plan) == Status::kOk);
+        }
+        break;
+    }
+    if (i % 10 == 0) ok = ok && lookups_match(wss, rng);
+  }
+  TWIN_CHECK(ok);
+  TWIN_CHECK(adds > 2000);
+  off_grid(wss);
+
+  // A copy has its own indexes.
+  WssHalf copy = wss;
+  wss.clear();
+  TWIN_CHECK(lookups_match(wss, rng) && lookups_match(copy, rng));
+}
+
+}  // namespace
+
+int main() {
+  hand_placed();
+  wss_lookups();
+  return twin::test::test_result();
+}
@@ -0,0 +1,231 @@
+// Checks the latency histograms: bucket_of and bucket_lower invert each
+// other and keep every bucket within 1/32 of its value, percentiles of a
+// known distribution land within that error, merging equals recording into
+// one histogram, samples from exited and still-running threads are all
+// collected, ticks convert to nanoseconds against the steady clock, and both
+// reports carry every operation with its count.
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "check.h"
+#include "twin/latency.h"
+
+namespace {
+
+using namespace twin;
+
+using H = LatencyHistogram;
+
+bool within(double got, double want, double rel) {
+  return std::abs(got - want) <= rel * std::max(want, 1.0);
+}
+
+void buckets_round_trip() {
+  bool round_trip = true;
+  bool contiguous = true;
+  bool narrow = true;
+  for (int b = 0; b + 1 < H::kBuckets; ++b) {
+    const std::uint64_t lo = H::bucket_lower(b);
+    const std::uint64_t next = H::bucket_lower(b + 1);
+    round_trip = round_trip && H::bucket_of(lo) == b && H::bucket_of(next - 1) == b;
+    contiguous = contiguous && next > lo;
+    // Exact below 2 * kSub, then no wider than 1/32 of the bucket's floor.
+    narrow = narrow && (b < 2 * H::kSub ? next - lo == 1 : (next - lo) * H::kSub <= lo);
+  }
+  TWIN_CHECK(round_trip);
+  TWIN_CHECK(contiguous);
+  TWIN_CHECK(narrow);
+  TWIN_CHECK(H::bucket_of(0) == 0 && H::bucket_of(H::kSub) == H::kSub);
+  // Everything past the top exponent shares the last bucket.
+  const std::uint64_t top = H::bucket_lower(H::kBuckets - 1);
+  TWIN_CHECK(H::bucket_of(top) == H::kBuckets - 1);
+  TWIN_CHECK(H::bucket_of(std::uint64_t{1} << 60) == H::kBuckets - 1);
+  TWIN_CHECK(H::bucket_of(~std::uint64_t{0}) == H::kBuckets - 1);
+}
+
+void percentiles() {
+  H empty;
+  TWIN_CHECK(empty.count() == 0 && empty.percentile(50) == 0 && empty.min() == 0);
+  TWIN_CHECK(empty.max() == 0 && empty.mean() == 0.0);
+
+  // Log-uniform samples from 1 ns to about 10 ms, compared with the exact
+  // order statistics.
+  std::mt19937_64 rng(9);
+  std::vector<std::uint64_t> samples;
+  H h;
+  double sum = 0.0;
+  for (int i = 0; i < 200000; ++i) {
+    const auto v = static_cast<std::uint64_t>(std::exp(std::ldexp(double(rng() >> 11), -53) * 16));
+    samples.push_back(v);
+    h.record(v);
+    sum += static_cast<double>(v);
+  }
+  std::sort(samples.begin(), samples.end());
+  TWIN_CHECK(h.count() == samples.size());
+  bool close = true;
+  for (double p : {0.1, 1.0, 10.0, 50.0, 90.0, 99.0, 99.9, 99.99, 100.0}) {
+    const auto rank = static_cast<std::size_t>(std::ceil(p / 100.0 * double(samples.size())));
+    const std::uint64_t want = samples[std::max<std::size_t>(rank, 1) - 1];
+    close = close && within(double(h.percentile(p)), double(want), 1.0 / H::kSub);
+  }
+  TWIN_CHECK(close);
+  TWIN_CHECK(h.min() == samples.front());
+  TWIN_CHECK(within(double(h.max()), double(samples.back()), 1.0 / H::kSub));
+  TWIN_CHECK(within(h.mean(), sum / double(samples.size()), 1.0 / H::kSub));
+  TWIN_CHECK(h.percentile(0) == h.percentile(1e-9));
+
+  // Small values are exact.
+  H small;
+  for (std::uint64_t v = 0; v < 2 * H::kSub; ++v) small.record(v);
+  TWIN_CHECK(small.min() == 0 && small.max() == 2 * H::kSub - 1);
+  TWIN_CHECK(small.percentile(50) == H::kSub - 1);
+}
+
+void merge_equals_single() {
+  std::mt19937_64 rng(4);
+  H all;
+  H parts[3];
+  for (int i = 0; i < 30000; ++i) {
+    const std::uint64_t v = rng() >> (rng() % 64);
+    all.record(v);
+    parts[i % 3].record(v);
+  }
+  H merged;
+  for (const H& p : parts) merged.merge(p);
+  TWIN_CHECK(merged.counts() == all.counts());
+  merged.reset();
+  TWIN_CHECK(merged.count() == 0);
+}
+
+// Per-thread shards: threads that have exited and threads still running
+// both show up in collect(), and reset() clears both.
+void shards_merge() {
+  metrics::reset();
+  constexpr int kThreads = 8;
+  constexpr int kPerThread = 10000;
+  std::vector<std::thread> exited;
+  for (int t = 0; t < kThreads; ++t) {
+    exited.emplace_back([] {
+      for (int i = 0; i < kPerThread; ++i) metrics::record(Op::kAdd, 1000);
+    });
+  }
+  for (std::thread& t : exited) t.join();
+
+  std::atomic<int> recorded{0};
+  std::atomic<bool> done{false};
+  std::vector<std::thread> running;
+  for (int t = 0; t < kThreads; ++t) {
+    running.emplace_back([&] {
+      for (int i = 0; i < kPerThread; ++i) metrics::record(Op::kDelete, 1000);
+      recorded.fetch_add(1);
+      while (!done.load()) std::this_thread::yield();
+    });
+  }
+  while (recorded.load() < kThreads) std::this_thread::yield();
+  TWIN_CHECK(metrics::collect(Op::kAdd).count() == std::uint64_t{kThreads} * kPerThread);
+  TWIN_CHECK(metrics::collect(Op::kDelete).count() == std::uint64_t{kThreads} * kPerThread);
+  TWIN_CHECK(metrics::collect(Op::kRetune).count() == 0);
+  metrics::reset();
+  TWIN_CHECK(metrics::collect(Op::kAdd).count() == 0);
+  TWIN_CHECK(metrics::collect(Op::kDelete).count() == 0);
+  done.store(true);
+  for (std::thread& t : running) t.join();
+  TWIN_CHECK(metrics::collect(Op::kDelete).count() == 0);
+
+  // Disabled, ScopedLatency records nothing.
+  metrics::set_enabled(false);
+  { ScopedLatency timer(Op::kAttenuate); }
+  metrics::set_enabled(true);
+  TWIN_CHECK(metrics::collect(Op::kAttenuate).count() == 0);
+  { ScopedLatency timer(Op::kAttenuate); }
+  TWIN_CHECK(metrics::collect(Op::kAttenuate).count() == 1);
+  metrics::reset();
+}
+
+void ticks_to_ns() {
+  metrics::reset();
+  using clock = std::chrono::steady_clock;
+  bool close = true;
+  for (int ms : {5, 20, 50}) {
+    const auto t0 = clock::now();
+    const std::uint64_t c0 = metrics::now_ticks();
+    std::this_thread::sleep_for(std::chrono::milliseconds(ms));
+    const std::uint64_t c1 = metrics::now_ticks();
+    const double ns = std::chrono::duration<double, std::nano>(clock::now() - t0).count();
+    metrics::reset();
+    metrics::record(Op::kRetune, c1 - c0);
+    // Bucket error plus the 10 ms calibration; loose enough for a busy host.
+    close = close && within(double(metrics::collect(Op::kRetune).percentile(50)), ns, 0.15);
+  }
+  TWIN_CHECK(close);
+  metrics::reset();
+}
+
+// The number after "<key>": in `s`, starting from `from`, or -1.
+long long field(const std::string& s, std::size_t from, const std::string& key) {
+  const std::size_t at = s.find("\"" + key + "\":", from);
+  if (at == std::string::npos) return -1;
+  return std::atoll(s.c_str() + at + key.size() + 3);
+}
+
+void reports() {
+  metrics::reset();
+  for (int i = 0; i < 100; ++i) metrics::record(Op::kPlanCommit, 5000);
+  for (int i = 0; i < 7; ++i) metrics::record(Op::kTelemetrySnapshot, 200);
+
+  const std::string json = metrics::report_json();
+  TWIN_CHECK(json.rfind("{\"unit\":\"ns\",\"ops\":{", 0) == 0);
+  TWIN_CHECK(json.size() >= 2 && json.compare(json.size() - 2, 2, "}}") == 0);
+  bool every_op = true;
+  for (int o = 0; o < kNumOps; ++o) {
+    const std::size_t at = json.find(std::string("\"") + to_string(static_cast<Op>(o)) + "\":{");
+    every_op = every_op && at != std::string::npos;
+    if (at == std::string::npos) continue;
+    long long want = 0;
+    if (static_cast<Op>(o) == Op::kPlanCommit) want = 100;
+    if (static_cast<Op>(o) == Op::kTelemetrySnapshot) want = 7;
+    every_op = every_op && field(json, at, "count") == want;
+    for (const char* key : {"min", "p50", "p90", "p99", "p999", "p9999", "max"}) {
+      every_op = every_op && field(json, at, key) >= 0;
+    }
+  }
+  TWIN_CHECK(every_op);
+  // The plan-commit percentiles all sit in the one bucket that was hit.
+  const std::size_t pc = json.find("\"plan_commit\":{");
+  const long long p50 = field(json, pc, "p50");
+  TWIN_CHECK(p50 > 0 && field(json, pc, "p9999") == p50 && field(json, pc, "max") == p50);
+
+  const std::string text = metrics::report_text();
+  TWIN_CHECK(std::count(text.begin(), text.end(), '\n') == kNumOps + 1);
+  TWIN_CHECK(text.rfind("op (ns)", 0) == 0);
+  bool rows = true;
+  for (int o = 0; o < kNumOps; ++o) {
+    rows = rows && text.find(std::string("\n") + to_string(static_cast<Op>(o)) + " ") !=
+                       std::string::npos;
+  }
+  TWIN_CHECK(rows);
+  const std::size_t row = text.find("\nplan_commit ");
+  TWIN_CHECK(row != std::string::npos && std::atoll(text.c_str() + row + 21) == 100);
+  metrics::reset();
+}
+
+}  // namespace
+
+int main() {
+  buckets_round_trip();
+  percentiles();
+  merge_equals_single();
+  shards_merge();
+  ticks_to_ns();
+  reports();
+  return twin::test::test_result();
+}
@@ -0,0 +1,142 @@
+// Randomised check of MediaChannelHierarchy against a flat reference: 200k
+// media channel adds, deletes, retunes and plan commits interleaved with
+// network media channel adds and removes. Every add must succeed exactly
+// when the reference says it fits, and the final trees must agree.
+
+#include <cstdint>
+#include <map>
+#include <random>
+#include <vector>
+
+#include "check.h"
+#include "twin/media_channel.h"
+
+namespace {
+
+using namespace twin;
+
+struct RefNmc {
+  ChannelId mc;
+  std::int64_t lower, upper;  // MHz
+};
+
+using Reference = std::map<NmcId, RefNmc>;
+
+// Retuning shifts the children by the centre delta and evicts the misfits.
+void retune(Reference& ref, const Channel& before, const Channel& after) {
+  const std::int64_t shift = block_center_mhz(after.first_slice, after.num_slices) -
+                             block_center_mhz(before.first_slice, before.num_slices);
+  const std::int64_t lower = slice_lower_mhz(after.first_slice);
+  const std::int64_t upper = slice_lower_mhz(after.first_slice + after.num_slices);
+  for (auto it = ref.begin(); it != ref.end();) {
+    RefNmc& n = it->second;
+    if (n.mc == after.id) {
+      n.lower += shift;
+      n.upper += shift;
+      if (n.lower < lower || n.upper > upper) {
+        it = ref.erase(it);
+        continue;
+      }
+    }
+    ++it;
+  }
+}
+
+void compare(const WssHalf& wss, const MediaChannelHierarchy& h, const Reference& ref) {
+  TWIN_CHECK(h.size() == ref.size());
+  for (const auto& [id, n] : ref) {
+    const NetworkMediaChannel* got = h.find(id);
+    TWIN_CHECK(got && got->media_channel == n.mc && got->lower.mhz() == n.lower &&
+               got->upper.mhz() == n.upper);
+    TWIN_CHECK(h.parent(id) && h.parent(id)->id == n.mc);
+  }
+  for (const Channel& ch : wss.channels()) {
+    std::int64_t prev_upper = 0;
+    std::size_t count = 0;
+    h.for_each_child(ch.id, [&](const NetworkMediaChannel& n) {
+      TWIN_CHECK(n.lower.mhz() >= prev_upper);
+      prev_upper = n.upper.mhz();
+      ++count;
+    });
+    TWIN_CHECK(count == h.num_children(ch.id));
+  }
+  std::size_t total = 0;
+  for (int port = 1; port <= kNumPorts; ++port) {
+    std::size_t count = 0;
+    h.for_each_media_channel(port, [&](const Channel& ch) {
+      TWIN_CHECK(ch.port == port);
+      ++count;
+    });
+    TWIN_CHECK(count == h.num_media_channels(port));
+    total += count;
+  }
+  TWIN_CHECK(total == wss.num_channels());
+}
+
+}  // namespace
+
+int main() {
+  WssHalf wss;
+  MediaChannelHierarchy h(wss);
+  Reference ref;
+  std::mt19937 rng(5);
+  long adds = 0;
+  for (int step = 0; step < 200000; ++step) {
+    const ChannelId id = 1 + rng() % 40;
+    const unsigned op = rng() % 10;
+    if (op == 0) {
+      wss.add_channel({id, static_cast<std::uint8_t>(1 + rng() % kNumPorts),
+                       static_cast<std::uint16_t>(rng() % 700),
+                       static_cast<std::uint16_t>(1 + rng() % 40), {}});
+    } else if (op == 1 && rng() % 4 == 0) {
+      if (wss.delete_channel(id) == Status::kOk) {
+        std::erase_if(ref, [&](const auto& e) { return e.second.mc == id; });
+      }
+    } else if (op == 2) {
+      if (const Channel* ch = wss.find(id)) {
+        const Channel before = *ch;
+        if (wss.retune_channel(id, static_cast<int>(rng() % 700),
+                               static_cast<int>(1 + rng() % 40)) == Status::kOk) {
+          retune(ref, before, *wss.find(id));
+        }
+      }
+    } else if (op == 3) {
+      const NmcId n = rng() % 3000;
+      const bool known = ref.erase(n) != 0;
+      TWIN_CHECK((h.remove(n) == Status::kOk) == known);
+    } else if (op == 9 && rng() % 200 == 0) {
+      // Drop one media channel and move some others between ports.
+      std::vector<ChannelSpec> plan(wss.channels().begin(), wss.channels().end());
+      if (!plan.empty()) plan.erase(plan.begin());
+      for (ChannelSpec& spec : plan) {
+        if (rng() % 3 == 0) spec.port = static_cast<std::uint8_t>(1 + rng() % kNumPorts);
+      }
+      if (wss.commit_plan(plan) == Status::kOk) {
+        std::erase_if(ref, [&](const auto& e) { return wss.find(e.second.mc) == nullptr; });
+      }
+    } else if (const Channel* ch = wss.find(id)) {
+      const std::int64_t lower = slice_lower_mhz(ch->first_slice);
+      const std::int64_t upper = slice_lower_mhz(ch->first_slice + ch->num_slices);
+      const std::int64_t span = upper - lower + 2000;
+      const std::int64_t a = lower - 1000 + static_cast<std::int64_t>(rng() % span);
+      const std::int64_t b = a + 1 + static_cast<std::int64_t>(rng() % 40000);
+      const NmcId n = rng() % 3000;
+      bool fits = a >= lower && b <= upper && ref.count(n) == 0;
+      for (const auto& [k, r] : ref) {
+        if (r.mc == id && r.lower < b && a < r.upper) fits = false;
+      }
+      const Status s = h.add(id, n, Frequency::from_mhz(a), Frequency::from_mhz(b));
+      TWIN_CHECK((s == Status::kOk) == fits);
+      if (s == Status::kOk) {
+        ref[n] = {id, a, b};
+        ++adds;
+      }
+    }
+    if (step % 10007 == 0) compare(wss, h, ref);
+  }
+  compare(wss, h, ref);
+  // Make sure the run exercised the tree rather than rejecting everything.
+  TWIN_CHECK(adds > 1000);
+  TWIN_CHECK(h.evicted() > 0);
+  return twin::test::test_result();
+}
@@ -0,0 +1,266 @@
+// Checks CascadeEvaluator three ways: hand-computed 3 dB widths for a single
+// hop and for two offset hops, the number of hops an isolated change
+// re-evaluates, and a randomised run of retunes, moves, deletes and
+// lightpath churn whose incremental results must match a fresh evaluator
+// bit for bit after every update(). Removed ids are reused, so churn keeps
+// them below the peak number of live lightpaths.
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <random>
+#include <vector>
+
+#include "check.h"
+#include "twin/passband.h"
+
+namespace {
+
+using namespace twin;
+
+constexpr int kNodes = 8;
+constexpr int kParallel = 4;  // Links between neighbours, on ports 1..4.
+
+// A line of nodes with kParallel links from each node to the next.
+// links[i][j] leaves node i on port j + 1.
+struct Line {
+  Network net;
+  std::vector<std::vector<LinkId>> links;
+
+  Line() {
+    for (int i = 0; i < kNodes; ++i) net.add_node("node");
+    links.resize(kNodes - 1);
+    for (int i = 0; i + 1 < kNodes; ++i) {
+      for (int j = 0; j < kParallel; ++j) {
+        links[i].push_back(net.add_link(i, i + 1, Half::kA, j + 1));
+      }
+    }
+  }
+
+  WssHalf& wss(const Path& path, std::size_t hop) {
+    return net.module(net.link(path[hop]).from).half(Half::kA);
+  }
+};
+
+double edge(double x_ghz, double otf_ghz) {
+  const double sigma = otf_ghz / (2.0 * std::sqrt(2.0 * std::log(2.0)));
+  return 0.5 * (1.0 + std::erf(x_ghz / (std::sqrt(2.0) * sigma)));
+}
+
+void hand_computed_widths() {
+  Line line;
+  const PassbandConfig cfg;
+  CascadeEvaluator eval(line.net, cfg);
+  const double slice = kSliceWidthMHz / 1000.0;
+  const double sample = slice / cfg.samples_per_slice;
+
+  // One hop, four slices: each edge sample sits half a sample inside the
+  // block, just above half power, so the 3 dB width is the block itself.
+  const Path one{line.links[0][0]};
+  line.wss(one, 0).add_channel({1, 1, 100, 4, {}});
+  const LightpathId a = eval.add_lightpath(one, 1);
+  eval.update();
+  const PassbandResult& ra = eval.result(a);
+  TWIN_CHECK(ra.connected);
+  TWIN_CHECK(std::abs(ra.nominal_bandwidth_ghz - 4 * slice) < 1e-9);
+  TWIN_CHECK(std::abs(ra.bandwidth_3db_ghz - 4 * slice) < 1e-9);
+  const std::span<const float> ta = eval.transmission(a);
+  TWIN_CHECK(ta.size() == static_cast<std::size_t>(4 * cfg.samples_per_slice));
+  bool shape = true;
+  for (std::size_t i = 0; i < ta.size(); ++i) {
+    const double f = (static_cast<double>(i) + 0.5) * sample;
+    const double want = edge(f, cfg.otf_bandwidth_ghz) - edge(f - 4 * slice, cfg.otf_bandwidth_ghz);
+    shape = shape && std::abs(ta[i] - want) < 1e-6;
+  }
+  TWIN_CHECK(shape);
+
+  // Two hops, the second shifted up one slice: the product passes the three
+  // shared slices. Its 3 dB points are where one edge is near half power,
+  // so the width is three slices to within a sample each side.
+  const Path two{line.links[1][1], line.links[2][1]};
+  line.wss(two, 0).add_channel({2, 2, 200, 4, {}});
+  line.wss(two, 1).add_channel({2, 2, 201, 4, {}});
+  const LightpathId b = eval.add_lightpath(two, 2);
+  eval.update();
+  const PassbandResult& rb = eval.result(b);
+  TWIN_CHECK(rb.connected);
+  TWIN_CHECK(std::abs(rb.nominal_bandwidth_ghz - 4 * slice) < 1e-9);
+  TWIN_CHECK(std::abs(rb.bandwidth_3db_ghz - 3 * slice) <= 2 * sample + 1e-9);
+  double peak = 0.0;
+  for (double f = 0.5 * sample; f < 4 * slice; f += sample) {
+    const double h1 = edge(f, cfg.otf_bandwidth_ghz) - edge(f - 4 * slice, cfg.otf_bandwidth_ghz);
+    const double h2 = edge(f - slice, cfg.otf_bandwidth_ghz) -
+                      edge(f - 5 * slice, cfg.otf_bandwidth_ghz);
+    peak = std::max(peak, h1 * h2);
+  }
+  TWIN_CHECK(std::abs(rb.peak_loss_db + 10.0 * std::log10(peak)) < 1e-5);
+
+  // Moving the second hop to another port blocks the lightpath there.
+  line.wss(two, 1).delete_channel(2);
+  line.wss(two, 1).add_channel({2, 3, 201, 4, {}});
+  eval.update();
+  TWIN_CHECK(!eval.result(b).connected && eval.result(b).blocked_hop == 1);
+}
+
+void only_dirty_suffix_is_evaluated() {
+  Line line;
+  CascadeEvaluator eval(line.net);
+  Path path;
+  for (int i = 0; i + 1 < kNodes; ++i) path.push_back(line.links[i][0]);
+  for (std::size_t h = 0; h < path.size(); ++h) line.wss(path, h).add_channel({5, 1, 300, 6, {}});
+  const LightpathId lp = eval.add_lightpath(path, 5);
+  eval.update();
+  TWIN_CHECK(eval.stats().hops_evaluated == path.size());
+
+  // A retune on hop 4 redoes hops 4 to the end; an attenuation does nothing.
+  const CascadeStats before = eval.stats();
+  line.wss(path, 4).retune_channel(5, 301, 5);
+  line.wss(path, 2).set_attenuation(5, Attenuation::from_db(3.0));
+  TWIN_CHECK(eval.num_dirty() == 1);
+  eval.update();
+  TWIN_CHECK(eval.stats().lightpaths_evaluated == before.lightpaths_evaluated + 1);
+  TWIN_CHECK(eval.stats().hops_evaluated == before.hops_evaluated + path.size() - 4);
+  TWIN_CHECK(eval.result(lp).connected);
+  line.wss(path, 1).set_attenuation(5, Attenuation::from_db(1.0));
+  TWIN_CHECK(eval.num_dirty() == 0);
+}
+
+struct Live {
+  LightpathId lp;
+  Path path;
+  ChannelId id;
+  int region;  // Slices [24 * region, 24 * region + 24) are this path's own.
+};
+
+bool same_results(CascadeEvaluator& eval, Network& net, const std::vector<Live>& live) {
+  eval.update();
+  CascadeEvaluator fresh(net);
+  std::vector<LightpathId> ids;
+  for (const Live& l : live) ids.push_back(fresh.add_lightpath(l.path, l.id));
+  fresh.update();
+  bool same = eval.num_lightpaths() == live.size();
+  for (std::size_t i = 0; i < live.size(); ++i) {
+    const PassbandResult& a = eval.result(live[i].lp);
+    const PassbandResult& b = fresh.result(ids[i]);
+    same = same && a.connected == b.connected && a.blocked_hop == b.blocked_hop &&
+           a.nominal_bandwidth_ghz == b.nominal_bandwidth_ghz &&
+           a.bandwidth_3db_ghz == b.bandwidth_3db_ghz && a.peak_loss_db == b.peak_loss_db;
+    const std::span<const float> ta = eval.transmission(live[i].lp);
+    const std::span<const float> tb = fresh.transmission(ids[i]);
+    same = same && std::equal(ta.begin(), ta.end(), tb.begin(), tb.end());
+  }
+  return same;
+}
+
+void incremental_matches_fresh() {
+  Line line;
+  CascadeEvaluator eval(line.net);
+  std::mt19937 rng(9);
+  std::vector<Live> live;
+  std::vector<char> region_used(32);
+  ChannelId next_id = 1;
+  int connected = 0;
+  int blocked = 0;
+  std::size_t peak = 0;
+  LightpathId max_lp = 0;
+  int removes = 0;
+
+  auto provision = [&] {
+    int region = 0;
+    while (region < 32 && region_used[region]) ++region;
+    if (region == 32) return;
+    const int a = static_cast<int>(rng() % (kNodes - 1));
+    const int b = a + 1 + static_cast<int>(rng() % (kNodes - 1 - a));
+    const int port = static_cast<int>(rng() % kParallel);
+    Live l{0, {}, next_id++, region};
+    for (int i = a; i < b; ++i) l.path.push_back(line.links[i][port]);
+    for (std::size_t h = 0; h < l.path.size(); ++h) {
+      const int first = 24 * region + static_cast<int>(rng() % 8);
+      line.wss(l.path, h).add_channel({l.id, static_cast<std::uint8_t>(port + 1),
+                                       static_cast<std::uint16_t>(first),
+                                       static_cast<std::uint16_t>(2 + rng() % 12), {}});
+    }
+    l.lp = eval.add_lightpath(l.path, l.id);
+    max_lp = std::max(max_lp, l.lp);
+    region_used[region] = 1;
+    live.push_back(std::move(l));
+    peak = std::max(peak, live.size());
+  };
+
+  for (int i = 0; i < 24; ++i) provision();
+  for (int op = 0; op < 20000; ++op) {
+    if (live.empty()) {
+      provision();
+      continue;
+    }
+    Live& l = live[rng() % live.size()];
+    const std::size_t hop = rng() % l.path.size();
+    WssHalf& wss = line.wss(l.path, hop);
+    const int port = line.net.link(l.path[hop]).port;
+    switch (rng() % 8) {
+      case 0:
+      case 1:
+      case 2: {
+        // Retune inside the path's region; the window moves when hop 0 does.
+        const int ns = 1 + static_cast<int>(rng() % 16);
+        wss.retune_channel(l.id, 24 * l.region + static_cast<int>(rng() % (25 - ns)), ns);
+        break;
+      }
+      case 3:
+        wss.set_attenuation(l.id, Attenuation::from_tenths(static_cast<std::int16_t>(rng() % 150)));
+        break;
+      case 4: {
+        // Delete, or re-add on the right port or a wrong one.
+        if (wss.find(l.id)) {
+          wss.delete_channel(l.id);
+        } else {
+          const int p = rng() % 3 == 0 ? 1 + (port % kNumPorts) : port;
+          wss.add_channel({l.id, static_cast<std::uint8_t>(p),
+                           static_cast<std::uint16_t>(24 * l.region + rng() % 8), 4, {}});
+        }
+        break;
+      }
+      case 5: {
+        if (rng() % 4 != 0) break;
+        eval.remove_lightpath(l.lp);
+        // Removing again, or an id never handed out, must not free a slot.
+        if (rng() % 2) eval.remove_lightpath(l.lp);
+        eval.remove_lightpath(1000000);
+        ++removes;
+        for (std::size_t h = 0; h < l.path.size(); ++h) line.wss(l.path, h).delete_channel(l.id);
+        region_used[l.region] = 0;
+        l = std::move(live.back());
+        live.pop_back();
+        provision();
+        break;
+      }
+      case 6:
+        // Re-commit the whole half unchanged: every watcher is reset.
+        if (rng() % 16 == 0) {
+          std::vector<ChannelSpec> plan(wss.channels().begin(), wss.channels().end());
+          TWIN_CHECK(wss.commit_plan(plan) == Status::kOk);
+        }
+        break;
+      default:
+        if (rng() % 2) eval.update();
+        break;
+    }
+    if (op % 500 == 499) {
+      TWIN_CHECK(same_results(eval, line.net, live));
+      for (const Live& x : live) (eval.result(x.lp).connected ? connected : blocked)++;
+    }
+  }
+  TWIN_CHECK(same_results(eval, line.net, live));
+  TWIN_CHECK(connected > 100 && blocked > 100);
+  TWIN_CHECK(removes > 100);
+  TWIN_CHECK(max_lp < peak);
+}
+
+}  // namespace
+
+int main() {
+  hand_computed_widths();
+  only_dirty_suffix_is_evaluated();
+  incremental_matches_fresh();
+  return twin::test::test_result();
+}
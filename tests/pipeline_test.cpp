@@ -0,0 +1,144 @@
+// Drives CommandPipeline with random commands over a small pool, some as
+// text, some pre-parsed, some unparsable or for a module that does not
+// exist, and with queues small enough to back up. For several shard counts,
+// every command must be acknowledged exactly once, acks for each half must
+// arrive in submission order, and each status and the final module state
+// must match applying the same commands one by one.
+
+#include <cstdint>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "check.h"
+#include "twin/pipeline.h"
+
+namespace {
+
+using namespace twin;
+
+constexpr std::uint32_t kModules = 8;
+
+Command random_command(std::mt19937& rng) {
+  Command c;
+  c.kind = static_cast<CommandKind>(rng() % 5);
+  // One module in a hundred is out of range and fails validation.
+  c.module = rng() % 100 == 0 ? kModules : static_cast<std::uint32_t>(rng() % kModules);
+  c.half = rng() % 2 ? Half::kA : Half::kB;
+  // A small id and slice space, so outcomes depend on the order applied.
+  c.channel = rng() % 16;
+  c.port = static_cast<std::uint8_t>(1 + rng() % kNumPorts);
+  c.first_slice = static_cast<std::uint16_t>(rng() % 120);
+  c.num_slices = static_cast<std::uint16_t>(1 + rng() % 12);
+  c.attenuation = Attenuation::from_tenths(static_cast<std::int16_t>(rng() % 200));
+  return c;
+}
+
+bool same_half(const WssHalf& a, const WssHalf& b) {
+  if (a.num_channels() != b.num_channels()) return false;
+  for (const Channel& ch : a.channels()) {
+    const Channel* o = b.find(ch.id);
+    if (!o || o->port != ch.port || o->first_slice != ch.first_slice ||
+        o->num_slices != ch.num_slices || o->attenuation != ch.attenuation) {
+      return false;
+    }
+  }
+  return true;
+}
+
+void run(std::size_t shards) {
+  std::vector<TwinModule> modules(kModules);
+  std::vector<TwinModule> serial(kModules);
+  std::vector<Ack> acks;
+  PipelineOptions opts;
+  opts.shards = shards;
+  opts.queue_capacity = 8;
+  CommandPipeline pipe(modules, [&](const Ack& a) { acks.push_back(a); }, opts);
+  TWIN_CHECK(pipe.num_shards() == shards);
+
+  // What each command should get when applied alone, in submission order.
+  std::vector<Status> want;
+  std::vector<char> sharded;
+  std::mt19937 rng(static_cast<unsigned>(shards));
+  std::string line;
+  const std::string overlong(CommandPipeline::kMaxLine + 1, 'x');
+  for (int i = 0; i < 100000; ++i) {
+    const unsigned form = rng() % 50;
+    std::uint64_t seq;
+    if (form == 0) {
+      seq = pipe.submit("frobnicate 1 A");
+      want.push_back(Status::kParseError);
+      sharded.push_back(0);
+    } else if (form == 1) {
+      seq = pipe.submit(overlong);
+      want.push_back(Status::kParseError);
+      sharded.push_back(0);
+    } else {
+      const Command c = random_command(rng);
+      if (form % 2) {
+        line.clear();
+        format_command(c, line);
+        seq = pipe.submit(line);
+      } else {
+        seq = pipe.submit(c);
+      }
+      Status s = validate_command(c, kModules);
+      if (s == Status::kOk) s = apply_command(serial[c.module], c);
+      want.push_back(s);
+      sharded.push_back(1);
+    }
+    TWIN_CHECK(seq == static_cast<std::uint64_t>(i));
+  }
+  pipe.flush();
+
+  // Exactly once each, with the serial status.
+  const PipelineStats st = pipe.stats();
+  TWIN_CHECK(st.submitted == want.size() && st.acked == want.size());
+  TWIN_CHECK(acks.size() == want.size());
+  std::vector<int> seen(want.size());
+  bool statuses = true;
+  std::uint64_t failed = 0;
+  for (const Ack& a : acks) {
+    if (a.seq >= seen.size()) {
+      statuses = false;
+      continue;
+    }
+    ++seen[a.seq];
+    statuses = statuses && a.status == want[a.seq];
+    failed += a.status != Status::kOk;
+  }
+  bool once = true;
+  for (int n : seen) once = once && n == 1;
+  TWIN_CHECK(once);
+  TWIN_CHECK(statuses);
+  TWIN_CHECK(st.failed == failed);
+
+  // Per half (including the out-of-range module), acks keep submission
+  // order. Parse failures have no half and are acked straight away.
+  std::vector<std::int64_t> last((kModules + 1) * kNumHalves, -1);
+  bool ordered = true;
+  for (const Ack& a : acks) {
+    if (a.seq >= sharded.size() || !sharded[a.seq]) continue;
+    std::int64_t& prev = last[a.module * kNumHalves + index_of(a.half)];
+    ordered = ordered && static_cast<std::int64_t>(a.seq) > prev;
+    prev = static_cast<std::int64_t>(a.seq);
+  }
+  TWIN_CHECK(ordered);
+
+  bool same = true;
+  for (std::size_t m = 0; m < kModules; ++m) {
+    for (Half h : {Half::kA, Half::kB}) {
+      same = same && same_half(modules[m].half(h), serial[m].half(h));
+    }
+  }
+  TWIN_CHECK(same);
+  // Enough of each outcome for the checks above to mean something.
+  TWIN_CHECK(failed > 1000 && want.size() - failed > 1000);
+}
+
+}  // namespace
+
+int main() {
+  for (std::size_t shards : {1, 3, 4}) run(shards);
+  return twin::test::test_result();
+}
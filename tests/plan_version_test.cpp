@@ -0,0 +1,199 @@
+// Checks PlanVersion copy-on-write: forks edited on both sides stay
+// isolated, untouched ports stay shared, a version that owns a node edits it
+// in place while a fresh copy forces a copy, and moved-from versions can be
+// reassigned. A randomised run keeps a tree of forks against plain channel
+// maps, with forks taken and dropped on another thread meanwhile.
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <map>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include "check.h"
+#include "twin/plan_version.h"
+
+namespace {
+
+using namespace twin;
+
+using Model = std::array<std::map<ChannelId, Channel>, kNumHalves>;
+
+bool same_channel(const Channel& a, const Channel& b) {
+  return a.id == b.id && a.port == b.port && a.first_slice == b.first_slice &&
+         a.num_slices == b.num_slices && a.attenuation == b.attenuation;
+}
+
+bool matches(const PlanVersion& v, const Model& model) {
+  for (int h = 0; h < kNumHalves; ++h) {
+    const Half half = static_cast<Half>(h);
+    const std::map<ChannelId, Channel>& want = model[h];
+    if (v.num_channels(half) != want.size()) return false;
+    for (const Channel& ch : v.channels(half)) {
+      auto it = want.find(ch.id);
+      if (it == want.end() || !same_channel(ch, it->second)) return false;
+    }
+    SliceBitmap common;
+    for (const auto& [id, ch] : want) common.set_range(ch.first_slice, ch.num_slices);
+    for (int s = 0; s < kNumSlices; ++s) {
+      if (common.test(s) != v.common_occupancy(half).test(s)) return false;
+    }
+  }
+  return true;
+}
+
+void fork_and_edit_both() {
+  PlanVersion base;
+  for (int p = 1; p <= 8; ++p) {
+    const ChannelSpec spec{static_cast<ChannelId>(p), static_cast<std::uint8_t>(p),
+                           static_cast<std::uint16_t>(20 * p), 4, {}};
+    TWIN_CHECK(base.add_channel(Half::kA, spec) == Status::kOk);
+  }
+  PlanVersion branch = base.fork();
+  for (int p = 1; p <= kNumPorts; ++p) TWIN_CHECK(branch.shares_port(base, Half::kA, p));
+
+  TWIN_CHECK(base.add_channel(Half::kA, {100, 3, 400, 4, {}}) == Status::kOk);
+  TWIN_CHECK(branch.retune_channel(Half::kA, 5, 102, 6) == Status::kOk);
+  TWIN_CHECK(branch.set_attenuation(Half::kA, 7, Attenuation::from_db(4.0)) == Status::kOk);
+  TWIN_CHECK(branch.delete_channel(Half::kA, 2) == Status::kOk);
+
+  // Each side sees only its own edits.
+  TWIN_CHECK(base.find(Half::kA, 100) && !branch.find(Half::kA, 100));
+  TWIN_CHECK(base.find(Half::kA, 5)->first_slice == 100);
+  TWIN_CHECK(branch.find(Half::kA, 5)->first_slice == 102);
+  TWIN_CHECK(base.find(Half::kA, 7)->attenuation == Attenuation{});
+  TWIN_CHECK(base.find(Half::kA, 2) && !branch.find(Half::kA, 2));
+  TWIN_CHECK(base.num_channels(Half::kA) == 9 && branch.num_channels(Half::kA) == 7);
+  TWIN_CHECK(!base.common_occupancy(Half::kA).test(107));
+  TWIN_CHECK(branch.common_occupancy(Half::kA).test(107));
+
+  // Only the edited ports were copied; half B was never touched.
+  for (int p = 1; p <= kNumPorts; ++p) {
+    const bool edited = p == 2 || p == 3 || p == 5 || p == 7;
+    TWIN_CHECK(branch.shares_port(base, Half::kA, p) == !edited);
+    TWIN_CHECK(branch.shares_port(base, Half::kB, p));
+  }
+
+  // The branch now owns its port 5 node, so a second edit is in place.
+  const std::vector<Channel>* port5 = &branch.port_channels(Half::kA, 5);
+  TWIN_CHECK(branch.set_attenuation(Half::kA, 5, Attenuation::from_db(1.0)) == Status::kOk);
+  TWIN_CHECK(&branch.port_channels(Half::kA, 5) == port5);
+
+  // A copy takes that ownership away from both sides.
+  PlanVersion copy = branch;
+  TWIN_CHECK(branch.set_attenuation(Half::kA, 5, Attenuation::from_db(2.0)) == Status::kOk);
+  TWIN_CHECK(&branch.port_channels(Half::kA, 5) != port5);
+  TWIN_CHECK(copy.find(Half::kA, 5)->attenuation == Attenuation::from_db(1.0));
+  TWIN_CHECK(copy.set_attenuation(Half::kA, 5, Attenuation::from_db(3.0)) == Status::kOk);
+  TWIN_CHECK(branch.find(Half::kA, 5)->attenuation == Attenuation::from_db(2.0));
+
+  // Round trip through a module.
+  TwinModule m;
+  TWIN_CHECK(branch.apply_to(m) == Status::kOk);
+  const PlanVersion back = PlanVersion::from_module(m);
+  TWIN_CHECK(back.num_channels(Half::kA) == 7);
+  TWIN_CHECK(back.find(Half::kA, 5)->first_slice == 102);
+
+  // A moved-from version can be assigned again.
+  PlanVersion moved = std::move(copy);
+  TWIN_CHECK(moved.find(Half::kA, 5)->attenuation == Attenuation::from_db(3.0));
+  copy = base;
+  TWIN_CHECK(copy.num_channels(Half::kA) == 9);
+  TWIN_CHECK(copy.add_channel(Half::kA, {200, 9, 600, 4, {}}) == Status::kOk);
+  TWIN_CHECK(!base.find(Half::kA, 200));
+}
+
+// Applies one random edit to `v` and, when it succeeds, to `model`.
+void random_edit(PlanVersion& v, Model& model, std::mt19937& rng) {
+  const int h = static_cast<int>(rng() % kNumHalves);
+  const Half half = static_cast<Half>(h);
+  const ChannelId id = rng() % 64;
+  auto it = model[h].find(id);
+  switch (rng() % 4) {
+    case 0: {
+      const ChannelSpec spec{id, static_cast<std::uint8_t>(1 + rng() % kNumPorts),
+                             static_cast<std::uint16_t>(rng() % 760),
+                             static_cast<std::uint16_t>(1 + rng() % 8), {}};
+      if (v.add_channel(half, spec) == Status::kOk) {
+        TWIN_CHECK(it == model[h].end());
+        model[h][id] = spec;
+      }
+      break;
+    }
+    case 1:
+      TWIN_CHECK((v.delete_channel(half, id) == Status::kOk) == (it != model[h].end()));
+      if (it != model[h].end()) model[h].erase(it);
+      break;
+    case 2: {
+      const int first = static_cast<int>(rng() % 760);
+      const int num = static_cast<int>(1 + rng() % 8);
+      if (v.retune_channel(half, id, first, num) == Status::kOk) {
+        it->second.first_slice = static_cast<std::uint16_t>(first);
+        it->second.num_slices = static_cast<std::uint16_t>(num);
+      }
+      break;
+    }
+    default: {
+      const Attenuation a = Attenuation::from_tenths(static_cast<std::int16_t>(rng() % 150));
+      TWIN_CHECK((v.set_attenuation(half, id, a) == Status::kOk) == (it != model[h].end()));
+      if (it != model[h].end()) it->second.attenuation = a;
+      break;
+    }
+  }
+}
+
+void random_forks() {
+  std::mt19937 rng(4);
+  std::vector<PlanVersion> versions(1);
+  std::vector<Model> models(1);
+  for (int i = 0; i < 200; ++i) random_edit(versions[0], models[0], rng);
+
+  // Another thread keeps forking and dropping a frozen snapshot. Copies of
+  // one source may run concurrently; the snapshot is never edited.
+  const PlanVersion frozen = versions[0].fork();
+  const Model frozen_model = models[0];
+  std::atomic<bool> stop{false};
+  std::thread churn([&] {
+    std::vector<PlanVersion> held;
+    while (!stop.load(std::memory_order_relaxed)) {
+      held.push_back(frozen.fork());
+      if (held.size() > 16) held.erase(held.begin());
+    }
+  });
+
+  for (int op = 0; op < 40000; ++op) {
+    const std::size_t i = rng() % versions.size();
+    const unsigned k = rng() % 20;
+    if (k == 0 && versions.size() < 24) {
+      versions.push_back(versions[i].fork());
+      models.push_back(models[i]);
+    } else if (k == 1 && versions.size() > 1) {
+      versions[i] = std::move(versions.back());
+      models[i] = std::move(models.back());
+      versions.pop_back();
+      models.pop_back();
+    } else {
+      random_edit(versions[i], models[i], rng);
+    }
+    if (op % 1000 == 999) {
+      bool all = true;
+      for (std::size_t v = 0; v < versions.size(); ++v) {
+        all = all && matches(versions[v], models[v]);
+      }
+      TWIN_CHECK(all);
+    }
+  }
+  stop = true;
+  churn.join();
+  TWIN_CHECK(matches(frozen, frozen_model));
+}
+
+}  // namespace
+
+int main() {
+  fork_and_edit_both();
+  random_forks();
+  return twin::test::test_result();
+}
@@ -0,0 +1,295 @@
+// Checks QotEstimator against a hand-computed single-span OSNR and its
+// small-signal GSNR, checks that GSNR falls as a link fills up or as launch
+// power rises past the optimum, and that estimate() of a candidate matches
+// the tracked result once it is provisioned, and that it rejects candidates
+// it cannot place. Then runs 200k lightpath adds,
+// removes and attenuation changes through one estimator, with double
+// removes mixed in, and checks it against an estimator built fresh on the
+// same network at intervals. Slot reuse and hop compaction must leave the
+// results unchanged and the ids bounded.
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <random>
+#include <span>
+#include <vector>
+
+#include "check.h"
+#include "twin/qot.h"
+#include "twin/rsa.h"
+
+namespace {
+
+using namespace twin;
+
+struct Live {
+  QotPathId lp;
+  std::vector<LinkId> path;
+  ChannelId id;
+};
+
+// Both sum the same per-hop terms; only the order of hops in memory differs.
+bool same_results(QotEstimator& q, Network& net, const std::vector<Live>& live) {
+  q.update();
+  QotEstimator fresh(net);
+  std::vector<QotPathId> ids;
+  for (const Live& l : live) ids.push_back(fresh.add_lightpath(l.path, l.id));
+  fresh.update();
+  for (std::size_t i = 0; i < live.size(); ++i) {
+    const QotResult& a = q.result(live[i].lp);
+    const QotResult& b = fresh.result(ids[i]);
+    if (a.valid != b.valid) return false;
+    if (a.valid && (std::abs(a.gsnr_db - b.gsnr_db) > 1e-9 ||
+                    std::abs(a.osnr_db - b.osnr_db) > 1e-9)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+void provision(Network& net, std::span<const LinkId> path, const ChannelSpec& spec) {
+  for (LinkId l : path) {
+    const Link& link = net.link(l);
+    ChannelSpec s = spec;
+    s.port = static_cast<std::uint8_t>(link.port);
+    TWIN_CHECK(net.module(link.from).half(link.half).add_channel(s) == Status::kOk);
+  }
+}
+
+void hand_computed_span() {
+  // One 80 km span: 16 dB of loss made up by a 5.5 dB noise figure
+  // amplifier, 0 dBm per channel. OSNR = P / (NF * G * h * nu * 12.5 GHz)
+  // = 0 + 57.954 - 16 - 5.5 dB.
+  Network net;
+  net.add_node("a");
+  net.add_node("b");
+  net.add_node("c");
+  const std::vector<LinkId> one{net.add_link(0, 1, Half::kA, 3, 80.0)};
+  const std::vector<LinkId> two{one[0], net.add_link(1, 2, Half::kA, 4, 80.0)};
+  QotConfig cfg;
+  cfg.crosstalk = false;
+  QotEstimator q(net, cfg);
+  provision(net, two, {1, 0, 100, 8, {}});
+  const QotPathId a = q.add_lightpath(one, 1);
+  const QotPathId b = q.add_lightpath(two, 1);
+  q.update();
+  TWIN_CHECK(q.result(a).valid && q.result(b).valid);
+  TWIN_CHECK(std::abs(q.result(a).osnr_db - 36.4538) < 1e-3);
+  // Two equal spans double the ASE.
+  TWIN_CHECK(std::abs(q.result(b).osnr_db - (36.4538 - 10.0 * std::log10(2.0))) < 1e-3);
+
+  // At -30 dBm NLI is negligible, so GSNR is the OSNR rescaled from 12.5 GHz
+  // to the symbol rate, 8 * 6.25 GHz / 1.15.
+  cfg.launch_dbm = -30.0;
+  QotEstimator low(net, cfg);
+  const QotPathId c = low.add_lightpath(one, 1);
+  low.update();
+  const double rs = 8 * 6.25e9 / 1.15;
+  TWIN_CHECK(std::abs(low.result(c).osnr_db - (36.4538 - 30.0)) < 1e-3);
+  TWIN_CHECK(std::abs(low.result(c).gsnr_db - (low.result(c).osnr_db -
+                                               10.0 * std::log10(rs / 12.5e9))) < 1e-3);
+
+  // An attenuation on the launching WSS comes straight off the power.
+  net.module(0).half(Half::kA).set_attenuation(1, Attenuation::from_db(3.0));
+  q.update();
+  TWIN_CHECK(std::abs(q.result(a).osnr_db - (36.4538 - 3.0)) < 1e-3);
+}
+
+void gsnr_is_monotonic() {
+  Network net;
+  net.add_node("a");
+  net.add_node("b");
+  const std::vector<LinkId> path{net.add_link(0, 1, Half::kA, 1, 400.0)};
+  WssHalf& wss = net.module(0).half(Half::kA);
+  provision(net, path, {1, 0, 380, 8, {}});
+
+  // Filling the link raises NLI (and crosstalk) on the channel under test.
+  QotEstimator q(net);
+  const QotPathId lp = q.add_lightpath(path, 1);
+  q.update();
+  double last = q.result(lp).gsnr_db;
+  bool falls = true;
+  for (int i = 0; i < 40; ++i) {
+    const int first = i % 2 ? 390 + 8 * (i / 2) : 372 - 8 * (i / 2);
+    wss.add_channel(
+        {static_cast<ChannelId>(100 + i), 1, static_cast<std::uint16_t>(first), 8, {}});
+    q.update();
+    falls = falls && q.result(lp).gsnr_db < last;
+    last = q.result(lp).gsnr_db;
+  }
+  TWIN_CHECK(falls);
+  const double full = last;
+
+  // OSNR rises with launch power throughout; GSNR peaks and then falls
+  // as NLI grows with the cube of the power.
+  double last_osnr = -1e9;
+  double last_gsnr = -1e9;
+  double peak_dbm = -1e9;
+  bool osnr_rises = true;
+  bool gsnr_falls_after_peak = true;
+  for (double dbm = -10.0; dbm <= 10.0; dbm += 0.5) {
+    QotConfig cfg;
+    cfg.launch_dbm = dbm;
+    QotEstimator p(net, cfg);
+    const QotPathId x = p.add_lightpath(path, 1);
+    p.update();
+    const QotResult& r = p.result(x);
+    osnr_rises = osnr_rises && r.osnr_db > last_osnr;
+    if (r.gsnr_db < last_gsnr && peak_dbm < -1e8) peak_dbm = dbm - 0.5;
+    if (peak_dbm > -1e8) gsnr_falls_after_peak = gsnr_falls_after_peak && r.gsnr_db < last_gsnr;
+    last_osnr = r.osnr_db;
+    last_gsnr = r.gsnr_db;
+    if (dbm == 0.0) TWIN_CHECK(std::abs(r.gsnr_db - full) < 1e-9);
+  }
+  TWIN_CHECK(osnr_rises);
+  TWIN_CHECK(peak_dbm > -10.0 && peak_dbm < 10.0);
+  TWIN_CHECK(gsnr_falls_after_peak);
+}
+
+void estimate_matches_provisioned() {
+  Network net;
+  for (int i = 0; i < 4; ++i) net.add_node("node");
+  const std::vector<LinkId> path{net.add_link(0, 1, Half::kA, 2, 160.0),
+                                 net.add_link(1, 2, Half::kA, 5, 240.0),
+                                 net.add_link(2, 3, Half::kB, 7, 90.0)};
+  // Some traffic already on the links.
+  provision(net, path, {50, 0, 200, 16, {}});
+  provision(net, std::span(path).first(2), {51, 0, 260, 8, {}});
+
+  QotConfig cfg;
+  cfg.crosstalk = false;  // estimate() uses the port ratio for crosstalk.
+  QotEstimator q(net, cfg);
+  const QotCandidate cands[] = {{path, 300, 6, Attenuation::from_db(1.5)},
+                                {std::span(path).first(1), 300, 6, {}},
+                                {{}, 300, 6, {}}};
+  QotResult batch[3];
+  q.estimate(cands, batch);
+  const QotResult single = q.estimate(cands[0]);
+  TWIN_CHECK(batch[0].valid && batch[1].valid && !batch[2].valid);
+  TWIN_CHECK(single.gsnr_db == batch[0].gsnr_db && single.osnr_db == batch[0].osnr_db);
+  TWIN_CHECK(batch[1].gsnr_db > batch[0].gsnr_db);
+  // Nothing was provisioned.
+  TWIN_CHECK(net.module(0).half(Half::kA).num_channels() == 2);
+
+  provision(net, path, {1, 0, 300, 6, Attenuation::from_db(1.5)});
+  const QotPathId lp = q.add_lightpath(path, 1);
+  q.update();
+  TWIN_CHECK(std::abs(q.result(lp).gsnr_db - batch[0].gsnr_db) < 1e-9);
+  TWIN_CHECK(std::abs(q.result(lp).osnr_db - batch[0].osnr_db) < 1e-9);
+}
+
+void estimate_rejects_bad_candidates() {
+  Network net;
+  net.add_node("a");
+  net.add_node("b");
+  const std::vector<LinkId> path{net.add_link(0, 1, Half::kA, 1, 80.0)};
+  const std::vector<LinkId> unknown{path[0], 7};
+  QotEstimator q(net);
+  // Each bad candidate sits between two good ones, which must be unaffected.
+  const QotCandidate good{path, 100, 4, {}};
+  const QotCandidate bad[] = {{{}, 100, 4, {}},
+                              {unknown, 100, 4, {}},
+                              {path, 100, 0, {}},
+                              {path, -1, 4, {}},
+                              {path, kNumSlices - 2, 4, {}},
+                              {path, 65536, 4, {}},
+                              {path, 100, 4, Attenuation::from_tenths(-1)},
+                              {path, 100, 4, Attenuation::from_tenths(201)}};
+  const QotResult want = q.estimate(good);
+  TWIN_CHECK(want.valid);
+  bool rejected = true;
+  bool others_same = true;
+  for (const QotCandidate& b : bad) {
+    const QotCandidate batch[] = {good, b, good};
+    QotResult out[3];
+    q.estimate(batch, out);
+    rejected = rejected && !out[1].valid && !q.estimate(b).valid;
+    for (int k : {0, 2}) {
+      others_same = others_same && out[k].valid && out[k].gsnr_db == want.gsnr_db &&
+                    out[k].osnr_db == want.osnr_db;
+    }
+  }
+  TWIN_CHECK(rejected);
+  TWIN_CHECK(others_same);
+  // The last slice and the attenuation limits themselves are fine.
+  TWIN_CHECK(q.estimate({path, kNumSlices - 4, 4, kMaxAttenuation}).valid);
+  TWIN_CHECK(q.estimate({path, 0, 1, kMinAttenuation}).valid);
+}
+
+void churn_matches_fresh() {
+  Network net;
+  const int n = 12;
+  for (int i = 0; i < n; ++i) net.add_node("node");
+  for (int i = 0; i < n; ++i) {
+    net.add_link(i, (i + 1) % n, Half::kA, 1, 240.0);
+    net.add_link((i + 1) % n, i, Half::kB, 1, 240.0);
+    net.add_link(i, (i + 5) % n, Half::kA, 2, 400.0);
+    net.add_link((i + 5) % n, i, Half::kB, 2, 400.0);
+  }
+  ThreadPool pool(1);
+  RsaSolver rsa(net, pool);
+  QotEstimator q(net);
+
+  std::mt19937 rng(3);
+  std::vector<Live> live;
+  ChannelId next_id = 1;
+  std::size_t peak = 0;
+  QotPathId max_lp = 0;
+  long removes = 0;
+  for (int op = 0; op < 200000; ++op) {
+    const unsigned k = rng() % 10;
+    if (k < 5 || live.size() < 5) {
+      const Demand d{static_cast<NodeId>(rng() % n), static_cast<NodeId>(rng() % n),
+                     static_cast<std::uint16_t>(2 + rng() % 6)};
+      if (d.src == d.dst) continue;
+      const RsaResult r = rsa.solve(d);
+      if (!r.found) continue;
+      const Attenuation att = Attenuation::from_tenths(static_cast<std::int16_t>(rng() % 50));
+      if (rsa.provision(r, next_id, att) != Status::kOk) continue;
+      const QotPathId lp = q.add_lightpath(r.path, next_id);
+      max_lp = std::max(max_lp, lp);
+      live.push_back({lp, r.path, next_id++});
+      peak = std::max(peak, live.size());
+    } else if (k < 9) {
+      const std::size_t i = rng() % live.size();
+      q.remove_lightpath(live[i].lp);
+      // Removing again must not hand the slot out twice.
+      if (rng() % 4 == 0) q.remove_lightpath(live[i].lp);
+      for (LinkId l : live[i].path) {
+        const Link& link = net.link(l);
+        net.module(link.from).half(link.half).delete_channel(live[i].id);
+      }
+      live[i] = live.back();
+      live.pop_back();
+      ++removes;
+    } else {
+      const Live& l = live[rng() % live.size()];
+      const Link& link = net.link(l.path.front());
+      net.module(link.from).half(link.half).set_attenuation(
+          l.id, Attenuation::from_tenths(static_cast<std::int16_t>(rng() % 100)));
+    }
+    if (op % 3 == 0) q.update();
+    if (op % 20000 == 19999) TWIN_CHECK(same_results(q, net, live));
+  }
+  TWIN_CHECK(same_results(q, net, live));
+  TWIN_CHECK(removes > 10000);
+
+  // Ids in use are always distinct, and freed ones are reused.
+  std::vector<QotPathId> ids;
+  for (const Live& l : live) ids.push_back(l.lp);
+  std::sort(ids.begin(), ids.end());
+  TWIN_CHECK(std::adjacent_find(ids.begin(), ids.end()) == ids.end());
+  TWIN_CHECK(max_lp < peak);
+}
+
+}  // namespace
+
+int main() {
+  hand_computed_span();
+  gsnr_is_monotonic();
+  estimate_matches_provisioned();
+  estimate_rejects_bad_candidates();
+  churn_matches_fresh();
+  return twin::test::test_result();
+}
@@ -0,0 +1,154 @@
+// Checks RoadmNode's path table: express, add and drop entries are
+// invalidated by a change on either WSS port they depend on (and on a plan
+// commit) but not by changes elsewhere, route-and-select intersects both
+// WSSs while broadcast-and-select only counts the egress selection, and
+// out-of-range degrees, add/drop ports and slice blocks are rejected.
+
+#include <vector>
+
+#include "check.h"
+#include "twin/roadm.h"
+
+namespace {
+
+using namespace twin;
+
+// Slices [first, first + num) and nothing else.
+SliceBitmap block(int first, int num) {
+  SliceBitmap b;
+  b.set_range(first, num);
+  return b;
+}
+
+void cache_follows_both_wss() {
+  std::vector<TwinModule> modules(4);
+  RoadmNode node({NodeArchitecture::kRouteSelect, 4, 8}, modules);
+  TWIN_CHECK(node.connect_express(0, 2, {7, 100, 8, {}}) == Status::kOk);
+  TWIN_CHECK(node.connect_add(1, 0, {20, 300, 4, {}}) == Status::kOk);
+  TWIN_CHECK(node.connect_drop(3, 2, {30, 400, 6, {}}) == Status::kOk);
+
+  SliceBitmap out;
+  TWIN_CHECK(node.express(0, 2, out) == Status::kOk && out == block(100, 8));
+  TWIN_CHECK(node.add_path(1, 0, out) == Status::kOk && out == block(300, 4));
+  TWIN_CHECK(node.drop_path(3, 2, out) == Status::kOk && out == block(400, 6));
+  const NodeStats warm = node.stats();
+  node.express(0, 2, out);
+  node.add_path(1, 0, out);
+  node.drop_path(3, 2, out);
+  TWIN_CHECK(node.stats().recomputes == warm.recomputes);
+
+  // The ingress side of the express path: only slices switched the same
+  // way at both WSSs pass.
+  TWIN_CHECK(modules[0].half(Half::kA).retune_channel(7, 104, 8) == Status::kOk);
+  TWIN_CHECK(node.stats().invalidations == warm.invalidations + 1);
+  TWIN_CHECK(node.express(0, 2, out) == Status::kOk && out == block(104, 4));
+  TWIN_CHECK(node.stats().recomputes == warm.recomputes + 1);
+
+  // The egress side.
+  TWIN_CHECK(modules[2].half(Half::kB).retune_channel(7, 104, 6) == Status::kOk);
+  TWIN_CHECK(node.stats().invalidations == warm.invalidations + 2);
+  TWIN_CHECK(node.express(0, 2, out) == Status::kOk && out == block(104, 6));
+
+  // Changes on other ports of the same halves leave the entry alone.
+  TWIN_CHECK(modules[0].half(Half::kA).add_channel({8, 3, 200, 4, {}}) == Status::kOk);
+  TWIN_CHECK(modules[2].half(Half::kB).add_channel({9, 2, 210, 4, {}}) == Status::kOk);
+  const NodeStats before = node.stats();
+  node.express(0, 2, out);
+  TWIN_CHECK(node.stats().recomputes == before.recomputes);
+
+  // Add and drop entries follow their own ports.
+  TWIN_CHECK(modules[1].half(Half::kB).set_attenuation(20, Attenuation::from_db(2.0)) ==
+             Status::kOk);
+  TWIN_CHECK(node.stats().invalidations == before.invalidations + 1);
+  TWIN_CHECK(modules[1].half(Half::kB).retune_channel(20, 302, 4) == Status::kOk);
+  TWIN_CHECK(node.add_path(1, 0, out) == Status::kOk && out == block(302, 4));
+  TWIN_CHECK(modules[3].half(Half::kA).delete_channel(30) == Status::kOk);
+  TWIN_CHECK(node.drop_path(3, 2, out) == Status::kOk && out.none());
+  TWIN_CHECK(node.stats().recomputes == before.recomputes + 2);
+
+  // A plan commit on the egress WSS invalidates every path it selects.
+  const std::vector<ChannelSpec> plan{{7, 1, 500, 4, {}}};
+  TWIN_CHECK(modules[2].half(Half::kB).commit_plan(plan) == Status::kOk);
+  TWIN_CHECK(node.express(0, 2, out) == Status::kOk && out.none());
+  node.disconnect(7);
+  TWIN_CHECK(modules[0].half(Half::kA).find(7) == nullptr);
+  TWIN_CHECK(modules[2].half(Half::kB).find(7) == nullptr);
+}
+
+void broadcast_and_route_select() {
+  for (NodeArchitecture arch : {NodeArchitecture::kRouteSelect,
+                                NodeArchitecture::kBroadcastSelect}) {
+    const bool bs = arch == NodeArchitecture::kBroadcastSelect;
+    std::vector<TwinModule> modules(3);
+    RoadmNode node({arch, 3, 4}, modules);
+
+    // Express connections only touch the ingress WSS under route-select.
+    TWIN_CHECK(node.connect_express(1, 0, {5, 50, 8, {}}) == Status::kOk);
+    TWIN_CHECK((modules[1].half(Half::kA).find(5) != nullptr) == !bs);
+    TWIN_CHECK(modules[0].half(Half::kB).find(5) != nullptr);
+
+    // A selection with no matching route passes only under broadcast.
+    TWIN_CHECK(modules[2].half(Half::kB).add_channel({6, 1, 80, 4, {}}) == Status::kOk);
+    SliceBitmap out;
+    TWIN_CHECK(node.express(0, 2, out) == Status::kOk);
+    TWIN_CHECK(out == (bs ? block(80, 4) : SliceBitmap{}));
+
+    // Ingress degree ports are splitter legs under broadcast: routing
+    // there neither invalidates nor narrows the express path.
+    const NodeStats before = node.stats();
+    TWIN_CHECK(modules[0].half(Half::kA).add_channel({6, 2, 82, 4, {}}) == Status::kOk);
+    TWIN_CHECK(node.stats().invalidations == before.invalidations + (bs ? 0 : 1));
+    TWIN_CHECK(node.express(0, 2, out) == Status::kOk);
+    TWIN_CHECK(out == (bs ? block(80, 4) : block(82, 2)));
+
+    // Drops go through the ingress WSS either way.
+    TWIN_CHECK(node.connect_drop(2, 1, {9, 600, 4, {}}) == Status::kOk);
+    TWIN_CHECK(node.drop_path(2, 1, out) == Status::kOk && out == block(600, 4));
+  }
+}
+
+void out_of_range() {
+  std::vector<TwinModule> modules(4);
+  RoadmNode node({NodeArchitecture::kRouteSelect, 4, 8}, modules);
+  const SliceBitmap marker = block(10, 3);
+  SliceBitmap out = marker;
+  TWIN_CHECK(node.express(-1, 0, out) == Status::kInvalidPort);
+  TWIN_CHECK(node.express(0, 4, out) == Status::kInvalidPort);
+  TWIN_CHECK(node.add_path(0, 8, out) == Status::kInvalidPort);
+  TWIN_CHECK(node.add_path(4, 0, out) == Status::kInvalidPort);
+  TWIN_CHECK(node.drop_path(0, -1, out) == Status::kInvalidPort);
+  TWIN_CHECK(node.drop_path(-1, 0, out) == Status::kInvalidPort);
+  TWIN_CHECK(out == marker);
+  TWIN_CHECK(node.express(1, 1, out) == Status::kOk && out.none());
+  TWIN_CHECK(node.stats().recomputes == 1);
+
+  // Slice blocks are checked before they are narrowed to the WSS fields:
+  // 65536 would otherwise wrap to slice 0.
+  const NodeChannel off_grid[] = {{1, 65536, 4, {}}, {1, 0, 65536 + 4, {}}, {1, -1, 4, {}},
+                                  {1, kNumSlices - 2, 4, {}}, {1, 100, 0, {}}};
+  for (const NodeChannel& ch : off_grid) {
+    TWIN_CHECK(node.connect_express(0, 1, ch) == Status::kInvalidRange);
+    TWIN_CHECK(node.connect_add(0, 0, ch) == Status::kInvalidRange);
+    TWIN_CHECK(node.connect_drop(0, 0, ch) == Status::kInvalidRange);
+  }
+  bool untouched = true;
+  for (const TwinModule& m : modules) {
+    for (Half h : {Half::kA, Half::kB}) untouched = untouched && m.half(h).num_channels() == 0;
+  }
+  TWIN_CHECK(untouched);
+
+  // An invalid config leaves an empty node that rejects every path.
+  RoadmNode empty({NodeArchitecture::kRouteSelect, 4, 8},
+                  std::span<TwinModule>(modules.data(), 3));
+  TWIN_CHECK(empty.degrees() == 0);
+  TWIN_CHECK(empty.express(0, 1, out) == Status::kInvalidPort);
+}
+
+}  // namespace
+
+int main() {
+  cache_follows_both_wss();
+  broadcast_and_route_select();
+  out_of_range();
+  return twin::test::test_result();
+}
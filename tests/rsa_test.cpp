@@ -0,0 +1,144 @@
+// Hand-checked cases for RsaSolver: the four fit policies on one link with
+// known free runs, the choice between a short path and a longer one that
+// fits tighter, spectrum continuity across hops, all-or-nothing
+// provisioning and a batch that sees its own earlier allocations.
+
+#include <cstdint>
+#include <vector>
+
+#include "check.h"
+#include "twin/rsa.h"
+
+namespace {
+
+using namespace twin;
+
+RsaOptions policy(FitPolicy p) {
+  RsaOptions opts;
+  opts.policy = p;
+  opts.deterministic = true;
+  return opts;
+}
+
+// Marks [first, first + num) used on the half behind `link`.
+void occupy(Network& net, LinkId link, ChannelId id, int first, int num) {
+  const Link& l = net.link(link);
+  TWIN_CHECK(net.module(l.from).half(l.half).add_channel(
+                 {id, 20, static_cast<std::uint16_t>(first), static_cast<std::uint16_t>(num),
+                  {}}) == Status::kOk);
+}
+
+void fit_policies() {
+  // Free runs on the link: [10, 14) of 4, [20, 26) of 6, [100, 103) of 3
+  // and [760, 768) of 8.
+  Network net;
+  net.add_node("a");
+  net.add_node("b");
+  const LinkId link = net.add_link(0, 1, Half::kA, 1);
+  occupy(net, link, 1000, 0, 10);
+  occupy(net, link, 1001, 14, 6);
+  occupy(net, link, 1002, 26, 74);
+  occupy(net, link, 1003, 103, 657);
+  ThreadPool pool(2);
+
+  struct Case {
+    FitPolicy policy;
+    std::uint16_t slices;
+    int want;  // First slice, or -1 for no fit.
+  };
+  const Case cases[] = {
+      // Three slices: the lowest run, the top of the highest, and the exact
+      // fit for both best fit and min fragmentation.
+      {FitPolicy::kFirstFit, 3, 10},
+      {FitPolicy::kLastFit, 3, 765},
+      {FitPolicy::kBestFit, 3, 100},
+      {FitPolicy::kMinFragmentation, 3, 100},
+      // Two slices: best fit takes the 3-run and strands one slice; min
+      // fragmentation takes the 4-run, whose remnant can still hold a demand.
+      {FitPolicy::kFirstFit, 2, 10},
+      {FitPolicy::kLastFit, 2, 766},
+      {FitPolicy::kBestFit, 2, 100},
+      {FitPolicy::kMinFragmentation, 2, 10},
+      // Six slices skip the narrower runs; nine fit nowhere.
+      {FitPolicy::kFirstFit, 6, 20},
+      {FitPolicy::kBestFit, 6, 20},
+      {FitPolicy::kMinFragmentation, 7, 760},
+      {FitPolicy::kFirstFit, 9, -1},
+      {FitPolicy::kBestFit, 9, -1},
+  };
+  for (const Case& c : cases) {
+    RsaSolver rsa(net, pool, policy(c.policy));
+    const RsaResult r = rsa.solve({0, 1, c.slices});
+    TWIN_CHECK(r.found == (c.want >= 0));
+    if (c.want >= 0) TWIN_CHECK(r.first_slice == c.want && r.num_slices == c.slices);
+  }
+
+  // When every run would leave a remnant narrower than the demand, min
+  // fragmentation keeps the widest remnant.
+  RsaSolver rsa(net, pool, policy(FitPolicy::kMinFragmentation));
+  const RsaResult r = rsa.solve({0, 1, 5});
+  TWIN_CHECK(r.found && r.first_slice == 760);
+  TWIN_CHECK(!rsa.solve({0, 1, 0}).found);
+  TWIN_CHECK(!rsa.solve({1, 0, 1}).found);
+}
+
+void path_choice_and_continuity() {
+  // 0 -> 1 -> 2 is 200 km, the direct 0 -> 2 link 500 km.
+  Network net;
+  for (int i = 0; i < 3; ++i) net.add_node("node");
+  const LinkId a = net.add_link(0, 1, Half::kA, 1, 100.0);
+  const LinkId b = net.add_link(1, 2, Half::kA, 1, 100.0);
+  const LinkId direct = net.add_link(0, 2, Half::kA, 2, 500.0);
+  // Module 0's half A launches both `a` and `direct`, so they share its free
+  // runs [40, 44) and [300, 310). `b` blocks [40, 44), so the short path can
+  // only use [300, 310), while the direct link also has an exact 4-slice gap.
+  occupy(net, a, 1, 0, 40);
+  occupy(net, a, 2, 44, 256);
+  occupy(net, a, 3, 310, 458);
+  occupy(net, b, 4, 40, 4);
+  occupy(net, b, 5, 200, 100);
+  ThreadPool pool(2);
+
+  RsaSolver first(net, pool, policy(FitPolicy::kFirstFit));
+  RsaResult r = first.solve({0, 2, 4});
+  TWIN_CHECK(r.found && r.path == (Path{a, b}) && r.first_slice == 300);
+  TWIN_CHECK(r.paths_evaluated == 2);
+
+  // Best fit prefers the exact gap, even on the longer path.
+  RsaSolver best(net, pool, policy(FitPolicy::kBestFit));
+  r = best.solve({0, 2, 4});
+  TWIN_CHECK(r.found && r.path == Path{direct} && r.first_slice == 40);
+  // On equal cost the path with fewer hops wins.
+  r = best.solve({0, 2, 10});
+  TWIN_CHECK(r.found && r.path == Path{direct} && r.first_slice == 300);
+
+  // Provisioning is all-or-nothing: a block taken on the second hop rolls
+  // back the first.
+  RsaResult clash = first.solve({0, 2, 4});
+  occupy(net, b, 6, 300, 2);
+  TWIN_CHECK(first.provision(clash, 77) == Status::kSliceConflict);
+  TWIN_CHECK(!net.module(0).half(Half::kA).find(77));
+  TWIN_CHECK(!net.module(1).half(Half::kA).find(77));
+  TWIN_CHECK(first.provision(RsaResult{}, 78) == Status::kInvalidRange);
+
+  // A batch sees its own allocations: the short path fills up from 302,
+  // then the third demand falls back to the direct link and the fourth
+  // finds nothing.
+  const std::vector<Demand> demands{{0, 2, 4}, {0, 2, 4}, {0, 2, 4}, {0, 2, 4}};
+  const std::vector<RsaResult> batch = first.solve_batch(demands, 50);
+  TWIN_CHECK(batch[0].found && batch[0].path == (Path{a, b}) && batch[0].first_slice == 302);
+  TWIN_CHECK(batch[1].found && batch[1].path == (Path{a, b}) && batch[1].first_slice == 306);
+  TWIN_CHECK(batch[2].found && batch[2].path == Path{direct} && batch[2].first_slice == 40);
+  TWIN_CHECK(!batch[3].found);
+  TWIN_CHECK(net.module(1).half(Half::kA).find(51)->first_slice == 306);
+  TWIN_CHECK(net.module(0).half(Half::kA).find(52)->port == 2);
+  TWIN_CHECK(!net.module(0).half(Half::kA).find(53));
+}
+
+}  // namespace
+
+int main() {
+  fit_policies();
+  path_choice_and_continuity();
+  return twin::test::test_result();
+}
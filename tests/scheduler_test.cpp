@@ -0,0 +1,330 @@
+// Drives CommandScheduler on its virtual clock through hand-timed scenarios:
+// restoration jumping queued routine work, an attenuation ramp preempted at
+// a step boundary and resumed, and an equalisation command promoted after
+// max_wait_us. A randomised run then checks that every command completes
+// exactly once and that queued() drains back to zero. Coalescing is checked
+// on a burst of updates to one channel, and on a random stream that must
+// leave the same final state as with coalescing off, in less virtual time.
+
+#include <cstdint>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+#include "check.h"
+#include "twin/scheduler.h"
+
+namespace {
+
+using namespace twin;
+
+Command add(ChannelId id, int first, int port = 1) {
+  Command c;
+  c.kind = CommandKind::kAdd;
+  c.channel = id;
+  c.port = static_cast<std::uint8_t>(port);
+  c.first_slice = static_cast<std::uint16_t>(first);
+  c.num_slices = 4;
+  return c;
+}
+
+Command atten(ChannelId id, double db) {
+  Command c;
+  c.kind = CommandKind::kAttenuate;
+  c.channel = id;
+  c.attenuation = Attenuation::from_db(db);
+  return c;
+}
+
+struct Log {
+  std::vector<Completion> done;
+  const Completion* find(std::uint64_t seq) const {
+    for (const Completion& c : done) {
+      if (c.seq == seq && !c.superseded_by) return &c;
+    }
+    return nullptr;
+  }
+};
+
+bool near(std::uint64_t got, std::uint64_t want) {
+  // Histograms report within about 3%.
+  return std::llabs(static_cast<long long>(got) - static_cast<long long>(want)) <=
+         static_cast<long long>(want / 25);
+}
+
+void restoration_jumps_routine() {
+  std::vector<TwinModule> modules(1);
+  Log log;
+  CommandScheduler s(modules, [&](const Completion& c) { log.done.push_back(c); });
+  const std::uint64_t p1 = s.submit(add(1, 0), CommandClass::kProvisioning);
+  s.advance(10'000);
+  const std::uint64_t p2 = s.submit(add(2, 10), CommandClass::kProvisioning);
+  const std::uint64_t p3 = s.submit(add(3, 20), CommandClass::kProvisioning);
+  const std::uint64_t r = s.submit(add(4, 30), CommandClass::kRestoration);
+  TWIN_CHECK(s.queued() == 4);
+  s.run_until_idle();
+  TWIN_CHECK(s.queued() == 0);
+
+  // The in-flight add is not interrupted; restoration goes next.
+  const SettleTiming t;
+  TWIN_CHECK(log.done.size() == 4);
+  if (log.done.size() != 4) return;
+  TWIN_CHECK(log.done[0].seq == p1 && log.done[0].finished == t.add_us);
+  TWIN_CHECK(log.done[1].seq == r && log.done[1].started == t.add_us);
+  TWIN_CHECK(log.done[2].seq == p2 && log.done[2].finished == 3 * t.add_us);
+  TWIN_CHECK(log.done[3].seq == p3 && log.done[3].finished == 4 * t.add_us);
+  const ClassStats& rs = s.stats(CommandClass::kRestoration);
+  TWIN_CHECK(rs.completed == 1 && rs.queueing_us.count() == 1);
+  TWIN_CHECK(near(rs.queueing_us.max(), t.add_us - 10'000));
+  TWIN_CHECK(s.stats(CommandClass::kProvisioning).completed == 3);
+  TWIN_CHECK(modules[0].half(Half::kA).channels().size() == 4);
+}
+
+void ramp_resumes_after_preemption() {
+  std::vector<TwinModule> modules(1);
+  WssHalf& wss = modules[0].half(Half::kA);
+  wss.add_channel({7, 2, 100, 4, {}});
+  Log log;
+  CommandScheduler s(modules, [&](const Completion& c) { log.done.push_back(c); });
+  const SettleTiming t;
+
+  // 0 to 5 dB in 1 dB steps: five steps of attenuate_step_us.
+  const std::uint64_t eq = s.submit(atten(7, 5.0), CommandClass::kEqualisation);
+  s.advance(30'000);
+  TWIN_CHECK(wss.find(7)->attenuation == Attenuation::from_db(1.0));
+  const std::uint64_t r = s.submit(add(8, 200), CommandClass::kRestoration);
+  s.advance(100'000);
+  // The second step settled at 40 ms, then restoration took the WSS.
+  TWIN_CHECK(wss.find(7)->attenuation == Attenuation::from_db(2.0));
+  TWIN_CHECK(wss.find(8) == nullptr);
+  TWIN_CHECK(s.queued() == 2);
+  s.run_until_idle();
+  TWIN_CHECK(s.queued() == 0);
+
+  const Completion* rc = log.find(r);
+  const Completion* ec = log.find(eq);
+  TWIN_CHECK(rc && ec);
+  if (!rc || !ec) return;
+  TWIN_CHECK(rc->started == 2 * t.attenuate_step_us);
+  TWIN_CHECK(rc->finished == 2 * t.attenuate_step_us + t.add_us);
+  TWIN_CHECK(ec->started == 0);
+  TWIN_CHECK(ec->finished == 5 * t.attenuate_step_us + t.add_us);
+  TWIN_CHECK(ec->status == Status::kOk);
+  TWIN_CHECK(wss.find(7)->attenuation == Attenuation::from_db(5.0));
+  TWIN_CHECK(s.stats(CommandClass::kEqualisation).preemptions == 1);
+  TWIN_CHECK(s.stats(CommandClass::kRestoration).preemptions == 0);
+}
+
+void starved_command_is_promoted() {
+  std::vector<TwinModule> modules(1);
+  WssHalf& wss = modules[0].half(Half::kA);
+  wss.add_channel({7, 2, 700, 4, {}});
+  Log log;
+  SchedulerOptions opts;
+  CommandScheduler s(modules, [&](const Completion& c) { log.done.push_back(c); }, opts);
+  const SettleTiming& t = opts.timing;
+
+  // One add is in flight when the equalisation command arrives; 59 more
+  // arrive 1 ms later and would keep it waiting for 7.2 s.
+  s.submit(add(100, 0), CommandClass::kProvisioning);
+  s.advance(0);
+  const std::uint64_t eq = s.submit(atten(7, 0.5), CommandClass::kEqualisation);
+  s.advance(1'000);
+  for (int i = 1; i < 60; ++i) {
+    s.submit(add(static_cast<ChannelId>(100 + i), 4 * i, 1 + i % kNumPorts),
+             CommandClass::kProvisioning);
+  }
+  // Restoration arriving at 5 s still goes ahead of the aged command.
+  s.advance(5'000'000);
+  const std::uint64_t r = s.submit(add(200, 600), CommandClass::kRestoration);
+  s.run_until_idle();
+  TWIN_CHECK(s.queued() == 0);
+
+  const VirtualTime boundary = 42 * t.add_us;  // First safe point after 5 s.
+  const Completion* rc = log.find(r);
+  const Completion* ec = log.find(eq);
+  TWIN_CHECK(rc && ec);
+  if (!rc || !ec) return;
+  TWIN_CHECK(rc->started == boundary);
+  TWIN_CHECK(ec->started == boundary + t.add_us);
+  TWIN_CHECK(ec->started - ec->queued >= opts.max_wait_us[index_of(CommandClass::kEqualisation)]);
+  TWIN_CHECK(s.stats(CommandClass::kEqualisation).promotions == 1);
+  TWIN_CHECK(s.stats(CommandClass::kProvisioning).promotions == 0);
+  TWIN_CHECK(s.stats(CommandClass::kProvisioning).completed == 60);
+  TWIN_CHECK(wss.channels().size() == 62);
+}
+
+void random_load_drains() {
+  std::vector<TwinModule> modules(3);
+  std::vector<int> completions;
+  CommandScheduler s(modules, [&](const Completion& c) {
+    if (c.seq >= completions.size()) completions.resize(c.seq + 1);
+    ++completions[c.seq];
+  });
+  std::mt19937 rng(5);
+  std::uint64_t submitted = 0;
+  VirtualTime now = 0;
+  for (int i = 0; i < 20000; ++i) {
+    Command c;
+    switch (rng() % 5) {
+      case 0:
+        c = add(rng() % 40, static_cast<int>(rng() % 760), 1 + static_cast<int>(rng() % kNumPorts));
+        break;
+      case 1:
+        c.kind = CommandKind::kDelete;
+        c.channel = rng() % 40;
+        break;
+      case 2:
+        c.kind = CommandKind::kRetune;
+        c.channel = rng() % 40;
+        c.first_slice = static_cast<std::uint16_t>(rng() % 760);
+        c.num_slices = static_cast<std::uint16_t>(1 + rng() % 8);
+        break;
+      case 3:
+        c = atten(rng() % 40, (rng() % 150) / 10.0);
+        break;
+      default:
+        c.kind = CommandKind::kSnapshot;
+        break;
+    }
+    // Module 3 does not exist, so some commands fail validation.
+    c.module = rng() % 4;
+    c.half = rng() % 2 ? Half::kA : Half::kB;
+    s.submit(c, static_cast<CommandClass>(rng() % kNumCommandClasses));
+    ++submitted;
+    if (rng() % 8 == 0) {
+      now += rng() % 200'000;
+      s.advance(now);
+    }
+  }
+  TWIN_CHECK(s.queued() > 0);
+  s.run_until_idle();
+  TWIN_CHECK(s.queued() == 0);
+  TWIN_CHECK(s.next_event() == CommandScheduler::kIdle);
+
+  bool once = completions.size() == submitted + 1;
+  for (std::size_t seq = 1; seq < completions.size(); ++seq) once = once && completions[seq] == 1;
+  TWIN_CHECK(once);
+  std::uint64_t completed = 0;
+  for (int c = 0; c < kNumCommandClasses; ++c) {
+    const ClassStats& st = s.stats(static_cast<CommandClass>(c));
+    TWIN_CHECK(st.completed == st.submitted);
+    TWIN_CHECK(st.completion_us.count() == st.completed);
+    completed += st.completed;
+  }
+  TWIN_CHECK(completed == submitted);
+}
+
+void burst_collapses_to_one_ramp() {
+  std::vector<TwinModule> modules(1);
+  WssHalf& wss = modules[0].half(Half::kA);
+  wss.add_channel({7, 2, 100, 4, {}});
+  Log log;
+  CommandScheduler s(modules, [&](const Completion& c) { log.done.push_back(c); });
+  const SettleTiming t;
+
+  // An add holds the WSS while 50 updates to channel 7 queue behind it.
+  s.submit(add(1, 0), CommandClass::kProvisioning);
+  s.advance(0);
+  std::uint64_t last = 0;
+  for (int i = 1; i <= 50; ++i) last = s.submit(atten(7, 0.1 * i), CommandClass::kEqualisation);
+  TWIN_CHECK(s.queued() == 2);
+  s.run_until_idle();
+  TWIN_CHECK(s.queued() == 0);
+
+  const ClassStats& st = s.stats(CommandClass::kEqualisation);
+  TWIN_CHECK(st.submitted == 50 && st.completed == 50 && st.coalesced == 49);
+  TWIN_CHECK(st.queueing_us.count() == 1);
+  TWIN_CHECK(st.completion_us.count() == 50);
+  int superseded = 0;
+  for (const Completion& c : log.done) superseded += c.superseded_by != 0;
+  TWIN_CHECK(superseded == 49);
+  const Completion* ramp = log.find(last);
+  TWIN_CHECK(ramp && ramp->started == t.add_us);
+  // 0 to 5 dB is one ramp of five steps, not 50 ramps.
+  TWIN_CHECK(ramp && ramp->finished == t.add_us + 5 * t.attenuate_step_us);
+  TWIN_CHECK(wss.find(7)->attenuation == Attenuation::from_db(5.0));
+}
+
+// Each channel retunes only inside its own 16-slice region, so no command
+// fails and attenuates and retunes of a channel commute. The final state is
+// then each channel's last retune and last attenuation, whichever commands
+// were merged on the way.
+VirtualTime run_random_stream(std::vector<TwinModule>& modules, bool coalesce) {
+  constexpr int kChannels = 24;
+  for (TwinModule& m : modules) {
+    for (int h = 0; h < kNumHalves; ++h) {
+      for (int ch = 0; ch < kChannels; ++ch) {
+        m.half(static_cast<Half>(h)).add_channel(
+            {static_cast<ChannelId>(ch), static_cast<std::uint8_t>(1 + ch % kNumPorts),
+             static_cast<std::uint16_t>(16 * ch), 4, {}});
+      }
+    }
+  }
+  SchedulerOptions opts;
+  opts.coalesce = coalesce;
+  CommandScheduler s(modules, nullptr, opts);
+  std::mt19937 rng(11);
+  VirtualTime now = 0;
+  for (int i = 0; i < 5000; ++i) {
+    const ChannelId ch = rng() % kChannels;
+    Command c;
+    CommandClass cls = CommandClass::kEqualisation;
+    if (rng() % 3 == 0) {
+      c.kind = CommandKind::kRetune;
+      c.channel = ch;
+      c.num_slices = static_cast<std::uint16_t>(1 + rng() % 8);
+      c.first_slice = static_cast<std::uint16_t>(16 * ch + rng() % (17 - c.num_slices));
+      cls = CommandClass::kProvisioning;
+    } else {
+      c = atten(ch, (rng() % 150) / 10.0);
+    }
+    c.module = rng() % modules.size();
+    c.half = rng() % 2 ? Half::kA : Half::kB;
+    s.submit(c, cls);
+    if (i % 50 == 49) {
+      now += 50'000;
+      s.advance(now);
+    }
+  }
+  s.run_until_idle();
+  for (int c = 0; c < kNumCommandClasses; ++c) {
+    TWIN_CHECK(s.stats(static_cast<CommandClass>(c)).failed == 0);
+  }
+  return s.now();
+}
+
+void coalescing_keeps_final_state() {
+  std::vector<TwinModule> merged(4);
+  std::vector<TwinModule> plain(4);
+  const VirtualTime with = run_random_stream(merged, true);
+  const VirtualTime without = run_random_stream(plain, false);
+  bool same = true;
+  for (std::size_t m = 0; m < merged.size(); ++m) {
+    for (int h = 0; h < kNumHalves; ++h) {
+      const WssHalf& a = merged[m].half(static_cast<Half>(h));
+      const WssHalf& b = plain[m].half(static_cast<Half>(h));
+      same = same && a.channels().size() == b.channels().size();
+      for (const Channel& ch : a.channels()) {
+        const Channel* other = b.find(ch.id);
+        same = same && other && other->port == ch.port && other->first_slice == ch.first_slice &&
+               other->num_slices == ch.num_slices && other->attenuation == ch.attenuation;
+      }
+    }
+  }
+  TWIN_CHECK(same);
+  // Measured at about half; the bound leaves room for changes to the stream.
+  TWIN_CHECK(with * 10 < without * 6);
+}
+
+}  // namespace
+
+int main() {
+  restoration_jumps_routine();
+  ramp_resumes_after_preemption();
+  starved_command_is_promoted();
+  random_load_drains();
+  burst_collapses_to_one_ramp();
+  coalescing_keeps_final_state();
+  return twin::test::test_result();
+}
@@ -0,0 +1,206 @@
+// Drives ManagementServer over a Unix socket with two abusive clients. A slow
+// reader pipelines requests without reading replies: the server must stop
+// reading it at max_pending, then answer every request in order once the
+// client drains. A pipelining flood on a single reactor must not starve a
+// second client doing round trips, and every flood request must be answered.
+
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "check.h"
+#include "twin/server.h"
+
+namespace {
+
+using namespace twin;
+
+std::string socket_path(const char* name) {
+  return "/tmp/twin-server-test-" + std::to_string(::getpid()) + "-" + name;
+}
+
+int connect_unix(const std::string& path) {
+  const int fd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+  sockaddr_un addr{};
+  addr.sun_family = AF_UNIX;
+  std::memcpy(addr.sun_path, path.c_str(), path.size() + 1);
+  if (::connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof addr) != 0) {
+    ::close(fd);
+    return -1;
+  }
+  return fd;
+}
+
+bool write_all(int fd, const char* p, std::size_t n) {
+  while (n > 0) {
+    const ssize_t k = ::write(fd, p, n);
+    if (k <= 0) return false;
+    p += k;
+    n -= static_cast<std::size_t>(k);
+  }
+  return true;
+}
+
+// Reads reply lines until EOF and checks each against expected(i).
+template <typename Expected>
+std::size_t read_replies(int fd, Expected expected, bool& in_order) {
+  std::string buf;
+  std::vector<char> chunk(64 * 1024);
+  std::size_t lines = 0;
+  in_order = true;
+  for (;;) {
+    const ssize_t n = ::read(fd, chunk.data(), chunk.size());
+    if (n <= 0) break;
+    buf.append(chunk.data(), static_cast<std::size_t>(n));
+    std::size_t start = 0;
+    for (std::size_t nl; (nl = buf.find('\n', start)) != std::string::npos; start = nl + 1) {
+      in_order = in_order && std::string_view(buf).substr(start, nl - start) == expected(lines);
+      ++lines;
+    }
+    buf.erase(0, start);
+  }
+  in_order = in_order && buf.empty();
+  return lines;
+}
+
+void slow_reader() {
+  std::vector<TwinModule> modules(2);
+  ServerOptions opts;
+  opts.unix_path = socket_path("slow");
+  opts.max_read_burst = 4096;
+  opts.max_pending = 16 * 1024;
+  ManagementServer server(modules, opts);
+  std::string error;
+  TWIN_CHECK(server.start(error));
+  const int fd = connect_unix(opts.unix_path);
+  TWIN_CHECK(fd >= 0);
+  if (fd < 0) return;
+
+  // Pipeline without reading until the server stops taking requests. Without
+  // backpressure it would read and queue replies up to the cap.
+  const std::string line = "snapshot 1 B\n";
+  std::string block;
+  while (block.size() < 64 * 1024) block += line;
+  const std::size_t cap = 256u * 1024 * 1024;
+  ::fcntl(fd, F_SETFL, ::fcntl(fd, F_GETFL) | O_NONBLOCK);
+  std::size_t sent = 0;
+  bool blocked = false;
+  while (sent < cap && !blocked) {
+    const std::size_t off = sent % block.size();
+    const ssize_t n = ::write(fd, block.data() + off, block.size() - off);
+    if (n > 0) {
+      sent += static_cast<std::size_t>(n);
+      continue;
+    }
+    pollfd p{fd, POLLOUT, 0};
+    blocked = ::poll(&p, 1, 500) == 0;
+  }
+  TWIN_CHECK(blocked);
+  TWIN_CHECK(server.stats().read_pauses >= 1);
+  const std::uint64_t before = server.stats().requests;
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+  TWIN_CHECK(server.stats().requests == before);
+  TWIN_CHECK(before < sent / line.size());
+
+  // Drain: every request, including those buffered while paused, is answered
+  // once, in order, and the half-closed session then ends.
+  ::fcntl(fd, F_SETFL, ::fcntl(fd, F_GETFL) & ~O_NONBLOCK);
+  bool in_order = false;
+  std::size_t replies = 0;
+  std::thread reader([&] {
+    replies = read_replies(fd, [](std::size_t) { return std::string_view("ok 0 0"); },
+                           in_order);
+  });
+  const std::size_t tail = line.size() - sent % line.size();
+  if (tail != line.size()) {
+    write_all(fd, line.data() + line.size() - tail, tail);
+    sent += tail;
+  }
+  ::shutdown(fd, SHUT_WR);
+  reader.join();
+  ::close(fd);
+  TWIN_CHECK(in_order);
+  TWIN_CHECK(replies == sent / line.size());
+  TWIN_CHECK(server.stats().requests == sent / line.size());
+  server.stop();
+}
+
+void pipelining_flood() {
+  std::vector<TwinModule> modules(2);
+  ServerOptions opts;
+  opts.unix_path = socket_path("flood");
+  opts.reactors = 1;
+  opts.max_read_burst = 4096;
+  ManagementServer server(modules, opts);
+  std::string error;
+  TWIN_CHECK(server.start(error));
+  const int flood = connect_unix(opts.unix_path);
+  const int probe = connect_unix(opts.unix_path);
+  TWIN_CHECK(flood >= 0 && probe >= 0);
+  if (flood < 0 || probe < 0) return;
+
+  // Valid and invalid requests alternate, so a lost or repeated reply shows.
+  const std::size_t total = 2000000;
+  std::atomic<bool> flood_done{false};
+  bool in_order = false;
+  std::size_t replies = 0;
+  std::thread reader([&] {
+    replies = read_replies(
+        flood,
+        [](std::size_t i) { return std::string_view(i % 2 ? "err parse-error" : "ok 0 0"); },
+        in_order);
+    flood_done = true;
+  });
+  std::thread writer([&] {
+    std::string block;
+    for (std::size_t i = 0; i < total;) {
+      block.clear();
+      for (; i < total && block.size() < 64 * 1024; ++i) {
+        block += i % 2 ? "nope\n" : "snapshot 0 A\n";
+      }
+      if (!write_all(flood, block.data(), block.size())) break;
+    }
+    ::shutdown(flood, SHUT_WR);
+  });
+
+  while (server.stats().requests < 1000) std::this_thread::yield();
+  bool probe_ok = true;
+  char c;
+  for (int i = 0; i < 50 && probe_ok; ++i) {
+    probe_ok = write_all(probe, "snapshot 1 B\n", 13);
+    std::string reply;
+    while (probe_ok && ::read(probe, &c, 1) == 1 && c != '\n') reply += c;
+    probe_ok = probe_ok && reply == "ok 0 0";
+  }
+  // The probe got its turns while the flood was still being served.
+  TWIN_CHECK(probe_ok);
+  TWIN_CHECK(!flood_done);
+  writer.join();
+  reader.join();
+  ::close(flood);
+  ::close(probe);
+  TWIN_CHECK(in_order);
+  TWIN_CHECK(replies == total);
+  const ServerStats st = server.stats();
+  TWIN_CHECK(st.requests == total + 50);
+  TWIN_CHECK(st.burst_yields > 0);
+  server.stop();
+}
+
+}  // namespace
+
+int main() {
+  slow_reader();
+  pipelining_flood();
+  return twin::test::test_result();
+}
@@ -0,0 +1,159 @@
+// Checks that the deterministic parallel paths give the same answer for any
+// pool size: parallel_reduce on an order-sensitive float sum, a variation
+// sweep compared bit for bit, and a deterministic RSA batch run under a
+// budget too small to finish otherwise. Also checks pixel-defect sampling at
+// the extremes of the defect rate, where the geometric gaps overflow.
+
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <random>
+#include <vector>
+
+#include "check.h"
+#include "twin/rsa.h"
+#include "twin/variation.h"
+
+namespace {
+
+using namespace twin;
+
+bool same_bits(double a, double b) { return std::memcmp(&a, &b, sizeof a) == 0; }
+
+bool same_unit(const UnitResult& a, const UnitResult& b) {
+  return a.passed == b.passed && a.failed_channels == b.failed_channels &&
+         a.defective_channels == b.defective_channels &&
+         same_bits(a.worst_loss_db, b.worst_loss_db) &&
+         same_bits(a.worst_ripple_db, b.worst_ripple_db);
+}
+
+void reduce_is_ordered() {
+  // Terms spanning many magnitudes, so any change of grouping shows up.
+  std::vector<double> terms(100003);
+  std::mt19937_64 rng(9);
+  for (double& t : terms) t = std::ldexp(static_cast<double>(rng() % 1000) - 500.0, rng() % 60);
+  double want = 0.0;
+  for (std::size_t threads : {1, 2, 3, 4}) {
+    ThreadPool pool(threads);
+    const double sum = pool.parallel_reduce(
+        terms.size(), 1024, 0.0, [&](std::size_t i) { return terms[i]; },
+        [](double a, double b) { return a + b; });
+    if (threads == 1) want = sum;
+    TWIN_CHECK(same_bits(sum, want));
+  }
+}
+
+void sweep_is_independent_of_pool_size() {
+  TwinModule plan;
+  for (int i = 0; i < 40; ++i) {
+    const ChannelSpec spec{static_cast<ChannelId>(i), static_cast<std::uint8_t>(1 + i % 20),
+                           static_cast<std::uint16_t>(i * 16), 8,
+                           Attenuation::from_tenths(static_cast<std::int16_t>(i % 18 * 10))};
+    plan.half(Half::kA).add_channel(spec);
+  }
+  VariationConfig cfg;
+  cfg.pixel_defect_rate = 1e-3;
+  const VariationSweep sweep(cfg);
+
+  ThreadPool serial(1);
+  const SweepResult want = sweep.run(plan, 3000, serial);
+  TWIN_CHECK(want.passed > 0 && want.passed < want.units);
+  for (std::size_t threads : {2, 3, 4}) {
+    ThreadPool pool(threads);
+    const SweepResult got = sweep.run(plan, 3000, pool);
+    TWIN_CHECK(got.passed == want.passed);
+    TWIN_CHECK(same_bits(got.mean_worst_loss_db, want.mean_worst_loss_db));
+    TWIN_CHECK(same_bits(got.max_worst_loss_db, want.max_worst_loss_db));
+    TWIN_CHECK(same_bits(got.max_ripple_db, want.max_ripple_db));
+    TWIN_CHECK(got.channel_failures == want.channel_failures);
+    bool units_equal = got.per_unit.size() == want.per_unit.size();
+    for (std::size_t u = 0; units_equal && u < got.per_unit.size(); ++u) {
+      units_equal = same_unit(got.per_unit[u], want.per_unit[u]);
+    }
+    TWIN_CHECK(units_equal);
+  }
+
+  // A unit re-created on its own gives the result it had inside the sweep.
+  for (std::uint64_t u : {0u, 17u, 2999u}) {
+    TWIN_CHECK(same_unit(sweep.evaluate(plan, sweep.sample(u)), want.per_unit[u]));
+  }
+}
+
+int count_defects(const UnitVariation& u) {
+  int n = 0;
+  for (const HalfVariation& h : u.halves) {
+    for (const SliceBitmap& b : h.defects) n += b.count();
+  }
+  return n;
+}
+
+void defect_rate_extremes() {
+  VariationConfig cfg;
+  // Gaps far beyond any integer type, and infinite for the smallest rate.
+  for (double rate : {1e-300, std::numeric_limits<double>::denorm_min(), 1e-18}) {
+    cfg.pixel_defect_rate = rate;
+    const VariationSweep sweep(cfg);
+    int defects = 0;
+    for (std::uint64_t u = 0; u < 1000; ++u) defects += count_defects(sweep.sample(u));
+    TWIN_CHECK(defects == 0);
+  }
+  cfg.pixel_defect_rate = 1.0;
+  TWIN_CHECK(count_defects(VariationSweep(cfg).sample(0)) == 2 * kNumPorts * kNumSlices);
+
+  // Half the pixels, to within a few standard deviations (sigma ~ 88).
+  cfg.pixel_defect_rate = 0.5;
+  const int half = count_defects(VariationSweep(cfg).sample(1));
+  TWIN_CHECK(std::abs(half - kNumPorts * kNumSlices) < 600);
+}
+
+void rsa_batch_is_independent_of_pool_size() {
+  std::vector<std::uint64_t> hashes;
+  for (std::size_t threads : {1, 2, 4}) {
+    Network net;
+    const int n = 30;
+    for (int i = 0; i < n; ++i) net.add_node("node");
+    std::mt19937 lengths(1);
+    for (int i = 0; i < n; ++i) {
+      for (int k = 1; k <= 3; ++k) {
+        const int j = (i + k * 7) % n;
+        net.add_link(i, j, Half::kA, k, 50.0 + lengths() % 500);
+        net.add_link(j, i, Half::kB, k, 50.0 + lengths() % 500);
+      }
+    }
+    ThreadPool pool(threads);
+    RsaOptions opts;
+    opts.policy = FitPolicy::kBestFit;
+    opts.k_paths = 8;
+    opts.budget = std::chrono::microseconds(1);
+    opts.deterministic = true;
+    RsaSolver rsa(net, pool, opts);
+
+    std::mt19937 rng(5);
+    std::vector<Demand> demands;
+    for (int i = 0; i < 2000; ++i) {
+      const Demand d{static_cast<NodeId>(rng() % n), static_cast<NodeId>(rng() % n),
+                     static_cast<std::uint16_t>(1 + rng() % 8)};
+      if (d.src != d.dst) demands.push_back(d);
+    }
+    std::uint64_t h = 0;
+    for (const RsaResult& r : rsa.solve_batch(demands, 1)) {
+      h = h * 31 + r.found * 7 + r.first_slice * 3 + r.paths_evaluated;
+      for (LinkId l : r.path) h = h * 131 + l;
+    }
+    hashes.push_back(h);
+  }
+  TWIN_CHECK(hashes[1] == hashes[0]);
+  TWIN_CHECK(hashes[2] == hashes[0]);
+}
+
+}  // namespace
+
+int main() {
+  reduce_is_ordered();
+  sweep_is_independent_of_pool_size();
+  defect_rate_extremes();
+  rsa_batch_is_independent_of_pool_size();
+  return twin::test::test_result();
+}
@@ -0,0 +1,164 @@
+// Hand-checked cases for WssHalf's conflict rules: add, delete, retune and
+// attenuation each reject bad input with their own status and leave the
+// table and observers untouched, a slice is exclusive across all ports of
+// the common port, and commit_plan() replaces the table as a unit or not at
+// all.
+
+#include <cstdint>
+#include <vector>
+
+#include "check.h"
+#include "twin/wss.h"
+
+namespace {
+
+using namespace twin;
+
+struct Counter : WssObserver {
+  void on_channel_change(const WssHalf&, const Channel*, const Channel*) override { ++changes; }
+  void on_reset(const WssHalf&) override { ++resets; }
+  int changes = 0;
+  int resets = 0;
+};
+
+bool same_table(const WssHalf& wss, const std::vector<ChannelSpec>& want) {
+  if (wss.num_channels() != want.size()) return false;
+  SliceBitmap common;
+  for (const ChannelSpec& w : want) {
+    const Channel* ch = wss.find(w.id);
+    if (!ch || ch->port != w.port || ch->first_slice != w.first_slice ||
+        ch->num_slices != w.num_slices || ch->attenuation != w.attenuation) {
+      return false;
+    }
+    common.set_range(w.first_slice, w.num_slices);
+  }
+  return wss.common_occupancy() == common;
+}
+
+void add_and_delete() {
+  WssHalf wss;
+  Counter obs;
+  wss.add_observer(&obs);
+  TWIN_CHECK(wss.add_channel({1, 3, 100, 8, {}}) == Status::kOk);
+  TWIN_CHECK(wss.add_channel({2, 4, 108, 4, Attenuation::from_db(20.0)}) == Status::kOk);
+  const std::vector<ChannelSpec> two{{1, 3, 100, 8, {}},
+                                     {2, 4, 108, 4, Attenuation::from_db(20.0)}};
+
+  // Each rejection has its own status, checked in this order.
+  TWIN_CHECK(wss.add_channel({3, 0, 200, 4, {}}) == Status::kInvalidPort);
+  TWIN_CHECK(wss.add_channel({3, kNumPorts + 1, 200, 4, {}}) == Status::kInvalidPort);
+  TWIN_CHECK(wss.add_channel({3, 1, 765, 4, {}}) == Status::kInvalidRange);
+  TWIN_CHECK(wss.add_channel({3, 1, 200, 0, {}}) == Status::kInvalidRange);
+  TWIN_CHECK(wss.add_channel({3, 1, 200, 4, Attenuation::from_tenths(201)}) ==
+             Status::kInvalidAttenuation);
+  TWIN_CHECK(wss.add_channel({1, 1, 300, 4, {}}) == Status::kDuplicateChannel);
+  // A slice used on port 3 is unavailable to every other port.
+  TWIN_CHECK(wss.add_channel({3, 5, 107, 1, {}}) == Status::kSliceConflict);
+  TWIN_CHECK(wss.add_channel({3, 3, 90, 11, {}}) == Status::kSliceConflict);
+  TWIN_CHECK(same_table(wss, two));
+  TWIN_CHECK(obs.changes == 2);
+
+  // Blocks that only touch are fine, up to the last slice.
+  TWIN_CHECK(wss.add_channel({3, 5, 112, 1, {}}) == Status::kOk);
+  TWIN_CHECK(wss.add_channel({4, 5, 764, 4, {}}) == Status::kOk);
+  TWIN_CHECK(wss.port_occupancy(5).count() == 5);
+
+  TWIN_CHECK(wss.delete_channel(9) == Status::kUnknownChannel);
+  TWIN_CHECK(wss.delete_channel(1) == Status::kOk);
+  TWIN_CHECK(wss.delete_channel(1) == Status::kUnknownChannel);
+  TWIN_CHECK(wss.port_occupancy(3).none());
+  // Its slices and id are free again, on any port.
+  TWIN_CHECK(wss.add_channel({1, 7, 100, 8, {}}) == Status::kOk);
+  TWIN_CHECK(obs.changes == 6);
+  TWIN_CHECK(wss.find(1)->port == 7);
+  wss.remove_observer(&obs);
+}
+
+void retune_and_attenuate() {
+  WssHalf wss;
+  Counter obs;
+  TWIN_CHECK(wss.add_channel({1, 1, 100, 8, {}}) == Status::kOk);
+  TWIN_CHECK(wss.add_channel({2, 2, 110, 4, {}}) == Status::kOk);
+  wss.add_observer(&obs);
+  const std::vector<ChannelSpec> before{{1, 1, 100, 8, {}}, {2, 2, 110, 4, {}}};
+
+  TWIN_CHECK(wss.retune_channel(9, 0, 4) == Status::kUnknownChannel);
+  TWIN_CHECK(wss.retune_channel(1, 766, 4) == Status::kInvalidRange);
+  TWIN_CHECK(wss.retune_channel(1, 100, 0) == Status::kInvalidRange);
+  // Growing into channel 2's first slice conflicts.
+  TWIN_CHECK(wss.retune_channel(1, 100, 11) == Status::kSliceConflict);
+  TWIN_CHECK(wss.set_attenuation(9, {}) == Status::kUnknownChannel);
+  TWIN_CHECK(wss.set_attenuation(1, Attenuation::from_tenths(-1)) ==
+             Status::kInvalidAttenuation);
+  TWIN_CHECK(same_table(wss, before));
+  TWIN_CHECK(obs.changes == 0);
+
+  // A channel's own slices never conflict with its new position.
+  TWIN_CHECK(wss.retune_channel(1, 101, 9) == Status::kOk);
+  TWIN_CHECK(wss.retune_channel(1, 98, 12) == Status::kOk);
+  TWIN_CHECK(wss.port_occupancy(1).count() == 12 && wss.port_occupancy(1).test(98));
+  TWIN_CHECK(!wss.common_occupancy().test(97) && wss.common_occupancy().test(109));
+  TWIN_CHECK(wss.set_attenuation(1, Attenuation::from_db(20.0)) == Status::kOk);
+  TWIN_CHECK(wss.find(1)->attenuation == kMaxAttenuation);
+  TWIN_CHECK(obs.changes == 3);
+  wss.remove_observer(&obs);
+}
+
+void plan_commit_is_atomic() {
+  WssHalf wss;
+  TWIN_CHECK(wss.add_channel({1, 1, 100, 8, {}}) == Status::kOk);
+  TWIN_CHECK(wss.add_channel({2, 2, 200, 8, {}}) == Status::kOk);
+  Counter obs;
+  wss.add_observer(&obs);
+  const std::vector<ChannelSpec> before{{1, 1, 100, 8, {}}, {2, 2, 200, 8, {}}};
+
+  // Each bad plan is good up to its last entry, and nothing is applied.
+  const std::vector<ChannelSpec> ok{{5, 1, 0, 4, {}}, {6, 2, 4, 4, {}}, {1, 3, 8, 4, {}}};
+  struct Bad {
+    ChannelSpec last;
+    Status want;
+  };
+  const Bad bad[] = {{{7, 0, 300, 4, {}}, Status::kInvalidPort},
+                     {{7, 1, 767, 2, {}}, Status::kInvalidRange},
+                     {{7, 1, 300, 4, Attenuation::from_tenths(201)}, Status::kInvalidAttenuation},
+                     {{5, 4, 300, 4, {}}, Status::kDuplicateChannel},
+                     {{7, 4, 7, 2, {}}, Status::kSliceConflict}};
+  for (const Bad& b : bad) {
+    std::vector<ChannelSpec> plan = ok;
+    plan.push_back(b.last);
+    TWIN_CHECK(WssHalf::validate_plan(plan) == b.want);
+    TWIN_CHECK(wss.commit_plan(plan) == b.want);
+    TWIN_CHECK(same_table(wss, before));
+  }
+  // More entries than slices can never fit.
+  std::vector<ChannelSpec> huge(kNumSlices + 1);
+  for (std::size_t i = 0; i < huge.size(); ++i) {
+    huge[i] = {static_cast<ChannelId>(i), 1, 0, 1, {}};
+  }
+  TWIN_CHECK(wss.commit_plan(huge) == Status::kTableFull);
+  TWIN_CHECK(obs.changes == 0 && obs.resets == 0);
+
+  // A good plan replaces the table, old ids included, with one reset.
+  TWIN_CHECK(WssHalf::validate_plan(ok) == Status::kOk);
+  TWIN_CHECK(wss.commit_plan(ok) == Status::kOk);
+  TWIN_CHECK(same_table(wss, ok));
+  TWIN_CHECK(!wss.find(2) && wss.port_occupancy(2).count() == 4);
+  TWIN_CHECK(obs.changes == 0 && obs.resets == 1);
+
+  // The same slice twice within the plan, and an empty plan.
+  const std::vector<ChannelSpec> overlap{{8, 1, 50, 4, {}}, {9, 20, 53, 4, {}}};
+  TWIN_CHECK(wss.commit_plan(overlap) == Status::kSliceConflict);
+  TWIN_CHECK(wss.commit_plan({}) == Status::kOk);
+  TWIN_CHECK(wss.num_channels() == 0 && wss.common_occupancy().none());
+  TWIN_CHECK(obs.resets == 2);
+  wss.remove_observer(&obs);
+}
+
+}  // namespace
+
+int main() {
+  add_and_delete();
+  retune_and_attenuate();
+  plan_commit_is_atomic();
+  return twin::test::test_result();
+}
@@ -0,0 +1,11 @@
+#pragma once
+
+#include <cstdint>
+
+// Counts calls into the global allocator. Linking alloc_count.cpp replaces
+// operator new/delete for the whole program, so it is only built into tools.
+namespace alloc_count {
+
+std::uint64_t allocations();
+
+}  // namespace alloc_count
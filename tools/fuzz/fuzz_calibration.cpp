@@ -0,0 +1,31 @@
+// Fuzz target for the calibration loader. A malformed file must be
+// reported at a line inside the input and must leave the target untouched.
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <string>
+#include <string_view>
+
+#include "twin/calibration.h"
+
+extern "C" int LLVMFuzzerTestOneInput(const std::uint8_t* data, std::size_t size) {
+  static twin::ThreadPool pool(1);
+  static twin::Calibration cal;
+  const std::string_view text(reinterpret_cast<const char*>(data), size);
+
+  const std::string serial = cal.serial;
+  const std::uint16_t probe = cal.insertion_loss[0][0][0];
+  const twin::CalibrationParse r = twin::parse_calibration_csv(text, cal, pool);
+  if (r.status == twin::Status::kOk) {
+    if (r.error_line != 0 || r.records > r.lines) std::abort();
+    return 0;
+  }
+  const auto lines = static_cast<std::size_t>(std::count(text.begin(), text.end(), '\n')) + 1;
+  if (r.status != twin::Status::kParseError || r.error_line == 0 || r.error_line > lines) {
+    std::abort();
+  }
+  if (cal.serial != serial || cal.insertion_loss[0][0][0] != probe) std::abort();
+  return 0;
+}
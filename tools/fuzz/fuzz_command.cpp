@@ -0,0 +1,41 @@
+// Fuzz target for the command parser. Every line of the input is parsed;
+// each accepted command must survive a format/parse round trip unchanged
+// and validate without touching module state.
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <string>
+#include <string_view>
+
+#include "twin/command.h"
+
+namespace {
+
+bool same(const twin::Command& a, const twin::Command& b) {
+  return a.kind == b.kind && a.half == b.half && a.module == b.module &&
+         a.channel == b.channel && a.port == b.port && a.first_slice == b.first_slice &&
+         a.num_slices == b.num_slices && a.attenuation == b.attenuation;
+}
+
+}  // namespace
+
+extern "C" int LLVMFuzzerTestOneInput(const std::uint8_t* data, std::size_t size) {
+  const std::string_view text(reinterpret_cast<const char*>(data), size);
+  std::string formatted;
+  std::size_t pos = 0;
+  while (pos <= text.size()) {
+    std::size_t eol = text.find('\n', pos);
+    if (eol == std::string_view::npos) eol = text.size();
+    twin::Command c;
+    if (twin::parse_command(text.substr(pos, eol - pos), c) == twin::Status::kOk) {
+      formatted.clear();
+      twin::format_command(c, formatted);
+      twin::Command back;
+      if (twin::parse_command(formatted, back) != twin::Status::kOk || !same(c, back)) std::abort();
+      twin::validate_command(c, 16);
+    }
+    pos = eol + 1;
+  }
+  return 0;
+}
@@ -0,0 +1,22 @@
+// Parse-only fuzz target for the command parser. Every line of the input is
+// parsed and nothing else, so the throughput driver measures the parser on
+// its own; fuzz_command.cpp adds the round-trip and validation checks.
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+#include "twin/command.h"
+
+extern "C" int LLVMFuzzerTestOneInput(const std::uint8_t* data, std::size_t size) {
+  const std::string_view text(reinterpret_cast<const char*>(data), size);
+  std::size_t pos = 0;
+  while (pos <= text.size()) {
+    std::size_t eol = text.find('\n', pos);
+    if (eol == std::string_view::npos) eol = text.size();
+    twin::Command c;
+    twin::parse_command(text.substr(pos, eol - pos), c);
+    pos = eol + 1;
+  }
+  return 0;
+}
@@ -0,0 +1,40 @@
+// Fuzz target for the plan validator. The input is read as raw ChannelSpec
+// records, the same bytes a checkpoint holds. validate_plan() and
+// commit_plan() must agree; a rejected plan leaves the half as it was and an
+// accepted one is reflected exactly in the tables.
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#include "twin/wss.h"
+
+extern "C" int LLVMFuzzerTestOneInput(const std::uint8_t* data, std::size_t size) {
+  std::vector<twin::ChannelSpec> plan(size / sizeof(twin::ChannelSpec));
+  if (!plan.empty()) std::memcpy(plan.data(), data, plan.size() * sizeof(twin::ChannelSpec));
+
+  twin::WssHalf wss;
+  wss.add_channel({1, 1, 0, 1, {}});
+  const twin::Status checked = twin::WssHalf::validate_plan(plan);
+  const twin::Status committed = wss.commit_plan(plan);
+  if (checked != committed) std::abort();
+
+  if (committed != twin::Status::kOk) {
+    if (wss.num_channels() != 1 || wss.find(1) == nullptr) std::abort();
+    return 0;
+  }
+  if (wss.num_channels() != plan.size()) std::abort();
+  int slices = 0;
+  for (const twin::ChannelSpec& spec : plan) {
+    const twin::Channel* ch = wss.find(spec.id);
+    if (ch == nullptr || ch->port != spec.port || ch->first_slice != spec.first_slice ||
+        ch->num_slices != spec.num_slices || ch->attenuation != spec.attenuation) {
+      std::abort();
+    }
+    slices += spec.num_slices;
+  }
+  if (wss.common_occupancy().count() != slices) std::abort();
+  return 0;
+}
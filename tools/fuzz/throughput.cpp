@@ -0,0 +1,106 @@
+// Throughput driver for the fuzz targets. Linked against one target in
+// place of libFuzzer, it loads a corpus into memory and replays it in a loop,
+// reporting executions and bytes per second:
+//
+//   twin-fuzz-<target> [--seconds S] [--min-execs N] <file | dir>...
+//
+// Directories are read one level deep. --min-execs fails the run (exit 1)
+// when fewer than N executions per second were reached, so a slow-down shows
+// up as a failure rather than only as a number.
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+extern "C" int LLVMFuzzerTestOneInput(const std::uint8_t* data, std::size_t size);
+
+namespace {
+
+void usage() {
+  std::fprintf(stderr, "usage: twin-fuzz-<target> [--seconds S] [--min-execs N] <file | dir>...\n");
+}
+
+bool read_file(const std::filesystem::path& path, std::vector<std::string>& out) {
+  std::ifstream in(path, std::ios::binary);
+  if (!in) return false;
+  out.emplace_back(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+  return true;
+}
+
+bool load(const char* arg, std::vector<std::string>& out) {
+  const std::filesystem::path path(arg);
+  std::error_code ec;
+  if (!std::filesystem::is_directory(path, ec)) return read_file(path, out);
+  std::vector<std::filesystem::path> files;
+  for (const auto& e : std::filesystem::directory_iterator(path, ec)) {
+    if (e.is_regular_file()) files.push_back(e.path());
+  }
+  // Sorted so the replay order, and hence the timing, does not depend on
+  // the file system.
+  std::sort(files.begin(), files.end());
+  for (const auto& f : files) {
+    if (!read_file(f, out)) return false;
+  }
+  return !ec;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  double seconds = 1.0;
+  double min_execs = 0.0;
+  std::vector<std::string> corpus;
+  for (int i = 1; i < argc; ++i) {
+    if (std::strcmp(argv[i], "--seconds") == 0 && i + 1 < argc) {
+      seconds = std::strtod(argv[++i], nullptr);
+    } else if (std::strcmp(argv[i], "--min-execs") == 0 && i + 1 < argc) {
+      min_execs = std::strtod(argv[++i], nullptr);
+    } else if (argv[i][0] == '-') {
+      usage();
+      return 2;
+    } else if (!load(argv[i], corpus)) {
+      std::fprintf(stderr, "cannot read %s\n", argv[i]);
+      return 2;
+    }
+  }
+  if (corpus.empty()) {
+    usage();
+    return 2;
+  }
+
+  using Clock = std::chrono::steady_clock;
+  std::uint64_t execs = 0;
+  std::uint64_t bytes = 0;
+  const Clock::time_point start = Clock::now();
+  const Clock::time_point deadline =
+      start + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(seconds));
+  Clock::time_point now = start;
+  do {
+    for (const std::string& input : corpus) {
+      LLVMFuzzerTestOneInput(reinterpret_cast<const std::uint8_t*>(input.data()), input.size());
+      bytes += input.size();
+    }
+    execs += corpus.size();
+    now = Clock::now();
+  } while (now < deadline);
+
+  const double elapsed = std::chrono::duration<double>(now - start).count();
+  const double rate = static_cast<double>(execs) / elapsed;
+  std::printf("inputs %zu, execs %llu in %.3f s, %.0f execs/s, %.1f MB/s\n", corpus.size(),
+              static_cast<unsigned long long>(execs), elapsed, rate,
+              static_cast<double>(bytes) / elapsed / 1e6);
+  if (rate < min_execs) {
+    std::printf("below --min-execs %.0f\n", min_execs);
+    return 1;
+  }
+  return 0;
+}
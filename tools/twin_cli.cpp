@@ -0,0 +1,206 @@
+// Headless driver: runs a twin script in batch and reports timing.
+//
+//   twin-cli [--repeat N] [--quiet] [--json] [--no-metrics] [--alloc-check]
+//            [--variation UNITS [--seed S]] [--threads N] [--load CKPT]
+//            [--save CKPT] <script | ->
+//
+// --load starts from a checkpoint instead of empty modules; --save writes
+// the final pool (see twin/checkpoint.h).
+//
+// --alloc-check treats the first run as warm-up and fails (exit 1) if any
+// later run allocates from the heap.
+//
+// --variation qualifies each module's final plan against UNITS sampled
+// manufacturing units (see twin/variation.h). --threads sizes its pool
+// (default: all cores); the report is bit-identical for any N, so runs can
+// be diffed across machines.
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+#include "alloc_count.h"
+#include "twin/calibration.h"
+#include "twin/checkpoint.h"
+#include "twin/latency.h"
+#include "twin/module.h"
+#include "twin/script.h"
+#include "twin/thread_pool.h"
+#include "twin/variation.h"
+
+namespace {
+
+void usage() {
+  std::fprintf(stderr,
+               "usage: twin-cli [--repeat N] [--quiet] [--json] [--no-metrics] [--alloc-check]\n"
+               "                [--variation UNITS [--seed S]] [--threads N] [--load CKPT]\n"
+               "                [--save CKPT] <script | ->\n");
+}
+
+bool read_all(const char* path, std::string& out) {
+  if (std::strcmp(path, "-") == 0) {
+    out.assign(std::istreambuf_iterator<char>(std::cin), std::istreambuf_iterator<char>());
+    return true;
+  }
+  std::ifstream in(path, std::ios::binary);
+  if (!in) return false;
+  out.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+  return true;
+}
+
+void report_variation(const std::vector<twin::TwinModule>& modules, std::size_t units,
+                      std::uint64_t seed, std::size_t threads) {
+  twin::VariationConfig config;
+  config.seed = seed;
+  const twin::VariationSweep sweep(config);
+  twin::ThreadPool pool(threads);
+  for (const twin::TwinModule& m : modules) {
+    if (m.half(twin::Half::kA).num_channels() + m.half(twin::Half::kB).num_channels() == 0) continue;
+    const auto t0 = std::chrono::steady_clock::now();
+    const twin::SweepResult r = sweep.run(m, units, pool);
+    const double secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+    std::fprintf(stderr,
+                 "variation %s: %zu units, yield %.2f%%, worst loss mean %.2f dB max %.2f dB, "
+                 "ripple max %.2f dB (%.3f s)\n",
+                 m.serial().c_str(), r.units, 100.0 * r.yield(), r.mean_worst_loss_db,
+                 r.max_worst_loss_db, r.max_ripple_db, secs);
+    for (std::size_t c = 0; c < r.channels.size(); ++c) {
+      if (r.channel_failures[c] == 0) continue;
+      std::fprintf(stderr, "  %s ch %u failed on %u units\n", twin::to_string(r.channels[c].first),
+                   r.channels[c].second, r.channel_failures[c]);
+    }
+  }
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  unsigned long repeat = 1;
+  bool quiet = false;
+  bool json = false;
+  const char* path = nullptr;
+  std::size_t variation_units = 0;
+  std::uint64_t seed = 1;
+  std::size_t threads = 0;
+  bool alloc_check = false;
+  const char* load_path = nullptr;
+  const char* save_path = nullptr;
+
+  for (int i = 1; i < argc; ++i) {
+    if (std::strcmp(argv[i], "--repeat") == 0 && i + 1 < argc) {
+      repeat = std::strtoul(argv[++i], nullptr, 10);
+    } else if (std::strcmp(argv[i], "--quiet") == 0) {
+      quiet = true;
+    } else if (std::strcmp(argv[i], "--json") == 0) {
+      json = true;
+    } else if (std::strcmp(argv[i], "--variation") == 0 && i + 1 < argc) {
+      variation_units = std::strtoul(argv[++i], nullptr, 10);
+    } else if (std::strcmp(argv[i], "--seed") == 0 && i + 1 < argc) {
+      seed = std::strtoull(argv[++i], nullptr, 10);
+    } else if (std::strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+      threads = std::strtoul(argv[++i], nullptr, 10);
+    } else if (std::strcmp(argv[i], "--load") == 0 && i + 1 < argc) {
+      load_path = argv[++i];
+    } else if (std::strcmp(argv[i], "--save") == 0 && i + 1 < argc) {
+      save_path = argv[++i];
+    } else if (std::strcmp(argv[i], "--alloc-check") == 0) {
+      alloc_check = true;
+    } else if (std::strcmp(argv[i], "--no-metrics") == 0) {
+      twin::metrics::set_enabled(false);
+    } else if (argv[i][0] == '-' && argv[i][1] != '\0') {
+      usage();
+      return 2;
+    } else {
+      path = argv[i];
+    }
+  }
+  if (path == nullptr) {
+    usage();
+    return 2;
+  }
+
+  std::string text;
+  if (!read_all(path, text)) {
+    std::fprintf(stderr, "twin-cli: cannot read %s\n", path);
+    return 2;
+  }
+  twin::Script script;
+  twin::ScriptError err;
+  if (twin::parse_script(text, script, err) != twin::Status::kOk) {
+    std::fprintf(stderr, "%s:%u: %s\n", path, err.line, err.message.c_str());
+    return 2;
+  }
+
+  std::vector<twin::TwinModule> modules;
+  if (load_path) {
+    twin::MappedCheckpoint ckpt;
+    twin::CalibrationCache calibrations;
+    twin::Status s = ckpt.open(load_path);
+    if (s == twin::Status::kOk) s = twin::load_checkpoint(ckpt.bytes(), modules, calibrations);
+    if (s != twin::Status::kOk) {
+      std::fprintf(stderr, "twin-cli: cannot load %s: %s\n", load_path, twin::to_string(s));
+      return 2;
+    }
+  }
+  modules.reserve(std::max<std::size_t>(modules.size(), script.modules));
+  for (std::size_t i = modules.size(); i < script.modules; ++i) {
+    modules.emplace_back("twin-" + std::to_string(i));
+  }
+
+  twin::metrics::reset();
+  twin::ScriptRunner runner(script, stdout, !quiet);
+  twin::ScriptStats stats;
+  std::uint64_t warm_allocs = 0;
+  if (alloc_check) {
+    runner.run(modules, stats);
+    warm_allocs = alloc_count::allocations();
+  }
+  const auto t0 = std::chrono::steady_clock::now();
+  for (unsigned long r = 0; r < repeat; ++r) runner.run(modules, stats);
+  const std::uint64_t steady_allocs = alloc_count::allocations() - warm_allocs;
+  const double secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+  const double rate = secs > 0 ? static_cast<double>(stats.commands) / secs : 0.0;
+
+  if (json) {
+    std::fprintf(stderr,
+                 "{\"commands\":%llu,\"failed_commands\":%llu,\"assertions\":%llu,"
+                 "\"failed_assertions\":%llu,\"seconds\":%.6f,\"commands_per_sec\":%.0f,"
+                 "\"latency\":%s}\n",
+                 static_cast<unsigned long long>(stats.commands),
+                 static_cast<unsigned long long>(stats.failed_commands),
+                 static_cast<unsigned long long>(stats.assertions),
+                 static_cast<unsigned long long>(stats.failed_assertions), secs, rate,
+                 twin::metrics::report_json().c_str());
+  } else {
+    std::fprintf(stderr,
+                 "commands %llu (%llu failed), assertions %llu (%llu failed)\n"
+                 "wall %.3f s, %.0f commands/s\n%s",
+                 static_cast<unsigned long long>(stats.commands),
+                 static_cast<unsigned long long>(stats.failed_commands),
+                 static_cast<unsigned long long>(stats.assertions),
+                 static_cast<unsigned long long>(stats.failed_assertions), secs, rate,
+                 twin::metrics::enabled() ? twin::metrics::report_text().c_str() : "");
+  }
+  if (alloc_check) {
+    std::fprintf(stderr, "steady-state heap allocations: %llu over %lu runs\n",
+                 static_cast<unsigned long long>(steady_allocs), repeat);
+  }
+  if (save_path) {
+    std::vector<std::byte> blob;
+    twin::save_checkpoint(modules, blob);
+    if (twin::write_checkpoint_file(save_path, blob) != twin::Status::kOk) {
+      std::fprintf(stderr, "twin-cli: cannot write %s\n", save_path);
+      return 2;
+    }
+  }
+  if (variation_units > 0) report_variation(modules, variation_units, seed, threads);
+  const bool alloc_failed = alloc_check && steady_allocs != 0;
+  return stats.failed_assertions == 0 && !alloc_failed ? 0 : 1;
+}